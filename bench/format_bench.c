@@ -0,0 +1,104 @@
+/* Number formatting microbenchmark: snprintf("%.*f") versus out_fixed() in
+   src/sentinel.c. Every value is formatted both ways first; the benchmark
+   aborts on the first string that differs.
+
+   cc -std=c11 -O2 -pthread -o format-bench bench/format_bench.c
+   ./format-bench [values] [repeats]
+*/
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "../src/sentinel.c"
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t g_state = 0x9E3779B97F4A7C15ull;
+
+static uint64_t next_random(void) {
+  g_state ^= g_state << 13;
+  g_state ^= g_state >> 7;
+  g_state ^= g_state << 17;
+  return g_state;
+}
+
+/* Report-like values, exact ties at every precision, and arbitrary bit
+   patterns, negative ones included. */
+static double sample_value(long i) {
+  double unit = (double)(next_random() >> 11) / 9007199254740992.0;
+  switch (i % 6) {
+    case 0: return unit;
+    case 1: return 1.0 + 4.0 * unit;
+    case 2: return (double)(next_random() % 200000) / 8.0;
+    case 3: return -unit * 1000.0;
+    case 4: return unit * 1e12;
+    default: {
+      uint64_t bits = next_random();
+      double v;
+      memcpy(&v, &bits, sizeof(v));
+      return v;
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  long count = argc > 1 ? atol(argv[1]) : 2000000;
+  int repeats = argc > 2 ? atoi(argv[2]) : 3;
+  if (count < 1) count = 1;
+  if (repeats < 1) repeats = 1;
+  double *values = (double *)malloc(sizeof(double) * (size_t)count);
+  OutBuf out;
+  if (!values || !out_open(&out, "/dev/null")) {
+    fprintf(stderr, "Failed to set up the benchmark.\n");
+    return 1;
+  }
+  for (long i = 0; i < count; i++) values[i] = sample_value(i);
+
+  for (int decimals = 0; decimals <= 9; decimals++) {
+    for (long i = 0; i < count; i++) {
+      char expected[512];
+      snprintf(expected, sizeof(expected), "%.*f", decimals, values[i]);
+      out.len = 0;
+      out_fixed(&out, values[i], decimals);
+      if (out.len != strlen(expected) || memcmp(out.buf, expected, out.len) != 0) {
+        fprintf(stderr, "out_fixed(%.17g, %d) gave \"%.*s\", printf gives \"%s\".\n", values[i], decimals,
+                (int)out.len, out.buf, expected);
+        return 1;
+      }
+    }
+  }
+  out.len = 0;
+  printf("checked %ld values at 0-9 decimals\n", count);
+
+  /* Timed on the report-like values only, at the report's precision. */
+  long timed = 0;
+  for (long i = 0; i < count; i++) {
+    if (i % 6 < 4) values[timed++] = values[i];
+  }
+  printf("%-10s %12s %10s\n", "formatter", "Mvalues/s", "speedup");
+  double printf_best = 0;
+  for (int variant = 0; variant < 2; variant++) {
+    double best = 0;
+    for (int r = 0; r < repeats; r++) {
+      double t0 = bench_now();
+      for (long i = 0; i < timed; i++) {
+        if (variant == 0) {
+          out_printf(&out, "%.2f", values[i]);
+        } else {
+          out_fixed(&out, values[i], 2);
+        }
+        out_char(&out, '\n');
+      }
+      out_flush(&out);
+      double elapsed = bench_now() - t0;
+      if (best == 0 || elapsed < best) best = elapsed;
+    }
+    if (variant == 0) printf_best = best;
+    printf("%-10s %12.1f %9.2fx\n", variant == 0 ? "printf" : "out_fixed", (double)timed / best / 1e6,
+           printf_best / best);
+  }
+  out_close(&out);
+  free(values);
+  return 0;
+}
@@ -0,0 +1,161 @@
+/* Reproducible synthetic cohort CSVs for benchmarking. The same options and
+   seed always produce the same bytes.
+
+   cc -std=c11 -O2 -o gen-cohort-csv bench/gen_cohort_csv.c
+   ./gen-cohort-csv --rows 1000000 --cohorts 500 --invalid-ratio 0.02 \
+       --date-spread 120 --as-of 2026-03-01 --seed 7 --output big.csv
+*/
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t g_state = 1;
+
+static uint64_t next_random(void) {
+  /* splitmix64 */
+  uint64_t z = (g_state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static unsigned random_below(unsigned n) {
+  return n ? (unsigned)(next_random() % n) : 0;
+}
+
+static double random_unit(void) {
+  return (double)(next_random() >> 11) / 9007199254740992.0;
+}
+
+static int days_from_civil(int y, int m, int d) {
+  y -= m <= 2;
+  int era = (y >= 0 ? y : y - 399) / 400;
+  int yoe = y - era * 400;
+  int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+static void civil_from_days(int z, int *y, int *m, int *d) {
+  z += 719468;
+  int era = (z >= 0 ? z : z - 146096) / 146097;
+  int doe = z - era * 146097;
+  int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int mp = (5 * doy + 2) / 153;
+  *d = doy - (153 * mp + 2) / 5 + 1;
+  *m = mp + (mp < 10 ? 3 : -9);
+  *y = yoe + era * 400 + (*m <= 2);
+}
+
+static void usage(const char *name) {
+  printf("Usage: %s [options]\n", name);
+  printf("  --rows N            Data rows to write (default 100000)\n");
+  printf("  --cohorts N         Distinct cohort names (default 200)\n");
+  printf("  --invalid-ratio R   Share of rows that fail validation, 0-1 (default 0.02)\n");
+  printf("  --date-spread DAYS  Touchpoints fall in the DAYS before --as-of (default 90)\n");
+  printf("  --as-of YYYY-MM-DD  Anchor date for touchpoints (default 2026-03-01)\n");
+  printf("  --seed N            PRNG seed (default 1)\n");
+  printf("  --output PATH       Write to PATH instead of stdout\n");
+}
+
+/* Writes one row that the sentinel rejects, cycling through the invalid
+   categories it reports separately. */
+static void write_invalid_row(FILE *out, long row, const char *cohort, const char *date) {
+  switch (random_below(5)) {
+    case 0:
+      fprintf(out, "S-%07ld,%s,%s\n", row, cohort, date);
+      break;
+    case 1:
+      fprintf(out, "S-%07ld,%s,%s,n/a,0.75,4.0\n", row, cohort, date);
+      break;
+    case 2:
+      fprintf(out, "S-%07ld,%s,%.*s/%s,2,0.75,4.0\n", row, cohort, 4, date, date + 5);
+      break;
+    case 3:
+      fprintf(out, "S-%07ld,%s,%s,2,1.40,4.0\n", row, cohort, date);
+      break;
+    default:
+      fprintf(out, " ,%s,%s,2,0.75,4.0\n", cohort, date);
+      break;
+  }
+}
+
+int main(int argc, char **argv) {
+  long rows = 100000;
+  int cohorts = 200;
+  double invalid_ratio = 0.02;
+  int date_spread = 90;
+  const char *as_of = "2026-03-01";
+  unsigned long long seed = 1;
+  const char *output = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--rows") == 0 && i + 1 < argc) {
+      rows = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--cohorts") == 0 && i + 1 < argc) {
+      cohorts = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--invalid-ratio") == 0 && i + 1 < argc) {
+      invalid_ratio = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--date-spread") == 0 && i + 1 < argc) {
+      date_spread = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--as-of") == 0 && i + 1 < argc) {
+      as_of = argv[++i];
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+      usage(argv[0]);
+      return 0;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  int y = 0;
+  int m = 0;
+  int d = 0;
+  if (rows < 0 || cohorts < 1 || date_spread < 0 || invalid_ratio < 0 || invalid_ratio > 1 ||
+      sscanf(as_of, "%4d-%2d-%2d", &y, &m, &d) != 3) {
+    fprintf(stderr, "Invalid generator options.\n");
+    return 1;
+  }
+  int as_of_day = days_from_civil(y, m, d);
+  g_state = seed;
+
+  FILE *out = output ? fopen(output, "w") : stdout;
+  if (!out) {
+    perror("Failed to open output file");
+    return 1;
+  }
+
+  fprintf(out, "scholar_id,cohort,last_touchpoint_date,touchpoints_last_30d,attendance_rate,satisfaction_score\n");
+  for (long row = 1; row <= rows; row++) {
+    char cohort[32];
+    char date[32];
+    snprintf(cohort, sizeof(cohort), "Cohort-%05u", random_below((unsigned)cohorts) + 1);
+    civil_from_days(as_of_day - (int)random_below((unsigned)date_spread + 1), &y, &m, &d);
+    snprintf(date, sizeof(date), "%04d-%02d-%02d", y, m, d);
+
+    if (random_unit() < invalid_ratio) {
+      write_invalid_row(out, row, cohort, date);
+      continue;
+    }
+
+    /* Skew toward engaged scholars so every risk band is populated. */
+    int touchpoints = (int)random_below(9);
+    double attendance = 0.35 + 0.65 * (1.0 - random_unit() * random_unit());
+    double satisfaction = 1.0 + 4.0 * (1.0 - random_unit() * random_unit());
+    fprintf(out, "S-%07ld,%s,%s,%d,%.2f,%.1f\n", row, cohort, date, touchpoints, attendance, satisfaction);
+  }
+
+  if (out != stdout && fclose(out) != 0) {
+    perror("Failed to write output file");
+    return 1;
+  }
+  return 0;
+}
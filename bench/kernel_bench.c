@@ -0,0 +1,277 @@
+/* Scoring kernel cross-check and microbenchmark: the original if/else risk
+   rules versus every score_kernel_* variant in src/sentinel.c, both the kernels
+   specialized for the default profile and the generic ones that read a
+   ScoringProfile at run time. The generic kernels are also checked with a
+   custom profile against the same rules written over a profile. Inputs
+   lean on the exact threshold values; any difference in days_since, score,
+   tier or a bucket counter aborts.
+
+   cc -std=c11 -O2 -pthread -o kernel-bench bench/kernel_bench.c
+   ./kernel-bench [rows] [repeats]
+*/
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "../src/sentinel.c"
+
+/* The scoring rules as they were written before the kernels. */
+static int legacy_risk_score(int days_since, int touchpoints, double attendance, double satisfaction) {
+  int score = 0;
+  if (days_since > 30) score += 3;
+  else if (days_since > 14) score += 2;
+  else if (days_since > 7) score += 1;
+
+  if (touchpoints == 0) score += 2;
+  else if (touchpoints <= 1) score += 1;
+
+  if (attendance < 0.6) score += 2;
+  else if (attendance < 0.8) score += 1;
+
+  if (satisfaction < 3.0) score += 2;
+  else if (satisfaction < 4.0) score += 1;
+
+  return score;
+}
+
+static const char *legacy_risk_label(int score) {
+  if (score >= 6) return "high";
+  if (score >= 3) return "medium";
+  return "low";
+}
+
+static void legacy_score(const ScoreBlock *b, int n, int counts[KC_COUNT]) {
+  for (int i = 0; i < n; i++) {
+    int d = b->as_of_day - b->days[i];
+    int future = 0;
+    if (d < 0) {
+      future = 1;
+      d = 0;
+    }
+    int tp = b->touchpoints[i];
+    double a = b->attendance[i];
+    double s = b->satisfaction[i];
+    int score = legacy_risk_score(d, tp, a, s);
+    const char *label = legacy_risk_label(score);
+    b->days_since[i] = d;
+    b->scores[i] = score;
+    b->tiers[i] = strcmp(label, "high") == 0 ? TIER_HIGH : strcmp(label, "medium") == 0 ? TIER_MEDIUM : TIER_LOW;
+    if (!b->eligible[i]) continue;
+    counts[KC_FUTURE] += future;
+    if (d > 30) counts[KC_RECENCY_OVER_30]++;
+    else if (d > 14) counts[KC_RECENCY_15_30]++;
+    else if (d > 7) counts[KC_RECENCY_8_14]++;
+    if (tp == 0) counts[KC_TOUCHPOINTS_ZERO]++;
+    else if (tp <= 1) counts[KC_TOUCHPOINTS_ONE]++;
+    if (a < 0.6) counts[KC_ATTENDANCE_LOW]++;
+    else if (a < 0.8) counts[KC_ATTENDANCE_MID]++;
+    if (s < 3.0) counts[KC_SATISFACTION_LOW]++;
+    else if (s < 4.0) counts[KC_SATISFACTION_MID]++;
+    if (strcmp(label, "high") == 0) counts[KC_HIGH]++;
+    else if (strcmp(label, "medium") == 0) counts[KC_MEDIUM]++;
+    else counts[KC_LOW]++;
+  }
+}
+
+/* legacy_score with every threshold read from a profile. */
+static void legacy_profile_score(const ScoreBlock *b, int n, int counts[KC_COUNT]) {
+  const ScoringProfile *p = b->profile;
+  for (int i = 0; i < n; i++) {
+    int d = b->as_of_day - b->days[i];
+    int future = 0;
+    if (d < 0) {
+      future = 1;
+      d = 0;
+    }
+    int tp = b->touchpoints[i];
+    double a = b->attendance[i];
+    double s = b->satisfaction[i];
+    int score = 0;
+    int bucket[4] = {-1, -1, -1, -1};
+    for (int k = 2; k >= 0 && bucket[0] < 0; k--) {
+      if (d > p->recency_days[k]) bucket[0] = k;
+    }
+    for (int k = 1; k >= 0 && bucket[1] < 0; k--) {
+      if (tp <= p->touchpoints_at_most[k]) bucket[1] = k;
+    }
+    for (int k = 1; k >= 0 && bucket[2] < 0; k--) {
+      if (a < p->attendance_below[k]) bucket[2] = k;
+    }
+    for (int k = 1; k >= 0 && bucket[3] < 0; k--) {
+      if (s < p->satisfaction_below[k]) bucket[3] = k;
+    }
+    if (bucket[0] >= 0) score += p->recency_points[bucket[0]];
+    if (bucket[1] >= 0) score += p->touchpoints_points[bucket[1]];
+    if (bucket[2] >= 0) score += p->attendance_points[bucket[2]];
+    if (bucket[3] >= 0) score += p->satisfaction_points[bucket[3]];
+    int tier = score >= p->high_at ? TIER_HIGH : score >= p->medium_at ? TIER_MEDIUM : TIER_LOW;
+    b->days_since[i] = d;
+    b->scores[i] = score;
+    b->tiers[i] = tier;
+    if (!b->eligible[i]) continue;
+    counts[KC_FUTURE] += future;
+    if (bucket[0] == 2) counts[KC_RECENCY_OVER_30]++;
+    else if (bucket[0] == 1) counts[KC_RECENCY_15_30]++;
+    else if (bucket[0] == 0) counts[KC_RECENCY_8_14]++;
+    if (bucket[1] == 1) counts[KC_TOUCHPOINTS_ZERO]++;
+    else if (bucket[1] == 0) counts[KC_TOUCHPOINTS_ONE]++;
+    if (bucket[2] == 1) counts[KC_ATTENDANCE_LOW]++;
+    else if (bucket[2] == 0) counts[KC_ATTENDANCE_MID]++;
+    if (bucket[3] == 1) counts[KC_SATISFACTION_LOW]++;
+    else if (bucket[3] == 0) counts[KC_SATISFACTION_MID]++;
+    if (tier == TIER_HIGH) counts[KC_HIGH]++;
+    else if (tier == TIER_MEDIUM) counts[KC_MEDIUM]++;
+    else counts[KC_LOW]++;
+  }
+}
+
+static uint64_t g_state = 0x2545F4914F6CDD1Dull;
+
+static uint32_t next_random(void) {
+  g_state ^= g_state << 13;
+  g_state ^= g_state >> 7;
+  g_state ^= g_state << 17;
+  return (uint32_t)(g_state >> 32);
+}
+
+static double pick_double(const double *edges, int edge_count, double lo, double hi) {
+  if (next_random() % 3 == 0) return edges[next_random() % (uint32_t)edge_count];
+  return lo + (hi - lo) * (next_random() / 4294967296.0);
+}
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+  int rows = argc > 1 ? atoi(argv[1]) : 4000000;
+  int repeats = argc > 2 ? atoi(argv[2]) : 5;
+  if (rows < 1) rows = 1;
+  if (repeats < 1) repeats = 1;
+
+  const int as_of = days_from_civil(2026, 3, 1);
+  const int day_edges[] = {-3, -1, 0, 1, 7, 8, 14, 15, 30, 31, 200};
+  const double attendance_edges[] = {0.0, 0.5999999999999999, 0.6, 0.6000000000000001, 0.7999999999999999, 0.8, 1.0};
+  const double satisfaction_edges[] = {1.0, 2.9999999999999996, 3.0, 3.0000000000000004, 3.9999999999999996, 4.0, 5.0};
+
+  int *days = (int *)malloc(sizeof(int) * (size_t)rows);
+  int *tp = (int *)malloc(sizeof(int) * (size_t)rows);
+  double *att = (double *)malloc(sizeof(double) * (size_t)rows);
+  double *sat = (double *)malloc(sizeof(double) * (size_t)rows);
+  unsigned char *eligible = (unsigned char *)malloc((size_t)rows);
+  int *out[2][3];
+  for (int k = 0; k < 2; k++) {
+    for (int j = 0; j < 3; j++) out[k][j] = (int *)malloc(sizeof(int) * (size_t)rows);
+  }
+  if (!days || !tp || !att || !sat || !eligible || !out[0][0] || !out[0][1] || !out[0][2] ||
+      !out[1][0] || !out[1][1] || !out[1][2]) {
+    fprintf(stderr, "Failed to allocate kernel inputs.\n");
+    return 1;
+  }
+  for (int i = 0; i < rows; i++) {
+    int gap = next_random() % 2 ? day_edges[next_random() % 11] : (int)(next_random() % 90) - 5;
+    days[i] = as_of - gap;
+    tp[i] = (int)(next_random() % 7);
+    att[i] = pick_double(attendance_edges, 7, 0.0, 1.0);
+    sat[i] = pick_double(satisfaction_edges, 7, 1.0, 5.0);
+    eligible[i] = next_random() % 8 != 0;
+  }
+
+  /* Bounds sit on the same edge values as the default profile, shifted, so
+     the custom pass still lands rows exactly on every threshold. */
+  ScoringProfile custom = k_default_profile;
+  snprintf(custom.name, sizeof(custom.name), "custom");
+  const int custom_days[] = {0, 8, 15};
+  const int custom_points[] = {2, 3, 5};
+  memcpy(custom.recency_days, custom_days, sizeof(custom_days));
+  memcpy(custom.recency_points, custom_points, sizeof(custom_points));
+  custom.touchpoints_at_most[0] = 3;
+  custom.touchpoints_at_most[1] = 1;
+  custom.touchpoints_points[0] = 0;
+  custom.touchpoints_points[1] = 4;
+  custom.attendance_below[0] = 0.6;
+  custom.attendance_below[1] = 0.5999999999999999;
+  custom.attendance_points[0] = 2;
+  custom.attendance_points[1] = 2;
+  custom.satisfaction_below[0] = 3.0000000000000004;
+  custom.satisfaction_below[1] = 1.0;
+  custom.satisfaction_points[0] = 1;
+  custom.satisfaction_points[1] = 7;
+  custom.medium_at = 5;
+  custom.high_at = 9;
+
+  const ScoringProfile *profiles[] = {&k_default_profile, &custom};
+  const char *names[] = {"legacy", "scalar", "sse2", "avx2", "neon"};
+  printf("rows: %d\n", rows);
+  for (int pass = 0; pass < 2; pass++) {
+    ScoreBlock ref = {as_of, days, tp, att, sat, eligible, out[0][0], out[0][1], out[0][2], profiles[pass]};
+    ScoreBlock got = {as_of, days, tp, att, sat, eligible, out[1][0], out[1][1], out[1][2], profiles[pass]};
+    int ref_counts[KC_COUNT] = {0};
+    if (pass == 0) {
+      legacy_score(&ref, rows, ref_counts);
+    } else {
+      legacy_profile_score(&ref, rows, ref_counts);
+    }
+
+    printf("\n%s profile\n", profiles[pass]->name);
+    printf("%-16s %12s %10s\n", "kernel", "Mrows/s", "speedup");
+    double legacy_best = 0;
+    for (size_t n = 0; n < sizeof(names) / sizeof(names[0]); n++) {
+      /* The specialized kernels only apply to the default profile. */
+      int first = n == 0 ? 0 : pass;
+      int last = n == 0 ? 0 : 1;
+      for (int generic = first; generic <= last; generic++) {
+        ScoreKernelFn kernel = n == 0 ? NULL : score_kernel_named(names[n], generic);
+        if (n > 0 && !kernel) continue;
+        char label[32];
+        snprintf(label, sizeof(label), "%s%s", names[n], generic ? " (generic)" : "");
+        double best = 0;
+        for (int r = 0; r < repeats; r++) {
+          int counts[KC_COUNT] = {0};
+          double t0 = bench_now();
+          if (!kernel) {
+            if (pass == 0) {
+              legacy_score(&got, rows, counts);
+            } else {
+              legacy_profile_score(&got, rows, counts);
+            }
+          } else {
+            /* Uneven block edges exercise every vector tail. */
+            for (int start = 0; start < rows;) {
+              int end = start + SCORE_BLOCK - (start % 7);
+              if (end > rows) end = rows;
+              kernel(&got, start, end, counts);
+              start = end;
+            }
+          }
+          double elapsed = bench_now() - t0;
+          if (memcmp(counts, ref_counts, sizeof(counts)) != 0) {
+            fprintf(stderr, "%s kernel counters differ from the reference (%s profile).\n", label,
+                    profiles[pass]->name);
+            return 1;
+          }
+          for (int j = 0; j < 3; j++) {
+            if (memcmp(out[0][j], out[1][j], sizeof(int) * (size_t)rows) != 0) {
+              fprintf(stderr, "%s kernel %s differ from the reference (%s profile).\n", label,
+                      j == 0 ? "days_since values" : j == 1 ? "scores" : "tiers", profiles[pass]->name);
+              return 1;
+            }
+          }
+          memset(out[1][1], 0xff, sizeof(int) * (size_t)rows);
+          if (r == 0 || elapsed < best) best = elapsed;
+        }
+        if (n == 0) legacy_best = best;
+        printf("%-16s %12.1f %9.2fx\n", label, rows / best / 1e6, legacy_best / best);
+      }
+    }
+  }
+
+  for (int k = 0; k < 2; k++) {
+    for (int j = 0; j < 3; j++) free(out[k][j]);
+  }
+  free(days);
+  free(tp);
+  free(att);
+  free(sat);
+  free(eligible);
+  return 0;
+}
@@ -0,0 +1,160 @@
+/* Tokenizer microbenchmark: the original fgets/strtok_r/trim loop versus the
+   row scanners in src/sentinel.c. Every variant must produce the same fields;
+   the benchmark aborts if any checksum differs.
+
+   cc -std=c11 -O2 -pthread -o scan-bench bench/scan_bench.c
+   ./scan-bench [rows | file.csv] [repeats]
+*/
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "../src/sentinel.c"
+
+typedef struct {
+  uint64_t fields;
+  uint64_t bytes;
+  uint64_t mix;
+} ScanChecksum;
+
+static void checksum_field(ScanChecksum *sum, int row, int col, const char *ptr, size_t len) {
+  sum->fields++;
+  sum->bytes += len;
+  uint64_t h = hash_name(ptr, len);
+  sum->mix += h * (uint64_t)(row * 7 + col + 1);
+}
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* The ingest loop as it was before the row scanners: copy each line into a
+   fixed buffer, strtok_r on commas, then trim() every field in place. */
+static ScanChecksum scan_legacy(const char *data, size_t len) {
+  ScanChecksum sum = {0, 0, 0};
+  char line[2048];
+  size_t pos = 0;
+  int row = 0;
+  while (pos < len) {
+    const char *nl = (const char *)memchr(data + pos, '\n', len - pos);
+    size_t line_len = nl ? (size_t)(nl - (data + pos)) + 1 : len - pos;
+    size_t copy = line_len < sizeof(line) ? line_len : sizeof(line) - 1;
+    memcpy(line, data + pos, copy);
+    line[copy] = '\0';
+    pos += line_len;
+
+    char *token;
+    char *rest = line;
+    char *fields[6];
+    int field_count = 0;
+    while ((token = strtok_r(rest, ",", &rest)) && field_count < 6) {
+      fields[field_count++] = token;
+    }
+    for (int i = 0; i < field_count; i++) {
+      trim(fields[i]);
+      checksum_field(&sum, row, i, fields[i], strlen(fields[i]));
+    }
+    row++;
+  }
+  return sum;
+}
+
+static ScanChecksum scan_with(ScanLineFn scan, const char *data, size_t len) {
+  ScanChecksum sum = {0, 0, 0};
+  size_t pos = 0;
+  StrView line;
+  StrView fields[6];
+  int field_count = 0;
+  int row = 0;
+  while (scan(data, len, &pos, &line, fields, &field_count)) {
+    for (int i = 0; i < field_count; i++) {
+      StrView f = trim_view(fields[i]);
+      checksum_field(&sum, row, i, f.ptr, f.len);
+    }
+    row++;
+  }
+  return sum;
+}
+
+static char *synthetic_csv(int rows, size_t *len_out) {
+  size_t cap = (size_t)rows * 96 + 128;
+  char *buf = (char *)malloc(cap);
+  if (!buf) return NULL;
+  size_t len = (size_t)snprintf(buf, cap, "scholar_id,cohort,last_touchpoint_date,touchpoints_last_30d,attendance_rate,satisfaction_score\n");
+  uint64_t state = 0x9E3779B97F4A7C15ull;
+  for (int i = 0; i < rows; i++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    len += (size_t)snprintf(buf + len, cap - len, "S-%07d,Region-%u/Campus-%u/Section-%u,2025-%02u-%02u,%u,0.%02u,%u.%u\n",
+                            i, (unsigned)(state % 7), (unsigned)(state >> 8) % 40, (unsigned)(state >> 16) % 90,
+                            (unsigned)(state >> 24) % 12 + 1, (unsigned)(state >> 32) % 28 + 1,
+                            (unsigned)(state >> 40) % 6, (unsigned)(state >> 44) % 100,
+                            (unsigned)(state >> 52) % 4 + 1, (unsigned)(state >> 56) % 10);
+  }
+  *len_out = len;
+  return buf;
+}
+
+static char *read_file(const char *path, size_t *len_out) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp) return NULL;
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  char *buf = size > 0 ? (char *)malloc((size_t)size) : NULL;
+  if (buf && fread(buf, 1, (size_t)size, fp) != (size_t)size) {
+    free(buf);
+    buf = NULL;
+  }
+  fclose(fp);
+  *len_out = buf ? (size_t)size : 0;
+  return buf;
+}
+
+int main(int argc, char **argv) {
+  const char *source = argc > 1 ? argv[1] : "2000000";
+  int repeats = argc > 2 ? atoi(argv[2]) : 5;
+  if (repeats < 1) repeats = 1;
+
+  size_t len = 0;
+  char *data = NULL;
+  char *end = NULL;
+  long rows = strtol(source, &end, 10);
+  if (end != source && *end == '\0' && rows > 0) {
+    data = synthetic_csv((int)rows, &len);
+  } else {
+    data = read_file(source, &len);
+  }
+  if (!data) {
+    fprintf(stderr, "Failed to load benchmark input.\n");
+    return 1;
+  }
+
+  const char *names[] = {"strtok_r", "scalar", "sse2", "avx2", "neon"};
+  ScanChecksum reference = scan_legacy(data, len);
+  printf("input: %zu bytes, %llu fields\n", len, (unsigned long long)reference.fields);
+  printf("%-10s %12s %10s\n", "scanner", "MB/s", "speedup");
+
+  double legacy_best = 0;
+  for (size_t n = 0; n < sizeof(names) / sizeof(names[0]); n++) {
+    ScanLineFn scan = n == 0 ? NULL : scan_line_named(names[n]);
+    if (n > 0 && !scan) continue;
+    double best = 0;
+    for (int r = 0; r < repeats; r++) {
+      double t0 = bench_now();
+      ScanChecksum sum = scan ? scan_with(scan, data, len) : scan_legacy(data, len);
+      double elapsed = bench_now() - t0;
+      if (sum.fields != reference.fields || sum.bytes != reference.bytes || sum.mix != reference.mix) {
+        fprintf(stderr, "%s produced different fields than strtok_r.\n", names[n]);
+        free(data);
+        return 1;
+      }
+      if (best == 0 || elapsed < best) best = elapsed;
+    }
+    if (n == 0) legacy_best = best;
+    printf("%-10s %12.1f %9.2fx\n", names[n], (double)len / best / 1e6, legacy_best / best);
+  }
+
+  free(data);
+  return 0;
+}
@@ -0,0 +1,379 @@
+/* Phase benchmark for the sentinel pipeline. Each phase runs over the output
+   of the previous one so it can be timed on its own; the best of --repeats
+   runs is reported with rows/sec, and peak RSS is printed at the end.
+
+   cc -std=c11 -O2 -pthread -o sentinel-bench bench/sentinel_bench.c
+   ./sentinel-bench big.csv --repeats 5 --as-of 2026-03-01
+*/
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "../src/sentinel.c"
+
+#include <sys/resource.h>
+
+typedef struct {
+  StrView fields[6];
+  int field_count;
+  size_t offset;
+} BenchLine;
+
+typedef struct {
+  BenchLine *lines;
+  int line_count;
+  ScholarRow *rows;
+  int row_count;
+  int *touchpoints;
+  double *attendance;
+  double *satisfaction;
+  int *days;
+  unsigned char *eligible;
+  int *days_since;
+  int *scores;
+  int *tiers;
+  RunTotals totals;
+  CohortTable cohorts;
+  TopRisks risks;
+  CohortSummary *summaries;
+  CohortAlert *alerts;
+  int alert_count;
+  Report report;
+} BenchState;
+
+typedef struct {
+  const char *path;
+  int as_of_day;
+  int limit;
+  int threads;
+  OutBuf sink;
+  InputReader reader;
+  int reader_open;
+  BenchState state;
+} Bench;
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Maps the input and splits every line. Later phases keep views into the map,
+   so the reader stays open until the next repeat replaces it. */
+static int phase_tokenize(Bench *b) {
+  BenchState *st = &b->state;
+  if (b->reader_open) input_close(&b->reader);
+  b->reader_open = input_open(&b->reader, b->path);
+  if (!b->reader_open || !b->reader.map) return 0;
+  int cap = st->lines ? st->line_count : 1024;
+  if (!st->lines) st->lines = (BenchLine *)malloc(sizeof(BenchLine) * (size_t)cap);
+  if (!st->lines) return 0;
+  int count = 0;
+  StrView line;
+  StrView fields[6];
+  int field_count = 0;
+  int header = 1;
+  while (input_next_row(&b->reader, &line, fields, &field_count)) {
+    if (header) {
+      header = 0;
+      continue;
+    }
+    if (count >= cap) {
+      cap *= 2;
+      BenchLine *resized = (BenchLine *)realloc(st->lines, sizeof(BenchLine) * (size_t)cap);
+      if (!resized) return 0;
+      st->lines = resized;
+    }
+    BenchLine *l = &st->lines[count++];
+    memcpy(l->fields, fields, sizeof(fields));
+    l->field_count = field_count;
+    l->offset = b->reader.line_offset;
+  }
+  st->line_count = count;
+  return 1;
+}
+
+static int phase_validate(Bench *b) {
+  BenchState *st = &b->state;
+  size_t n = (size_t)st->line_count + 1;
+  if (!st->rows) {
+    st->rows = (ScholarRow *)malloc(sizeof(ScholarRow) * n);
+    st->touchpoints = (int *)malloc(sizeof(int) * n);
+    st->attendance = (double *)malloc(sizeof(double) * n);
+    st->satisfaction = (double *)malloc(sizeof(double) * n);
+  }
+  if (!st->rows || !st->touchpoints || !st->attendance || !st->satisfaction) return 0;
+  memset(&st->totals, 0, sizeof(RunTotals));
+  int count = 0;
+  for (int i = 0; i < st->line_count; i++) {
+    const BenchLine *l = &st->lines[i];
+    ScholarRow *row = &st->rows[count];
+    if (!parse_scholar_fields(l->fields, l->field_count, row, &st->totals, 0)) continue;
+    row->offset = l->offset;
+    if (!row->valid) {
+      st->totals.invalid_rows++;
+      continue;
+    }
+    st->touchpoints[count] = row->touchpoints_30d;
+    st->attendance[count] = row->attendance_rate;
+    st->satisfaction[count] = row->satisfaction_score;
+    count++;
+  }
+  st->row_count = count;
+  return 1;
+}
+
+static int phase_dates(Bench *b) {
+  BenchState *st = &b->state;
+  size_t n = (size_t)st->row_count + 1;
+  if (!st->days) {
+    st->days = (int *)malloc(sizeof(int) * n);
+    st->eligible = (unsigned char *)malloc(n);
+  }
+  if (!st->days || !st->eligible) return 0;
+  DateCache cache;
+  memset(&cache, 0, sizeof(DateCache));
+  for (int i = 0; i < st->row_count; i++) {
+    st->days[i] = 0;
+    st->eligible[i] = (unsigned char)date_cache_parse(&cache, st->rows[i].last_touchpoint, &st->days[i]);
+  }
+  return 1;
+}
+
+static int phase_scoring(Bench *b) {
+  BenchState *st = &b->state;
+  size_t n = (size_t)st->row_count + 1;
+  if (!st->scores) {
+    st->days_since = (int *)malloc(sizeof(int) * n);
+    st->scores = (int *)malloc(sizeof(int) * n);
+    st->tiers = (int *)malloc(sizeof(int) * n);
+  }
+  if (!st->days_since || !st->scores || !st->tiers) return 0;
+  int counts[KC_COUNT] = {0};
+  ScoreBlock block = {b->as_of_day, st->days, st->touchpoints, st->attendance, st->satisfaction,
+                      st->eligible, st->days_since, st->scores, st->tiers, &k_default_profile};
+  select_score_kernel(&k_default_profile)(&block, 0, st->row_count, counts);
+  return 1;
+}
+
+static int phase_aggregate(Bench *b) {
+  BenchState *st = &b->state;
+  cohort_table_free(&st->cohorts);
+  if (!cohort_table_init(&st->cohorts)) return 0;
+  for (int i = 0; i < st->row_count; i++) {
+    if (!st->eligible[i]) continue;
+    const ScholarRow *r = &st->rows[i];
+    int cidx = find_or_add_cohort(&st->cohorts, r->cohort);
+    if (cidx < 0) return 0;
+    CohortStats *c = &st->cohorts.entries[cidx];
+    c->count++;
+    c->high += st->tiers[i] == TIER_HIGH;
+    c->medium += st->tiers[i] == TIER_MEDIUM;
+    c->low += st->tiers[i] == TIER_LOW;
+    fixed_sum_add(&c->attendance_sum, st->attendance[i]);
+    fixed_sum_add(&c->satisfaction_sum, st->satisfaction[i]);
+    c->touchpoints_sum += st->touchpoints[i];
+    c->days_since_sum += st->days_since[i];
+  }
+  return 1;
+}
+
+static int phase_top_k(Bench *b) {
+  BenchState *st = &b->state;
+  top_risks_free(&st->risks);
+  if (!top_risks_init(&st->risks, b->limit)) return 0;
+  for (int i = 0; i < st->row_count; i++) {
+    if (!st->eligible[i]) continue;
+    const ScholarRow *r = &st->rows[i];
+    if (!top_risks_admits(&st->risks, st->scores[i], st->days_since[i], r->id, r->offset)) continue;
+    int cidx = find_or_add_cohort(&st->cohorts, r->cohort);
+    if (cidx < 0) return 0;
+    RiskEntry entry;
+    memset(&entry, 0, sizeof(RiskEntry));
+    entry.cohort = st->cohorts.entries[cidx].name;
+    entry.risk_score = st->scores[i];
+    entry.days_since = st->days_since[i];
+    entry.touchpoints_30d = st->touchpoints[i];
+    entry.attendance_rate = st->attendance[i];
+    entry.satisfaction_score = st->satisfaction[i];
+    entry.offset = r->offset;
+    if (!top_risks_push(&st->risks, &entry, r->id)) return 0;
+  }
+  top_risks_finish(&st->risks, 1);
+  return 1;
+}
+
+static int phase_summaries(Bench *b) {
+  BenchState *st = &b->state;
+  free(st->summaries);
+  free(st->alerts);
+  st->alerts = NULL;
+  st->summaries = build_cohort_summaries(&st->cohorts, SORT_RISK, 1);
+  if (!st->summaries) return 0;
+  st->alert_count = build_alerts(st->summaries, st->cohorts.count, 0.30, 5, &st->alerts);
+  if (st->alert_count < 0) return 0;
+
+  Report *r = &st->report;
+  memset(r, 0, sizeof(Report));
+  r->reference_date = "bench";
+  r->cohort_sort = "risk";
+  r->totals = &st->totals;
+  r->risks = st->risks.entries;
+  r->risk_count = st->risks.count;
+  r->summaries = st->summaries;
+  r->cohort_count = st->cohorts.count;
+  r->cohort_display = st->cohorts.count;
+  r->alerts = st->alerts;
+  r->alert_count = st->alert_count;
+  r->alert_threshold = 0.30;
+  r->min_cohort_size = 5;
+  r->profile = &k_default_profile;
+  return 1;
+}
+
+static int phase_write_text(Bench *b) {
+  write_text_report(&b->sink, &b->state.report);
+  return out_flush(&b->sink);
+}
+
+static int phase_write_json(Bench *b) {
+  write_json_report(&b->sink, &b->state.report);
+  return out_flush(&b->sink);
+}
+
+static int phase_write_cohort_csv(Bench *b) {
+  write_cohort_csv(&b->sink, &b->state.report);
+  return out_flush(&b->sink);
+}
+
+static int phase_write_alert_csv(Bench *b) {
+  write_alert_csv(&b->sink, &b->state.report);
+  return out_flush(&b->sink);
+}
+
+/* The CLI ingest loop end to end (--stream, or --threads when > 1), for
+   comparison with the sum of the phases above. */
+static int phase_pipeline(Bench *b) {
+  InputReader reader;
+  if (!input_open(&reader, b->path)) return 0;
+  RunTotals totals;
+  memset(&totals, 0, sizeof(RunTotals));
+  CohortTable cohorts;
+  TopRisks risks;
+  memset(&risks, 0, sizeof(TopRisks));
+  DateCache dates;
+  memset(&dates, 0, sizeof(DateCache));
+  int ok = cohort_table_init(&cohorts) && top_risks_init(&risks, b->limit);
+  ScoreContext ctx;
+  memset(&ctx, 0, sizeof(ScoreContext));
+  ctx.as_of_day = b->as_of_day;
+  ctx.dates = &dates;
+  ctx.totals = &totals;
+  ctx.cohorts = &cohorts;
+  ctx.risks = &risks;
+  ctx.profile = &k_default_profile;
+  if (ok && b->threads > 1) {
+    ok = score_mapped_parallel(&reader, b->threads, &ctx, 0);
+  } else if (ok) {
+    StrView line;
+    StrView fields[6];
+    int field_count = 0;
+    int line_num = 0;
+    while (input_next_row(&reader, &line, fields, &field_count)) {
+      if (++line_num == 1) continue;
+      ScholarRow row;
+      if (!parse_scholar_fields(fields, field_count, &row, &totals, 0)) continue;
+      row.offset = reader.line_offset;
+      score_row(&row, &ctx);
+    }
+  }
+  ok = ok && !risks.failed;
+  if (ok) top_risks_finish(&risks, 1);
+  input_close(&reader);
+  cohort_table_free(&cohorts);
+  top_risks_free(&risks);
+  return ok;
+}
+
+typedef struct {
+  const char *name;
+  int (*run)(Bench *b);
+  int per_row;
+} BenchPhase;
+
+int main(int argc, char **argv) {
+  Bench b;
+  memset(&b, 0, sizeof(Bench));
+  b.limit = 10;
+  b.threads = 1;
+  int repeats = 5;
+  const char *as_of = "2026-03-01";
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+      repeats = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--as-of") == 0 && i + 1 < argc) {
+      as_of = argv[++i];
+    } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+      b.limit = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      b.threads = atoi(argv[++i]);
+    } else if (!b.path) {
+      b.path = argv[i];
+    }
+  }
+  if (!b.path || repeats < 1 || b.limit < 0 || b.threads < 1 || b.threads > MAX_THREADS ||
+      !parse_date(as_of, &b.as_of_day)) {
+    fprintf(stderr, "Usage: %s FILE.csv [--repeats N] [--as-of YYYY-MM-DD] [--limit N] [--threads N]\n", argv[0]);
+    return 1;
+  }
+  if (!out_open(&b.sink, "/dev/null")) {
+    perror("Failed to open /dev/null");
+    return 1;
+  }
+
+  const BenchPhase phases[] = {
+    {"read+tokenize", phase_tokenize, 1},
+    {"validate", phase_validate, 1},
+    {"dates", phase_dates, 1},
+    {"scoring", phase_scoring, 1},
+    {"aggregate", phase_aggregate, 1},
+    {"top-k", phase_top_k, 1},
+    {"cohort sort", phase_summaries, 0},
+    {"write text", phase_write_text, 0},
+    {"write json", phase_write_json, 0},
+    {"write cohort csv", phase_write_cohort_csv, 0},
+    {"write alert csv", phase_write_alert_csv, 0},
+    {"pipeline", phase_pipeline, 1},
+  };
+
+  printf("%-18s %10s %14s\n", "phase", "best ms", "rows/sec");
+  double total = 0;
+  for (size_t p = 0; p < sizeof(phases) / sizeof(phases[0]); p++) {
+    double best = 0;
+    for (int r = 0; r < repeats; r++) {
+      double t0 = bench_now();
+      if (!phases[p].run(&b)) {
+        fprintf(stderr, "Phase %s failed.\n", phases[p].name);
+        return 1;
+      }
+      double elapsed = bench_now() - t0;
+      if (r == 0 || elapsed < best) best = elapsed;
+    }
+    int is_pipeline = phases[p].run == phase_pipeline;
+    if (!is_pipeline) total += best;
+    int rows = b.state.line_count;
+    if (phases[p].per_row) {
+      printf("%-18s %10.2f %14.0f\n", phases[p].name, best * 1e3, best > 0 ? rows / best : 0.0);
+    } else {
+      printf("%-18s %10.2f %14s\n", phases[p].name, best * 1e3, "-");
+    }
+    if (p + 2 == sizeof(phases) / sizeof(phases[0])) {
+      printf("%-18s %10.2f %14.0f\n", "sum of phases", total * 1e3, total > 0 ? rows / total : 0.0);
+    }
+  }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  printf("rows: %d | passed validation: %d | cohorts: %d | pipeline threads: %d | peak RSS: %ld KB\n",
+         b.state.line_count, b.state.row_count, b.state.cohorts.count, b.threads, usage.ru_maxrss);
+  if (b.reader_open) input_close(&b.reader);
+  out_close(&b.sink);
+  return 0;
+}
@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+"""Loads one sentinel report into Postgres with COPY, in a single transaction.
+
+The report header comes from --json. Cohort summaries and alerts stream
+straight from --cohort-csv / --alert-csv when given (otherwise from the
+JSON arrays), and --scored adds every row of a --scored-out file. Pending
+schema migrations are applied first; see scripts/schema_migrations.py.
+"""
+import argparse
+import json
+import os
+import sys
+from pathlib import Path
+
+import psycopg
+from psycopg import sql
+
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+from read_scored import iter_batches  # noqa: E402
+from schema_migrations import migrate  # noqa: E402
+
+DEFAULT_SCHEMA = "cohort_health_sentinel"
+COPY_CHUNK = 1 << 20
+
+TABLE_COLUMNS = {
+    "cohort_summaries": [
+        "cohort", "count", "high", "medium", "low", "high_share", "risk_index",
+        "avg_touchpoints_30d", "avg_attendance", "avg_satisfaction", "avg_days_since",
+        "attendance_p10", "attendance_p50", "attendance_p90", "satisfaction_p10", "satisfaction_p50",
+        "satisfaction_p90", "touchpoints_30d_p10", "touchpoints_30d_p50", "touchpoints_30d_p90",
+        "days_since_p10", "days_since_p50", "days_since_p90",
+    ],
+    "alerts": [
+        "cohort", "high_share", "risk_index", "count", "high", "medium", "low",
+        "avg_days_since", "avg_attendance", "avg_satisfaction",
+    ],
+}
+TOP_RISK_COLUMNS = [
+    "scholar_id", "cohort", "score", "days_since", "touchpoints_30d", "attendance_rate", "satisfaction_score",
+]
+SCORED_COLUMNS = [
+    ("scholar_id", "scholar_id"), ("cohort", "cohort"), ("score", "risk_score"), ("tier", "tier"),
+    ("days_since", "days_since"), ("touchpoints_30d", "touchpoints_30d"),
+    ("attendance_rate", "attendance_rate"), ("satisfaction_score", "satisfaction_score"),
+]
+
+
+def connect():
+    params = {
+        "host": os.environ.get("GSCH_DB_HOST"),
+        "port": os.environ.get("GSCH_DB_PORT", "5432"),
+        "user": os.environ.get("GSCH_DB_USER"),
+        "password": os.environ.get("GSCH_DB_PASSWORD"),
+        "dbname": os.environ.get("GSCH_DB_NAME", "postgres"),
+    }
+    missing = [f"GSCH_DB_{key.upper()}" for key in ("host", "user", "password") if not params[key]]
+    if missing:
+        raise SystemExit(f"Missing required env vars: {', '.join(missing)}")
+    return psycopg.connect(**params)
+
+
+def load_report(path: Path) -> dict:
+    with path.open("r", encoding="utf-8") as handle:
+        report = json.load(handle)
+    if "scenarios" in report:
+        raise SystemExit("Load --scenarios output one scenario at a time.")
+    return report
+
+
+def insert_report(cur, schema: str, report: dict, source_label: str):
+    records = report.get("records", {})
+    invalid_breakdown = report.get("invalid_breakdown", {})
+    missing = report.get("missing", {})
+    risk_mix = report.get("risk_mix", {})
+    cohort_filter = report.get("cohort_filter")
+    cur.execute(
+        sql.SQL(
+            """
+            INSERT INTO {}.reports (
+                reference_date, cohort_filter, valid_records, invalid_records,
+                invalid_columns, invalid_numeric, invalid_date_format, invalid_range, clamped_values,
+                missing_ids, missing_dates, future_dates, risk_high, risk_medium, risk_low,
+                alert_threshold, min_cohort_size, source_label
+            )
+            VALUES (%s, %s, %s, %s, %s, %s, %s, %s, %s, %s, %s, %s, %s, %s, %s, %s, %s, %s)
+            RETURNING report_id
+            """
+        ).format(sql.Identifier(schema)),
+        (
+            report.get("reference_date", ""),
+            ",".join(cohort_filter) if cohort_filter else None,
+            records.get("valid", 0),
+            records.get("invalid", 0),
+            invalid_breakdown.get("columns", 0),
+            invalid_breakdown.get("numeric", 0),
+            invalid_breakdown.get("date_format", 0),
+            invalid_breakdown.get("range", 0),
+            report.get("clamped_values", 0),
+            missing.get("ids", 0),
+            missing.get("dates", 0),
+            report.get("date_anomalies", {}).get("future_dates", 0),
+            risk_mix.get("high", 0),
+            risk_mix.get("medium", 0),
+            risk_mix.get("low", 0),
+            report.get("alert_threshold", 0),
+            report.get("min_cohort_size", 0),
+            source_label,
+        ),
+    )
+    return cur.fetchone()[0]
+
+
+def copy_rows(cur, schema: str, table: str, columns, rows) -> int:
+    """COPYs (report_id-prefixed) tuples into schema.table."""
+    statement = sql.SQL("COPY {}.{} ({}) FROM STDIN").format(
+        sql.Identifier(schema), sql.Identifier(table), sql.SQL(", ").join(map(sql.Identifier, columns))
+    )
+    count = 0
+    with cur.copy(statement) as copy:
+        for row in rows:
+            copy.write_row(row)
+            count += 1
+    return count
+
+
+def copy_top_risks(cur, schema: str, report: dict, report_id) -> int:
+    return copy_rows(
+        cur, schema, "top_risks", ["report_id"] + TOP_RISK_COLUMNS,
+        (
+            (report_id, item["id"], item["cohort"], item["score"], item["days_since"],
+             item["touchpoints_30d"], item["attendance_rate"], item["satisfaction_score"])
+            for item in report.get("top_risks", [])
+        ),
+    )
+
+
+def copy_items(cur, schema: str, table: str, items, report_id) -> int:
+    """COPYs JSON cohort or alert objects into schema.table, taking the
+    TABLE_COLUMNS the first object carries (percentiles are optional)."""
+    columns = [c for c in TABLE_COLUMNS[table] if not items or c in items[0]]
+    return copy_rows(
+        cur, schema, table, ["report_id"] + columns,
+        ((report_id,) + tuple(item[c] for c in columns) for item in items),
+    )
+
+
+def copy_csv(cur, schema: str, table: str, path: Path, report_id) -> int:
+    """Streams a sentinel CSV into a temporary table, then moves it into
+    schema.table under report_id. The header names the columns."""
+    with path.open("rb") as handle:
+        header = handle.readline().decode("utf-8").strip().split(",")
+        unknown = [name for name in header if name not in TABLE_COLUMNS[table]]
+        if unknown:
+            raise SystemExit(f"{path}: unexpected columns {unknown} (scenario CSVs are not supported)")
+        columns = sql.SQL(", ").join(map(sql.Identifier, header))
+        stage = sql.Identifier(f"stage_{table}")
+        cur.execute(
+            sql.SQL("CREATE TEMP TABLE {} ON COMMIT DROP AS SELECT {} FROM {}.{} WITH NO DATA").format(
+                stage, columns, sql.Identifier(schema), sql.Identifier(table)
+            )
+        )
+        with cur.copy(sql.SQL("COPY {} ({}) FROM STDIN WITH (FORMAT csv)").format(stage, columns)) as copy:
+            while True:
+                chunk = handle.read(COPY_CHUNK)
+                if not chunk:
+                    break
+                copy.write(chunk)
+    cur.execute(
+        sql.SQL("INSERT INTO {}.{} (report_id, {}) SELECT %s, {} FROM {}").format(
+            sql.Identifier(schema), sql.Identifier(table), columns, columns, stage
+        ),
+        (report_id,),
+    )
+    return cur.rowcount
+
+
+def scored_rows(path: Path, report_id):
+    with path.open("rb") as handle:
+        for batch in iter_batches(handle):
+            columns = [batch[name] for _, name in SCORED_COLUMNS]
+            for values in zip(*columns):
+                yield (report_id,) + values
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="COPY one Cohort Health Sentinel report into Postgres.")
+    parser.add_argument("--schema", default=DEFAULT_SCHEMA, help="Target schema name")
+    parser.add_argument("--json", type=Path, help="JSON report (header, top risks, fallback tables)")
+    parser.add_argument("--cohort-csv", type=Path, help="Cohort summary CSV from the same run")
+    parser.add_argument("--alert-csv", type=Path, help="Alert CSV from the same run")
+    parser.add_argument("--scored", type=Path, help="--scored-out file from the same run")
+    parser.add_argument("--source", help="Source label for this report")
+    parser.add_argument("--migrate", action="store_true", help="Apply pending migrations and exit")
+    return parser.parse_args()
+
+
+def main() -> None:
+    args = parse_args()
+    if not args.migrate and args.json is None:
+        raise SystemExit("--json is required unless --migrate is given")
+    report = load_report(args.json) if args.json else None
+
+    with connect() as conn:
+        with conn.transaction():
+            applied = migrate(conn, args.schema)
+            if applied:
+                print(f"Applied {applied} migration(s) to schema '{args.schema}'.")
+            if report is None:
+                return
+            with conn.cursor() as cur:
+                report_id = insert_report(cur, args.schema, report, args.source or args.json.name)
+                counts = {"top_risks": copy_top_risks(cur, args.schema, report, report_id)}
+                for table, path, key in (
+                    ("cohort_summaries", args.cohort_csv, "cohorts"),
+                    ("alerts", args.alert_csv, "alerts"),
+                ):
+                    if path:
+                        counts[table] = copy_csv(cur, args.schema, table, path, report_id)
+                        continue
+                    counts[table] = copy_items(cur, args.schema, table, report.get(key, []), report_id)
+                if args.scored:
+                    counts["scored_rows"] = copy_rows(
+                        cur, args.schema, "scored_rows", ["report_id"] + [c for c, _ in SCORED_COLUMNS],
+                        scored_rows(args.scored, report_id),
+                    )
+    summary = ", ".join(f"{count} {table}" for table, count in counts.items())
+    print(f"Loaded report {report_id}: {summary}.")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,151 @@
+-- Report tables as scripts/postgres_ingest.py created them, with every
+-- column it used to add on each run folded in. Statements are idempotent so
+-- schemas postgres_ingest.py created before migrations existed adopt this
+-- version unchanged.
+--
+-- Older scripts/db_sync.py runs kept their own layout in the same schema:
+-- runs, cohort_metrics, cohort_alerts and a top_risks keyed by run_id, which
+-- would shadow the top_risks below. That layout is renamed to legacy_*
+-- first and its runs are copied into the report tables at the end.
+CREATE EXTENSION IF NOT EXISTS pgcrypto;
+
+DO $$
+BEGIN
+    IF EXISTS (
+        SELECT 1 FROM pg_attribute
+        WHERE attrelid = to_regclass('{schema}.top_risks') AND attname = 'run_id' AND NOT attisdropped
+    ) THEN
+        ALTER TABLE {schema}.top_risks RENAME TO legacy_top_risks;
+        ALTER TABLE IF EXISTS {schema}.runs RENAME TO legacy_runs;
+        ALTER TABLE IF EXISTS {schema}.cohort_metrics RENAME TO legacy_cohort_metrics;
+        ALTER TABLE IF EXISTS {schema}.cohort_alerts RENAME TO legacy_cohort_alerts;
+    END IF;
+END
+$$;
+
+CREATE TABLE IF NOT EXISTS {schema}.reports (
+    report_id UUID PRIMARY KEY DEFAULT gen_random_uuid(),
+    created_at TIMESTAMPTZ NOT NULL DEFAULT now(),
+    reference_date TEXT NOT NULL,
+    cohort_filter TEXT,
+    valid_records INT NOT NULL,
+    invalid_records INT NOT NULL,
+    invalid_columns INT NOT NULL DEFAULT 0,
+    invalid_numeric INT NOT NULL DEFAULT 0,
+    invalid_date_format INT NOT NULL DEFAULT 0,
+    invalid_range INT NOT NULL DEFAULT 0,
+    clamped_values INT NOT NULL DEFAULT 0,
+    missing_ids INT NOT NULL,
+    missing_dates INT NOT NULL,
+    future_dates INT NOT NULL DEFAULT 0,
+    risk_high INT NOT NULL,
+    risk_medium INT NOT NULL,
+    risk_low INT NOT NULL,
+    alert_threshold NUMERIC(5,2) NOT NULL,
+    min_cohort_size INT NOT NULL,
+    source_label TEXT
+);
+ALTER TABLE {schema}.reports ADD COLUMN IF NOT EXISTS future_dates INT NOT NULL DEFAULT 0;
+ALTER TABLE {schema}.reports ADD COLUMN IF NOT EXISTS invalid_columns INT NOT NULL DEFAULT 0;
+ALTER TABLE {schema}.reports ADD COLUMN IF NOT EXISTS invalid_numeric INT NOT NULL DEFAULT 0;
+ALTER TABLE {schema}.reports ADD COLUMN IF NOT EXISTS invalid_date_format INT NOT NULL DEFAULT 0;
+ALTER TABLE {schema}.reports ADD COLUMN IF NOT EXISTS invalid_range INT NOT NULL DEFAULT 0;
+ALTER TABLE {schema}.reports ADD COLUMN IF NOT EXISTS clamped_values INT NOT NULL DEFAULT 0;
+
+CREATE TABLE IF NOT EXISTS {schema}.top_risks (
+    report_id UUID NOT NULL REFERENCES {schema}.reports(report_id) ON DELETE CASCADE,
+    scholar_id TEXT NOT NULL,
+    cohort TEXT NOT NULL,
+    score INT NOT NULL,
+    days_since INT NOT NULL,
+    touchpoints_30d INT NOT NULL,
+    attendance_rate NUMERIC(5,2) NOT NULL,
+    satisfaction_score NUMERIC(5,2) NOT NULL
+);
+
+CREATE TABLE IF NOT EXISTS {schema}.cohort_summaries (
+    report_id UUID NOT NULL REFERENCES {schema}.reports(report_id) ON DELETE CASCADE,
+    cohort TEXT NOT NULL,
+    count INT NOT NULL,
+    high INT NOT NULL,
+    medium INT NOT NULL,
+    low INT NOT NULL,
+    risk_index NUMERIC(6,2) NOT NULL DEFAULT 0,
+    avg_touchpoints_30d NUMERIC(6,2) NOT NULL,
+    avg_attendance NUMERIC(5,2) NOT NULL,
+    avg_satisfaction NUMERIC(5,2) NOT NULL,
+    avg_days_since NUMERIC(6,1) NOT NULL
+);
+ALTER TABLE {schema}.cohort_summaries ADD COLUMN IF NOT EXISTS risk_index NUMERIC(6,2) NOT NULL DEFAULT 0;
+
+CREATE TABLE IF NOT EXISTS {schema}.alerts (
+    report_id UUID NOT NULL REFERENCES {schema}.reports(report_id) ON DELETE CASCADE,
+    cohort TEXT NOT NULL,
+    high_share NUMERIC(5,2) NOT NULL,
+    risk_index NUMERIC(6,2) NOT NULL DEFAULT 0,
+    count INT NOT NULL,
+    high INT NOT NULL,
+    medium INT NOT NULL,
+    low INT NOT NULL,
+    avg_days_since NUMERIC(6,1) NOT NULL,
+    avg_attendance NUMERIC(5,2) NOT NULL,
+    avg_satisfaction NUMERIC(5,2) NOT NULL
+);
+ALTER TABLE {schema}.alerts ADD COLUMN IF NOT EXISTS risk_index NUMERIC(6,2) NOT NULL DEFAULT 0;
+
+CREATE INDEX IF NOT EXISTS idx_reports_created_at ON {schema}.reports(created_at);
+CREATE INDEX IF NOT EXISTS idx_top_risks_report ON {schema}.top_risks(report_id);
+CREATE INDEX IF NOT EXISTS idx_cohort_summaries_report ON {schema}.cohort_summaries(report_id);
+CREATE INDEX IF NOT EXISTS idx_alerts_report ON {schema}.alerts(report_id);
+
+-- db_sync runs carry no risk mix, so it is summed from their cohorts.
+DO $$
+BEGIN
+    IF to_regclass('{schema}.legacy_runs') IS NOT NULL THEN
+        CREATE TEMP TABLE legacy_run_reports ON COMMIT DROP AS
+            SELECT id AS run_id, gen_random_uuid() AS report_id FROM {schema}.legacy_runs;
+        INSERT INTO {schema}.reports (
+            report_id, created_at, reference_date, valid_records, invalid_records,
+            invalid_columns, invalid_numeric, invalid_date_format, invalid_range, clamped_values,
+            missing_ids, missing_dates, future_dates, risk_high, risk_medium, risk_low,
+            alert_threshold, min_cohort_size, source_label
+        )
+        SELECT m.report_id, r.created_at, COALESCE(r.reference_date::text, ''), r.valid_count, r.invalid_count,
+               r.invalid_columns, r.invalid_numeric, r.invalid_date_format, r.invalid_range, r.clamped_values,
+               r.missing_ids, r.missing_dates, r.future_dates,
+               COALESCE(c.high, 0), COALESCE(c.medium, 0), COALESCE(c.low, 0),
+               r.alert_threshold, r.min_cohort_size, 'db_sync run ' || r.id
+        FROM {schema}.legacy_runs r
+        JOIN legacy_run_reports m ON m.run_id = r.id
+        LEFT JOIN (
+            SELECT run_id, SUM(high) AS high, SUM(medium) AS medium, SUM(low) AS low
+            FROM {schema}.legacy_cohort_metrics GROUP BY run_id
+        ) c ON c.run_id = r.id;
+        INSERT INTO {schema}.top_risks (
+            report_id, scholar_id, cohort, score, days_since, touchpoints_30d, attendance_rate, satisfaction_score
+        )
+        SELECT m.report_id, t.scholar_id, t.cohort, t.score, t.days_since, t.touchpoints_30d,
+               t.attendance_rate, t.satisfaction_score
+        FROM {schema}.legacy_top_risks t JOIN legacy_run_reports m ON m.run_id = t.run_id
+        ORDER BY t.id;
+        INSERT INTO {schema}.cohort_summaries (
+            report_id, cohort, count, high, medium, low, risk_index,
+            avg_touchpoints_30d, avg_attendance, avg_satisfaction, avg_days_since
+        )
+        SELECT m.report_id, c.cohort, c.count, c.high, c.medium, c.low, c.risk_index,
+               c.avg_touchpoints_30d, c.avg_attendance, c.avg_satisfaction, c.avg_days_since
+        FROM {schema}.legacy_cohort_metrics c JOIN legacy_run_reports m ON m.run_id = c.run_id
+        ORDER BY c.id;
+        INSERT INTO {schema}.alerts (
+            report_id, cohort, high_share, risk_index, count, high, medium, low,
+            avg_days_since, avg_attendance, avg_satisfaction
+        )
+        SELECT m.report_id, a.cohort, a.high_share, a.risk_index, a.count, a.high, a.medium, a.low,
+               a.avg_days_since, a.avg_attendance, a.avg_satisfaction
+        FROM {schema}.legacy_cohort_alerts a JOIN legacy_run_reports m ON m.run_id = a.run_id
+        ORDER BY a.id;
+        RAISE NOTICE 'Copied % db_sync run(s) into the report tables; the originals are kept as legacy_*.',
+            (SELECT COUNT(*) FROM legacy_run_reports);
+    END IF;
+END
+$$;
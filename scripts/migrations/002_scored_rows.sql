@@ -0,0 +1,15 @@
+-- Full --scored-out exports, and the high-risk share the cohort CSV carries.
+ALTER TABLE {schema}.cohort_summaries ADD COLUMN IF NOT EXISTS high_share NUMERIC(5,2);
+
+CREATE TABLE IF NOT EXISTS {schema}.scored_rows (
+    report_id UUID NOT NULL REFERENCES {schema}.reports(report_id) ON DELETE CASCADE,
+    scholar_id TEXT NOT NULL,
+    cohort TEXT NOT NULL,
+    score INT NOT NULL,
+    tier TEXT NOT NULL,
+    days_since INT NOT NULL,
+    touchpoints_30d INT NOT NULL,
+    attendance_rate NUMERIC(5,2) NOT NULL,
+    satisfaction_score NUMERIC(5,2) NOT NULL
+);
+CREATE INDEX IF NOT EXISTS idx_scored_rows_report ON {schema}.scored_rows(report_id);
@@ -0,0 +1,13 @@
+-- --percentiles columns of the cohort CSV; NULL for reports run without it.
+ALTER TABLE {schema}.cohort_summaries ADD COLUMN IF NOT EXISTS attendance_p10 NUMERIC(5,2);
+ALTER TABLE {schema}.cohort_summaries ADD COLUMN IF NOT EXISTS attendance_p50 NUMERIC(5,2);
+ALTER TABLE {schema}.cohort_summaries ADD COLUMN IF NOT EXISTS attendance_p90 NUMERIC(5,2);
+ALTER TABLE {schema}.cohort_summaries ADD COLUMN IF NOT EXISTS satisfaction_p10 NUMERIC(5,2);
+ALTER TABLE {schema}.cohort_summaries ADD COLUMN IF NOT EXISTS satisfaction_p50 NUMERIC(5,2);
+ALTER TABLE {schema}.cohort_summaries ADD COLUMN IF NOT EXISTS satisfaction_p90 NUMERIC(5,2);
+ALTER TABLE {schema}.cohort_summaries ADD COLUMN IF NOT EXISTS touchpoints_30d_p10 INT;
+ALTER TABLE {schema}.cohort_summaries ADD COLUMN IF NOT EXISTS touchpoints_30d_p50 INT;
+ALTER TABLE {schema}.cohort_summaries ADD COLUMN IF NOT EXISTS touchpoints_30d_p90 INT;
+ALTER TABLE {schema}.cohort_summaries ADD COLUMN IF NOT EXISTS days_since_p10 INT;
+ALTER TABLE {schema}.cohort_summaries ADD COLUMN IF NOT EXISTS days_since_p50 INT;
+ALTER TABLE {schema}.cohort_summaries ADD COLUMN IF NOT EXISTS days_since_p90 INT;
@@ -7,6 +7,8 @@ from urllib.parse import quote_plus
 
 from sqlalchemy import create_engine, text
 
+from schema_migrations import migrate
+
 DEFAULT_SCHEMA = "cohort_health_sentinel"
 DEFAULT_JSON = Path(__file__).resolve().parents[1] / "data" / "sample-output.json"
 
@@ -38,110 +40,8 @@ def load_report(path: Path):
 
 
 def setup_schema(conn, schema):
-    conn.execute(text("CREATE EXTENSION IF NOT EXISTS pgcrypto"))
-    conn.execute(text(f"CREATE SCHEMA IF NOT EXISTS {schema}"))
-    conn.execute(text(f"""
-        CREATE TABLE IF NOT EXISTS {schema}.reports (
-            report_id UUID PRIMARY KEY DEFAULT gen_random_uuid(),
-            created_at TIMESTAMPTZ NOT NULL DEFAULT now(),
-            reference_date TEXT NOT NULL,
-            cohort_filter TEXT,
-            valid_records INT NOT NULL,
-            invalid_records INT NOT NULL,
-            invalid_columns INT NOT NULL DEFAULT 0,
-            invalid_numeric INT NOT NULL DEFAULT 0,
-            invalid_date_format INT NOT NULL DEFAULT 0,
-            invalid_range INT NOT NULL DEFAULT 0,
-            clamped_values INT NOT NULL DEFAULT 0,
-            missing_ids INT NOT NULL,
-            missing_dates INT NOT NULL,
-            future_dates INT NOT NULL DEFAULT 0,
-            risk_high INT NOT NULL,
-            risk_medium INT NOT NULL,
-            risk_low INT NOT NULL,
-            alert_threshold NUMERIC(5,2) NOT NULL,
-            min_cohort_size INT NOT NULL,
-            source_label TEXT
-        )
-    """))
-    conn.execute(text(f"""
-        ALTER TABLE {schema}.reports
-        ADD COLUMN IF NOT EXISTS future_dates INT NOT NULL DEFAULT 0
-    """))
-    conn.execute(text(f"""
-        ALTER TABLE {schema}.reports
-        ADD COLUMN IF NOT EXISTS invalid_columns INT NOT NULL DEFAULT 0
-    """))
-    conn.execute(text(f"""
-        ALTER TABLE {schema}.reports
-        ADD COLUMN IF NOT EXISTS invalid_numeric INT NOT NULL DEFAULT 0
-    """))
-    conn.execute(text(f"""
-        ALTER TABLE {schema}.reports
-        ADD COLUMN IF NOT EXISTS invalid_date_format INT NOT NULL DEFAULT 0
-    """))
-    conn.execute(text(f"""
-        ALTER TABLE {schema}.reports
-        ADD COLUMN IF NOT EXISTS invalid_range INT NOT NULL DEFAULT 0
-    """))
-    conn.execute(text(f"""
-        ALTER TABLE {schema}.reports
-        ADD COLUMN IF NOT EXISTS clamped_values INT NOT NULL DEFAULT 0
-    """))
-    conn.execute(text(f"""
-        CREATE TABLE IF NOT EXISTS {schema}.top_risks (
-            report_id UUID NOT NULL REFERENCES {schema}.reports(report_id) ON DELETE CASCADE,
-            scholar_id TEXT NOT NULL,
-            cohort TEXT NOT NULL,
-            score INT NOT NULL,
-            days_since INT NOT NULL,
-            touchpoints_30d INT NOT NULL,
-            attendance_rate NUMERIC(5,2) NOT NULL,
-            satisfaction_score NUMERIC(5,2) NOT NULL
-        )
-    """))
-    conn.execute(text(f"""
-        CREATE TABLE IF NOT EXISTS {schema}.cohort_summaries (
-            report_id UUID NOT NULL REFERENCES {schema}.reports(report_id) ON DELETE CASCADE,
-            cohort TEXT NOT NULL,
-            count INT NOT NULL,
-            high INT NOT NULL,
-            medium INT NOT NULL,
-            low INT NOT NULL,
-            risk_index NUMERIC(6,2) NOT NULL DEFAULT 0,
-            avg_touchpoints_30d NUMERIC(6,2) NOT NULL,
-            avg_attendance NUMERIC(5,2) NOT NULL,
-            avg_satisfaction NUMERIC(5,2) NOT NULL,
-            avg_days_since NUMERIC(6,1) NOT NULL
-        )
-    """))
-    conn.execute(text(f"""
-        ALTER TABLE {schema}.cohort_summaries
-        ADD COLUMN IF NOT EXISTS risk_index NUMERIC(6,2) NOT NULL DEFAULT 0
-    """))
-    conn.execute(text(f"""
-        CREATE TABLE IF NOT EXISTS {schema}.alerts (
-            report_id UUID NOT NULL REFERENCES {schema}.reports(report_id) ON DELETE CASCADE,
-            cohort TEXT NOT NULL,
-            high_share NUMERIC(5,2) NOT NULL,
-            risk_index NUMERIC(6,2) NOT NULL DEFAULT 0,
-            count INT NOT NULL,
-            high INT NOT NULL,
-            medium INT NOT NULL,
-            low INT NOT NULL,
-            avg_days_since NUMERIC(6,1) NOT NULL,
-            avg_attendance NUMERIC(5,2) NOT NULL,
-            avg_satisfaction NUMERIC(5,2) NOT NULL
-        )
-    """))
-    conn.execute(text(f"""
-        ALTER TABLE {schema}.alerts
-        ADD COLUMN IF NOT EXISTS risk_index NUMERIC(6,2) NOT NULL DEFAULT 0
-    """))
-    conn.execute(text(f"CREATE INDEX IF NOT EXISTS idx_reports_created_at ON {schema}.reports(created_at)"))
-    conn.execute(text(f"CREATE INDEX IF NOT EXISTS idx_top_risks_report ON {schema}.top_risks(report_id)"))
-    conn.execute(text(f"CREATE INDEX IF NOT EXISTS idx_cohort_summaries_report ON {schema}.cohort_summaries(report_id)"))
-    conn.execute(text(f"CREATE INDEX IF NOT EXISTS idx_alerts_report ON {schema}.alerts(report_id)"))
+    """Applies pending versioned migrations from scripts/migrations."""
+    migrate(conn.connection.driver_connection, schema)
 
 
 def ingest_report(conn, schema, report, source_label):
@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""Reads a --scored-out file without pyarrow.
+
+The file is an Arrow IPC stream, so pyarrow.ipc.open_stream(path) reads it
+directly. This reader covers the subset the sentinel writes (Int,
+FloatingPoint and Utf8 columns, optional validity bitmaps) for hosts that
+only have the standard library.
+"""
+import argparse
+import csv
+import struct
+import sys
+from typing import BinaryIO, Dict, Iterator, List, Tuple
+
+CONTINUATION = 0xFFFFFFFF
+HEADER_SCHEMA = 1
+HEADER_RECORD_BATCH = 3
+TYPE_INT = 2
+TYPE_FLOAT = 3
+TYPE_UTF8 = 5
+
+
+class Table:
+    """A flatbuffer table at `pos` inside `buf`."""
+
+    def __init__(self, buf: bytes, pos: int):
+        self.buf = buf
+        self.pos = pos
+        self.vtable = pos - struct.unpack_from("<i", buf, pos)[0]
+        self.vtable_len = struct.unpack_from("<H", buf, self.vtable)[0]
+
+    def _field(self, index: int) -> int:
+        slot = 4 + 2 * index
+        if slot >= self.vtable_len:
+            return 0
+        return struct.unpack_from("<H", self.buf, self.vtable + slot)[0]
+
+    def scalar(self, index: int, fmt: str, default=0):
+        off = self._field(index)
+        return struct.unpack_from("<" + fmt, self.buf, self.pos + off)[0] if off else default
+
+    def _target(self, index: int) -> int:
+        off = self._field(index)
+        if not off:
+            return 0
+        at = self.pos + off
+        return at + struct.unpack_from("<I", self.buf, at)[0]
+
+    def table(self, index: int) -> "Table":
+        target = self._target(index)
+        return Table(self.buf, target) if target else None
+
+    def string(self, index: int) -> str:
+        target = self._target(index)
+        length = struct.unpack_from("<I", self.buf, target)[0]
+        return self.buf[target + 4:target + 4 + length].decode("utf-8")
+
+    def vector(self, index: int) -> Tuple[int, int]:
+        """Returns (first element position, element count)."""
+        target = self._target(index)
+        if not target:
+            return 0, 0
+        return target + 4, struct.unpack_from("<I", self.buf, target)[0]
+
+    def tables(self, index: int) -> List["Table"]:
+        start, count = self.vector(index)
+        out = []
+        for i in range(count):
+            at = start + 4 * i
+            out.append(Table(self.buf, at + struct.unpack_from("<I", self.buf, at)[0]))
+        return out
+
+
+def read_message(fh: BinaryIO):
+    """Returns (Message table, body bytes), or None at end of stream."""
+    prefix = fh.read(4)
+    if len(prefix) < 4:
+        return None
+    length = struct.unpack("<I", prefix)[0]
+    if length == CONTINUATION:
+        prefix = fh.read(4)
+        if len(prefix) < 4:
+            raise ValueError("truncated message length")
+        length = struct.unpack("<I", prefix)[0]
+    if length == 0:
+        return None
+    meta = fh.read(length)
+    if len(meta) < length:
+        raise ValueError("truncated message metadata")
+    message = Table(meta, struct.unpack_from("<I", meta, 0)[0])
+    body_len = message.scalar(3, "q")
+    body = fh.read(body_len)
+    if len(body) < body_len:
+        raise ValueError("truncated message body")
+    return message, body
+
+
+def parse_schema(schema: Table) -> Tuple[str, List[Tuple[str, int, Table]]]:
+    order = ">" if schema.scalar(0, "h") == 1 else "<"
+    fields = []
+    for field in schema.tables(1):
+        type_id = field.scalar(2, "B")
+        if type_id not in (TYPE_INT, TYPE_FLOAT, TYPE_UTF8):
+            raise ValueError(f"unsupported Arrow type {type_id} for {field.string(0)}")
+        fields.append((field.string(0), type_id, field.table(3)))
+    return order, fields
+
+
+def decode_column(order: str, type_id: int, type_table: Table, length: int, null_count: int, buffers, body: bytes):
+    def buffer(entry):
+        offset, size = entry
+        return body[offset:offset + size]
+
+    validity = buffer(buffers.pop(0))
+    if type_id == TYPE_UTF8:
+        offsets = struct.unpack_from(f"{order}{length + 1}i", buffer(buffers.pop(0)))
+        data = buffer(buffers.pop(0))
+        values = [data[offsets[i]:offsets[i + 1]].decode("utf-8") for i in range(length)]
+    elif type_id == TYPE_INT:
+        width = type_table.scalar(0, "i")
+        signed = type_table.scalar(1, "?", False)
+        code = {8: "b", 16: "h", 32: "i", 64: "q"}[width]
+        values = list(struct.unpack_from(f"{order}{length}{code if signed else code.upper()}", buffer(buffers.pop(0))))
+    else:
+        code = {1: "f", 2: "d"}[type_table.scalar(0, "h")]
+        values = list(struct.unpack_from(f"{order}{length}{code}", buffer(buffers.pop(0))))
+    if null_count and validity:
+        values = [v if validity[i >> 3] >> (i & 7) & 1 else None for i, v in enumerate(values)]
+    return values
+
+
+def iter_batches(fh: BinaryIO) -> Iterator[Dict[str, list]]:
+    """Yields each record batch as {column name: values}."""
+    first = read_message(fh)
+    if first is None or first[0].scalar(1, "B") != HEADER_SCHEMA:
+        raise ValueError("stream does not start with a schema")
+    order, fields = parse_schema(first[0].table(2))
+    while True:
+        message = read_message(fh)
+        if message is None:
+            return
+        meta, body = message
+        if meta.scalar(1, "B") != HEADER_RECORD_BATCH:
+            continue
+        batch = meta.table(2)
+        length = batch.scalar(0, "q")
+        node_start, node_count = batch.vector(1)
+        buf_start, buf_count = batch.vector(2)
+        if node_count != len(fields):
+            raise ValueError("record batch does not match the schema")
+        buffers = [struct.unpack_from("<qq", batch.buf, buf_start + 16 * i) for i in range(buf_count)]
+        columns = {}
+        for i, (name, type_id, type_table) in enumerate(fields):
+            _, null_count = struct.unpack_from("<qq", batch.buf, node_start + 16 * i)
+            columns[name] = decode_column(order, type_id, type_table, length, null_count, buffers, body)
+        yield columns
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Print a --scored-out Arrow stream as CSV.")
+    parser.add_argument("path", help="File written by --scored-out")
+    parser.add_argument("--count", action="store_true", help="Print only the row and batch counts")
+    args = parser.parse_args()
+
+    rows = 0
+    batches = 0
+    writer = None
+    with open(args.path, "rb") as fh:
+        for columns in iter_batches(fh):
+            names = list(columns)
+            batches += 1
+            count = len(columns[names[0]]) if names else 0
+            rows += count
+            if args.count:
+                continue
+            if writer is None:
+                writer = csv.writer(sys.stdout)
+                writer.writerow(names)
+            writer.writerows(zip(*(columns[name] for name in names)))
+    if args.count:
+        print(f"{rows} rows in {batches} batches")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Versioned schema migrations for the cohort_health_sentinel tables.
+
+Each file in scripts/migrations is named NNN_description.sql and applied at
+most once per schema; applied versions are recorded in
+<schema>.schema_migrations. A run on an up-to-date schema costs one query.
+"""
+import re
+from pathlib import Path
+from typing import List, Tuple
+
+from psycopg import sql
+
+MIGRATIONS_DIR = Path(__file__).resolve().parent / "migrations"
+_NAME = re.compile(r"^(\d{3})_[a-z0-9_]+\.sql$")
+
+
+def available_migrations() -> List[Tuple[int, str, Path]]:
+    """Returns (version, name, path) for every migration file, in order."""
+    found = []
+    for path in MIGRATIONS_DIR.iterdir():
+        match = _NAME.match(path.name)
+        if match:
+            found.append((int(match.group(1)), path.stem, path))
+    found.sort()
+    versions = [version for version, _, _ in found]
+    if versions != list(range(1, len(versions) + 1)):
+        raise SystemExit(f"Migration versions in {MIGRATIONS_DIR} must run 1..N without gaps: {versions}")
+    return found
+
+
+def latest_version() -> int:
+    migrations = available_migrations()
+    return migrations[-1][0] if migrations else 0
+
+
+def current_version(cur, schema: str) -> int:
+    cur.execute("SELECT to_regclass(%s)", (f"{schema}.schema_migrations",))
+    if cur.fetchone()[0] is None:
+        return 0
+    cur.execute(sql.SQL("SELECT COALESCE(MAX(version), 0) FROM {}.schema_migrations").format(sql.Identifier(schema)))
+    return cur.fetchone()[0]
+
+
+def migrate(conn, schema: str) -> int:
+    """Applies pending migrations inside the caller's transaction and returns
+    how many ran. Concurrent loaders serialize on an advisory lock."""
+    target = latest_version()
+    with conn.cursor() as cur:
+        if current_version(cur, schema) >= target:
+            return 0
+        cur.execute("SELECT pg_advisory_xact_lock(hashtext(%s))", (f"{schema}.schema_migrations",))
+        quoted = sql.Identifier(schema).as_string(conn)
+        cur.execute(f"CREATE SCHEMA IF NOT EXISTS {quoted}")
+        cur.execute(
+            f"""
+            CREATE TABLE IF NOT EXISTS {quoted}.schema_migrations (
+                version INT PRIMARY KEY,
+                name TEXT NOT NULL,
+                applied_at TIMESTAMPTZ NOT NULL DEFAULT now()
+            )
+            """
+        )
+        applied = current_version(cur, schema)
+        count = 0
+        for version, name, path in available_migrations():
+            if version <= applied:
+                continue
+            cur.execute(path.read_text(encoding="utf-8").replace("{schema}", quoted))
+            cur.execute(
+                sql.SQL("INSERT INTO {}.schema_migrations (version, name) VALUES (%s, %s)").format(
+                    sql.Identifier(schema)
+                ),
+                (version, name),
+            )
+            count += 1
+        return count
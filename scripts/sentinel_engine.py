@@ -0,0 +1,271 @@
+#!/usr/bin/env python3
+"""In-process access to the sentinel engine (src/sentinel.h) through ctypes.
+
+Build the library once with
+    cc -std=c11 -O2 -pthread -fPIC -shared -o libsentinel.so src/sentinel.c
+and point SENTINEL_LIB at it (the repository root is searched by default).
+Engine.report() returns the same keys as the --json report, with values
+unrounded, so callers that read the JSON can take it without a round trip.
+"""
+import ctypes
+import os
+from pathlib import Path
+from typing import Iterable, Optional, Sequence
+
+DEFAULT_LIB = Path(__file__).resolve().parent.parent / "libsentinel.so"
+PERCENTILE_METRICS = ("attendance", "satisfaction", "touchpoints_30d", "days_since")
+PERCENTILE_QUANTILES = ("p10", "p50", "p90")
+
+
+class Options(ctypes.Structure):
+    _fields_ = [
+        ("as_of", ctypes.c_char_p),
+        ("cohort_filter", ctypes.c_char_p),
+        ("cohort_sort", ctypes.c_char_p),
+        ("scoring_profile", ctypes.c_char_p),
+        ("limit", ctypes.c_int),
+        ("cohort_limit", ctypes.c_int),
+        ("alert_threshold", ctypes.c_double),
+        ("min_cohort_size", ctypes.c_int),
+        ("clamp_ranges", ctypes.c_int),
+        ("percentiles", ctypes.c_int),
+        ("rollup_separator", ctypes.c_char),
+        ("scenarios", ctypes.c_char_p),
+        ("dedupe", ctypes.c_char_p),
+        ("threads", ctypes.c_int),
+        ("stream", ctypes.c_int),
+        ("cache", ctypes.c_char_p),
+        ("state", ctypes.c_char_p),
+        ("state_delta", ctypes.c_int),
+        ("scored_out", ctypes.c_char_p),
+        ("stats", ctypes.c_int),
+    ]
+
+
+class Row(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_char_p) for name in (
+        "scholar_id", "cohort", "last_touchpoint_date", "touchpoints_30d", "attendance_rate", "satisfaction_score",
+    )]
+
+
+class Totals(ctypes.Structure):
+    _fields_ = [(name, ctypes.c_int) for name in (
+        "data_rows", "valid", "invalid", "missing_ids", "missing_dates", "invalid_columns", "invalid_numeric",
+        "invalid_date_format", "invalid_range", "future_dates", "clamped_values", "high", "medium", "low",
+    )]
+
+
+class Risk(ctypes.Structure):
+    _fields_ = [
+        ("scholar_id", ctypes.c_char_p),
+        ("cohort", ctypes.c_char_p),
+        ("score", ctypes.c_int),
+        ("days_since", ctypes.c_int),
+        ("touchpoints_30d", ctypes.c_int),
+        ("attendance_rate", ctypes.c_double),
+        ("satisfaction_score", ctypes.c_double),
+    ]
+
+
+class Cohort(ctypes.Structure):
+    _fields_ = [("cohort", ctypes.c_char_p)] + [(name, ctypes.c_int) for name in (
+        "level", "count", "high", "medium", "low",
+    )] + [(name, ctypes.c_double) for name in (
+        "high_share", "risk_index", "avg_touchpoints_30d", "avg_attendance", "avg_satisfaction", "avg_days_since",
+    )] + [("percentiles", (ctypes.c_double * 3) * 4)]
+
+
+class Alert(ctypes.Structure):
+    _fields_ = [("cohort", ctypes.c_char_p)] + [(name, ctypes.c_int) for name in (
+        "level", "count", "high", "medium", "low",
+    )] + [(name, ctypes.c_double) for name in (
+        "high_share", "risk_index", "avg_days_since", "avg_attendance", "avg_satisfaction",
+    )]
+
+
+_lib = None
+
+
+def load_library(path: Optional[str] = None):
+    """Loads libsentinel.so once and declares its signatures."""
+    global _lib
+    if _lib is not None:
+        return _lib
+    path = path or os.environ.get("SENTINEL_LIB") or str(DEFAULT_LIB)
+    try:
+        lib = ctypes.CDLL(path)
+    except OSError as exc:
+        raise SystemExit(f"Failed to load the sentinel library {path}: {exc}") from None
+    handle = ctypes.c_void_p
+    lib.sentinel_options_init.argtypes = [ctypes.POINTER(Options)]
+    lib.sentinel_options_init.restype = None
+    lib.sentinel_engine_create.argtypes = [ctypes.POINTER(Options), ctypes.c_char_p, ctypes.c_size_t]
+    lib.sentinel_engine_create.restype = handle
+    lib.sentinel_feed_buffer.argtypes = [handle, ctypes.c_char_p, ctypes.c_size_t]
+    lib.sentinel_feed_rows.argtypes = [handle, ctypes.POINTER(Row), ctypes.c_size_t]
+    lib.sentinel_finalize.argtypes = [handle]
+    lib.sentinel_reference_date.argtypes = [handle]
+    lib.sentinel_reference_date.restype = ctypes.c_char_p
+    lib.sentinel_totals.argtypes = [handle, ctypes.POINTER(Totals)]
+    lib.sentinel_totals.restype = None
+    lib.sentinel_cohort_total.argtypes = [handle]
+    for name, struct in (("cohort", Cohort), ("alert", Alert), ("risk", Risk)):
+        getattr(lib, f"sentinel_{name}_count").argtypes = [handle]
+        getattr(lib, f"sentinel_{name}_at").argtypes = [handle, ctypes.c_int, ctypes.POINTER(struct)]
+    lib.sentinel_engine_free.argtypes = [handle]
+    lib.sentinel_engine_free.restype = None
+    _lib = lib
+    return lib
+
+
+def _text(value) -> Optional[bytes]:
+    if value is None:
+        return None
+    return value if isinstance(value, bytes) else str(value).encode("utf-8")
+
+
+def _fields(struct) -> dict:
+    return {name: getattr(struct, name) for name, _ in struct._fields_}
+
+
+class Engine:
+    """One engine handle. Feed CSV bytes with feed() or row tuples with
+    feed_rows() (not both), then call report(). Use as a context manager or
+    call close()."""
+
+    def __init__(self, as_of: Optional[str] = None, cohort: Optional[str] = None, cohort_sort: str = "risk",
+                 scoring_profile: Optional[str] = None, limit: int = 10, cohort_limit: int = -1,
+                 alert_threshold: float = 0.30, min_cohort_size: int = 5, clamp_ranges: bool = False,
+                 percentiles: bool = False, rollup_separator: Optional[str] = None, library: Optional[str] = None):
+        self._lib = load_library(library)
+        options = Options()
+        self._lib.sentinel_options_init(ctypes.byref(options))
+        options.as_of = _text(as_of)
+        options.cohort_filter = _text(cohort)
+        options.cohort_sort = _text(cohort_sort)
+        options.scoring_profile = _text(scoring_profile)
+        options.limit = limit
+        options.cohort_limit = cohort_limit
+        options.alert_threshold = alert_threshold
+        options.min_cohort_size = min_cohort_size
+        options.clamp_ranges = int(clamp_ranges)
+        options.percentiles = int(percentiles)
+        if rollup_separator:
+            if len(rollup_separator) != 1:
+                raise ValueError("rollup_separator must be one character")
+            options.rollup_separator = rollup_separator.encode("utf-8")
+        self.alert_threshold = min(max(alert_threshold, 0.0), 1.0)
+        self.min_cohort_size = max(min_cohort_size, 1)
+        self.percentiles = bool(percentiles)
+        self.rollup = bool(rollup_separator)
+        error = ctypes.create_string_buffer(256)
+        self._handle = self._lib.sentinel_engine_create(ctypes.byref(options), error, len(error))
+        if not self._handle:
+            raise ValueError(error.value.decode("utf-8"))
+        self._finalized = False
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def close(self) -> None:
+        if self._handle:
+            self._lib.sentinel_engine_free(self._handle)
+            self._handle = None
+
+    def feed(self, data: bytes) -> None:
+        """Feeds CSV bytes, header first; chunks may split lines anywhere."""
+        if not self._lib.sentinel_feed_buffer(self._handle, data, len(data)):
+            raise RuntimeError("sentinel_feed_buffer failed")
+
+    def feed_file(self, path, chunk_size: int = 1 << 20) -> None:
+        with open(path, "rb") as handle:
+            while True:
+                chunk = handle.read(chunk_size)
+                if not chunk:
+                    return
+                self.feed(chunk)
+
+    def feed_rows(self, rows: Iterable[Sequence]) -> None:
+        """Feeds rows of (scholar_id, cohort, last_touchpoint_date,
+        touchpoints_30d, attendance_rate, satisfaction_score); values are
+        validated as their CSV text, so None or "" marks a missing field."""
+        batch = list(rows)
+        array = (Row * max(len(batch), 1))()
+        for slot, row in zip(array, batch):
+            for (name, _), value in zip(Row._fields_, row):
+                setattr(slot, name, _text(value))
+        if not self._lib.sentinel_feed_rows(self._handle, array, len(batch)):
+            raise RuntimeError("sentinel_feed_rows failed")
+
+    def _finalize(self) -> None:
+        if not self._finalized:
+            if not self._lib.sentinel_finalize(self._handle):
+                raise MemoryError("sentinel_finalize failed")
+            self._finalized = True
+
+    def _items(self, name: str, struct):
+        self._finalize()
+        count = getattr(self._lib, f"sentinel_{name}_count")(self._handle)
+        at = getattr(self._lib, f"sentinel_{name}_at")
+        item = struct()
+        for index in range(count):
+            at(self._handle, index, ctypes.byref(item))
+            yield item
+
+    def totals(self) -> dict:
+        self._finalize()
+        totals = Totals()
+        self._lib.sentinel_totals(self._handle, ctypes.byref(totals))
+        return _fields(totals)
+
+    def top_risks(self):
+        for risk in self._items("risk", Risk):
+            item = _fields(risk)
+            item["id"] = item.pop("scholar_id").decode("utf-8")
+            item["cohort"] = item["cohort"].decode("utf-8")
+            yield item
+
+    def cohorts(self):
+        for cohort in self._items("cohort", Cohort):
+            item = _fields(cohort)
+            item["cohort"] = item["cohort"].decode("utf-8")
+            values = item.pop("percentiles")
+            if not self.rollup:
+                del item["level"]
+            for m, metric in enumerate(PERCENTILE_METRICS if self.percentiles else ()):
+                for q, quantile in enumerate(PERCENTILE_QUANTILES):
+                    item[f"{metric}_{quantile}"] = values[m][q]
+            yield item
+
+    def alerts(self):
+        for alert in self._items("alert", Alert):
+            item = _fields(alert)
+            item["cohort"] = item["cohort"].decode("utf-8")
+            if not self.rollup:
+                del item["level"]
+            yield item
+
+    def report(self) -> dict:
+        """The --json report keys db_sync.py and bulk_load.py read."""
+        totals = self.totals()
+        return {
+            "reference_date": self._lib.sentinel_reference_date(self._handle).decode("utf-8"),
+            "records": {"valid": totals["valid"], "invalid": totals["invalid"]},
+            "cohort_total": self._lib.sentinel_cohort_total(self._handle),
+            "missing": {"ids": totals["missing_ids"], "dates": totals["missing_dates"]},
+            "invalid_breakdown": {
+                "columns": totals["invalid_columns"], "numeric": totals["invalid_numeric"],
+                "date_format": totals["invalid_date_format"], "range": totals["invalid_range"],
+            },
+            "clamped_values": totals["clamped_values"],
+            "date_anomalies": {"future_dates": totals["future_dates"]},
+            "risk_mix": {"high": totals["high"], "medium": totals["medium"], "low": totals["low"]},
+            "alert_threshold": self.alert_threshold,
+            "min_cohort_size": self.min_cohort_size,
+            "top_risks": list(self.top_risks()),
+            "cohorts": list(self.cohorts()),
+            "alerts": list(self.alerts()),
+        }
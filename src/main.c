@@ -1,797 +1,2212 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdarg.h>
+#include <glob.h>
+#include <poll.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#ifdef SENTINEL_PG
+#include <libpq-fe.h>
+#endif
+
+#include "sentinel_internal.h"
 
-#define MAX_LINE 2048
-#define MAX_NAME 64
-#define MAX_DATE 16
-
-typedef struct {
-  char id[MAX_NAME];
-  char cohort[MAX_NAME];
-  char last_touchpoint[MAX_DATE];
-  int touchpoints_30d;
-  double attendance_rate;
-  double satisfaction_score;
-  int valid;
-} Scholar;
+static void usage(const char *name) {
+  printf("Group Scholar Cohort Health Sentinel\n\n");
+  printf("Usage: %s --input <file>... [--input-list <file>] [--json <file>] [--cohort-csv <file>] [--alert-csv <file>] [--as-of YYYY-MM-DD] [--limit N]\n", name);
+  printf("          [--alert-threshold PCT] [--min-cohort-size N] [--cohort NAME[,NAME]]\n");
+  printf("          [--cohort-sort risk|high|name] [--cohort-limit N] [--clamp-ranges] [--stream] [--threads N]\n");
+  printf("          [--stats] [--stats-json <file>] [--scoring-profile <file>] [--scenarios <file>]\n");
+  printf("          [--state <file> [--state-delta]] [--cache <file>] [--serve <socket> [--serve-workers N]]\n");
+  printf("          [--scored-out <file>] [--pg-sink <conninfo> [--pg-schema NAME]]\n");
+  printf("          [--dedupe first|last|latest-touchpoint] [--percentiles] [--trend [--trend-rise PCT]]\n");
+  printf("          [--watch] [--rollup-separator CHAR]\n\n");
+  printf("Options:\n");
+  printf("  --input   CSV file with scholar engagement data (- reads stdin); repeat it or pass a glob to merge files\n");
+  printf("            gzip/zstd inputs are decompressed on the fly (builds with -DSENTINEL_ZLIB/-DSENTINEL_ZSTD)\n");
+  printf("  --input-list  File naming one input path or glob per line (# comments; relative to the list)\n");
+  printf("  --json    Write JSON output to file\n");
+  printf("  --cohort-csv  Write cohort summary CSV to file\n");
+  printf("  --alert-csv  Write cohort alert CSV to file\n");
+  printf("  --as-of   Reference date for recency calculations\n");
+  printf("  --limit   Limit number of risk entries shown (default 10)\n");
+  printf("  --cohort-sort   Sort cohort summary by risk, high, or name (default risk)\n");
+  printf("  --cohort-limit  Limit number of cohorts shown in summary\n");
+  printf("  --alert-threshold  High-risk share that triggers cohort alert (default 0.30)\n");
+  printf("  --min-cohort-size  Minimum cohort size for alerts (default 5)\n");
+  printf("  --cohort  Filter results to one or more cohorts (comma-separated)\n");
+  printf("  --clamp-ranges  Clamp out-of-range numeric values instead of marking invalid\n");
+  printf("  --stream  Score rows as they are read instead of buffering the whole file\n");
+  printf("  --threads  Parse and score regular input files in N parallel chunks (implies --stream)\n");
+  printf("  --stats   Print per-phase wall/CPU time and run counters to stderr\n");
+  printf("  --stats-json  Write the run stats as JSON to file\n");
+  printf("  --scoring-profile  Load risk thresholds, points, and tier cutoffs from file\n");
+  printf("  --scenarios  Parse once, then report every scoring/alert scenario in file\n");
+  printf("  --state   Keep per-scholar rows and cohort totals in file; reruns apply only changed rows\n");
+  printf("  --state-delta  Input holds only new or changed rows (default: full export, missing rows retire)\n");
+  printf("  --cache   Keep the parsed columns in file; later runs on the unchanged input skip parsing\n");
+  printf("  --serve   Keep the scored input resident and answer JSON report queries on a unix socket\n");
+  printf("  --serve-workers  Threads answering --serve queries (default 4)\n");
+  printf("  --scored-out  Stream every scored row to file as an Arrow IPC stream\n");
+  printf("  --pg-sink  Write the report to Postgres over libpq (\"\" uses PG* variables; needs -DSENTINEL_PG)\n");
+  printf("  --pg-schema  Schema --pg-sink writes to (default cohort_health_sentinel)\n");
+  printf("  --dedupe  Score one row per scholar id: the first, the last, or the latest touchpoint\n");
+  printf("  --percentiles  Add p10/p50/p90 of each cohort metric to the JSON cohorts and --cohort-csv\n");
+  printf("  --trend   Report per-cohort series over dated snapshots (one input per date, or a snapshot_date column)\n");
+  printf("  --trend-rise  High-risk share rise since the previous snapshot that alerts (default 0.05)\n");
+  printf("  --watch   Keep running, score rows as they are appended and rewrite outputs when alerts change\n");
+  printf("  --rollup-separator  Cohort names are paths; also report and alert on every ancestor level\n");
+}
 
+/* The --input list: every --input value (a path, "-", or a glob) and every
+   line of each --input-list file, in command-line order. */
 typedef struct {
-  char name[MAX_NAME];
+  char **paths;
   int count;
-  int high;
-  int medium;
-  int low;
-  double attendance_sum;
-  double satisfaction_sum;
-  int touchpoints_sum;
-  double days_since_sum;
-} CohortStats;
+  int capacity;
+} InputList;
+
+static int input_list_push(InputList *list, const char *path) {
+  if (list->count == list->capacity) {
+    int capacity = list->capacity ? list->capacity * 2 : 8;
+    char **grown = (char **)realloc(list->paths, sizeof(char *) * (size_t)capacity);
+    if (!grown) return 0;
+    list->paths = grown;
+    list->capacity = capacity;
+  }
+  char *copy = strdup(path);
+  if (!copy) return 0;
+  list->paths[list->count++] = copy;
+  return 1;
+}
 
-typedef struct {
-  char id[MAX_NAME];
-  char cohort[MAX_NAME];
-  int risk_score;
-  int days_since;
-  int touchpoints_30d;
-  double attendance_rate;
-  double satisfaction_score;
-} RiskEntry;
+static void input_list_free(InputList *list) {
+  for (int i = 0; i < list->count; i++) free(list->paths[i]);
+  free(list->paths);
+  memset(list, 0, sizeof(InputList));
+}
 
-typedef struct {
-  char cohort[MAX_NAME];
-  int count;
-  int high;
-  int medium;
-  int low;
-  double high_ratio;
-  double risk_index;
-  double avg_days;
-  double avg_attendance;
-  double avg_satisfaction;
-} CohortAlert;
+/* Adds pattern, or its matches in sorted order when it holds glob
+   characters. A glob that matches nothing is an error. */
+static int input_list_add(InputList *list, const char *pattern) {
+  if (!strpbrk(pattern, "*?[")) {
+    if (input_list_push(list, pattern)) return 1;
+    fprintf(stderr, "Failed to allocate input list.\n");
+    return 0;
+  }
+  glob_t matches;
+  int rc = glob(pattern, 0, NULL, &matches);
+  if (rc == GLOB_NOMATCH) {
+    fprintf(stderr, "No input files match %s.\n", pattern);
+    return 0;
+  }
+  int ok = rc == 0;
+  for (size_t i = 0; ok && i < matches.gl_pathc; i++) ok = input_list_push(list, matches.gl_pathv[i]);
+  if (!ok) fprintf(stderr, "Failed to expand %s.\n", pattern);
+  globfree(&matches);
+  return ok;
+}
 
+/* --input-list: one path or glob per line; blank lines and # comments are
+   skipped, and relative entries resolve against the list file's directory. */
+static int input_list_load(InputList *list, const char *list_path) {
+  FILE *f = fopen(list_path, "r");
+  if (!f) {
+    perror("Failed to open input list");
+    return 0;
+  }
+  const char *slash = strrchr(list_path, '/');
+  int dir_len = slash ? (int)(slash - list_path) + 1 : 0;
+  char line[4096];
+  char path[8192];
+  int ok = 1;
+  while (ok && fgets(line, sizeof(line), f)) {
+    char *start = line;
+    while (*start == ' ' || *start == '\t') start++;
+    size_t len = strlen(start);
+    while (len > 0 && isspace((unsigned char)start[len - 1])) start[--len] = '\0';
+    if (len == 0 || start[0] == '#') continue;
+    if (start[0] == '/' || strcmp(start, "-") == 0) {
+      ok = input_list_add(list, start);
+    } else {
+      snprintf(path, sizeof(path), "%.*s%s", dir_len, list_path, start);
+      ok = input_list_add(list, path);
+    }
+  }
+  fclose(f);
+  return ok;
+}
+
+/* --pg-sink: reports go straight into the cohort_health_sentinel tables
+   that scripts/migrations defines, with no JSON round trip. The whole run
+   is one transaction. Per report, the header statements are pipelined:
+   BEGIN and the schema version check (first report only) plus the
+   INSERT ... RETURNING report_id go out together and cost one round trip.
+   Top risks, cohort summaries and alerts then stream through COPY, each
+   row sent as soon as it is formatted. Build with -DSENTINEL_PG and link
+   -lpq; other builds reject the option. */
+#define PG_SCHEMA_VERSION 3
+
+#ifdef SENTINEL_PG
 typedef struct {
-  char cohort[MAX_NAME];
-  int count;
-  int high;
-  int medium;
-  int low;
-  double high_share;
-  double risk_index;
-  double avg_touchpoints;
-  double avg_attendance;
-  double avg_satisfaction;
-  double avg_days;
-} CohortSummary;
-
-typedef enum {
-  SORT_RISK,
-  SORT_HIGH,
-  SORT_NAME
-} CohortSort;
-
-static CohortSort g_cohort_sort = SORT_RISK;
-
-static void trim(char *s) {
-  char *start = s;
-  while (isspace((unsigned char)*start)) start++;
-  if (start != s) memmove(s, start, strlen(start) + 1);
-  if (*s == '\0') return;
-  char *end = s + strlen(s);
-  while (end > s && isspace((unsigned char)*(end - 1))) end--;
-  *end = '\0';
-}
-
-static int parse_int(const char *s, int *out) {
-  char *end = NULL;
-  long val = strtol(s, &end, 10);
-  if (end == s || *end != '\0') return 0;
-  *out = (int)val;
+  PGconn *conn;
+  char *schema;
+  int reports;
+  OutBuf copy;
+} PgSink;
+
+static int pg_copy_put(void *ctx, const char *p, size_t n) {
+  while (n > 0) {
+    int chunk = n > (1u << 30) ? 1 << 30 : (int)n;
+    if (PQputCopyData((PGconn *)ctx, p, chunk) != 1) return 0;
+    p += chunk;
+    n -= (size_t)chunk;
+  }
   return 1;
 }
 
-static int parse_double(const char *s, double *out) {
-  char *end = NULL;
-  double val = strtod(s, &end);
-  if (end == s || *end != '\0') return 0;
-  *out = val;
+static int pg_sink_open(PgSink *pg, const char *conninfo, const char *schema) {
+  memset(pg, 0, sizeof(PgSink));
+  pg->conn = PQconnectdb(conninfo);
+  if (PQstatus(pg->conn) != CONNECTION_OK) {
+    fprintf(stderr, "Failed to connect to Postgres: %s", PQerrorMessage(pg->conn));
+    PQfinish(pg->conn);
+    pg->conn = NULL;
+    return 0;
+  }
+  pg->schema = PQescapeIdentifier(pg->conn, schema, strlen(schema));
+  if (!pg->schema || !out_init(&pg->copy, -1)) {
+    fprintf(stderr, "Failed to allocate Postgres sink.\n");
+    return 0;
+  }
+  pg->copy.sink = pg_copy_put;
+  pg->copy.sink_ctx = pg->conn;
   return 1;
 }
 
-static int parse_date(const char *s, struct tm *out) {
-  int y = 0, m = 0, d = 0;
-  if (sscanf(s, "%d-%d-%d", &y, &m, &d) != 3) return 0;
-  if (y < 1900 || m < 1 || m > 12 || d < 1 || d > 31) return 0;
-  memset(out, 0, sizeof(struct tm));
-  out->tm_year = y - 1900;
-  out->tm_mon = m - 1;
-  out->tm_mday = d;
-  out->tm_isdst = -1;
-  return 1;
+/* Drains the result stream of one statement; returns its first result. */
+static PGresult *pg_next_result(PGconn *conn) {
+  PGresult *res = PQgetResult(conn);
+  PGresult *extra;
+  while ((extra = PQgetResult(conn)) != NULL) PQclear(extra);
+  return res;
 }
 
-static time_t to_time_utc(struct tm tmval) {
-  return mktime(&tmval);
+static void out_copy_str(OutBuf *o, const char *s) {
+  const char *run = s;
+  for (const char *p = s; *p; p++) {
+    char esc;
+    switch (*p) {
+      case '\\': esc = '\\'; break;
+      case '\t': esc = 't'; break;
+      case '\n': esc = 'n'; break;
+      case '\r': esc = 'r'; break;
+      default: continue;
+    }
+    out_bytes(o, run, (size_t)(p - run));
+    out_char(o, '\\');
+    out_char(o, esc);
+    run = p + 1;
+  }
+  out_str(o, run);
 }
 
-static int days_between(time_t a, time_t b) {
-  double diff = difftime(a, b);
-  return (int)(diff / 86400.0);
+static void pg_field_int(OutBuf *o, long long v) {
+  out_char(o, '\t');
+  out_int(o, v);
 }
 
-static int risk_score_for(int days_since, int touchpoints, double attendance, double satisfaction) {
-  int score = 0;
-  if (days_since > 30) score += 3;
-  else if (days_since > 14) score += 2;
-  else if (days_since > 7) score += 1;
+static void pg_field_fixed(OutBuf *o, double v, int decimals) {
+  out_char(o, '\t');
+  out_fixed(o, v, decimals);
+}
 
-  if (touchpoints == 0) score += 2;
-  else if (touchpoints <= 1) score += 1;
+/* Runs one COPY ... FROM STDIN; `kind` picks the rows from r. */
+static int pg_copy_rows(PgSink *pg, const Report *r, const char *report_id, int kind) {
+  static const char *const tables[3] = {
+    "top_risks (report_id, scholar_id, cohort, score, days_since, touchpoints_30d, attendance_rate, "
+    "satisfaction_score",
+    "cohort_summaries (report_id, cohort, count, high, medium, low, high_share, risk_index, "
+    "avg_touchpoints_30d, avg_attendance, avg_satisfaction, avg_days_since",
+    "alerts (report_id, cohort, high_share, risk_index, count, high, medium, low, avg_days_since, "
+    "avg_attendance, avg_satisfaction"
+  };
+  static const char *const percentile_columns =
+    ", attendance_p10, attendance_p50, attendance_p90, satisfaction_p10, satisfaction_p50, satisfaction_p90, "
+    "touchpoints_30d_p10, touchpoints_30d_p50, touchpoints_30d_p90, days_since_p10, days_since_p50, days_since_p90";
+  char sql[1024];
+  snprintf(sql, sizeof(sql), "COPY %s.%s%s) FROM STDIN", pg->schema, tables[kind],
+           kind == 1 && r->percentiles ? percentile_columns : "");
+  PGresult *res = PQexec(pg->conn, sql);
+  int ok = PQresultStatus(res) == PGRES_COPY_IN;
+  PQclear(res);
+  if (!ok) {
+    fprintf(stderr, "Failed to start Postgres COPY: %s", PQerrorMessage(pg->conn));
+    return 0;
+  }
 
-  if (attendance < 0.6) score += 2;
-  else if (attendance < 0.8) score += 1;
+  OutBuf *o = &pg->copy;
+  int count = kind == 0 ? r->risk_count : kind == 1 ? r->cohort_display : r->alert_count;
+  for (int i = 0; i < count; i++) {
+    out_str(o, report_id);
+    out_char(o, '\t');
+    if (kind == 0) {
+      const RiskEntry *e = &r->risks[i];
+      out_copy_str(o, e->id);
+      out_char(o, '\t');
+      out_copy_str(o, e->cohort);
+      pg_field_int(o, e->risk_score);
+      pg_field_int(o, e->days_since);
+      pg_field_int(o, e->touchpoints_30d);
+      pg_field_fixed(o, e->attendance_rate, 2);
+      pg_field_fixed(o, e->satisfaction_score, 2);
+    } else if (kind == 1) {
+      const CohortSummary *c = &r->summaries[i];
+      out_copy_str(o, c->cohort);
+      pg_field_int(o, c->count);
+      pg_field_int(o, c->high);
+      pg_field_int(o, c->medium);
+      pg_field_int(o, c->low);
+      pg_field_fixed(o, c->high_share, 2);
+      pg_field_fixed(o, c->risk_index, 2);
+      pg_field_fixed(o, c->avg_touchpoints, 2);
+      pg_field_fixed(o, c->avg_attendance, 2);
+      pg_field_fixed(o, c->avg_satisfaction, 2);
+      pg_field_fixed(o, c->avg_days, 1);
+      for (int m = 0; r->percentiles && m < SKETCH_METRICS; m++) {
+        for (int q = 0; q < SKETCH_QUANTILES; q++) {
+          pg_field_fixed(o, c->percentiles[m][q], k_sketch_metrics[m].integral ? 0 : 2);
+        }
+      }
+    } else {
+      const CohortAlert *a = &r->alerts[i];
+      out_copy_str(o, a->cohort);
+      pg_field_fixed(o, a->high_ratio, 2);
+      pg_field_fixed(o, a->risk_index, 2);
+      pg_field_int(o, a->count);
+      pg_field_int(o, a->high);
+      pg_field_int(o, a->medium);
+      pg_field_int(o, a->low);
+      pg_field_fixed(o, a->avg_days, 1);
+      pg_field_fixed(o, a->avg_attendance, 2);
+      pg_field_fixed(o, a->avg_satisfaction, 2);
+    }
+    out_char(o, '\n');
+  }
+  ok = out_flush(o);
+  o->failed = 0;
+  if (PQputCopyEnd(pg->conn, ok ? NULL : "client write failed") != 1) ok = 0;
+  res = pg_next_result(pg->conn);
+  if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+    fprintf(stderr, "Failed to copy rows to Postgres: %s", PQerrorMessage(pg->conn));
+    ok = 0;
+  }
+  PQclear(res);
+  return ok;
+}
 
-  if (satisfaction < 3.0) score += 2;
-  else if (satisfaction < 4.0) score += 1;
+/* Inserts r as one reports row plus its top risks, cohort summaries and
+   alerts. `source` fills reports.source_label. */
+static int pg_sink_write(PgSink *pg, const Report *r, const char *source) {
+  const RunTotals *t = r->totals;
+  char filter[1024] = "";
+  size_t filter_len = 0;
+  for (int i = 0; i < r->cohort_filter_count; i++) {
+    int n = snprintf(filter + filter_len, sizeof(filter) - filter_len, "%s%s", i ? "," : "", r->cohort_filters[i]);
+    if (n < 0 || (size_t)n >= sizeof(filter) - filter_len) break;
+    filter_len += (size_t)n;
+  }
+  char numbers[15][32];
+  const int ints[14] = {t->valid_count, t->invalid_rows, t->invalid_columns, t->invalid_numeric,
+                        t->invalid_date_format, t->invalid_range, t->clamped_values, t->missing_ids,
+                        t->missing_dates, t->future_dates, t->high_count, t->medium_count, t->low_count,
+                        r->min_cohort_size};
+  for (int i = 0; i < 14; i++) snprintf(numbers[i], sizeof(numbers[i]), "%d", ints[i]);
+  snprintf(numbers[14], sizeof(numbers[14]), "%.2f", r->alert_threshold);
+  const char *params[18] = {r->reference_date, r->cohort_filter_count ? filter : NULL};
+  for (int i = 0; i < 13; i++) params[2 + i] = numbers[i];
+  params[15] = numbers[14];
+  params[16] = numbers[13];
+  params[17] = source;
+
+  char version_sql[256];
+  char insert_sql[1024];
+  snprintf(version_sql, sizeof(version_sql), "SELECT COALESCE(MAX(version), 0) FROM %s.schema_migrations", pg->schema);
+  snprintf(insert_sql, sizeof(insert_sql),
+           "INSERT INTO %s.reports (reference_date, cohort_filter, valid_records, invalid_records, "
+           "invalid_columns, invalid_numeric, invalid_date_format, invalid_range, clamped_values, missing_ids, "
+           "missing_dates, future_dates, risk_high, risk_medium, risk_low, alert_threshold, min_cohort_size, "
+           "source_label) VALUES ($1, $2, $3, $4, $5, $6, $7, $8, $9, $10, $11, $12, $13, $14, $15, $16, $17, $18) "
+           "RETURNING report_id",
+           pg->schema);
+
+  int first = pg->reports == 0;
+  int ok = PQenterPipelineMode(pg->conn) == 1;
+  if (ok && first) {
+    ok = PQsendQueryParams(pg->conn, "BEGIN", 0, NULL, NULL, NULL, NULL, 0) == 1 &&
+         PQsendQueryParams(pg->conn, version_sql, 0, NULL, NULL, NULL, NULL, 0) == 1;
+  }
+  ok = ok && PQsendQueryParams(pg->conn, insert_sql, 18, NULL, params, NULL, NULL, 0) == 1 &&
+       PQpipelineSync(pg->conn) == 1;
+  if (!ok) {
+    fprintf(stderr, "Failed to send report to Postgres: %s", PQerrorMessage(pg->conn));
+    return 0;
+  }
 
-  return score;
+  char report_id[64] = "";
+  int version = PG_SCHEMA_VERSION;
+  for (int q = first ? 0 : 2; q < 3; q++) {
+    PGresult *res = pg_next_result(pg->conn);
+    ExecStatusType status = PQresultStatus(res);
+    if (status != (q == 0 ? PGRES_COMMAND_OK : PGRES_TUPLES_OK)) {
+      if (ok) fprintf(stderr, "Failed to insert report into Postgres: %s", PQresultErrorMessage(res));
+      if (ok && q == 1) fprintf(stderr, "Run scripts/bulk_load.py --migrate to create the schema.\n");
+      ok = 0;
+    } else if (q == 1) {
+      version = atoi(PQgetvalue(res, 0, 0));
+    } else if (q == 2) {
+      snprintf(report_id, sizeof(report_id), "%s", PQgetvalue(res, 0, 0));
+    }
+    PQclear(res);
+  }
+  PQclear(PQgetResult(pg->conn));
+  if (PQexitPipelineMode(pg->conn) != 1) ok = 0;
+  if (ok && version < PG_SCHEMA_VERSION) {
+    fprintf(stderr, "Postgres schema is at version %d, need %d; run scripts/bulk_load.py --migrate.\n", version,
+            PG_SCHEMA_VERSION);
+    ok = 0;
+  }
+  if (!ok) return 0;
+  pg->reports++;
+
+  for (int kind = 0; kind < 3; kind++) {
+    if (!pg_copy_rows(pg, r, report_id, kind)) return 0;
+  }
+  return 1;
 }
 
-static const char *risk_label(int score) {
-  if (score >= 6) return "high";
-  if (score >= 3) return "medium";
-  return "low";
+static int pg_sink_commit(PgSink *pg) {
+  PGresult *res = PQexec(pg->conn, "COMMIT");
+  int ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+  if (!ok) fprintf(stderr, "Failed to commit to Postgres: %s", PQerrorMessage(pg->conn));
+  PQclear(res);
+  return ok;
 }
 
-static double cohort_risk_index(int high, int medium, int low) {
-  int count = high + medium + low;
-  if (count == 0) return 0.0;
-  return (high * 3.0 + medium * 2.0 + low * 1.0) / (double)count;
+/* Closes the connection; an uncommitted transaction rolls back. */
+static void pg_sink_close(PgSink *pg) {
+  if (pg->schema) PQfreemem(pg->schema);
+  if (pg->copy.buf) out_close(&pg->copy);
+  if (pg->conn) PQfinish(pg->conn);
+  memset(pg, 0, sizeof(PgSink));
+}
+#else
+typedef struct {
+  int unused;
+} PgSink;
+
+static int pg_sink_open(PgSink *pg, const char *conninfo, const char *schema) {
+  (void)pg;
+  (void)conninfo;
+  (void)schema;
+  fprintf(stderr, "--pg-sink needs a build with -DSENTINEL_PG and -lpq.\n");
+  return 0;
 }
 
-static CohortSort cohort_sort_mode(const char *value, int *ok) {
-  if (strcmp(value, "risk") == 0) {
-    *ok = 1;
-    return SORT_RISK;
-  }
-  if (strcmp(value, "high") == 0) {
-    *ok = 1;
-    return SORT_HIGH;
-  }
-  if (strcmp(value, "name") == 0) {
-    *ok = 1;
-    return SORT_NAME;
-  }
-  *ok = 0;
-  return SORT_RISK;
+static int pg_sink_write(PgSink *pg, const Report *r, const char *source) {
+  (void)pg;
+  (void)r;
+  (void)source;
+  return 0;
 }
 
-static int matches_cohort(const char *cohort, char **filters, int filter_count) {
-  if (filter_count == 0) return 1;
-  for (int i = 0; i < filter_count; i++) {
-    if (strcmp(cohort, filters[i]) == 0) return 1;
-  }
+static int pg_sink_commit(PgSink *pg) {
+  (void)pg;
   return 0;
 }
 
-static void usage(const char *name) {
-  printf("Group Scholar Cohort Health Sentinel\n\n");
-  printf("Usage: %s --input <file> [--json <file>] [--cohort-csv <file>] [--alert-csv <file>] [--as-of YYYY-MM-DD] [--limit N]\n", name);
-  printf("          [--alert-threshold PCT] [--min-cohort-size N] [--cohort NAME[,NAME]]\n");
-  printf("          [--cohort-sort risk|high|name] [--cohort-limit N] [--clamp-ranges]\n\n");
-  printf("Options:\n");
-  printf("  --input   CSV file with scholar engagement data\n");
-  printf("  --json    Write JSON output to file\n");
-  printf("  --cohort-csv  Write cohort summary CSV to file\n");
-  printf("  --alert-csv  Write cohort alert CSV to file\n");
-  printf("  --as-of   Reference date for recency calculations\n");
-  printf("  --limit   Limit number of risk entries shown (default 10)\n");
-  printf("  --cohort-sort   Sort cohort summary by risk, high, or name (default risk)\n");
-  printf("  --cohort-limit  Limit number of cohorts shown in summary\n");
-  printf("  --alert-threshold  High-risk share that triggers cohort alert (default 0.30)\n");
-  printf("  --min-cohort-size  Minimum cohort size for alerts (default 5)\n");
-  printf("  --cohort  Filter results to one or more cohorts (comma-separated)\n");
-  printf("  --clamp-ranges  Clamp out-of-range numeric values instead of marking invalid\n");
+static void pg_sink_close(PgSink *pg) {
+  (void)pg;
 }
+#endif
+
+/* --serve: a resident, fully scored snapshot of one input answering report
+   queries over a unix socket. Rows are grouped by interned cohort name and
+   scored once; each name keeps the counters its rows add to the run totals
+   and its rows in top-risk order. A query sums the counters of the names
+   its filter matches, picks its cohorts from summaries presorted for every
+   --cohort-sort mode and merges the matching names' risk lists, so the
+   answer equals the --json report of a run with the same options. */
+typedef struct {
+  int score;
+  int days_since;
+  const char *id;
+  size_t offset;
+  int row;
+} ServeRisk;
 
-static int find_or_add_cohort(CohortStats *cohorts, int *count, const char *name) {
-  for (int i = 0; i < *count; i++) {
-    if (strcmp(cohorts[i].name, name) == 0) return i;
-  }
-  if (*count >= 200) return -1;
-  snprintf(cohorts[*count].name, MAX_NAME, "%s", name);
-  cohorts[*count].count = 0;
-  cohorts[*count].high = 0;
-  cohorts[*count].medium = 0;
-  cohorts[*count].low = 0;
-  cohorts[*count].attendance_sum = 0;
-  cohorts[*count].satisfaction_sum = 0;
-  cohorts[*count].touchpoints_sum = 0;
-  cohorts[*count].days_since_sum = 0;
-  (*count)++;
-  return *count - 1;
-}
-
-static int compare_risk(const void *a, const void *b) {
-  const RiskEntry *ra = (const RiskEntry *)a;
-  const RiskEntry *rb = (const RiskEntry *)b;
-  if (rb->risk_score != ra->risk_score) return rb->risk_score - ra->risk_score;
+typedef struct {
+  ScholarColumns columns;
+  CacheKey source;
+  int as_of_day;
+  RunTotals base_totals;
+  RunTotals *name_totals;
+  CohortTable cohorts;
+  CohortSummary *sorted[3];
+  ServeRisk *risks;
+  int *risk_start;
+  int risk_count;
+} ServeSnapshot;
+
+/* What a snapshot is built from, and the query defaults from the command
+   line. */
+typedef struct {
+  const char *input;
+  const char *cache_path;
+  const char *as_of_str;
+  int clamp_ranges;
+  const ScoringProfile *profile;
+  const char *cohort_filter;
+  const char *cohort_sort;
+  int limit;
+  int cohort_limit;
+  double alert_threshold;
+  int min_cohort_size;
+  int percentiles;
+} ServeConfig;
+
+
+static int compare_serve_risk(const void *a, const void *b) {
+  const ServeRisk *ra = (const ServeRisk *)a;
+  const ServeRisk *rb = (const ServeRisk *)b;
+  if (rb->score != ra->score) return rb->score - ra->score;
   if (rb->days_since != ra->days_since) return rb->days_since - ra->days_since;
-  return strcmp(ra->id, rb->id);
-}
-
-static int compare_cohort_summary(const void *a, const void *b) {
-  const CohortSummary *ca = (const CohortSummary *)a;
-  const CohortSummary *cb = (const CohortSummary *)b;
-  if (g_cohort_sort == SORT_NAME) {
-    return strcmp(ca->cohort, cb->cohort);
-  }
-  if (g_cohort_sort == SORT_HIGH) {
-    if (cb->high_share > ca->high_share) return 1;
-    if (cb->high_share < ca->high_share) return -1;
-    if (cb->risk_index > ca->risk_index) return 1;
-    if (cb->risk_index < ca->risk_index) return -1;
-    return strcmp(ca->cohort, cb->cohort);
-  }
-  if (cb->risk_index > ca->risk_index) return 1;
-  if (cb->risk_index < ca->risk_index) return -1;
-  if (cb->high_share > ca->high_share) return 1;
-  if (cb->high_share < ca->high_share) return -1;
-  return strcmp(ca->cohort, cb->cohort);
+  int r = strcmp(ra->id, rb->id);
+  if (r != 0) return r;
+  return (ra->offset > rb->offset) - (ra->offset < rb->offset);
 }
 
-static int compare_alerts(const void *a, const void *b) {
-  const CohortAlert *ca = (const CohortAlert *)a;
-  const CohortAlert *cb = (const CohortAlert *)b;
-  if (cb->high_ratio > ca->high_ratio) return 1;
-  if (cb->high_ratio < ca->high_ratio) return -1;
-  if (cb->risk_index > ca->risk_index) return 1;
-  if (cb->risk_index < ca->risk_index) return -1;
-  return strcmp(ca->cohort, cb->cohort);
+static void serve_snapshot_free(ServeSnapshot *snap) {
+  if (!snap) return;
+  columns_free(&snap->columns);
+  free(snap->name_totals);
+  cohort_table_free(&snap->cohorts);
+  for (int i = 0; i < 3; i++) free(snap->sorted[i]);
+  free(snap->risks);
+  free(snap->risk_start);
+  free(snap);
 }
 
-int main(int argc, char **argv) {
-  const char *input = NULL;
-  const char *json_path = NULL;
-  const char *cohort_csv_path = NULL;
-  const char *alert_csv_path = NULL;
-  const char *as_of_str = NULL;
-  const char *cohort_filter = NULL;
-  const char *cohort_sort = "risk";
-  int limit = 10;
-  int cohort_limit = -1;
-  double alert_threshold = 0.30;
-  int min_cohort_size = 5;
-  int clamp_ranges = 0;
-  char *cohort_filter_buffer = NULL;
-  char **cohort_filters = NULL;
-  int cohort_filter_count = 0;
 
-  for (int i = 1; i < argc; i++) {
-    if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
-      input = argv[++i];
-    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
-      json_path = argv[++i];
-    } else if (strcmp(argv[i], "--cohort-csv") == 0 && i + 1 < argc) {
-      cohort_csv_path = argv[++i];
-    } else if (strcmp(argv[i], "--alert-csv") == 0 && i + 1 < argc) {
-      alert_csv_path = argv[++i];
-    } else if (strcmp(argv[i], "--as-of") == 0 && i + 1 < argc) {
-      as_of_str = argv[++i];
-    } else if (strcmp(argv[i], "--cohort") == 0 && i + 1 < argc) {
-      cohort_filter = argv[++i];
-    } else if (strcmp(argv[i], "--cohort-sort") == 0 && i + 1 < argc) {
-      cohort_sort = argv[++i];
-    } else if (strcmp(argv[i], "--cohort-limit") == 0 && i + 1 < argc) {
-      if (!parse_int(argv[++i], &cohort_limit)) {
-        fprintf(stderr, "Invalid --cohort-limit value.\n");
-        return 1;
-      }
-    } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
-      limit = atoi(argv[++i]);
-    } else if (strcmp(argv[i], "--alert-threshold") == 0 && i + 1 < argc) {
-      if (!parse_double(argv[++i], &alert_threshold)) {
-        fprintf(stderr, "Invalid --alert-threshold value.\n");
-        return 1;
-      }
-    } else if (strcmp(argv[i], "--min-cohort-size") == 0 && i + 1 < argc) {
-      if (!parse_int(argv[++i], &min_cohort_size)) {
-        fprintf(stderr, "Invalid --min-cohort-size value.\n");
-        return 1;
-      }
-    } else if (strcmp(argv[i], "--clamp-ranges") == 0) {
-      clamp_ranges = 1;
-    } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
-      usage(argv[0]);
-      return 0;
+/* Groups the eligible rows by name and scores each group with one kernel
+   call, keeping its counters, cohort stats and sorted risk list. */
+static int serve_score_snapshot(ServeSnapshot *snap, const ScoringProfile *profile) {
+  const ScholarColumns *cols = &snap->columns;
+  int name_count = cols->names.count;
+  snap->name_totals = (RunTotals *)calloc((size_t)(name_count > 0 ? name_count : 1), sizeof(RunTotals));
+  snap->risk_start = (int *)calloc((size_t)name_count + 1, sizeof(int));
+  if (!snap->name_totals || !snap->risk_start) return 0;
+  for (int i = 0; i < cols->count; i++) {
+    int cid = cols->cohort_ids[i];
+    if (cols->state[i] == ROW_INVALID) {
+      snap->base_totals.invalid_rows++;
+    } else if (cols->state[i] == ROW_BAD_DATE) {
+      snap->name_totals[cid].invalid_rows++;
+      snap->name_totals[cid].invalid_date_format++;
+    } else {
+      snap->risk_start[cid + 1]++;
+    }
+  }
+  for (int i = 0; i < name_count; i++) snap->risk_start[i + 1] += snap->risk_start[i];
+  int n = snap->risk_start[name_count];
+  snap->risk_count = n;
+
+  size_t rows = (size_t)(n > 0 ? n : 1);
+  int *fill = (int *)malloc(sizeof(int) * (size_t)(name_count > 0 ? name_count : 1));
+  int *days = (int *)malloc(sizeof(int) * rows);
+  int *touchpoints = (int *)malloc(sizeof(int) * rows);
+  double *attendance = (double *)malloc(sizeof(double) * rows);
+  double *satisfaction = (double *)malloc(sizeof(double) * rows);
+  unsigned char *eligible = (unsigned char *)malloc(rows);
+  int *days_since = (int *)malloc(sizeof(int) * rows);
+  int *scores = (int *)malloc(sizeof(int) * rows);
+  int *tiers = (int *)malloc(sizeof(int) * rows);
+  snap->risks = (ServeRisk *)malloc(sizeof(ServeRisk) * rows);
+  int ok = fill && days && touchpoints && attendance && satisfaction && eligible && days_since && scores && tiers &&
+           snap->risks;
+  if (ok) {
+    memcpy(fill, snap->risk_start, sizeof(int) * (size_t)name_count);
+    memset(eligible, 1, rows);
+    for (int i = 0; i < cols->count; i++) {
+      if (cols->state[i] != ROW_VALID) continue;
+      int p = fill[cols->cohort_ids[i]]++;
+      days[p] = cols->days[i];
+      touchpoints[p] = cols->touchpoints[i];
+      attendance[p] = cols->attendance[i];
+      satisfaction[p] = cols->satisfaction[i];
+      snap->risks[p].row = i;
     }
   }
 
+  ScoreContext ctx;
+  TopRisks none;
+  memset(&ctx, 0, sizeof(ScoreContext));
+  memset(&none, 0, sizeof(TopRisks));
+  ctx.risks = &none;
+  ScoreKernelFn kernel = select_score_kernel(profile);
+  ScoreBlock block = {snap->as_of_day, days, touchpoints, attendance, satisfaction, eligible,
+                      days_since, scores, tiers, profile};
+  for (int cid = 0; ok && cid < name_count; cid++) {
+    int start = snap->risk_start[cid];
+    int end = snap->risk_start[cid + 1];
+    if (start == end) continue;
+    int counts[KC_COUNT] = {0};
+    kernel(&block, start, end, counts);
+    run_totals_add_counts(&snap->name_totals[cid], counts);
+    const CohortStats *name = &cols->names.entries[cid];
+    StrView cohort = {name->name, name->name_len};
+    int idx = find_or_add_cohort(&snap->cohorts, cohort);
+    ok = idx >= 0;
+    for (int p = start; ok && p < end; p++) {
+      int row = snap->risks[p].row;
+      StrView id = {cols->arena + cols->id_offsets[row], cols->id_lens[row]};
+      account_row(&ctx, &snap->cohorts.entries[idx], scores[p], tiers[p], days_since[p], touchpoints[p],
+                  attendance[p], satisfaction[p], id, cohort, cols->offsets[row]);
+      snap->risks[p].score = scores[p];
+      snap->risks[p].days_since = days_since[p];
+      snap->risks[p].id = id.ptr;
+      snap->risks[p].offset = cols->offsets[row];
+    }
+    if (ok && end - start > 1) qsort(snap->risks + start, (size_t)(end - start), sizeof(ServeRisk), compare_serve_risk);
+  }
+
+  /* Summaries are sorted once per mode here, never per query. */
+  for (int mode = 0; ok && mode < 3; mode++) {
+    snap->sorted[mode] = build_cohort_summaries(&snap->cohorts, (CohortSort)mode, 1);
+    ok = snap->sorted[mode] != NULL;
+  }
+
+  free(fill);
+  free(days);
+  free(touchpoints);
+  free(attendance);
+  free(satisfaction);
+  free(eligible);
+  free(days_since);
+  free(scores);
+  free(tiers);
+  return ok;
+}
+
+/* Reads and scores config->input into a new snapshot, or returns NULL after
+   reporting why. */
+static ServeSnapshot *serve_load(const ServeConfig *config) {
+  ServeSnapshot *snap = (ServeSnapshot *)calloc(1, sizeof(ServeSnapshot));
+  if (!snap || !columns_init(&snap->columns) || !cohort_table_init(&snap->cohorts)) {
+    fprintf(stderr, "Failed to allocate snapshot.\n");
+    serve_snapshot_free(snap);
+    return NULL;
+  }
+  snap->cohorts.sketched = config->percentiles;
+  snap->as_of_day = local_today();
+  if (config->as_of_str) parse_date(config->as_of_str, &snap->as_of_day);
+
+  InputReader reader;
+  if (!input_open(&reader, config->input)) {
+    perror("Failed to open input file");
+    serve_snapshot_free(snap);
+    return NULL;
+  }
+  if (!cache_source_key(&reader, &snap->source)) {
+    fprintf(stderr, "--serve needs a regular --input file.\n");
+    input_close(&reader);
+    serve_snapshot_free(snap);
+    return NULL;
+  }
+  DateCache dates;
+  memset(&dates, 0, sizeof(DateCache));
+  int loaded = load_columns(&reader, config->cache_path, config->clamp_ranges, &snap->columns, &snap->base_totals,
+                            &dates);
+  input_close(&reader);
+  if (loaded < 0) {
+    serve_snapshot_free(snap);
+    return NULL;
+  }
+  if (!serve_score_snapshot(snap, config->profile)) {
+    fprintf(stderr, "Failed to allocate snapshot.\n");
+    serve_snapshot_free(snap);
+    return NULL;
+  }
+  fprintf(stderr, "Loaded %s: %d rows, %d cohorts%s\n", config->input, snap->base_totals.data_rows,
+          snap->cohorts.count, loaded == 1 ? " (from cache)" : "");
+  return snap;
+}
+
+/* Parses one query line of key=value pairs separated by '&' over the
+   command-line defaults. Returns 0 on an unknown key or bad value. */
+static int serve_parse_query(char *line, const ServeConfig *config, const char **cohort, CohortSort *sort,
+                             int *limit, int *cohort_limit, double *alert_threshold, int *min_cohort_size) {
   int sort_ok = 0;
-  g_cohort_sort = cohort_sort_mode(cohort_sort, &sort_ok);
-  if (!sort_ok) {
-    fprintf(stderr, "Invalid --cohort-sort value. Use risk, high, or name.\n");
-    return 1;
+  *cohort = config->cohort_filter;
+  *sort = cohort_sort_mode(config->cohort_sort, &sort_ok);
+  *limit = config->limit;
+  *cohort_limit = config->cohort_limit;
+  *alert_threshold = config->alert_threshold;
+  *min_cohort_size = config->min_cohort_size;
+  char *save = NULL;
+  for (char *pair = strtok_r(line, "&", &save); pair; pair = strtok_r(NULL, "&", &save)) {
+    char *eq = strchr(pair, '=');
+    if (!eq) return 0;
+    *eq = '\0';
+    char *key = pair;
+    char *value = eq + 1;
+    trim(key);
+    trim(value);
+    int ok = 1;
+    if (strcmp(key, "cohort") == 0) {
+      *cohort = value;
+    } else if (strcmp(key, "cohort_sort") == 0) {
+      *sort = cohort_sort_mode(value, &ok);
+    } else if (strcmp(key, "limit") == 0) {
+      ok = parse_int(value, limit);
+    } else if (strcmp(key, "cohort_limit") == 0) {
+      ok = parse_int(value, cohort_limit);
+    } else if (strcmp(key, "alert_threshold") == 0) {
+      ok = parse_double(value, alert_threshold);
+    } else if (strcmp(key, "min_cohort_size") == 0) {
+      ok = parse_int(value, min_cohort_size);
+    } else {
+      ok = 0;
+    }
+    if (!ok) return 0;
   }
+  if (*limit < 0) *limit = 0;
+  if (*cohort_limit < -1) *cohort_limit = -1;
+  if (*alert_threshold < 0) *alert_threshold = 0;
+  if (*alert_threshold > 1.0) *alert_threshold = 1.0;
+  if (*min_cohort_size < 1) *min_cohort_size = 1;
+  return 1;
+}
 
-  if (!input) {
-    usage(argv[0]);
-    return 1;
+/* Answers one query line from snap. Returns 0 when the answer could not be
+   built (an error object was written instead). */
+static int serve_query(const ServeSnapshot *snap, const ServeConfig *config, char *line, OutBuf *out) {
+  const char *cohort = NULL;
+  CohortSort sort = SORT_RISK;
+  int limit = 0;
+  int cohort_limit = -1;
+  double alert_threshold = 0;
+  int min_cohort_size = 1;
+  if (!serve_parse_query(line, config, &cohort, &sort, &limit, &cohort_limit, &alert_threshold, &min_cohort_size)) {
+    out_str(out, "{\"error\": \"invalid query\"}\n");
+    return 0;
   }
 
-  if (cohort_filter) {
-    cohort_filter_buffer = strdup(cohort_filter);
-    if (!cohort_filter_buffer) {
-      fprintf(stderr, "Failed to allocate cohort filter buffer.\n");
-      return 1;
+  char *filter_buffer = NULL;
+  char **filters = NULL;
+  int filter_count = 0;
+  const ScholarColumns *cols = &snap->columns;
+  int name_count = cols->names.count;
+  unsigned char *match = (unsigned char *)malloc((size_t)(name_count > 0 ? name_count : 1));
+  CohortSummary *summaries = (CohortSummary *)malloc(sizeof(CohortSummary) * (size_t)(snap->cohorts.count + 1));
+  CohortAlert *alerts = NULL;
+  TopRisks top;
+  int ok = top_risks_init(&top, limit) && match && summaries &&
+           (!cohort || split_cohort_filters(cohort, &filter_buffer, &filters, &filter_count));
+
+  RunTotals totals = snap->base_totals;
+  int cohort_count = 0;
+  for (int i = 0; ok && i < name_count; i++) {
+    StrView name = {cols->names.entries[i].name, cols->names.entries[i].name_len};
+    match[i] = (unsigned char)matches_cohort(name, filters, filter_count);
+    if (match[i]) run_totals_merge(&totals, &snap->name_totals[i]);
+  }
+  for (int i = 0; ok && i < snap->cohorts.count; i++) {
+    const CohortSummary *c = &snap->sorted[sort][i];
+    StrView name = {c->cohort, strlen(c->cohort)};
+    if (matches_cohort(name, filters, filter_count)) summaries[cohort_count++] = *c;
+  }
+  for (int i = 0; ok && i < name_count; i++) {
+    if (!match[i]) continue;
+    for (int p = snap->risk_start[i]; p < snap->risk_start[i + 1]; p++) {
+      const ServeRisk *r = &snap->risks[p];
+      int row = r->row;
+      StrView id = {r->id, cols->id_lens[row]};
+      if (!top_risks_admits(&top, r->score, r->days_since, id, r->offset)) break;
+      RiskEntry entry;
+      memset(&entry, 0, sizeof(RiskEntry));
+      entry.cohort = cols->names.entries[i].name;
+      entry.risk_score = r->score;
+      entry.days_since = r->days_since;
+      entry.touchpoints_30d = cols->touchpoints[row];
+      entry.attendance_rate = cols->attendance[row];
+      entry.satisfaction_score = cols->satisfaction[row];
+      entry.offset = r->offset;
+      top_risks_push(&top, &entry, id);
     }
-    int slots = 4;
-    cohort_filters = (char **)malloc(sizeof(char *) * slots);
-    if (!cohort_filters) {
-      fprintf(stderr, "Failed to allocate cohort filters.\n");
-      free(cohort_filter_buffer);
-      return 1;
+  }
+  int alert_count = ok && !top.failed ? build_alerts(summaries, cohort_count, alert_threshold, min_cohort_size, &alerts)
+                                      : -1;
+  ok = ok && alert_count >= 0;
+
+  if (ok) {
+    top_risks_finish(&top, 1);
+    Report report;
+    memset(&report, 0, sizeof(Report));
+    report.reference_date = config->as_of_str ? config->as_of_str : "today";
+    report.cohort_sort = k_sort_names[sort];
+    report.cohort_filters = filters;
+    report.cohort_filter_count = filter_count;
+    report.totals = &totals;
+    report.risks = top.entries;
+    report.risk_count = top.count;
+    report.summaries = summaries;
+    report.cohort_count = cohort_count;
+    report.cohort_display = cohort_limit >= 0 && cohort_limit < cohort_count ? cohort_limit : cohort_count;
+    report.alerts = alerts;
+    report.alert_count = alert_count;
+    report.alert_threshold = alert_threshold;
+    report.min_cohort_size = min_cohort_size;
+    report.profile = config->profile;
+    report.percentiles = config->percentiles;
+    write_json_report(out, &report);
+  } else {
+    out_str(out, "{\"error\": \"out of memory\"}\n");
+  }
+  top_risks_free(&top);
+  free(match);
+  free(summaries);
+  free(alerts);
+  free(filter_buffer);
+  free(filters);
+  return ok;
+}
+
+/* Workers announce the snapshot they are reading in their in_use slot, so a
+   reload can publish a new one with a single pointer swap and free the old
+   one once no slot holds it. Readers never take a lock. */
+typedef struct {
+  _Atomic(ServeSnapshot *) current;
+  _Atomic(ServeSnapshot *) *in_use;
+  atomic_int *client_fd;
+  atomic_int stopping;
+  int workers;
+  int listen_fd;
+  const ServeConfig *config;
+} ServeServer;
+
+typedef struct {
+  ServeServer *server;
+  int index;
+} ServeWorker;
+
+static const ServeSnapshot *serve_acquire(ServeServer *server, int w) {
+  ServeSnapshot *snap = atomic_load(&server->current);
+  for (;;) {
+    atomic_store(&server->in_use[w], snap);
+    ServeSnapshot *again = atomic_load(&server->current);
+    if (again == snap) return snap;
+    snap = again;
+  }
+}
+
+static void serve_publish(ServeServer *server, ServeSnapshot *snap) {
+  ServeSnapshot *old = atomic_exchange(&server->current, snap);
+  for (int w = 0; w < server->workers; w++) {
+    while (atomic_load(&server->in_use[w]) == old) {
+      struct timespec pause = {0, 1000000};
+      nanosleep(&pause, NULL);
     }
-    char *token = strtok(cohort_filter_buffer, ",");
-    while (token) {
-      trim(token);
-      if (*token) {
-        if (cohort_filter_count >= slots) {
-          slots *= 2;
-          char **resized = (char **)realloc(cohort_filters, sizeof(char *) * slots);
-          if (!resized) {
-            fprintf(stderr, "Failed to expand cohort filters.\n");
-            free(cohort_filter_buffer);
-            free(cohort_filters);
-            return 1;
-          }
-          cohort_filters = resized;
-        }
-        cohort_filters[cohort_filter_count++] = token;
-      }
-      token = strtok(NULL, ",");
+  }
+  serve_snapshot_free(old);
+}
+
+/* Answers every query line on each accepted connection in turn. */
+static void *serve_worker(void *arg) {
+  ServeWorker *worker = (ServeWorker *)arg;
+  ServeServer *server = worker->server;
+  int w = worker->index;
+  char *line = NULL;
+  size_t line_cap = 0;
+  OutBuf out;
+  if (!out_init(&out, -1)) return NULL;
+  while (!atomic_load(&server->stopping)) {
+    int fd = accept(server->listen_fd, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      break;
+    }
+    atomic_store(&server->client_fd[w], fd);
+    FILE *in = fdopen(fd, "r");
+    if (!in) {
+      close(fd);
+      atomic_store(&server->client_fd[w], -1);
+      continue;
     }
-    if (cohort_filter_count == 0) {
-      free(cohort_filters);
-      cohort_filters = NULL;
+    out.fd = fd;
+    out.failed = 0;
+    ssize_t got;
+    while ((got = getline(&line, &line_cap, in)) > 0) {
+      while (got > 0 && (line[got - 1] == '\n' || line[got - 1] == '\r')) line[--got] = '\0';
+      const ServeSnapshot *snap = serve_acquire(server, w);
+      serve_query(snap, server->config, line, &out);
+      atomic_store(&server->in_use[w], NULL);
+      if (!out_flush(&out)) break;
     }
+    atomic_store(&server->client_fd[w], -1);
+    fclose(in);
   }
+  out.fd = -1;
+  out_close(&out);
+  free(line);
+  return NULL;
+}
 
-  if (limit < 0) limit = 0;
-  if (cohort_limit < -1) cohort_limit = -1;
-  if (alert_threshold < 0) alert_threshold = 0;
-  if (alert_threshold > 1.0) alert_threshold = 1.0;
-  if (min_cohort_size < 1) min_cohort_size = 1;
+static int serve_same_source(const CacheKey *a, const CacheKey *b) {
+  return a->size == b->size && a->mtime_sec == b->mtime_sec && a->mtime_nsec == b->mtime_nsec;
+}
 
-  FILE *fp = fopen(input, "r");
-  if (!fp) {
-    perror("Failed to open input file");
-    free(cohort_filter_buffer);
-    free(cohort_filters);
+static int serve_stat_source(const char *path, CacheKey *key) {
+  struct stat st;
+  memset(key, 0, sizeof(CacheKey));
+  if (stat(path, &st) != 0) return 0;
+  key->size = (uint64_t)st.st_size;
+  key->mtime_sec = (int64_t)st.st_mtim.tv_sec;
+  key->mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+  return 1;
+}
+
+static int serve_listen(const char *path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path %s is too long.\n", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("Failed to create socket");
+    return -1;
+  }
+  /* Replace a stale socket file, but never one a live server answers on. */
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+    fprintf(stderr, "Another server is already listening on %s.\n", path);
+    close(fd);
+    return -1;
+  }
+  close(fd);
+  unlink(path);
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+    perror("Failed to listen on socket");
+    if (fd >= 0) close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/* Runs the server until SIGINT or SIGTERM. The input is polled once a
+   second and reloaded after its size or mtime has changed and then held
+   still for a poll, or when the day rolls over without --as-of; SIGHUP
+   reloads at once. A failed reload keeps the current snapshot. */
+static int serve_run(const char *socket_path, const ServeConfig *config, int workers) {
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGHUP);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+  struct sigaction ignore;
+  memset(&ignore, 0, sizeof(ignore));
+  ignore.sa_handler = SIG_IGN;
+  sigaction(SIGPIPE, &ignore, NULL);
+
+  ServeSnapshot *first = serve_load(config);
+  if (!first) return 1;
+  ServeServer server;
+  memset(&server, 0, sizeof(ServeServer));
+  server.workers = workers;
+  server.config = config;
+  server.listen_fd = serve_listen(socket_path);
+  server.in_use = (_Atomic(ServeSnapshot *) *)calloc((size_t)workers, sizeof(*server.in_use));
+  server.client_fd = (atomic_int *)calloc((size_t)workers, sizeof(atomic_int));
+  ServeWorker *jobs = (ServeWorker *)calloc((size_t)workers, sizeof(ServeWorker));
+  pthread_t *tids = (pthread_t *)calloc((size_t)workers, sizeof(pthread_t));
+  if (server.listen_fd < 0 || !server.in_use || !server.client_fd || !jobs || !tids) {
+    if (server.listen_fd >= 0) {
+      close(server.listen_fd);
+      unlink(socket_path);
+    }
+    free(server.in_use);
+    free(server.client_fd);
+    free(jobs);
+    free(tids);
+    serve_snapshot_free(first);
     return 1;
   }
+  atomic_init(&server.current, first);
+  atomic_init(&server.stopping, 0);
+  for (int w = 0; w < workers; w++) {
+    atomic_init(&server.in_use[w], NULL);
+    atomic_init(&server.client_fd[w], -1);
+  }
+  int started = 0;
+  for (; started < workers; started++) {
+    jobs[started].server = &server;
+    jobs[started].index = started;
+    if (pthread_create(&tids[started], NULL, serve_worker, &jobs[started]) != 0) break;
+  }
+  fprintf(stderr, "Serving on %s with %d worker%s\n", socket_path, started, started == 1 ? "" : "s");
+
+  /* The source and day last loaded, or last failed to load, so a broken
+     file is not retried every second. */
+  CacheKey attempted = first->source;
+  CacheKey pending = first->source;
+  int attempted_day = first->as_of_day;
+  while (started > 0) {
+    struct timespec tick = {1, 0};
+    int sig = sigtimedwait(&signals, NULL, &tick);
+    if (sig == SIGINT || sig == SIGTERM) break;
+    CacheKey now;
+    int seen = serve_stat_source(config->input, &now);
+    int changed = seen && !serve_same_source(&now, &attempted) && serve_same_source(&now, &pending);
+    int today = local_today();
+    int new_day = !config->as_of_str && today != attempted_day;
+    pending = now;
+    if (sig != SIGHUP && !changed && !new_day) continue;
+    ServeSnapshot *next = serve_load(config);
+    if (next) {
+      attempted = next->source;
+      serve_publish(&server, next);
+    } else {
+      fprintf(stderr, "Reload failed; still serving the previous snapshot.\n");
+      if (seen) attempted = now;
+    }
+    attempted_day = today;
+  }
 
-  struct tm as_of_tm;
-  time_t as_of_time;
-  if (as_of_str) {
-    if (!parse_date(as_of_str, &as_of_tm)) {
-      fprintf(stderr, "Invalid --as-of date. Use YYYY-MM-DD.\n");
-      fclose(fp);
-      return 1;
+  atomic_store(&server.stopping, 1);
+  shutdown(server.listen_fd, SHUT_RDWR);
+  for (int w = 0; w < workers; w++) {
+    int fd = atomic_load(&server.client_fd[w]);
+    if (fd >= 0) shutdown(fd, SHUT_RD);
+  }
+  for (int w = 0; w < started; w++) pthread_join(tids[w], NULL);
+  close(server.listen_fd);
+  unlink(socket_path);
+  serve_snapshot_free(atomic_load(&server.current));
+  free(server.in_use);
+  free(server.client_fd);
+  free(jobs);
+  free(tids);
+  return started > 0 ? 0 : 1;
+}
+
+/* --trend: one run over dated snapshots of the same export. Each snapshot
+   is scored as of its own date into its own cohort table; the tables are
+   then aligned on one interned name table, so every cohort gets a series
+   and its move since the previous snapshot. A cohort alerts when its
+   high-risk share rose by at least --trend-rise since the previous
+   snapshot, with --min-cohort-size rows in both. */
+#define TREND_DEFAULT_RISE 0.05
+
+typedef struct {
+  int day;
+  char date[MAX_DATE];
+  int files;
+  RunTotals totals;
+  CohortTable cohorts;
+} TrendSnapshot;
+
+typedef struct {
+  int count;
+  int high;
+  int medium;
+  int low;
+} TrendCell;
+
+/* One cohort's series: cells[i] is its count in snapshot i. The change is
+   latest minus previous snapshot, when the cohort has rows in both. */
+typedef struct {
+  const char *cohort;
+  const TrendCell *cells;
+  int has_change;
+  double share_change;
+  double risk_change;
+} TrendCohort;
+
+typedef struct {
+  char **paths;
+  int path_count;
+  int threads;
+  int clamp_ranges;
+  const ScoringProfile *profile;
+  char **cohort_filters;
+  int cohort_filter_count;
+  double rise;
+  double alert_threshold;
+  int min_cohort_size;
+  int cohort_limit;
+  const char *json_path;
+  const char *cohort_csv_path;
+  const char *alert_csv_path;
+} TrendConfig;
+
+typedef struct {
+  TrendSnapshot *snapshots;
+  int count;
+  int capacity;
+  int last;
+  int undated;
+  CohortTable names;
+  TrendCell *cells;
+  TrendCohort *cohorts;
+  int cohort_display;
+} TrendRun;
+
+static void trend_run_free(TrendRun *run) {
+  for (int i = 0; i < run->count; i++) cohort_table_free(&run->snapshots[i].cohorts);
+  free(run->snapshots);
+  cohort_table_free(&run->names);
+  free(run->cells);
+  free(run->cohorts);
+  memset(run, 0, sizeof(TrendRun));
+}
+
+/* Returns the snapshot dated `day`, adding it on first use, or NULL when
+   the table could not grow. Rows of one snapshot usually arrive together,
+   so the search starts at the last hit. */
+static TrendSnapshot *trend_snapshot(TrendRun *run, int day) {
+  for (int n = 0; n < run->count; n++) {
+    int i = (run->last + n) % run->count;
+    if (run->snapshots[i].day == day) {
+      run->last = i;
+      return &run->snapshots[i];
     }
-    as_of_time = to_time_utc(as_of_tm);
-  } else {
-    time_t now = time(NULL);
-    struct tm *local = localtime(&now);
-    as_of_time = to_time_utc(*local);
   }
+  if (run->count == run->capacity) {
+    int capacity = run->capacity ? run->capacity * 2 : 16;
+    TrendSnapshot *grown = (TrendSnapshot *)realloc(run->snapshots, sizeof(TrendSnapshot) * (size_t)capacity);
+    if (!grown) return NULL;
+    run->snapshots = grown;
+    run->capacity = capacity;
+  }
+  TrendSnapshot *snap = &run->snapshots[run->count];
+  memset(snap, 0, sizeof(TrendSnapshot));
+  if (!cohort_table_init(&snap->cohorts)) {
+    cohort_table_free(&snap->cohorts);
+    return NULL;
+  }
+  int y = 0, m = 0, d = 0;
+  civil_from_days(day, &y, &m, &d);
+  snprintf(snap->date, sizeof(snap->date), "%04u-%02u-%02u", (unsigned)y % 10000u, (unsigned)m % 100u, (unsigned)d % 100u);
+  snap->day = day;
+  run->last = run->count++;
+  return snap;
+}
+
+/* The first YYYY-MM-DD in the file name part of path. */
+static int trend_path_day(const char *path, int *day) {
+  const char *name = strrchr(path, '/');
+  name = name ? name + 1 : path;
+  for (size_t i = 0; name[i]; i++) {
+    char text[11];
+    int y = 0, m = 0, d = 0;
+    if (strlen(name + i) < 10) break;
+    memcpy(text, name + i, 10);
+    text[10] = '\0';
+    if (parse_date_fixed(text, &y, &m, &d) && parse_date(text, day)) return 1;
+  }
+  return 0;
+}
+
+static void trend_point(ScoreContext *ctx, TrendSnapshot *snap) {
+  ctx->as_of_day = snap->day;
+  ctx->totals = &snap->totals;
+  ctx->cohorts = &snap->cohorts;
+}
+
+/* Several inputs: each file is the snapshot its name dates. Files are
+   parsed `threads` at a time into buffered columns and scored in list
+   order, so only one batch of columns is resident. */
+static int trend_read_files(TrendRun *run, const TrendConfig *config, ScoreContext *ctx) {
+  int *days = (int *)malloc(sizeof(int) * (size_t)config->path_count);
+  InputCount *counts = (InputCount *)calloc((size_t)config->path_count, sizeof(InputCount));
+  int ok = days && counts;
+  if (!ok) fprintf(stderr, "Failed to allocate per-file counts.\n");
+  for (int i = 0; ok && i < config->path_count; i++) {
+    if (!trend_path_day(config->paths[i], &days[i])) {
+      fprintf(stderr, "--trend needs a YYYY-MM-DD date in each input file name: %s\n", config->paths[i]);
+      ok = 0;
+    }
+  }
+  RunTotals parsed;
+  for (int start = 0; ok && start < config->path_count; start += config->threads) {
+    int n = config->path_count - start < config->threads ? config->path_count - start : config->threads;
+    memset(&parsed, 0, sizeof(RunTotals));
+    ctx->totals = &parsed;
+    FileJob *jobs = ingest_files(config->paths + start, n, n, 0, ctx, config->clamp_ranges, NULL, counts + start);
+    ok = jobs != NULL;
+    for (int i = 0; ok && i < n; i++) {
+      TrendSnapshot *snap = trend_snapshot(run, days[start + i]);
+      if (!snap) {
+        fprintf(stderr, "Failed to allocate trend snapshot.\n");
+        ok = 0;
+        break;
+      }
+      snap->files++;
+      run_totals_merge(&snap->totals, &jobs[i].totals);
+      trend_point(ctx, snap);
+      if (jobs[i].cols.count > 0 && !score_columns(&jobs[i].cols, ctx)) {
+        fprintf(stderr, "Failed to allocate cohort table.\n");
+        ok = 0;
+      }
+    }
+    file_jobs_free(jobs, jobs ? n : 0);
+  }
+  free(days);
+  free(counts);
+  return ok;
+}
 
-  char line[MAX_LINE];
+static StrView trend_last_field(StrView line) {
+  size_t i = line.len;
+  while (i > 0 && line.ptr[i - 1] != ',') i--;
+  StrView field = {line.ptr + i, line.len - i};
+  return trim_view(field);
+}
+
+/* One input: a trailing snapshot_date column puts each row in its
+   snapshot. Rows whose snapshot date does not parse count as undated. */
+static int trend_read_dated(TrendRun *run, const TrendConfig *config, ScoreContext *ctx) {
+  InputReader in;
+  if (!input_open(&in, config->paths[0])) {
+    perror("Failed to open input file");
+    return 0;
+  }
+  DateCache snapshot_dates;
+  memset(&snapshot_dates, 0, sizeof(DateCache));
+  StrView line;
+  StrView fields[6];
+  int field_count = 0;
   int line_num = 0;
-  int capacity = 128;
-  int count = 0;
-  Scholar *scholars = (Scholar *)malloc(sizeof(Scholar) * capacity);
-
-  int missing_dates = 0;
-  int missing_ids = 0;
-  int invalid_rows = 0;
-  int invalid_columns = 0;
-  int invalid_numeric = 0;
-  int invalid_date_format = 0;
-  int invalid_range = 0;
-  int future_dates = 0;
-  int clamped_values = 0;
-  int recency_over_30 = 0;
-  int recency_15_30 = 0;
-  int recency_8_14 = 0;
-  int touchpoints_zero = 0;
-  int touchpoints_one = 0;
-  int attendance_low = 0;
-  int attendance_mid = 0;
-  int satisfaction_low = 0;
-  int satisfaction_mid = 0;
-
-  while (fgets(line, sizeof(line), fp)) {
-    line_num++;
-    if (line_num == 1) continue;
-    if (count >= capacity) {
-      capacity *= 2;
-      scholars = (Scholar *)realloc(scholars, sizeof(Scholar) * capacity);
-    }
-
-    char *token;
-    char *rest = line;
-    char *fields[6];
-    int field_count = 0;
-
-    while ((token = strtok_r(rest, ",", &rest)) && field_count < 6) {
-      fields[field_count++] = token;
-    }
-
-    if (field_count < 6) {
-      invalid_rows++;
-      invalid_columns++;
+  int ok = 1;
+  TrendSnapshot *snap = NULL;
+  while (ok && input_next_row(&in, &line, fields, &field_count)) {
+    StrView date = trend_last_field(line);
+    if (++line_num == 1) {
+      if (date.len != 13 || memcmp(date.ptr, "snapshot_date", 13) != 0) {
+        fprintf(stderr, "--trend over one input needs a trailing snapshot_date column.\n");
+        ok = 0;
+      }
       continue;
     }
-
-    for (int i = 0; i < 6; i++) {
-      trim(fields[i]);
+    int day = 0;
+    if (!date_cache_parse(&snapshot_dates, date, &day)) {
+      run->undated++;
+      continue;
     }
+    if (!snap || snap->day != day) {
+      if (!(snap = trend_snapshot(run, day))) {
+        fprintf(stderr, "Failed to allocate trend snapshot.\n");
+        ok = 0;
+        break;
+      }
+      snap->files = 1;
+      trend_point(ctx, snap);
+    }
+    snap->totals.data_rows++;
+    ScholarRow row;
+    if (!parse_scholar_fields(fields, field_count, &row, &snap->totals, config->clamp_ranges)) continue;
+    row.offset = in.line_offset;
+    score_row(&row, ctx);
+  }
+  if (ok && in.error) {
+    fprintf(stderr, "Failed to read input file %s: %s.\n", config->paths[0], in.error);
+    ok = 0;
+  }
+  input_close(&in);
+  return ok;
+}
 
-    Scholar s;
-    memset(&s, 0, sizeof(Scholar));
-    s.valid = 1;
+static int compare_trend_snapshot(const void *a, const void *b) {
+  const TrendSnapshot *sa = (const TrendSnapshot *)a;
+  const TrendSnapshot *sb = (const TrendSnapshot *)b;
+  return (sa->day > sb->day) - (sa->day < sb->day);
+}
 
-    snprintf(s.id, MAX_NAME, "%s", fields[0]);
-    snprintf(s.cohort, MAX_NAME, "%s", fields[1]);
-    snprintf(s.last_touchpoint, MAX_DATE, "%s", fields[2]);
+static double trend_share(const TrendCell *c) {
+  return c->count ? (double)c->high / c->count : 0;
+}
 
-    if (strlen(s.id) == 0) {
-      missing_ids++;
-      s.valid = 0;
-    }
+/* Largest rise in high-risk share first, then risk index, then name;
+   cohorts without a change follow. */
+static int compare_trend_cohort(const void *a, const void *b) {
+  const TrendCohort *ca = (const TrendCohort *)a;
+  const TrendCohort *cb = (const TrendCohort *)b;
+  if (ca->has_change != cb->has_change) return cb->has_change - ca->has_change;
+  if (ca->share_change != cb->share_change) return ca->share_change < cb->share_change ? 1 : -1;
+  if (ca->risk_change != cb->risk_change) return ca->risk_change < cb->risk_change ? 1 : -1;
+  return strcmp(ca->cohort, cb->cohort);
+}
 
-    if (strlen(s.last_touchpoint) == 0) {
-      missing_dates++;
-      s.valid = 0;
+/* Orders the snapshots, interns every cohort name once and lays the
+   counts out cohort-major. */
+static int trend_finish(TrendRun *run, const TrendConfig *config) {
+  if (run->count > 1) qsort(run->snapshots, (size_t)run->count, sizeof(TrendSnapshot), compare_trend_snapshot);
+  if (!cohort_table_init(&run->names)) return 0;
+  for (int s = 0; s < run->count; s++) {
+    const CohortTable *t = &run->snapshots[s].cohorts;
+    for (int i = 0; i < t->count; i++) {
+      StrView name = {t->entries[i].name, t->entries[i].name_len};
+      if (find_or_add_cohort(&run->names, name) < 0) return 0;
     }
+  }
+  int names = run->names.count;
+  int count = run->count;
+  run->cells = (TrendCell *)calloc((size_t)(names > 0 ? names : 1) * (size_t)(count > 0 ? count : 1), sizeof(TrendCell));
+  run->cohorts = (TrendCohort *)calloc((size_t)(names > 0 ? names : 1), sizeof(TrendCohort));
+  if (!run->cells || !run->cohorts) return 0;
+  for (int s = 0; s < count; s++) {
+    const CohortTable *t = &run->snapshots[s].cohorts;
+    for (int i = 0; i < t->count; i++) {
+      const CohortStats *c = &t->entries[i];
+      StrView name = {c->name, c->name_len};
+      TrendCell *cell = &run->cells[(size_t)find_or_add_cohort(&run->names, name) * (size_t)count + (size_t)s];
+      cell->count = c->count;
+      cell->high = c->high;
+      cell->medium = c->medium;
+      cell->low = c->low;
+    }
+  }
+  for (int i = 0; i < names; i++) {
+    TrendCohort *tc = &run->cohorts[i];
+    tc->cohort = run->names.entries[i].name;
+    tc->cells = &run->cells[(size_t)i * (size_t)count];
+    if (count < 2) continue;
+    const TrendCell *prev = &tc->cells[count - 2];
+    const TrendCell *last = &tc->cells[count - 1];
+    tc->has_change = prev->count > 0 && last->count > 0;
+    if (!tc->has_change) continue;
+    tc->share_change = trend_share(last) - trend_share(prev);
+    tc->risk_change = cohort_risk_index(last->high, last->medium, last->low) -
+                      cohort_risk_index(prev->high, prev->medium, prev->low);
+  }
+  if (names > 1) qsort(run->cohorts, (size_t)names, sizeof(TrendCohort), compare_trend_cohort);
+  run->cohort_display = config->cohort_limit >= 0 && config->cohort_limit < names ? config->cohort_limit : names;
+  return 1;
+}
 
-    int numeric_invalid = 0;
-    if (!parse_int(fields[3], &s.touchpoints_30d)) {
-      s.valid = 0;
-      numeric_invalid = 1;
-    } else if (s.touchpoints_30d < 0) {
-      if (clamp_ranges) {
-        s.touchpoints_30d = 0;
-        clamped_values++;
-      } else {
-        s.valid = 0;
-        invalid_range++;
+static int trend_alerts(const TrendRun *run, const TrendCohort *c, const TrendConfig *config) {
+  return c->has_change && c->cells[run->count - 2].count >= config->min_cohort_size &&
+         c->cells[run->count - 1].count >= config->min_cohort_size && c->share_change >= config->rise;
+}
+
+static void out_signed_fixed(OutBuf *out, double v, int decimals) {
+  if (v >= 0) out_char(out, '+');
+  out_fixed(out, v, decimals);
+}
+
+static void write_trend_text(OutBuf *out, const TrendRun *run, const TrendConfig *config) {
+  const TrendSnapshot *first = &run->snapshots[0];
+  const TrendSnapshot *latest = &run->snapshots[run->count - 1];
+  out_str(out, "Group Scholar Cohort Health Sentinel\n");
+  out_printf(out, "Trend: %d snapshots, %s to %s\n", run->count, first->date, latest->date);
+  if (!profile_is_default(config->profile)) out_printf(out, "Scoring profile: %s\n", config->profile->name);
+  if (run->undated) out_printf(out, "Rows without a snapshot date: %d\n", run->undated);
+  out_str(out, "Snapshot\tFiles\tValid\tInvalid\tHigh\tMedium\tLow\n");
+  for (int s = 0; s < run->count; s++) {
+    const TrendSnapshot *snap = &run->snapshots[s];
+    const RunTotals *t = &snap->totals;
+    out_printf(out, "%s\t%d\t%d\t%d\t%d\t%d\t%d\n", snap->date, snap->files, t->valid_count, t->invalid_rows,
+               t->high_count, t->medium_count, t->low_count);
+  }
+
+  out_str(out, "\nCohort trend (sorted by high-share change");
+  if (run->count > 1) out_printf(out, " since %s", run->snapshots[run->count - 2].date);
+  out_str(out, ")\n");
+  if (run->cohort_display == 0) {
+    out_str(out, "None\n");
+  } else {
+    out_str(out, "Cohort\tCount\tHighShare\tChange\tRiskIndex\tChange\tHighShareSeries\n");
+    for (int i = 0; i < run->cohort_display; i++) {
+      const TrendCohort *c = &run->cohorts[i];
+      const TrendCell *last = &c->cells[run->count - 1];
+      out_str(out, c->cohort);
+      out_char(out, '\t');
+      out_int(out, last->count);
+      out_char(out, '\t');
+      out_fixed(out, trend_share(last), 2);
+      out_char(out, '\t');
+      if (c->has_change) out_signed_fixed(out, c->share_change, 2); else out_char(out, '-');
+      out_char(out, '\t');
+      out_fixed(out, cohort_risk_index(last->high, last->medium, last->low), 2);
+      out_char(out, '\t');
+      if (c->has_change) out_signed_fixed(out, c->risk_change, 2); else out_char(out, '-');
+      out_char(out, '\t');
+      for (int s = 0; s < run->count; s++) {
+        if (s > 0) out_char(out, ' ');
+        if (c->cells[s].count) out_fixed(out, trend_share(&c->cells[s]), 2); else out_char(out, '-');
       }
+      out_char(out, '\n');
     }
-    if (!parse_double(fields[4], &s.attendance_rate)) {
-      s.valid = 0;
-      numeric_invalid = 1;
-    } else if (s.attendance_rate < 0 || s.attendance_rate > 1.0) {
-      if (clamp_ranges) {
-        if (s.attendance_rate < 0) s.attendance_rate = 0;
-        if (s.attendance_rate > 1.0) s.attendance_rate = 1.0;
-        clamped_values++;
-      } else {
-        s.valid = 0;
-        invalid_range++;
-      }
+  }
+
+  out_str(out, "\nRising high-risk share (up >= ");
+  out_fixed(out, config->rise, 2);
+  out_printf(out, ", min size %d)\n", config->min_cohort_size);
+  int alerts = 0;
+  for (int i = 0; i < run->names.count; i++) {
+    const TrendCohort *c = &run->cohorts[i];
+    if (!trend_alerts(run, c, config)) continue;
+    if (alerts++ == 0) out_str(out, "Cohort\tPrevious\tLatest\tChange\tCount\tAboveThreshold\n");
+    out_str(out, c->cohort);
+    out_char(out, '\t');
+    out_fixed(out, trend_share(&c->cells[run->count - 2]), 2);
+    out_char(out, '\t');
+    out_fixed(out, trend_share(&c->cells[run->count - 1]), 2);
+    out_char(out, '\t');
+    out_signed_fixed(out, c->share_change, 2);
+    out_char(out, '\t');
+    out_int(out, c->cells[run->count - 1].count);
+    out_char(out, '\t');
+    out_str(out, trend_share(&c->cells[run->count - 1]) >= config->alert_threshold ? "yes\n" : "no\n");
+  }
+  if (alerts == 0) out_str(out, "None\n");
+}
+
+static void write_trend_json(OutBuf *out, const TrendRun *run, const TrendConfig *config) {
+  out_str(out, "{\n  \"trend\": {\"snapshots\": ");
+  out_int(out, run->count);
+  out_str(out, ", \"rise_threshold\": ");
+  out_fixed(out, config->rise, 2);
+  out_str(out, ", \"alert_threshold\": ");
+  out_fixed(out, config->alert_threshold, 2);
+  out_printf(out, ", \"min_cohort_size\": %d, \"undated_rows\": %d},\n", config->min_cohort_size, run->undated);
+  out_str(out, "  \"snapshots\": [\n");
+  for (int s = 0; s < run->count; s++) {
+    const TrendSnapshot *snap = &run->snapshots[s];
+    const RunTotals *t = &snap->totals;
+    out_printf(out, "    {\"date\": \"%s\", \"files\": %d, \"records\": {\"valid\": %d, \"invalid\": %d}, "
+               "\"risk_mix\": {\"high\": %d, \"medium\": %d, \"low\": %d}}%s\n",
+               snap->date, snap->files, t->valid_count, t->invalid_rows, t->high_count, t->medium_count,
+               t->low_count, s == run->count - 1 ? "" : ",");
+  }
+  out_str(out, "  ],\n  \"cohorts\": [\n");
+  for (int i = 0; i < run->cohort_display; i++) {
+    const TrendCohort *c = &run->cohorts[i];
+    out_str(out, "    {\"cohort\": ");
+    out_json_str(out, c->cohort);
+    out_str(out, ", \"high_share_change\": ");
+    if (c->has_change) out_fixed(out, c->share_change, 2); else out_str(out, "null");
+    out_str(out, ", \"risk_index_change\": ");
+    if (c->has_change) out_fixed(out, c->risk_change, 2); else out_str(out, "null");
+    out_str(out, ", \"series\": [");
+    for (int s = 0; s < run->count; s++) {
+      const TrendCell *cell = &c->cells[s];
+      out_printf(out, "%s{\"date\": \"%s\", \"count\": %d, \"high\": %d, \"medium\": %d, \"low\": %d, \"high_share\": ",
+                 s ? ", " : "", run->snapshots[s].date, cell->count, cell->high, cell->medium, cell->low);
+      out_fixed(out, trend_share(cell), 2);
+      out_str(out, ", \"risk_index\": ");
+      out_fixed(out, cohort_risk_index(cell->high, cell->medium, cell->low), 2);
+      out_char(out, '}');
     }
-    if (!parse_double(fields[5], &s.satisfaction_score)) {
-      s.valid = 0;
-      numeric_invalid = 1;
-    } else if (s.satisfaction_score < 1.0 || s.satisfaction_score > 5.0) {
-      if (clamp_ranges) {
-        if (s.satisfaction_score < 1.0) s.satisfaction_score = 1.0;
-        if (s.satisfaction_score > 5.0) s.satisfaction_score = 5.0;
-        clamped_values++;
+    out_str(out, i == run->cohort_display - 1 ? "]}\n" : "]},\n");
+  }
+  out_str(out, "  ],\n  \"alerts\": [");
+  int alerts = 0;
+  for (int i = 0; i < run->names.count; i++) {
+    const TrendCohort *c = &run->cohorts[i];
+    if (!trend_alerts(run, c, config)) continue;
+    const TrendCell *last = &c->cells[run->count - 1];
+    out_str(out, alerts++ ? ",\n    {\"cohort\": " : "\n    {\"cohort\": ");
+    out_json_str(out, c->cohort);
+    out_str(out, ", \"previous_high_share\": ");
+    out_fixed(out, trend_share(&c->cells[run->count - 2]), 2);
+    out_str(out, ", \"high_share\": ");
+    out_fixed(out, trend_share(last), 2);
+    out_str(out, ", \"high_share_change\": ");
+    out_fixed(out, c->share_change, 2);
+    out_printf(out, ", \"count\": %d, \"above_threshold\": %s}", last->count,
+               trend_share(last) >= config->alert_threshold ? "true" : "false");
+  }
+  out_str(out, alerts ? "\n  ]\n}\n" : "]\n}\n");
+}
+
+/* One row per cohort and snapshot; the changes are against the previous
+   snapshot and blank when either has no rows. */
+static void write_trend_cohort_csv(OutBuf *out, const TrendRun *run) {
+  out_str(out, "cohort,snapshot_date,count,high,medium,low,high_share,risk_index,high_share_change,risk_index_change\n");
+  for (int i = 0; i < run->cohort_display; i++) {
+    const TrendCohort *c = &run->cohorts[i];
+    for (int s = 0; s < run->count; s++) {
+      const TrendCell *cell = &c->cells[s];
+      const TrendCell *prev = s > 0 ? &c->cells[s - 1] : NULL;
+      out_csv_str(out, c->cohort);
+      out_printf(out, ",%s,%d,%d,%d,%d,", run->snapshots[s].date, cell->count, cell->high, cell->medium, cell->low);
+      out_fixed(out, trend_share(cell), 2);
+      out_char(out, ',');
+      out_fixed(out, cohort_risk_index(cell->high, cell->medium, cell->low), 2);
+      out_char(out, ',');
+      if (prev && prev->count && cell->count) {
+        out_fixed(out, trend_share(cell) - trend_share(prev), 2);
+        out_char(out, ',');
+        out_fixed(out, cohort_risk_index(cell->high, cell->medium, cell->low) -
+                       cohort_risk_index(prev->high, prev->medium, prev->low), 2);
       } else {
-        s.valid = 0;
-        invalid_range++;
+        out_char(out, ',');
       }
+      out_char(out, '\n');
     }
-    if (numeric_invalid) invalid_numeric++;
+  }
+}
 
-    scholars[count++] = s;
+static void write_trend_alert_csv(OutBuf *out, const TrendRun *run, const TrendConfig *config) {
+  out_str(out, "cohort,previous_date,snapshot_date,previous_high_share,high_share,high_share_change,count,above_threshold\n");
+  for (int i = 0; i < run->names.count; i++) {
+    const TrendCohort *c = &run->cohorts[i];
+    if (!trend_alerts(run, c, config)) continue;
+    const TrendCell *last = &c->cells[run->count - 1];
+    out_csv_str(out, c->cohort);
+    out_printf(out, ",%s,%s,", run->snapshots[run->count - 2].date, run->snapshots[run->count - 1].date);
+    out_fixed(out, trend_share(&c->cells[run->count - 2]), 2);
+    out_char(out, ',');
+    out_fixed(out, trend_share(last), 2);
+    out_char(out, ',');
+    out_fixed(out, c->share_change, 2);
+    out_printf(out, ",%d,%d\n", last->count, trend_share(last) >= config->alert_threshold);
   }
+}
 
-  fclose(fp);
+/* kind: 0 text, 1 JSON, 2 cohort CSV, 3 alert CSV. */
+static int trend_write(OutBuf *out, const TrendRun *run, const TrendConfig *config, int kind) {
+  if (kind == 0) write_trend_text(out, run, config);
+  if (kind == 1) write_trend_json(out, run, config);
+  if (kind == 2) write_trend_cohort_csv(out, run);
+  if (kind == 3) write_trend_alert_csv(out, run, config);
+  return out_close(out);
+}
 
-  int valid_count = 0;
-  int high_count = 0;
-  int medium_count = 0;
-  int low_count = 0;
+static int trend_main(const TrendConfig *config) {
+  TrendRun run;
+  memset(&run, 0, sizeof(TrendRun));
+  DateCache dates;
+  memset(&dates, 0, sizeof(DateCache));
+  TopRisks none;
+  memset(&none, 0, sizeof(TopRisks));
+  ScoreContext ctx;
+  memset(&ctx, 0, sizeof(ScoreContext));
+  ctx.dates = &dates;
+  ctx.cohort_filters = config->cohort_filters;
+  ctx.cohort_filter_count = config->cohort_filter_count;
+  ctx.risks = &none;
+  ctx.profile = config->profile;
+  ctx.generic_profile = !profile_is_default(config->profile);
+
+  int ok = config->path_count > 1 ? trend_read_files(&run, config, &ctx) : trend_read_dated(&run, config, &ctx);
+  if (ok && run.count == 0) {
+    fprintf(stderr, "--trend found no dated snapshots.\n");
+    ok = 0;
+  }
+  if (ok && !trend_finish(&run, config)) {
+    fprintf(stderr, "Failed to allocate trend series.\n");
+    ok = 0;
+  }
+  const char *paths[4] = {NULL, config->json_path, config->cohort_csv_path, config->alert_csv_path};
+  static const char *const errors[4] = {"Failed to write output", "Failed to write JSON output",
+                                        "Failed to write cohort CSV output", "Failed to write alert CSV output"};
+  for (int kind = 0; ok && kind < 4; kind++) {
+    OutBuf out;
+    if (kind > 0 && !paths[kind]) continue;
+    if (kind == 0 ? !out_init(&out, STDOUT_FILENO) : !out_open(&out, paths[kind])) {
+      perror(errors[kind]);
+      ok = 0;
+    } else if (!trend_write(&out, &run, config, kind)) {
+      perror(errors[kind]);
+      ok = 0;
+    }
+  }
+  trend_run_free(&run);
+  return ok ? 0 : 1;
+}
 
-  RiskEntry *risks = (RiskEntry *)malloc(sizeof(RiskEntry) * count);
-  int risk_count = 0;
+/* --watch: one input's accumulators stay resident while the file is
+   tailed. Each pass parses only the bytes appended since the last one, up
+   to the last complete line; a truncated or replaced file, a day rollover
+   without --as-of, or SIGHUP rescans it from the start. The report is
+   rewritten when the set of alerting cohorts changes, each file output
+   through a temporary file renamed into place. Linux wakes on inotify;
+   the file is also polled every second, which is all other hosts get. */
+#define WATCH_POLL_MS 1000
 
-  CohortStats cohorts[200];
-  int cohort_count = 0;
+typedef struct {
+  const char *input;
+  const char *as_of_str;
+  int clamp_ranges;
+  const ScoringProfile *profile;
+  char **cohort_filters;
+  int cohort_filter_count;
+  const char *cohort_sort;
+  int limit;
+  int cohort_limit;
+  double alert_threshold;
+  int min_cohort_size;
+  int percentiles;
+  const Rollup *rollup;
+  const char *json_path;
+  const char *cohort_csv_path;
+  const char *alert_csv_path;
+} WatchConfig;
+
+/* offset counts the file bytes consumed; buf holds what was read past it
+   without a newline yet. alerted lists, sorted, the cohorts that alerted in
+   the last report written; stale is set once rows arrived after it. */
+typedef struct {
+  int fd;
+  dev_t dev;
+  ino_t ino;
+  uint64_t offset;
+  char *buf;
+  size_t len;
+  size_t cap;
+  int lines;
+  ScanLineFn scan_line;
+  RunTotals totals;
+  CohortTable cohorts;
+  TopRisks risks;
+  DateCache dates;
+  ScoreContext ctx;
+  const char **alerted;
+  int alerted_count;
+  int reports;
+  int stale;
+} WatchRun;
+
+static void watch_reset(WatchRun *run) {
+  cohort_table_free(&run->cohorts);
+  top_risks_free(&run->risks);
+  free(run->alerted);
+  run->alerted = NULL;
+  run->alerted_count = 0;
+}
 
-  for (int i = 0; i < count; i++) {
-    Scholar *s = &scholars[i];
-    if (!s->valid) {
-      invalid_rows++;
-      continue;
+/* (Re)opens the input and starts the accumulators over. The current ones
+   are kept when the file cannot be opened. */
+static int watch_open(WatchRun *run, const WatchConfig *config) {
+  int fd = open(config->input, O_RDONLY);
+  struct stat st;
+  if (fd < 0) return 0;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    errno = EINVAL;
+    return 0;
+  }
+  watch_reset(run);
+  if (run->fd >= 0) close(run->fd);
+  run->fd = fd;
+  run->dev = st.st_dev;
+  run->ino = st.st_ino;
+  run->offset = 0;
+  run->len = 0;
+  run->lines = 0;
+  memset(&run->totals, 0, sizeof(RunTotals));
+  memset(&run->dates, 0, sizeof(DateCache));
+  int as_of_day = local_today();
+  if (config->as_of_str) parse_date(config->as_of_str, &as_of_day);
+  if (!cohort_table_init(&run->cohorts) || !top_risks_init(&run->risks, config->limit)) {
+    errno = ENOMEM;
+    return 0;
+  }
+  run->cohorts.sketched = config->percentiles;
+  run->cohorts.rollup = config->rollup;
+  ScoreContext *ctx = &run->ctx;
+  memset(ctx, 0, sizeof(ScoreContext));
+  ctx->as_of_day = as_of_day;
+  ctx->dates = &run->dates;
+  ctx->cohort_filters = config->cohort_filters;
+  ctx->cohort_filter_count = config->cohort_filter_count;
+  ctx->totals = &run->totals;
+  ctx->cohorts = &run->cohorts;
+  ctx->risks = &run->risks;
+  ctx->profile = config->profile;
+  ctx->generic_profile = !profile_is_default(config->profile);
+  ctx->rollup = config->rollup;
+  return 1;
+}
+
+/* Scores the complete lines appended since the last pass. Returns 0 on a
+   read or allocation failure, or when the input is compressed. */
+static int watch_read(WatchRun *run, const WatchConfig *config) {
+  for (;;) {
+    if (run->cap - run->len < READ_CHUNK) {
+      size_t cap = run->cap ? run->cap * 2 : READ_CHUNK * 4;
+      char *grown = (char *)realloc(run->buf, cap);
+      if (!grown) {
+        fprintf(stderr, "Failed to allocate watch buffer.\n");
+        return 0;
+      }
+      run->buf = grown;
+      run->cap = cap;
+    }
+    ssize_t n = pread(run->fd, run->buf + run->len, run->cap - run->len, (off_t)(run->offset + run->len));
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) {
+      perror("Failed to read input file");
+      return 0;
+    }
+    if (n == 0) return 1;
+    run->len += (size_t)n;
+    if (run->offset == 0 && packed_format((const unsigned char *)run->buf, run->len) != PACK_NONE) {
+      fprintf(stderr, "--watch tails plain CSV; %s is compressed.\n", config->input);
+      return 0;
     }
 
-    if (!matches_cohort(s->cohort, cohort_filters, cohort_filter_count)) {
-      continue;
+    size_t end = run->len;
+    while (end > 0 && run->buf[end - 1] != '\n') end--;
+    score_csv_lines(run->buf, end, run->offset, &run->lines, run->scan_line, &run->ctx, config->clamp_ranges);
+    if (end > 0) run->stale = 1;
+    memmove(run->buf, run->buf + end, run->len - end);
+    run->len -= end;
+    run->offset += end;
+  }
+}
+
+
+/* Writes one file output next to path and renames it into place. */
+static int watch_write_file(const char *path, const Report *report, int kind) {
+  size_t path_len = strlen(path);
+  char *tmp = (char *)malloc(path_len + 5);
+  if (!tmp) return 0;
+  memcpy(tmp, path, path_len);
+  memcpy(tmp + path_len, ".tmp", 5);
+  OutBuf out;
+  if (!out_open(&out, tmp)) {
+    free(tmp);
+    return 0;
+  }
+  if (kind == 0) write_json_report(&out, report);
+  if (kind == 1) write_cohort_csv(&out, report);
+  if (kind == 2) write_alert_csv(&out, report);
+  int ok = out_close(&out) && rename(tmp, path) == 0;
+  if (!ok) remove(tmp);
+  free(tmp);
+  return ok;
+}
+
+/* Rebuilds the report and, when forced or when the alerting cohorts
+   differ from the last report written, prints it and rewrites the file
+   outputs. A failed write keeps the old set, so the next pass retries. */
+static int watch_report(WatchRun *run, const WatchConfig *config, int force) {
+  if (run->risks.failed) {
+    fprintf(stderr, "Failed to allocate top risk list.\n");
+    return 0;
+  }
+  int sort_ok = 0;
+  CohortSummary *summaries = build_cohort_summaries(&run->cohorts, cohort_sort_mode(config->cohort_sort, &sort_ok), 1);
+  CohortAlert *alerts = NULL;
+  int alert_count = summaries ? build_alerts(summaries, run->cohorts.count, config->alert_threshold,
+                                             config->min_cohort_size, &alerts) : -1;
+  const char **alerted = alert_count >= 0 ? (const char **)malloc(sizeof(char *) * (size_t)(alert_count + 1)) : NULL;
+  RiskEntry *risks = alerted ? (RiskEntry *)malloc(sizeof(RiskEntry) * (size_t)(run->risks.count + 1)) : NULL;
+  if (!risks) {
+    fprintf(stderr, "Failed to allocate cohort summaries.\n");
+    free(summaries);
+    free(alerts);
+    free(alerted);
+    return 0;
+  }
+  for (int i = 0; i < alert_count; i++) alerted[i] = alerts[i].cohort;
+  if (alert_count > 1) qsort(alerted, alert_count, sizeof(char *), compare_name_ptr);
+  int changed = force || alert_count != run->alerted_count;
+  for (int i = 0; !changed && i < alert_count; i++) changed = strcmp(alerted[i], run->alerted[i]) != 0;
+  int ok = 1;
+  if (changed) {
+    /* The heap keeps taking rows, so the report sorts a copy. */
+    memcpy(risks, run->risks.entries, sizeof(RiskEntry) * (size_t)run->risks.count);
+    if (run->risks.count > 1) qsort(risks, run->risks.count, sizeof(RiskEntry), compare_risk);
+    Report report;
+    memset(&report, 0, sizeof(Report));
+    report.reference_date = config->as_of_str ? config->as_of_str : "today";
+    report.cohort_sort = config->cohort_sort;
+    report.cohort_filters = config->cohort_filters;
+    report.cohort_filter_count = config->cohort_filter_count;
+    report.totals = &run->totals;
+    report.risks = risks;
+    report.risk_count = run->risks.count;
+    report.summaries = summaries;
+    report.cohort_count = run->cohorts.count;
+    report.cohort_display = cohort_display_count(summaries, run->cohorts.count, config->cohort_limit);
+    report.alerts = alerts;
+    report.alert_count = alert_count;
+    report.alert_threshold = config->alert_threshold;
+    report.min_cohort_size = config->min_cohort_size;
+    report.profile = config->profile;
+    report.percentiles = config->percentiles;
+    report.rollup_separator = config->rollup ? config->rollup->separator : '\0';
+
+    OutBuf text;
+    if (out_init(&text, STDOUT_FILENO)) {
+      if (run->reports > 0) out_char(&text, '\n');
+      write_text_report(&text, &report);
+      out_close(&text);
+    }
+    const char *paths[3] = {config->json_path, config->cohort_csv_path, config->alert_csv_path};
+    static const char *const errors[3] = {"Failed to write JSON output", "Failed to write cohort CSV output",
+                                          "Failed to write alert CSV output"};
+    for (int kind = 0; kind < 3; kind++) {
+      if (paths[kind] && !watch_write_file(paths[kind], &report, kind)) {
+        perror(errors[kind]);
+        ok = 0;
+      }
     }
+    run->reports++;
+    run->stale = !ok;
+  }
+  if (changed && ok) {
+    free(run->alerted);
+    run->alerted = alerted;
+    run->alerted_count = alert_count;
+  } else {
+    free(alerted);
+  }
+  free(risks);
+  free(summaries);
+  free(alerts);
+  return ok;
+}
 
-    struct tm touch_tm;
-    if (!parse_date(s->last_touchpoint, &touch_tm)) {
-      invalid_rows++;
-      invalid_date_format++;
-      continue;
+/* Runs until SIGINT or SIGTERM, then writes a last report when rows
+   arrived since the previous one. A failed first pass exits; later
+   failures are reported and the next pass tries again. */
+static int watch_run(const WatchConfig *config) {
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGHUP);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+  WatchRun run;
+  memset(&run, 0, sizeof(WatchRun));
+  run.fd = -1;
+  run.scan_line = select_scan_line();
+  if (!watch_open(&run, config)) {
+    perror("Failed to open input file");
+    watch_reset(&run);
+    return 1;
+  }
+  int ok = watch_read(&run, config) && watch_report(&run, config, 1);
+  int notify = -1;
+#ifdef __linux__
+  int watch_fd = -1;
+  notify = ok ? inotify_init1(IN_NONBLOCK | IN_CLOEXEC) : -1;
+  if (notify >= 0) watch_fd = inotify_add_watch(notify, config->input, IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+#endif
+  if (ok) fprintf(stderr, "Watching %s\n", config->input);
+  while (ok) {
+    struct timespec tick = {WATCH_POLL_MS / 1000, 0};
+    if (notify >= 0) {
+      struct pollfd wake = {notify, POLLIN, 0};
+      if (poll(&wake, 1, WATCH_POLL_MS) > 0) {
+        char events[4096];
+        while (read(notify, events, sizeof(events)) > 0) continue;
+      }
+      tick.tv_sec = 0;
+    }
+    int sig = sigtimedwait(&signals, NULL, &tick);
+    if (sig == SIGINT || sig == SIGTERM) {
+      if (watch_read(&run, config) && run.stale) ok = watch_report(&run, config, 1);
+      break;
     }
 
-    time_t touch_time = to_time_utc(touch_tm);
-    int days_since = days_between(as_of_time, touch_time);
-    if (days_since < 0) {
-      future_dates++;
-      days_since = 0;
-    }
-    if (days_since > 30) recency_over_30++;
-    else if (days_since > 14) recency_15_30++;
-    else if (days_since > 7) recency_8_14++;
-    if (s->touchpoints_30d == 0) touchpoints_zero++;
-    else if (s->touchpoints_30d <= 1) touchpoints_one++;
-    if (s->attendance_rate < 0.6) attendance_low++;
-    else if (s->attendance_rate < 0.8) attendance_mid++;
-    if (s->satisfaction_score < 3.0) satisfaction_low++;
-    else if (s->satisfaction_score < 4.0) satisfaction_mid++;
-    int score = risk_score_for(days_since, s->touchpoints_30d, s->attendance_rate, s->satisfaction_score);
-
-    const char *label = risk_label(score);
-    if (strcmp(label, "high") == 0) high_count++;
-    else if (strcmp(label, "medium") == 0) medium_count++;
-    else low_count++;
-
-    valid_count++;
-
-    int cidx = find_or_add_cohort(cohorts, &cohort_count, s->cohort);
-    if (cidx >= 0) {
-      cohorts[cidx].count++;
-      if (strcmp(label, "high") == 0) cohorts[cidx].high++;
-      else if (strcmp(label, "medium") == 0) cohorts[cidx].medium++;
-      else cohorts[cidx].low++;
-      cohorts[cidx].attendance_sum += s->attendance_rate;
-      cohorts[cidx].satisfaction_sum += s->satisfaction_score;
-      cohorts[cidx].touchpoints_sum += s->touchpoints_30d;
-      cohorts[cidx].days_since_sum += days_since;
-    }
-
-    RiskEntry entry;
-    memset(&entry, 0, sizeof(RiskEntry));
-    snprintf(entry.id, MAX_NAME, "%s", s->id);
-    snprintf(entry.cohort, MAX_NAME, "%s", s->cohort);
-    entry.risk_score = score;
-    entry.days_since = days_since;
-    entry.touchpoints_30d = s->touchpoints_30d;
-    entry.attendance_rate = s->attendance_rate;
-    entry.satisfaction_score = s->satisfaction_score;
-    risks[risk_count++] = entry;
-  }
-
-  qsort(risks, risk_count, sizeof(RiskEntry), compare_risk);
-  if (limit > risk_count) limit = risk_count;
-
-  printf("Group Scholar Cohort Health Sentinel\n");
-  printf("Reference date: %s\n", as_of_str ? as_of_str : "today");
-  printf("Records: %d valid, %d invalid\n", valid_count, invalid_rows);
-  printf("Missing IDs: %d | Missing dates: %d | Future dates: %d\n", missing_ids, missing_dates, future_dates);
-  printf("Invalid breakdown: columns %d | numeric %d | date format %d | range %d\n",
-         invalid_columns, invalid_numeric, invalid_date_format, invalid_range);
-  printf("Clamped values: %d\n", clamped_values);
-  printf("Risk mix: %d high | %d medium | %d low\n", high_count, medium_count, low_count);
-  printf("Risk drivers: recency>30 %d | recency15-30 %d | recency8-14 %d\n",
-         recency_over_30, recency_15_30, recency_8_14);
-  printf("              touchpoints0 %d | touchpoints1 %d | attendance<0.6 %d | attendance<0.8 %d | satisfaction<3 %d | satisfaction<4 %d\n\n",
-         touchpoints_zero, touchpoints_one, attendance_low, attendance_mid, satisfaction_low, satisfaction_mid);
-
-  if (limit > 0) {
-    printf("Top %d risk entries\n", limit);
-    printf("ID\tCohort\tScore\tDays\tTouch30\tAttend\tSatisfaction\n");
-    for (int i = 0; i < limit; i++) {
-      RiskEntry *r = &risks[i];
-      printf("%s\t%s\t%d\t%d\t%d\t%.2f\t%.2f\n",
-             r->id, r->cohort, r->risk_score, r->days_since, r->touchpoints_30d,
-             r->attendance_rate, r->satisfaction_score);
-    }
-  }
-
-  CohortSummary *summaries = (CohortSummary *)malloc(sizeof(CohortSummary) * cohort_count);
-  for (int i = 0; i < cohort_count; i++) {
-    CohortStats *c = &cohorts[i];
-    double avg_touch = c->count ? (double)c->touchpoints_sum / c->count : 0;
-    double avg_att = c->count ? c->attendance_sum / c->count : 0;
-    double avg_sat = c->count ? c->satisfaction_sum / c->count : 0;
-    double avg_days = c->count ? c->days_since_sum / c->count : 0;
-    double high_share = c->count ? (double)c->high / c->count : 0;
-    double risk_index = cohort_risk_index(c->high, c->medium, c->low);
-    CohortSummary summary;
-    memset(&summary, 0, sizeof(CohortSummary));
-    snprintf(summary.cohort, MAX_NAME, "%s", c->name);
-    summary.count = c->count;
-    summary.high = c->high;
-    summary.medium = c->medium;
-    summary.low = c->low;
-    summary.high_share = high_share;
-    summary.risk_index = risk_index;
-    summary.avg_touchpoints = avg_touch;
-    summary.avg_attendance = avg_att;
-    summary.avg_satisfaction = avg_sat;
-    summary.avg_days = avg_days;
-    summaries[i] = summary;
-  }
-
-  if (cohort_count > 1) {
-    qsort(summaries, cohort_count, sizeof(CohortSummary), compare_cohort_summary);
-  }
-
-  int cohort_display = cohort_count;
-  if (cohort_limit >= 0 && cohort_limit < cohort_display) {
-    cohort_display = cohort_limit;
-  }
-
-  printf("\nCohort summary (sorted by %s)\n", cohort_sort);
-  if (cohort_display == 0) {
-    printf("None\n");
-  } else {
-    printf("Cohort\tCount\tHigh\tMedium\tLow\tHighShare\tRiskIndex\tAvgTouch30\tAvgAttend\tAvgSatisfaction\tAvgDaysSince\n");
-    for (int i = 0; i < cohort_display; i++) {
-      CohortSummary *c = &summaries[i];
-      printf("%s\t%d\t%d\t%d\t%d\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%.1f\n",
-             c->cohort, c->count, c->high, c->medium, c->low, c->high_share,
-             c->risk_index, c->avg_touchpoints, c->avg_attendance, c->avg_satisfaction, c->avg_days);
+    struct stat st;
+    if (stat(config->input, &st) != 0) continue;
+    int rescan = sig == SIGHUP || st.st_dev != run.dev || st.st_ino != run.ino ||
+                 (uint64_t)st.st_size < run.offset + run.len ||
+                 (!config->as_of_str && local_today() != run.ctx.as_of_day);
+    if (!rescan && (uint64_t)st.st_size == run.offset + run.len) continue;
+    if (rescan) {
+      if (!watch_open(&run, config)) {
+        perror("Failed to reopen input file");
+        continue;
+      }
+#ifdef __linux__
+      if (notify >= 0) {
+        if (watch_fd >= 0) inotify_rm_watch(notify, watch_fd);
+        watch_fd = inotify_add_watch(notify, config->input, IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+      }
+#endif
     }
+    if (watch_read(&run, config)) watch_report(&run, config, rescan);
+    if (run.risks.failed) ok = 0;
   }
+  if (notify >= 0) close(notify);
+  if (run.fd >= 0) close(run.fd);
+  free(run.buf);
+  watch_reset(&run);
+  return ok ? 0 : 1;
+}
 
-  if (cohort_csv_path) {
-    FILE *cf = fopen(cohort_csv_path, "w");
-    if (!cf) {
-      perror("Failed to write cohort CSV output");
-    } else {
-      fprintf(cf, "cohort,count,high,medium,low,high_share,risk_index,avg_touchpoints_30d,avg_attendance,avg_satisfaction,avg_days_since\n");
-      for (int i = 0; i < cohort_display; i++) {
-        CohortSummary *c = &summaries[i];
-        fprintf(cf, "%s,%d,%d,%d,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.1f\n",
-                c->cohort, c->count, c->high, c->medium, c->low, c->high_share,
-                c->risk_index, c->avg_touchpoints, c->avg_attendance, c->avg_satisfaction, c->avg_days);
+/* Everything the command line asks for. `options` is what a report run
+   hands the engine; the rest picks the mode and where output goes. */
+typedef struct {
+  SentinelOptions options;
+  InputList inputs;
+  const char *json_path;
+  const char *cohort_csv_path;
+  const char *alert_csv_path;
+  const char *stats_json_path;
+  int stats_text;
+  const char *serve_path;
+  int serve_workers;
+  const char *pg_conninfo;
+  const char *pg_schema;
+  int trend;
+  double trend_rise;
+  int watch;
+} CliArgs;
+
+/* --trend, --watch and --serve keep their own scoring loops and take the
+   report options as already validated by main(). */
+static int run_mode(const CliArgs *a) {
+  const SentinelOptions *o = &a->options;
+  ScoringProfile profile = k_default_profile;
+  if (o->scoring_profile && !load_scoring_profile(o->scoring_profile, &profile)) return 1;
+  char *cohort_filter_buffer = NULL;
+  char **cohort_filters = NULL;
+  int cohort_filter_count = 0;
+  if (o->cohort_filter && !split_cohort_filters(o->cohort_filter, &cohort_filter_buffer, &cohort_filters,
+                                                &cohort_filter_count)) {
+    fprintf(stderr, "Failed to allocate cohort filters.\n");
+    free(cohort_filter_buffer);
+    return 1;
+  }
+  Rollup rollup;
+  memset(&rollup, 0, sizeof(Rollup));
+  if (o->rollup_separator) {
+    rollup.separator = o->rollup_separator;
+    rollup.filter_count = cohort_filter_count;
+    if (cohort_filter_count > 0) {
+      rollup.filters = (char **)malloc(sizeof(char *) * (size_t)cohort_filter_count);
+      if (!rollup.filters) {
+        fprintf(stderr, "Failed to allocate cohort filters.\n");
+        free(cohort_filter_buffer);
+        free(cohort_filters);
+        return 1;
       }
-      fclose(cf);
-    }
-  }
-
-  CohortAlert alerts[200];
-  int alert_count = 0;
-  for (int i = 0; i < cohort_count; i++) {
-    CohortSummary *c = &summaries[i];
-    if (c->count < min_cohort_size) continue;
-    if (c->high_share < alert_threshold) continue;
-    CohortAlert alert;
-    memset(&alert, 0, sizeof(CohortAlert));
-    snprintf(alert.cohort, MAX_NAME, "%s", c->cohort);
-    alert.count = c->count;
-    alert.high = c->high;
-    alert.medium = c->medium;
-    alert.low = c->low;
-    alert.high_ratio = c->high_share;
-    alert.risk_index = c->risk_index;
-    alert.avg_days = c->avg_days;
-    alert.avg_attendance = c->avg_attendance;
-    alert.avg_satisfaction = c->avg_satisfaction;
-    alerts[alert_count++] = alert;
-  }
-
-  if (alert_count > 0) {
-    qsort(alerts, alert_count, sizeof(CohortAlert), compare_alerts);
-    printf("\nCohort alerts (high-risk share >= %.2f, min size %d)\n", alert_threshold, min_cohort_size);
-    printf("Cohort\tHighShare\tRiskIndex\tCount\tHigh\tMedium\tLow\tAvgDays\tAvgAttend\tAvgSatisfaction\n");
-    for (int i = 0; i < alert_count; i++) {
-      CohortAlert *a = &alerts[i];
-      printf("%s\t%.2f\t%.2f\t%d\t%d\t%d\t%d\t%.1f\t%.2f\t%.2f\n",
-             a->cohort, a->high_ratio, a->risk_index, a->count, a->high, a->medium, a->low,
-             a->avg_days, a->avg_attendance, a->avg_satisfaction);
+      memcpy(rollup.filters, cohort_filters, sizeof(char *) * (size_t)cohort_filter_count);
+      qsort(rollup.filters, cohort_filter_count, sizeof(char *), compare_name_ptr);
     }
+  }
+
+  int limit = o->limit < 0 ? 0 : o->limit;
+  int cohort_limit = o->cohort_limit < -1 ? -1 : o->cohort_limit;
+  double alert_threshold = o->alert_threshold < 0 ? 0 : o->alert_threshold > 1.0 ? 1.0 : o->alert_threshold;
+  int min_cohort_size = o->min_cohort_size < 1 ? 1 : o->min_cohort_size;
+  int rc;
+  if (a->trend) {
+    TrendConfig config = {a->inputs.paths, a->inputs.count, default_workers(o->threads), o->clamp_ranges, &profile,
+                          cohort_filters, cohort_filter_count, a->trend_rise, alert_threshold, min_cohort_size,
+                          cohort_limit, a->json_path, a->cohort_csv_path, a->alert_csv_path};
+    rc = trend_main(&config);
+  } else if (a->watch) {
+    WatchConfig config = {a->inputs.paths[0], o->as_of, o->clamp_ranges, &profile, cohort_filters,
+                          cohort_filter_count, o->cohort_sort, limit, cohort_limit, alert_threshold, min_cohort_size,
+                          o->percentiles, o->rollup_separator ? &rollup : NULL, a->json_path, a->cohort_csv_path,
+                          a->alert_csv_path};
+    rc = watch_run(&config);
   } else {
-    printf("\nCohort alerts (high-risk share >= %.2f, min size %d)\n", alert_threshold, min_cohort_size);
-    printf("None\n");
+    ServeConfig config = {a->inputs.paths[0], o->cache, o->as_of, o->clamp_ranges, &profile, o->cohort_filter,
+                          o->cohort_sort, limit, cohort_limit, alert_threshold, min_cohort_size, o->percentiles};
+    rc = serve_run(a->serve_path, &config, a->serve_workers);
   }
+  free(cohort_filter_buffer);
+  free(cohort_filters);
+  free(rollup.filters);
+  return rc;
+}
 
-  if (alert_csv_path) {
-    FILE *af = fopen(alert_csv_path, "w");
-    if (!af) {
-      perror("Failed to write alert CSV output");
-    } else {
-      fprintf(af, "cohort,high_share,risk_index,count,high,medium,low,avg_days_since,avg_attendance,avg_satisfaction\n");
-      for (int i = 0; i < alert_count; i++) {
-        CohortAlert *a = &alerts[i];
-        fprintf(af, "%s,%.2f,%.2f,%d,%d,%d,%d,%.1f,%.2f,%.2f\n",
-                a->cohort, a->high_ratio, a->risk_index, a->count, a->high, a->medium, a->low,
-                a->avg_days, a->avg_attendance, a->avg_satisfaction);
-      }
-      fclose(af);
+/* Opens a file output the way fopen(path, "w") would; -1 when there is
+   none or it cannot be created (reported). */
+static int open_output(const char *path, const char *failure) {
+  if (!path) return -1;
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) perror(failure);
+  return fd;
+}
+
+/* A file output that fails is reported once and dropped; the run goes on. */
+static void write_output(SentinelEngine *engine, SentinelOutput output, int *fd, const char *failure) {
+  if (*fd < 0 || sentinel_write(engine, output, *fd)) return;
+  perror(failure);
+  close(*fd);
+  *fd = -1;
+}
+
+static void close_output(int fd, const char *failure) {
+  if (fd >= 0 && close(fd) != 0) perror(failure);
+}
+
+/* One report run: a handle ingests every input, then each scenario is
+   finalized and written to stdout, the file outputs and --pg-sink. */
+static int run_report(const CliArgs *a) {
+  char error[256];
+  SentinelEngine *engine = sentinel_engine_create(&a->options, error, sizeof(error));
+  if (!engine) {
+    fprintf(stderr, "%s\n", error);
+    return 1;
+  }
+  PgSink pg;
+  int pg_open = 0;
+  if (a->pg_conninfo) {
+    if (!pg_sink_open(&pg, a->pg_conninfo, a->pg_schema)) {
+      sentinel_engine_free(engine);
+      return 1;
     }
+    pg_open = 1;
   }
 
-  if (json_path) {
-    FILE *jf = fopen(json_path, "w");
-    if (!jf) {
-      perror("Failed to write JSON output");
-    } else {
-      fprintf(jf, "{\n");
-      fprintf(jf, "  \"reference_date\": \"%s\",\n", as_of_str ? as_of_str : "today");
-      fprintf(jf, "  \"records\": {\"valid\": %d, \"invalid\": %d},\n",
-              valid_count, invalid_rows);
-      fprintf(jf, "  \"cohort_sort\": \"%s\",\n", cohort_sort);
-      fprintf(jf, "  \"cohort_total\": %d,\n", cohort_count);
-      fprintf(jf, "  \"cohort_limit\": %d,\n", cohort_display);
-      if (cohort_filter_count > 0) {
-        fprintf(jf, "  \"cohort_filter\": [");
-        for (int i = 0; i < cohort_filter_count; i++) {
-          fprintf(jf, "\"%s\"%s", cohort_filters[i], (i == cohort_filter_count - 1) ? "" : ", ");
-        }
-        fprintf(jf, "],\n");
+  int exit_code = sentinel_feed_files(engine, a->inputs.paths, a->inputs.count) ? 0 : 1;
+  int cohort_fd = -1;
+  int alert_fd = -1;
+  int json_fd = -1;
+  if (exit_code == 0) {
+    cohort_fd = open_output(a->cohort_csv_path, "Failed to write cohort CSV output");
+    alert_fd = open_output(a->alert_csv_path, "Failed to write alert CSV output");
+    json_fd = open_output(a->json_path, "Failed to write JSON output");
+  }
+  int scenario_count = sentinel_scenario_count(engine);
+  for (int si = 0; exit_code == 0 && si < scenario_count; si++) {
+    if (!sentinel_finalize_scenario(engine, si) || !sentinel_write(engine, SENTINEL_OUTPUT_TEXT, STDOUT_FILENO)) {
+      exit_code = 1;
+      break;
+    }
+    write_output(engine, SENTINEL_OUTPUT_COHORT_CSV, &cohort_fd, "Failed to write cohort CSV output");
+    write_output(engine, SENTINEL_OUTPUT_ALERT_CSV, &alert_fd, "Failed to write alert CSV output");
+    write_output(engine, SENTINEL_OUTPUT_JSON, &json_fd, "Failed to write JSON output");
+    if (pg_open) {
+      char source[1024];
+      char more[32] = "";
+      const char *scenario = a->options.scenarios ? sentinel_scenario_name(engine, si) : NULL;
+      if (a->inputs.count > 1) snprintf(more, sizeof(more), " (+%d more)", a->inputs.count - 1);
+      snprintf(source, sizeof(source), "%s%s%s%s", a->inputs.paths[0], more, scenario ? "#" : "",
+               scenario ? scenario : "");
+      if (!pg_sink_write(&pg, engine_report(engine), source)) exit_code = 1;
+      engine_lap(engine, PHASE_WRITE_PG);
+    }
+  }
+  close_output(cohort_fd, "Failed to write cohort CSV output");
+  close_output(alert_fd, "Failed to write alert CSV output");
+  close_output(json_fd, "Failed to write JSON output");
+
+  if (exit_code == 0 && !sentinel_save(engine)) exit_code = 1;
+  if (pg_open) {
+    if (exit_code == 0 && !pg_sink_commit(&pg)) exit_code = 1;
+    pg_sink_close(&pg);
+  }
+
+  if (a->options.stats && exit_code == 0) {
+    if (a->stats_text) sentinel_write(engine, SENTINEL_OUTPUT_STATS_TEXT, STDERR_FILENO);
+    int stats_fd = open_output(a->stats_json_path, "Failed to write stats JSON output");
+    if (stats_fd >= 0) {
+      if (!sentinel_write(engine, SENTINEL_OUTPUT_STATS_JSON, stats_fd)) perror("Failed to write stats JSON output");
+      close(stats_fd);
+    }
+  }
+  sentinel_engine_free(engine);
+  return exit_code;
+}
+
+int main(int argc, char **argv) {
+  CliArgs args;
+  memset(&args, 0, sizeof(CliArgs));
+  SentinelOptions *o = &args.options;
+  sentinel_options_init(o);
+  args.serve_workers = 4;
+  args.pg_schema = "cohort_health_sentinel";
+  args.trend_rise = TREND_DEFAULT_RISE;
+  InputList *inputs = &args.inputs;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+      if (!input_list_add(inputs, argv[++i])) return 1;
+    } else if (strcmp(argv[i], "--input-list") == 0 && i + 1 < argc) {
+      if (!input_list_load(inputs, argv[++i])) return 1;
+    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      args.json_path = argv[++i];
+    } else if (strcmp(argv[i], "--cohort-csv") == 0 && i + 1 < argc) {
+      args.cohort_csv_path = argv[++i];
+    } else if (strcmp(argv[i], "--alert-csv") == 0 && i + 1 < argc) {
+      args.alert_csv_path = argv[++i];
+    } else if (strcmp(argv[i], "--as-of") == 0 && i + 1 < argc) {
+      o->as_of = argv[++i];
+    } else if (strcmp(argv[i], "--cohort") == 0 && i + 1 < argc) {
+      o->cohort_filter = argv[++i];
+    } else if (strcmp(argv[i], "--cohort-sort") == 0 && i + 1 < argc) {
+      o->cohort_sort = argv[++i];
+    } else if (strcmp(argv[i], "--cohort-limit") == 0 && i + 1 < argc) {
+      if (!parse_int(argv[++i], &o->cohort_limit)) {
+        fprintf(stderr, "Invalid --cohort-limit value.\n");
+        return 1;
       }
-      fprintf(jf, "  \"missing\": {\"ids\": %d, \"dates\": %d},\n", missing_ids, missing_dates);
-      fprintf(jf, "  \"invalid_breakdown\": {\"columns\": %d, \"numeric\": %d, \"date_format\": %d, \"range\": %d},\n",
-              invalid_columns, invalid_numeric, invalid_date_format, invalid_range);
-      fprintf(jf, "  \"clamped_values\": %d,\n", clamped_values);
-      fprintf(jf, "  \"date_anomalies\": {\"future_dates\": %d},\n", future_dates);
-      fprintf(jf, "  \"risk_mix\": {\"high\": %d, \"medium\": %d, \"low\": %d},\n",
-              high_count, medium_count, low_count);
-      fprintf(jf, "  \"risk_drivers\": {\"recency_over_30\": %d, \"recency_15_30\": %d, \"recency_8_14\": %d, \"touchpoints_zero\": %d, \"touchpoints_one\": %d, \"attendance_low\": %d, \"attendance_mid\": %d, \"satisfaction_low\": %d, \"satisfaction_mid\": %d},\n",
-              recency_over_30, recency_15_30, recency_8_14, touchpoints_zero, touchpoints_one,
-              attendance_low, attendance_mid, satisfaction_low, satisfaction_mid);
-      fprintf(jf, "  \"alert_threshold\": %.2f,\n", alert_threshold);
-      fprintf(jf, "  \"min_cohort_size\": %d,\n", min_cohort_size);
-      fprintf(jf, "  \"top_risks\": [\n");
-      for (int i = 0; i < limit; i++) {
-        RiskEntry *r = &risks[i];
-        fprintf(jf, "    {\"id\": \"%s\", \"cohort\": \"%s\", \"score\": %d, \"days_since\": %d, \"touchpoints_30d\": %d, \"attendance_rate\": %.2f, \"satisfaction_score\": %.2f}%s\n",
-                r->id, r->cohort, r->risk_score, r->days_since, r->touchpoints_30d,
-                r->attendance_rate, r->satisfaction_score,
-                (i == limit - 1) ? "" : ",");
+    } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+      o->limit = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--alert-threshold") == 0 && i + 1 < argc) {
+      if (!parse_double(argv[++i], &o->alert_threshold)) {
+        fprintf(stderr, "Invalid --alert-threshold value.\n");
+        return 1;
       }
-      fprintf(jf, "  ],\n");
-      fprintf(jf, "  \"cohorts\": [\n");
-      for (int i = 0; i < cohort_display; i++) {
-        CohortSummary *c = &summaries[i];
-        fprintf(jf, "    {\"cohort\": \"%s\", \"count\": %d, \"high\": %d, \"medium\": %d, \"low\": %d, \"high_share\": %.2f, \"risk_index\": %.2f, \"avg_touchpoints_30d\": %.2f, \"avg_attendance\": %.2f, \"avg_satisfaction\": %.2f, \"avg_days_since\": %.1f}%s\n",
-                c->cohort, c->count, c->high, c->medium, c->low, c->high_share,
-                c->risk_index, c->avg_touchpoints, c->avg_attendance, c->avg_satisfaction, c->avg_days,
-                (i == cohort_display - 1) ? "" : ",");
+    } else if (strcmp(argv[i], "--min-cohort-size") == 0 && i + 1 < argc) {
+      if (!parse_int(argv[++i], &o->min_cohort_size)) {
+        fprintf(stderr, "Invalid --min-cohort-size value.\n");
+        return 1;
       }
-      fprintf(jf, "  ],\n");
-      fprintf(jf, "  \"alerts\": [\n");
-      for (int i = 0; i < alert_count; i++) {
-        CohortAlert *a = &alerts[i];
-        fprintf(jf, "    {\"cohort\": \"%s\", \"high_share\": %.2f, \"risk_index\": %.2f, \"count\": %d, \"high\": %d, \"medium\": %d, \"low\": %d, \"avg_days_since\": %.1f, \"avg_attendance\": %.2f, \"avg_satisfaction\": %.2f}%s\n",
-                a->cohort, a->high_ratio, a->risk_index, a->count, a->high, a->medium, a->low,
-                a->avg_days, a->avg_attendance, a->avg_satisfaction,
-                (i == alert_count - 1) ? "" : ",");
+    } else if (strcmp(argv[i], "--clamp-ranges") == 0) {
+      o->clamp_ranges = 1;
+    } else if (strcmp(argv[i], "--stream") == 0) {
+      o->stream = 1;
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      if (!parse_int(argv[++i], &o->threads) || o->threads < 1 || o->threads > MAX_THREADS) {
+        fprintf(stderr, "Invalid --threads value. Use 1-%d.\n", MAX_THREADS);
+        return 1;
       }
-      fprintf(jf, "  ]\n");
-      fprintf(jf, "}\n");
-      fclose(jf);
+    } else if (strcmp(argv[i], "--stats") == 0) {
+      args.stats_text = 1;
+      o->stats = 1;
+    } else if (strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc) {
+      args.stats_json_path = argv[++i];
+      o->stats = 1;
+    } else if (strcmp(argv[i], "--scoring-profile") == 0 && i + 1 < argc) {
+      o->scoring_profile = argv[++i];
+    } else if (strcmp(argv[i], "--scenarios") == 0 && i + 1 < argc) {
+      o->scenarios = argv[++i];
+    } else if (strcmp(argv[i], "--state") == 0 && i + 1 < argc) {
+      o->state = argv[++i];
+    } else if (strcmp(argv[i], "--state-delta") == 0) {
+      o->state_delta = 1;
+    } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+      o->cache = argv[++i];
+    } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+      args.serve_path = argv[++i];
+    } else if (strcmp(argv[i], "--serve-workers") == 0 && i + 1 < argc) {
+      if (!parse_int(argv[++i], &args.serve_workers) || args.serve_workers < 1 || args.serve_workers > MAX_THREADS) {
+        fprintf(stderr, "Invalid --serve-workers value. Use 1-%d.\n", MAX_THREADS);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--scored-out") == 0 && i + 1 < argc) {
+      o->scored_out = argv[++i];
+    } else if (strcmp(argv[i], "--pg-sink") == 0 && i + 1 < argc) {
+      args.pg_conninfo = argv[++i];
+    } else if (strcmp(argv[i], "--pg-schema") == 0 && i + 1 < argc) {
+      args.pg_schema = argv[++i];
+    } else if (strcmp(argv[i], "--dedupe") == 0 && i + 1 < argc) {
+      o->dedupe = argv[++i];
+      if (!dedupe_mode(o->dedupe)) {
+        fprintf(stderr, "Invalid --dedupe value. Use first, last, or latest-touchpoint.\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--percentiles") == 0) {
+      o->percentiles = 1;
+    } else if (strcmp(argv[i], "--trend") == 0) {
+      args.trend = 1;
+    } else if (strcmp(argv[i], "--trend-rise") == 0 && i + 1 < argc) {
+      if (!parse_double(argv[++i], &args.trend_rise) || args.trend_rise < 0) {
+        fprintf(stderr, "Invalid --trend-rise value.\n");
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--watch") == 0) {
+      args.watch = 1;
+    } else if (strcmp(argv[i], "--rollup-separator") == 0 && i + 1 < argc) {
+      const char *separator = argv[++i];
+      if (strlen(separator) != 1 || separator[0] == ',') {
+        fprintf(stderr, "Invalid --rollup-separator value. Use one character other than a comma.\n");
+        return 1;
+      }
+      o->rollup_separator = separator[0];
+    } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+      usage(argv[0]);
+      return 0;
     }
   }
 
-  free(risks);
-  free(scholars);
-  free(summaries);
-  free(cohort_filter_buffer);
-  free(cohort_filters);
+  int sort_ok = 0;
+  cohort_sort_mode(o->cohort_sort, &sort_ok);
+  if (!sort_ok) {
+    fprintf(stderr, "Invalid --cohort-sort value. Use risk, high, or name.\n");
+    return 1;
+  }
 
-  return 0;
+  if (inputs->count == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+  int multi_input = inputs->count > 1;
+  int threaded = o->threads > 1;
+
+  int as_of_day = 0;
+  const char *failure = NULL;
+  if (o->scenarios && (o->stream || threaded)) {
+    failure = "--scenarios scores buffered columns; drop --stream and --threads.";
+  } else if (o->state && (o->stream || threaded || o->scenarios)) {
+    failure = "--state cannot be combined with --stream, --threads or --scenarios.";
+  } else if (o->state_delta && !o->state) {
+    failure = "--state-delta needs --state.";
+  } else if (args.serve_path && (o->stream || threaded || o->state || o->scenarios || args.json_path ||
+                                 args.cohort_csv_path || args.alert_csv_path)) {
+    failure = "--serve answers queries on its socket; drop --stream, --threads, --state, --scenarios and file outputs.";
+  } else if (o->cache && (o->stream || threaded || o->state)) {
+    failure = "--cache stores buffered columns; drop --stream, --threads and --state.";
+  } else if (args.pg_conninfo && args.serve_path) {
+    failure = "--pg-sink writes one run's report; drop --serve.";
+  } else if (multi_input && (o->state || o->cache || args.serve_path)) {
+    failure = "--state, --cache and --serve read a single --input file.";
+  } else if (multi_input && o->scored_out && o->stream) {
+    failure = "--scored-out over several inputs scores buffered columns; drop --stream.";
+  } else if (o->scored_out && (threaded || o->state || o->scenarios || args.serve_path)) {
+    failure = "--scored-out writes rows in input order from one scoring pass; drop --threads, --state, --scenarios "
+              "and --serve.";
+  } else if (args.trend && (o->as_of || o->stream || o->state || o->cache || args.serve_path || o->scenarios ||
+                            o->scored_out || args.pg_conninfo || o->dedupe || o->percentiles || o->stats)) {
+    failure = "--trend scores each snapshot as of its own date; drop --as-of, --stream, --state, --cache, --serve, "
+              "--scenarios, --scored-out, --pg-sink, --dedupe, --percentiles and --stats.";
+  } else if (args.watch && (multi_input || strcmp(inputs->paths[0], "-") == 0 || o->stream || threaded || o->state ||
+                            o->cache || args.serve_path || o->scenarios || o->scored_out || args.pg_conninfo ||
+                            o->dedupe || args.trend || o->stats)) {
+    failure = "--watch tails one --input file; drop --stream, --threads, --state, --cache, --serve, --scenarios, "
+              "--scored-out, --pg-sink, --dedupe, --trend and --stats.";
+  } else if (o->rollup_separator && (o->state || args.serve_path || args.trend)) {
+    failure = "--rollup-separator cannot be combined with --state, --serve or --trend.";
+  } else if (o->dedupe && (o->state || args.serve_path)) {
+    failure = "--dedupe cannot be combined with --state or --serve.";
+  } else if (o->as_of && (strlen(o->as_of) >= MAX_DATE || !parse_date(o->as_of, &as_of_day))) {
+    failure = "Invalid --as-of date. Use YYYY-MM-DD.";
+  }
+  int rc = 1;
+  if (failure) {
+    fprintf(stderr, "%s\n", failure);
+  } else if (args.trend || args.watch || args.serve_path) {
+    rc = run_mode(&args);
+  } else {
+    rc = run_report(&args);
+  }
+  input_list_free(inputs);
+  return rc;
 }
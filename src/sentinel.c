@@ -0,0 +1,6172 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <stdatomic.h>
+#include <stdarg.h>
+#include <float.h>
+#ifdef SENTINEL_ZLIB
+#include <zlib.h>
+#endif
+#ifdef SENTINEL_ZSTD
+#include <zstd.h>
+#endif
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "sentinel_internal.h"
+
+const SketchMetric k_sketch_metrics[SKETCH_METRICS] = {
+  {"attendance", -10, 11, 0, 0},
+  {"satisfaction", 0, 3, 0, 705},
+  {"touchpoints_30d", 0, 16, 1, 898},
+  {"days_since", 0, 16, 1, 1923},
+};
+static const int k_sketch_percents[SKETCH_QUANTILES] = {10, 50, 90};
+const ScoringProfile k_default_profile = {
+  "default",
+  {7, 14, 30}, {1, 2, 3},
+  {1, 0}, {1, 2},
+  {0.8, 0.6}, {1, 2},
+  {4.0, 3.0}, {1, 2},
+  3, 6
+};
+static const char *const k_phase_names[PHASE_COUNT] = {
+  "open", "parse", "score", "sort_risks", "summaries", "alerts",
+  "write_text", "write_cohort_csv", "write_alert_csv", "write_json", "write_pg"
+};
+void trim(char *s) {
+  char *start = s;
+  while (isspace((unsigned char)*start)) start++;
+  if (start != s) memmove(s, start, strlen(start) + 1);
+  if (*s == '\0') return;
+  char *end = s + strlen(s);
+  while (end > s && isspace((unsigned char)*(end - 1))) end--;
+  *end = '\0';
+}
+
+int parse_int(const char *s, int *out) {
+  char *end = NULL;
+  long val = strtol(s, &end, 10);
+  if (end == s || *end != '\0') return 0;
+  *out = (int)val;
+  return 1;
+}
+
+int parse_double(const char *s, double *out) {
+  char *end = NULL;
+  double val = strtod(s, &end);
+  if (end == s || *end != '\0' || val != val) return 0;
+  *out = val;
+  return 1;
+}
+
+static void fixed_sum_add(FixedSum *sum, double value) {
+  uint64_t whole = (uint64_t)value;
+  uint64_t frac = (uint64_t)((value - (double)whole) * 18446744073709551616.0);
+  sum->frac += frac;
+  sum->whole += whole + (sum->frac < frac);
+}
+
+static void fixed_sum_merge(FixedSum *sum, const FixedSum *other) {
+  sum->frac += other->frac;
+  sum->whole += other->whole + (sum->frac < other->frac);
+}
+
+static double fixed_sum_value(const FixedSum *sum) {
+  return (double)sum->whole + (double)sum->frac / 18446744073709551616.0;
+}
+
+static int sketch_bucket(const SketchMetric *m, double value) {
+  if (!(value > 0)) return 0;
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  long long key = (long long)(bits >> (52 - SKETCH_SUB_BITS)) - ((long long)(1023 + m->min_exp) << SKETCH_SUB_BITS);
+  long long top = (long long)m->octaves << SKETCH_SUB_BITS;
+  if (key < 0) return 0;
+  return 1 + (int)(key < top ? key : top - 1);
+}
+
+/* The value reported for a bucket: the point within 0.78% of both ends,
+   rounded for whole-number metrics (exact below 128). */
+static double sketch_bucket_value(const SketchMetric *m, int bucket) {
+  if (bucket == 0) return 0;
+  uint64_t key = (uint64_t)(bucket - 1) + ((uint64_t)(1023 + m->min_exp) << SKETCH_SUB_BITS);
+  uint64_t lo_bits = key << (52 - SKETCH_SUB_BITS);
+  uint64_t hi_bits = (key + 1) << (52 - SKETCH_SUB_BITS);
+  double lo;
+  double hi;
+  memcpy(&lo, &lo_bits, sizeof(lo));
+  memcpy(&hi, &hi_bits, sizeof(hi));
+  double v = 2 * lo * hi / (lo + hi);
+  return m->integral ? (double)(long long)(v + 0.5) : v;
+}
+
+static void sketch_add(uint32_t *sketch, double attendance, double satisfaction, int touchpoints, int days_since) {
+  const SketchMetric *m = k_sketch_metrics;
+  sketch[m[SKETCH_ATTENDANCE].first + sketch_bucket(&m[SKETCH_ATTENDANCE], attendance)]++;
+  sketch[m[SKETCH_SATISFACTION].first + sketch_bucket(&m[SKETCH_SATISFACTION], satisfaction)]++;
+  sketch[m[SKETCH_TOUCHPOINTS].first + sketch_bucket(&m[SKETCH_TOUCHPOINTS], (double)touchpoints)]++;
+  sketch[m[SKETCH_DAYS_SINCE].first + sketch_bucket(&m[SKETCH_DAYS_SINCE], (double)days_since)]++;
+}
+
+/* The metric's value of rank (n - 1) * percent / 100 in sorted order. */
+static double sketch_quantile(const uint32_t *sketch, const SketchMetric *m, int percent) {
+  const uint32_t *counts = sketch + m->first;
+  int buckets = 1 + (m->octaves << SKETCH_SUB_BITS);
+  long long n = 0;
+  for (int b = 0; b < buckets; b++) n += counts[b];
+  if (n == 0) return 0;
+  long long rank = (n - 1) * percent / 100;
+  long long seen = 0;
+  int b = 0;
+  while ((seen += counts[b]) <= rank) b++;
+  return sketch_bucket_value(m, b);
+}
+
+StrView trim_view(StrView v) {
+  while (v.len > 0 && isspace((unsigned char)v.ptr[0])) {
+    v.ptr++;
+    v.len--;
+  }
+  while (v.len > 0 && isspace((unsigned char)v.ptr[v.len - 1])) v.len--;
+  return v;
+}
+
+static int view_cmp_cstr(StrView v, const char *s) {
+  int r = strncmp(v.ptr, s, v.len);
+  if (r != 0) return r;
+  return s[v.len] == '\0' ? 0 : -1;
+}
+
+/* strtol/strtod want NUL-terminated text, which a mapped view is not. */
+static int parse_view_with(StrView v, int (*parse)(const char *, void *), void *out) {
+  char small[64];
+  char *buf = small;
+  if (v.len >= sizeof(small)) {
+    buf = (char *)malloc(v.len + 1);
+    if (!buf) return 0;
+  }
+  memcpy(buf, v.ptr, v.len);
+  buf[v.len] = '\0';
+  int ok = parse(buf, out);
+  if (buf != small) free(buf);
+  return ok;
+}
+
+static int parse_int_cb(const char *s, void *out) {
+  return parse_int(s, (int *)out);
+}
+
+static int parse_double_cb(const char *s, void *out) {
+  return parse_double(s, (double *)out);
+}
+
+static int parse_int_view(StrView v, int *out) {
+  size_t i = 0;
+  int negative = 0;
+  if (v.len > 0 && (v.ptr[0] == '-' || v.ptr[0] == '+')) {
+    negative = v.ptr[0] == '-';
+    i = 1;
+  }
+  if (i == v.len || v.len - i > 9) return parse_view_with(v, parse_int_cb, out);
+  int val = 0;
+  for (; i < v.len; i++) {
+    unsigned d = (unsigned)(v.ptr[i] - '0');
+    if (d > 9) return parse_view_with(v, parse_int_cb, out);
+    val = val * 10 + (int)d;
+  }
+  *out = negative ? -val : val;
+  return 1;
+}
+
+/* Plain decimals with at most 15 significant digits are exact as
+   mantissa / 10^k, which is the correctly rounded value strtod() would
+   return. Exponents, hex, inf/nan and longer inputs go through strtod(). */
+static int parse_double_view(StrView v, double *out) {
+  static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                                 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+  size_t i = 0;
+  int negative = 0;
+  if (v.len > 0 && (v.ptr[0] == '-' || v.ptr[0] == '+')) {
+    negative = v.ptr[0] == '-';
+    i = 1;
+  }
+  int64_t mantissa = 0;
+  int digits = 0;
+  int frac_digits = 0;
+  int seen_dot = 0;
+  for (; i < v.len; i++) {
+    char c = v.ptr[i];
+    if (c >= '0' && c <= '9') {
+      if (++digits > 15) return parse_view_with(v, parse_double_cb, out);
+      mantissa = mantissa * 10 + (c - '0');
+      if (seen_dot) frac_digits++;
+    } else if (c == '.' && !seen_dot) {
+      seen_dot = 1;
+    } else {
+      return parse_view_with(v, parse_double_cb, out);
+    }
+  }
+  if (digits == 0) return parse_view_with(v, parse_double_cb, out);
+  double val = (double)mantissa / pow10[frac_digits];
+  *out = negative ? -val : val;
+  return 1;
+}
+
+/* Days since 1970-01-01 in the proleptic Gregorian calendar. Day-of-month
+   overflow rolls into the next month, matching how mktime() normalized it. */
+static int days_from_civil(int y, int m, int d) {
+  y -= m <= 2;
+  int era = (y >= 0 ? y : y - 399) / 400;
+  int yoe = y - era * 400;
+  int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+void civil_from_days(int z, int *y, int *m, int *d) {
+  z += 719468;
+  int era = (z >= 0 ? z : z - 146096) / 146097;
+  int doe = z - era * 146097;
+  int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int mp = (5 * doy + 2) / 153;
+  *d = doy - (153 * mp + 2) / 5 + 1;
+  *m = mp < 10 ? mp + 3 : mp - 9;
+  *y = yoe + era * 400 + (*m <= 2);
+}
+
+static int digits_value(const char *s, int n, int *out) {
+  int v = 0;
+  for (int i = 0; i < n; i++) {
+    unsigned d = (unsigned)(s[i] - '0');
+    if (d > 9) return 0;
+    v = v * 10 + (int)d;
+  }
+  *out = v;
+  return 1;
+}
+
+int parse_date_fixed(const char *s, int *y, int *m, int *d) {
+  return digits_value(s, 4, y) && s[4] == '-' && digits_value(s + 5, 2, m) &&
+         s[7] == '-' && digits_value(s + 8, 2, d) && s[10] == '\0';
+}
+
+/* Parses a date into a civil day number. Canonical YYYY-MM-DD takes the
+   fixed-offset path; anything else falls back to the lenient sscanf form the
+   tool has always accepted (e.g. 2026-1-5 or a trailing time component). */
+int parse_date(const char *s, int *day_out) {
+  int y = 0, m = 0, d = 0;
+  if (!parse_date_fixed(s, &y, &m, &d) && sscanf(s, "%d-%d-%d", &y, &m, &d) != 3) return 0;
+  if (y < 1900 || m < 1 || m > 12 || d < 1 || d > 31) return 0;
+  *day_out = days_from_civil(y, m, d);
+  return 1;
+}
+
+int local_today(void) {
+  time_t now = time(NULL);
+  struct tm local;
+  localtime_r(&now, &local);
+  return days_from_civil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+}
+
+
+int date_cache_parse(DateCache *cache, StrView s, int *day_out) {
+  if (s.len >= MAX_DATE) return 0;
+  char text[MAX_DATE];
+  uint64_t key[2] = {0, 0};
+  memcpy(key, s.ptr, s.len);
+  memcpy(text, key, sizeof(text));
+  uint64_t h = (key[0] * 0x9E3779B97F4A7C15ull) ^ (key[1] * 0xC2B2AE3D27D4EB4Full);
+  DateCacheSlot *slot = &cache->slots[(h >> 56) & (DATE_CACHE_SLOTS - 1)];
+  if (slot->used && slot->key[0] == key[0] && slot->key[1] == key[1]) {
+    *day_out = slot->day;
+    return slot->ok;
+  }
+  slot->key[0] = key[0];
+  slot->key[1] = key[1];
+  slot->used = 1;
+  slot->ok = (unsigned char)parse_date(text, &slot->day);
+  *day_out = slot->day;
+  return slot->ok;
+}
+
+
+/* Kernel bodies take the profile as a parameter and are always inlined.
+   The default kernels pass &k_default_profile, so its thresholds and point
+   steps fold into immediates; the _profile kernels read b->profile. Each
+   bucket is one compare per bound, giving a row the step between adjacent
+   bucket points, so a bucket count is the difference of two compares. */
+#define KERNEL_INLINE static inline __attribute__((always_inline))
+
+KERNEL_INLINE void score_kernel_scalar_body(const ScoreBlock *b, int start, int end, int counts[KC_COUNT],
+                                            const ScoringProfile *p) {
+  const int r_step0 = p->recency_points[0];
+  const int r_step1 = p->recency_points[1] - p->recency_points[0];
+  const int r_step2 = p->recency_points[2] - p->recency_points[1];
+  const int t_step0 = p->touchpoints_points[0];
+  const int t_step1 = p->touchpoints_points[1] - p->touchpoints_points[0];
+  const int a_step0 = p->attendance_points[0];
+  const int a_step1 = p->attendance_points[1] - p->attendance_points[0];
+  const int s_step0 = p->satisfaction_points[0];
+  const int s_step1 = p->satisfaction_points[1] - p->satisfaction_points[0];
+  for (int i = start; i < end; i++) {
+    int e = b->eligible[i] != 0;
+    int d = b->as_of_day - b->days[i];
+    int future = d < 0;
+    d &= -(int)(d >= 0);
+    int tp = b->touchpoints[i];
+    double a = b->attendance[i];
+    double s = b->satisfaction[i];
+    int r0 = d > p->recency_days[0], r1 = d > p->recency_days[1], r2 = d > p->recency_days[2];
+    int t0 = tp <= p->touchpoints_at_most[0], t1 = tp <= p->touchpoints_at_most[1];
+    int a0 = a < p->attendance_below[0], a1 = a < p->attendance_below[1];
+    int s0 = s < p->satisfaction_below[0], s1 = s < p->satisfaction_below[1];
+    int score = r0 * r_step0 + r1 * r_step1 + r2 * r_step2 + t0 * t_step0 + t1 * t_step1 +
+                a0 * a_step0 + a1 * a_step1 + s0 * s_step0 + s1 * s_step1;
+    int hi = score >= p->high_at, med = score >= p->medium_at;
+    b->days_since[i] = d;
+    b->scores[i] = score;
+    b->tiers[i] = hi + med;
+    counts[KC_FUTURE] += e & future;
+    counts[KC_RECENCY_OVER_30] += e & r2;
+    counts[KC_RECENCY_15_30] += e & (r1 - r2);
+    counts[KC_RECENCY_8_14] += e & (r0 - r1);
+    counts[KC_TOUCHPOINTS_ZERO] += e & t1;
+    counts[KC_TOUCHPOINTS_ONE] += e & (t0 - t1);
+    counts[KC_ATTENDANCE_LOW] += e & a1;
+    counts[KC_ATTENDANCE_MID] += e & (a0 - a1);
+    counts[KC_SATISFACTION_LOW] += e & s1;
+    counts[KC_SATISFACTION_MID] += e & (s0 - s1);
+    counts[KC_HIGH] += e & hi;
+    counts[KC_MEDIUM] += e & (med - hi);
+    counts[KC_LOW] += e & (1 - med);
+  }
+}
+
+/* Reference kernel; the SIMD kernels must match it exactly
+   (bench/kernel_bench.c checks them against the original if/else rules). */
+static void score_kernel_scalar(const ScoreBlock *b, int start, int end, int counts[KC_COUNT]) {
+  score_kernel_scalar_body(b, start, end, counts, &k_default_profile);
+}
+
+static void score_kernel_scalar_profile(const ScoreBlock *b, int start, int end, int counts[KC_COUNT]) {
+  score_kernel_scalar_body(b, start, end, counts, b->profile);
+}
+
+#if defined(__x86_64__)
+/* Packs two 2 x f64 compare masks into one 4 x i32 mask. */
+static inline __m128i sse2_pack_pd_mask(__m128d lo, __m128d hi) {
+  return _mm_castps_si128(_mm_shuffle_ps(_mm_castpd_ps(lo), _mm_castpd_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+KERNEL_INLINE __m128i sse2_below(const double *v, double bound) {
+  const __m128d b = _mm_set1_pd(bound);
+  return sse2_pack_pd_mask(_mm_cmplt_pd(_mm_loadu_pd(v), b), _mm_cmplt_pd(_mm_loadu_pd(v + 2), b));
+}
+
+KERNEL_INLINE void score_kernel_sse2_body(const ScoreBlock *b, int start, int end, int counts[KC_COUNT],
+                                          const ScoringProfile *p) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i as_of = _mm_set1_epi32(b->as_of_day);
+  const __m128i r_step0 = _mm_set1_epi32(p->recency_points[0]);
+  const __m128i r_step1 = _mm_set1_epi32(p->recency_points[1] - p->recency_points[0]);
+  const __m128i r_step2 = _mm_set1_epi32(p->recency_points[2] - p->recency_points[1]);
+  const __m128i t_step0 = _mm_set1_epi32(p->touchpoints_points[0]);
+  const __m128i t_step1 = _mm_set1_epi32(p->touchpoints_points[1] - p->touchpoints_points[0]);
+  const __m128i a_step0 = _mm_set1_epi32(p->attendance_points[0]);
+  const __m128i a_step1 = _mm_set1_epi32(p->attendance_points[1] - p->attendance_points[0]);
+  const __m128i s_step0 = _mm_set1_epi32(p->satisfaction_points[0]);
+  const __m128i s_step1 = _mm_set1_epi32(p->satisfaction_points[1] - p->satisfaction_points[0]);
+  __m128i acc[KC_COUNT];
+  for (int k = 0; k < KC_COUNT; k++) acc[k] = zero;
+  int i = start;
+  for (; i + 4 <= end; i += 4) {
+    uint32_t eb;
+    memcpy(&eb, b->eligible + i, 4);
+    __m128i e = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)eb), zero), zero);
+    e = _mm_cmpgt_epi32(e, zero);
+    __m128i d = _mm_sub_epi32(as_of, _mm_loadu_si128((const __m128i *)(b->days + i)));
+    __m128i future = _mm_cmplt_epi32(d, zero);
+    d = _mm_andnot_si128(future, d);
+    __m128i r0 = _mm_cmpgt_epi32(d, _mm_set1_epi32(p->recency_days[0]));
+    __m128i r1 = _mm_cmpgt_epi32(d, _mm_set1_epi32(p->recency_days[1]));
+    __m128i r2 = _mm_cmpgt_epi32(d, _mm_set1_epi32(p->recency_days[2]));
+    __m128i tp = _mm_loadu_si128((const __m128i *)(b->touchpoints + i));
+    __m128i t0 = _mm_cmplt_epi32(tp, _mm_set1_epi32(p->touchpoints_at_most[0] + 1));
+    __m128i t1 = _mm_cmplt_epi32(tp, _mm_set1_epi32(p->touchpoints_at_most[1] + 1));
+    __m128i a0 = sse2_below(b->attendance + i, p->attendance_below[0]);
+    __m128i a1 = sse2_below(b->attendance + i, p->attendance_below[1]);
+    __m128i s0 = sse2_below(b->satisfaction + i, p->satisfaction_below[0]);
+    __m128i s1 = sse2_below(b->satisfaction + i, p->satisfaction_below[1]);
+    __m128i score = _mm_add_epi32(
+        _mm_add_epi32(_mm_add_epi32(_mm_and_si128(r0, r_step0), _mm_and_si128(r1, r_step1)),
+                      _mm_add_epi32(_mm_and_si128(r2, r_step2), _mm_and_si128(t0, t_step0))),
+        _mm_add_epi32(_mm_add_epi32(_mm_and_si128(t1, t_step1), _mm_and_si128(a0, a_step0)),
+                      _mm_add_epi32(_mm_add_epi32(_mm_and_si128(a1, a_step1), _mm_and_si128(s0, s_step0)),
+                                    _mm_and_si128(s1, s_step1))));
+    __m128i hi = _mm_cmpgt_epi32(score, _mm_set1_epi32(p->high_at - 1));
+    __m128i med = _mm_cmpgt_epi32(score, _mm_set1_epi32(p->medium_at - 1));
+    _mm_storeu_si128((__m128i *)(b->days_since + i), d);
+    _mm_storeu_si128((__m128i *)(b->scores + i), score);
+    _mm_storeu_si128((__m128i *)(b->tiers + i), _mm_sub_epi32(zero, _mm_add_epi32(hi, med)));
+    /* Compare masks are -1, so subtracting them counts rows. */
+    acc[KC_FUTURE] = _mm_sub_epi32(acc[KC_FUTURE], _mm_and_si128(e, future));
+    acc[KC_RECENCY_OVER_30] = _mm_sub_epi32(acc[KC_RECENCY_OVER_30], _mm_and_si128(e, r2));
+    acc[KC_RECENCY_15_30] = _mm_sub_epi32(acc[KC_RECENCY_15_30], _mm_and_si128(e, _mm_andnot_si128(r2, r1)));
+    acc[KC_RECENCY_8_14] = _mm_sub_epi32(acc[KC_RECENCY_8_14], _mm_and_si128(e, _mm_andnot_si128(r1, r0)));
+    acc[KC_TOUCHPOINTS_ZERO] = _mm_sub_epi32(acc[KC_TOUCHPOINTS_ZERO], _mm_and_si128(e, t1));
+    acc[KC_TOUCHPOINTS_ONE] = _mm_sub_epi32(acc[KC_TOUCHPOINTS_ONE], _mm_and_si128(e, _mm_andnot_si128(t1, t0)));
+    acc[KC_ATTENDANCE_LOW] = _mm_sub_epi32(acc[KC_ATTENDANCE_LOW], _mm_and_si128(e, a1));
+    acc[KC_ATTENDANCE_MID] = _mm_sub_epi32(acc[KC_ATTENDANCE_MID], _mm_and_si128(e, _mm_andnot_si128(a1, a0)));
+    acc[KC_SATISFACTION_LOW] = _mm_sub_epi32(acc[KC_SATISFACTION_LOW], _mm_and_si128(e, s1));
+    acc[KC_SATISFACTION_MID] = _mm_sub_epi32(acc[KC_SATISFACTION_MID], _mm_and_si128(e, _mm_andnot_si128(s1, s0)));
+    acc[KC_HIGH] = _mm_sub_epi32(acc[KC_HIGH], _mm_and_si128(e, hi));
+    acc[KC_MEDIUM] = _mm_sub_epi32(acc[KC_MEDIUM], _mm_and_si128(e, _mm_andnot_si128(hi, med)));
+    acc[KC_LOW] = _mm_sub_epi32(acc[KC_LOW], _mm_andnot_si128(med, e));
+  }
+  for (int k = 0; k < KC_COUNT; k++) {
+    int lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc[k]);
+    counts[k] += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+  score_kernel_scalar_body(b, i, end, counts, p);
+}
+
+static void score_kernel_sse2(const ScoreBlock *b, int start, int end, int counts[KC_COUNT]) {
+  score_kernel_sse2_body(b, start, end, counts, &k_default_profile);
+}
+
+static void score_kernel_sse2_profile(const ScoreBlock *b, int start, int end, int counts[KC_COUNT]) {
+  score_kernel_sse2_body(b, start, end, counts, b->profile);
+}
+
+/* Packs two 4 x f64 compare masks into one 8 x i32 mask in row order. */
+__attribute__((target("avx2")))
+static inline __m256i avx2_pack_pd_mask(__m256d lo, __m256d hi) {
+  __m256 packed = _mm256_shuffle_ps(_mm256_castpd_ps(lo), _mm256_castpd_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+  return _mm256_permute4x64_epi64(_mm256_castps_si256(packed), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+__attribute__((target("avx2")))
+KERNEL_INLINE __m256i avx2_below(const double *v, double bound) {
+  const __m256d b = _mm256_set1_pd(bound);
+  return avx2_pack_pd_mask(_mm256_cmp_pd(_mm256_loadu_pd(v), b, _CMP_LT_OQ),
+                           _mm256_cmp_pd(_mm256_loadu_pd(v + 4), b, _CMP_LT_OQ));
+}
+
+__attribute__((target("avx2")))
+KERNEL_INLINE void score_kernel_avx2_body(const ScoreBlock *b, int start, int end, int counts[KC_COUNT],
+                                          const ScoringProfile *p) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i as_of = _mm256_set1_epi32(b->as_of_day);
+  const __m256i r_step0 = _mm256_set1_epi32(p->recency_points[0]);
+  const __m256i r_step1 = _mm256_set1_epi32(p->recency_points[1] - p->recency_points[0]);
+  const __m256i r_step2 = _mm256_set1_epi32(p->recency_points[2] - p->recency_points[1]);
+  const __m256i t_step0 = _mm256_set1_epi32(p->touchpoints_points[0]);
+  const __m256i t_step1 = _mm256_set1_epi32(p->touchpoints_points[1] - p->touchpoints_points[0]);
+  const __m256i a_step0 = _mm256_set1_epi32(p->attendance_points[0]);
+  const __m256i a_step1 = _mm256_set1_epi32(p->attendance_points[1] - p->attendance_points[0]);
+  const __m256i s_step0 = _mm256_set1_epi32(p->satisfaction_points[0]);
+  const __m256i s_step1 = _mm256_set1_epi32(p->satisfaction_points[1] - p->satisfaction_points[0]);
+  __m256i acc[KC_COUNT];
+  for (int k = 0; k < KC_COUNT; k++) acc[k] = zero;
+  int i = start;
+  for (; i + 8 <= end; i += 8) {
+    __m256i e = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(b->eligible + i)));
+    e = _mm256_cmpgt_epi32(e, zero);
+    __m256i d = _mm256_sub_epi32(as_of, _mm256_loadu_si256((const __m256i *)(b->days + i)));
+    __m256i future = _mm256_cmpgt_epi32(zero, d);
+    d = _mm256_andnot_si256(future, d);
+    __m256i r0 = _mm256_cmpgt_epi32(d, _mm256_set1_epi32(p->recency_days[0]));
+    __m256i r1 = _mm256_cmpgt_epi32(d, _mm256_set1_epi32(p->recency_days[1]));
+    __m256i r2 = _mm256_cmpgt_epi32(d, _mm256_set1_epi32(p->recency_days[2]));
+    __m256i tp = _mm256_loadu_si256((const __m256i *)(b->touchpoints + i));
+    __m256i t0 = _mm256_cmpgt_epi32(_mm256_set1_epi32(p->touchpoints_at_most[0] + 1), tp);
+    __m256i t1 = _mm256_cmpgt_epi32(_mm256_set1_epi32(p->touchpoints_at_most[1] + 1), tp);
+    __m256i a0 = avx2_below(b->attendance + i, p->attendance_below[0]);
+    __m256i a1 = avx2_below(b->attendance + i, p->attendance_below[1]);
+    __m256i s0 = avx2_below(b->satisfaction + i, p->satisfaction_below[0]);
+    __m256i s1 = avx2_below(b->satisfaction + i, p->satisfaction_below[1]);
+    __m256i score = _mm256_add_epi32(
+        _mm256_add_epi32(_mm256_add_epi32(_mm256_and_si256(r0, r_step0), _mm256_and_si256(r1, r_step1)),
+                         _mm256_add_epi32(_mm256_and_si256(r2, r_step2), _mm256_and_si256(t0, t_step0))),
+        _mm256_add_epi32(_mm256_add_epi32(_mm256_and_si256(t1, t_step1), _mm256_and_si256(a0, a_step0)),
+                         _mm256_add_epi32(_mm256_add_epi32(_mm256_and_si256(a1, a_step1), _mm256_and_si256(s0, s_step0)),
+                                          _mm256_and_si256(s1, s_step1))));
+    __m256i hi = _mm256_cmpgt_epi32(score, _mm256_set1_epi32(p->high_at - 1));
+    __m256i med = _mm256_cmpgt_epi32(score, _mm256_set1_epi32(p->medium_at - 1));
+    _mm256_storeu_si256((__m256i *)(b->days_since + i), d);
+    _mm256_storeu_si256((__m256i *)(b->scores + i), score);
+    _mm256_storeu_si256((__m256i *)(b->tiers + i), _mm256_sub_epi32(zero, _mm256_add_epi32(hi, med)));
+    acc[KC_FUTURE] = _mm256_sub_epi32(acc[KC_FUTURE], _mm256_and_si256(e, future));
+    acc[KC_RECENCY_OVER_30] = _mm256_sub_epi32(acc[KC_RECENCY_OVER_30], _mm256_and_si256(e, r2));
+    acc[KC_RECENCY_15_30] = _mm256_sub_epi32(acc[KC_RECENCY_15_30], _mm256_and_si256(e, _mm256_andnot_si256(r2, r1)));
+    acc[KC_RECENCY_8_14] = _mm256_sub_epi32(acc[KC_RECENCY_8_14], _mm256_and_si256(e, _mm256_andnot_si256(r1, r0)));
+    acc[KC_TOUCHPOINTS_ZERO] = _mm256_sub_epi32(acc[KC_TOUCHPOINTS_ZERO], _mm256_and_si256(e, t1));
+    acc[KC_TOUCHPOINTS_ONE] = _mm256_sub_epi32(acc[KC_TOUCHPOINTS_ONE], _mm256_and_si256(e, _mm256_andnot_si256(t1, t0)));
+    acc[KC_ATTENDANCE_LOW] = _mm256_sub_epi32(acc[KC_ATTENDANCE_LOW], _mm256_and_si256(e, a1));
+    acc[KC_ATTENDANCE_MID] = _mm256_sub_epi32(acc[KC_ATTENDANCE_MID], _mm256_and_si256(e, _mm256_andnot_si256(a1, a0)));
+    acc[KC_SATISFACTION_LOW] = _mm256_sub_epi32(acc[KC_SATISFACTION_LOW], _mm256_and_si256(e, s1));
+    acc[KC_SATISFACTION_MID] = _mm256_sub_epi32(acc[KC_SATISFACTION_MID], _mm256_and_si256(e, _mm256_andnot_si256(s1, s0)));
+    acc[KC_HIGH] = _mm256_sub_epi32(acc[KC_HIGH], _mm256_and_si256(e, hi));
+    acc[KC_MEDIUM] = _mm256_sub_epi32(acc[KC_MEDIUM], _mm256_and_si256(e, _mm256_andnot_si256(hi, med)));
+    acc[KC_LOW] = _mm256_sub_epi32(acc[KC_LOW], _mm256_andnot_si256(med, e));
+  }
+  for (int k = 0; k < KC_COUNT; k++) {
+    int lanes[8];
+    _mm256_storeu_si256((__m256i *)lanes, acc[k]);
+    counts[k] += lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+  }
+  score_kernel_scalar_body(b, i, end, counts, p);
+}
+
+__attribute__((target("avx2")))
+static void score_kernel_avx2(const ScoreBlock *b, int start, int end, int counts[KC_COUNT]) {
+  score_kernel_avx2_body(b, start, end, counts, &k_default_profile);
+}
+
+__attribute__((target("avx2")))
+static void score_kernel_avx2_profile(const ScoreBlock *b, int start, int end, int counts[KC_COUNT]) {
+  score_kernel_avx2_body(b, start, end, counts, b->profile);
+}
+#endif
+
+#if defined(__aarch64__)
+static inline uint32x4_t neon_pack_f64_mask(uint64x2_t lo, uint64x2_t hi) {
+  return vcombine_u32(vmovn_u64(lo), vmovn_u64(hi));
+}
+
+KERNEL_INLINE uint32x4_t neon_below(const double *v, double bound) {
+  const float64x2_t b = vdupq_n_f64(bound);
+  return neon_pack_f64_mask(vcltq_f64(vld1q_f64(v), b), vcltq_f64(vld1q_f64(v + 2), b));
+}
+
+KERNEL_INLINE void score_kernel_neon_body(const ScoreBlock *b, int start, int end, int counts[KC_COUNT],
+                                          const ScoringProfile *p) {
+  const int32x4_t as_of = vdupq_n_s32(b->as_of_day);
+  const uint32x4_t r_step0 = vdupq_n_u32((uint32_t)p->recency_points[0]);
+  const uint32x4_t r_step1 = vdupq_n_u32((uint32_t)(p->recency_points[1] - p->recency_points[0]));
+  const uint32x4_t r_step2 = vdupq_n_u32((uint32_t)(p->recency_points[2] - p->recency_points[1]));
+  const uint32x4_t t_step0 = vdupq_n_u32((uint32_t)p->touchpoints_points[0]);
+  const uint32x4_t t_step1 = vdupq_n_u32((uint32_t)(p->touchpoints_points[1] - p->touchpoints_points[0]));
+  const uint32x4_t a_step0 = vdupq_n_u32((uint32_t)p->attendance_points[0]);
+  const uint32x4_t a_step1 = vdupq_n_u32((uint32_t)(p->attendance_points[1] - p->attendance_points[0]));
+  const uint32x4_t s_step0 = vdupq_n_u32((uint32_t)p->satisfaction_points[0]);
+  const uint32x4_t s_step1 = vdupq_n_u32((uint32_t)(p->satisfaction_points[1] - p->satisfaction_points[0]));
+  uint32x4_t acc[KC_COUNT];
+  for (int k = 0; k < KC_COUNT; k++) acc[k] = vdupq_n_u32(0);
+  int i = start;
+  for (; i + 4 <= end; i += 4) {
+    uint32_t eb;
+    memcpy(&eb, b->eligible + i, 4);
+    uint32x4_t e = vtstq_u32(vmovl_u16(vget_low_u16(vmovl_u8(vcreate_u8(eb)))), vdupq_n_u32(0xff));
+    int32x4_t d = vsubq_s32(as_of, vld1q_s32(b->days + i));
+    uint32x4_t future = vcltq_s32(d, vdupq_n_s32(0));
+    d = vmaxq_s32(d, vdupq_n_s32(0));
+    uint32x4_t r0 = vcgtq_s32(d, vdupq_n_s32(p->recency_days[0]));
+    uint32x4_t r1 = vcgtq_s32(d, vdupq_n_s32(p->recency_days[1]));
+    uint32x4_t r2 = vcgtq_s32(d, vdupq_n_s32(p->recency_days[2]));
+    int32x4_t tp = vld1q_s32(b->touchpoints + i);
+    uint32x4_t t0 = vcleq_s32(tp, vdupq_n_s32(p->touchpoints_at_most[0]));
+    uint32x4_t t1 = vcleq_s32(tp, vdupq_n_s32(p->touchpoints_at_most[1]));
+    uint32x4_t a0 = neon_below(b->attendance + i, p->attendance_below[0]);
+    uint32x4_t a1 = neon_below(b->attendance + i, p->attendance_below[1]);
+    uint32x4_t s0 = neon_below(b->satisfaction + i, p->satisfaction_below[0]);
+    uint32x4_t s1 = neon_below(b->satisfaction + i, p->satisfaction_below[1]);
+    uint32x4_t score = vaddq_u32(vaddq_u32(vaddq_u32(vandq_u32(r0, r_step0), vandq_u32(r1, r_step1)),
+                                           vaddq_u32(vandq_u32(r2, r_step2), vandq_u32(t0, t_step0))),
+                                 vaddq_u32(vaddq_u32(vandq_u32(t1, t_step1), vandq_u32(a0, a_step0)),
+                                           vaddq_u32(vaddq_u32(vandq_u32(a1, a_step1), vandq_u32(s0, s_step0)),
+                                                     vandq_u32(s1, s_step1))));
+    int32x4_t sscore = vreinterpretq_s32_u32(score);
+    uint32x4_t hi = vcgeq_s32(sscore, vdupq_n_s32(p->high_at));
+    uint32x4_t med = vcgeq_s32(sscore, vdupq_n_s32(p->medium_at));
+    uint32x4_t one = vdupq_n_u32(1);
+    vst1q_s32(b->days_since + i, d);
+    vst1q_s32(b->scores + i, sscore);
+    vst1q_s32(b->tiers + i, vreinterpretq_s32_u32(vaddq_u32(vandq_u32(hi, one), vandq_u32(med, one))));
+    acc[KC_FUTURE] = vsubq_u32(acc[KC_FUTURE], vandq_u32(e, future));
+    acc[KC_RECENCY_OVER_30] = vsubq_u32(acc[KC_RECENCY_OVER_30], vandq_u32(e, r2));
+    acc[KC_RECENCY_15_30] = vsubq_u32(acc[KC_RECENCY_15_30], vandq_u32(e, vbicq_u32(r1, r2)));
+    acc[KC_RECENCY_8_14] = vsubq_u32(acc[KC_RECENCY_8_14], vandq_u32(e, vbicq_u32(r0, r1)));
+    acc[KC_TOUCHPOINTS_ZERO] = vsubq_u32(acc[KC_TOUCHPOINTS_ZERO], vandq_u32(e, t1));
+    acc[KC_TOUCHPOINTS_ONE] = vsubq_u32(acc[KC_TOUCHPOINTS_ONE], vandq_u32(e, vbicq_u32(t0, t1)));
+    acc[KC_ATTENDANCE_LOW] = vsubq_u32(acc[KC_ATTENDANCE_LOW], vandq_u32(e, a1));
+    acc[KC_ATTENDANCE_MID] = vsubq_u32(acc[KC_ATTENDANCE_MID], vandq_u32(e, vbicq_u32(a0, a1)));
+    acc[KC_SATISFACTION_LOW] = vsubq_u32(acc[KC_SATISFACTION_LOW], vandq_u32(e, s1));
+    acc[KC_SATISFACTION_MID] = vsubq_u32(acc[KC_SATISFACTION_MID], vandq_u32(e, vbicq_u32(s0, s1)));
+    acc[KC_HIGH] = vsubq_u32(acc[KC_HIGH], vandq_u32(e, hi));
+    acc[KC_MEDIUM] = vsubq_u32(acc[KC_MEDIUM], vandq_u32(e, vbicq_u32(med, hi)));
+    acc[KC_LOW] = vsubq_u32(acc[KC_LOW], vbicq_u32(e, med));
+  }
+  for (int k = 0; k < KC_COUNT; k++) counts[k] += (int)vaddvq_u32(acc[k]);
+  score_kernel_scalar_body(b, i, end, counts, p);
+}
+
+static void score_kernel_neon(const ScoreBlock *b, int start, int end, int counts[KC_COUNT]) {
+  score_kernel_neon_body(b, start, end, counts, &k_default_profile);
+}
+
+static void score_kernel_neon_profile(const ScoreBlock *b, int start, int end, int counts[KC_COUNT]) {
+  score_kernel_neon_body(b, start, end, counts, b->profile);
+}
+#endif
+
+/* Looks up a kernel by variant name; generic selects the variant that reads
+   b->profile instead of the one specialized for the default profile. */
+static ScoreKernelFn score_kernel_named(const char *name, int generic) {
+  if (strcmp(name, "scalar") == 0) return generic ? score_kernel_scalar_profile : score_kernel_scalar;
+#if defined(__x86_64__)
+  if (strcmp(name, "sse2") == 0) return generic ? score_kernel_sse2_profile : score_kernel_sse2;
+  __builtin_cpu_init();
+  if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+    return generic ? score_kernel_avx2_profile : score_kernel_avx2;
+  }
+#elif defined(__aarch64__)
+  if (strcmp(name, "neon") == 0) return generic ? score_kernel_neon_profile : score_kernel_neon;
+#endif
+  return NULL;
+}
+
+int profile_is_default(const ScoringProfile *p) {
+  const ScoringProfile *d = &k_default_profile;
+  return memcmp(p->recency_days, d->recency_days, sizeof(d->recency_days)) == 0 &&
+         memcmp(p->recency_points, d->recency_points, sizeof(d->recency_points)) == 0 &&
+         memcmp(p->touchpoints_at_most, d->touchpoints_at_most, sizeof(d->touchpoints_at_most)) == 0 &&
+         memcmp(p->touchpoints_points, d->touchpoints_points, sizeof(d->touchpoints_points)) == 0 &&
+         p->attendance_below[0] == d->attendance_below[0] && p->attendance_below[1] == d->attendance_below[1] &&
+         memcmp(p->attendance_points, d->attendance_points, sizeof(d->attendance_points)) == 0 &&
+         p->satisfaction_below[0] == d->satisfaction_below[0] && p->satisfaction_below[1] == d->satisfaction_below[1] &&
+         memcmp(p->satisfaction_points, d->satisfaction_points, sizeof(d->satisfaction_points)) == 0 &&
+         p->medium_at == d->medium_at && p->high_at == d->high_at;
+}
+
+/* Same policy as select_scan_line(); SENTINEL_KERNEL pins a variant. Any
+   profile equal to the default gets the specialized kernels. */
+ScoreKernelFn select_score_kernel(const ScoringProfile *profile) {
+  int generic = !profile_is_default(profile);
+  const char *forced = getenv("SENTINEL_KERNEL");
+  if (forced && score_kernel_named(forced, generic)) return score_kernel_named(forced, generic);
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return generic ? score_kernel_avx2_profile : score_kernel_avx2;
+  return generic ? score_kernel_sse2_profile : score_kernel_sse2;
+#elif defined(__aarch64__)
+  return generic ? score_kernel_neon_profile : score_kernel_neon;
+#else
+  return generic ? score_kernel_scalar_profile : score_kernel_scalar;
+#endif
+}
+
+double cohort_risk_index(int high, int medium, int low) {
+  int count = high + medium + low;
+  if (count == 0) return 0.0;
+  return (high * 3.0 + medium * 2.0 + low * 1.0) / (double)count;
+}
+
+CohortSort cohort_sort_mode(const char *value, int *ok) {
+  if (strcmp(value, "risk") == 0) {
+    *ok = 1;
+    return SORT_RISK;
+  }
+  if (strcmp(value, "high") == 0) {
+    *ok = 1;
+    return SORT_HIGH;
+  }
+  if (strcmp(value, "name") == 0) {
+    *ok = 1;
+    return SORT_NAME;
+  }
+  *ok = 0;
+  return SORT_RISK;
+}
+
+const char *const k_sort_names[3] = {"risk", "high", "name"};
+
+
+int matches_cohort(StrView cohort, char **filters, int filter_count) {
+  if (filter_count == 0) return 1;
+  for (int i = 0; i < filter_count; i++) {
+    if (view_cmp_cstr(cohort, filters[i]) == 0) return 1;
+  }
+  return 0;
+}
+
+/* Binary-searches each prefix of cohort that ends before a separator, then
+   the whole name, so the cost grows with the depth, not the filter count. */
+static int rollup_matches(const Rollup *r, StrView cohort) {
+  if (r->filter_count == 0) return 1;
+  for (size_t len = 1; len <= cohort.len; len++) {
+    if (len < cohort.len && cohort.ptr[len] != r->separator) continue;
+    StrView prefix = {cohort.ptr, len};
+    int lo = 0;
+    int hi = r->filter_count;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      int cmp = view_cmp_cstr(prefix, r->filters[mid]);
+      if (cmp == 0) return 1;
+      if (cmp < 0) hi = mid; else lo = mid + 1;
+    }
+  }
+  return 0;
+}
+
+static int context_wants(const ScoreContext *ctx, StrView cohort) {
+  if (ctx->rollup) return rollup_matches(ctx->rollup, cohort);
+  return matches_cohort(cohort, ctx->cohort_filters, ctx->cohort_filter_count);
+}
+
+/* Splits a comma-separated --cohort value into trimmed, non-empty names.
+   The names point into *buffer; both are freed by the caller. Returns 0 on
+   allocation failure. */
+int split_cohort_filters(const char *text, char **buffer, char ***filters, int *count) {
+  *buffer = strdup(text);
+  *filters = NULL;
+  *count = 0;
+  int slots = 4;
+  char **list = *buffer ? (char **)malloc(sizeof(char *) * slots) : NULL;
+  if (!list) return 0;
+  char *save = NULL;
+  for (char *token = strtok_r(*buffer, ",", &save); token; token = strtok_r(NULL, ",", &save)) {
+    trim(token);
+    if (!*token) continue;
+    if (*count >= slots) {
+      slots *= 2;
+      char **resized = (char **)realloc(list, sizeof(char *) * slots);
+      if (!resized) {
+        free(list);
+        return 0;
+      }
+      list = resized;
+    }
+    list[(*count)++] = token;
+  }
+  if (*count == 0) {
+    free(list);
+    list = NULL;
+  }
+  *filters = list;
+  return 1;
+}
+
+int compare_name_ptr(const void *a, const void *b) {
+  return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+
+/* Parses "v1, v2, ..." into exactly `count` ints or doubles. */
+static int parse_profile_values(char *text, int count, int is_double, void *out) {
+  int n = 0;
+  char *rest = text;
+  char *token;
+  while ((token = strtok_r(rest, ",", &rest))) {
+    trim(token);
+    if (n >= count) return 0;
+    if (is_double ? !parse_double(token, (double *)out + n) : !parse_int(token, (int *)out + n)) return 0;
+    n++;
+  }
+  return n == count;
+}
+
+static int profile_is_valid(const ScoringProfile *p) {
+  const int *points[] = {p->recency_points, p->touchpoints_points, p->attendance_points, p->satisfaction_points};
+  const int point_counts[] = {3, 2, 2, 2};
+  for (int k = 0; k < 4; k++) {
+    for (int j = 0; j < point_counts[k]; j++) {
+      if (points[k][j] < 0 || points[k][j] > 1000) return 0;
+    }
+  }
+  /* Buckets must nest: every severe bucket sits inside the milder one. */
+  return p->recency_days[0] >= 0 && p->recency_days[0] < p->recency_days[1] &&
+         p->recency_days[1] < p->recency_days[2] &&
+         p->touchpoints_at_most[0] > p->touchpoints_at_most[1] && p->touchpoints_at_most[1] >= 0 &&
+         p->touchpoints_at_most[0] < 1000000 &&
+         p->attendance_below[0] > p->attendance_below[1] &&
+         p->satisfaction_below[0] > p->satisfaction_below[1] &&
+         p->medium_at <= p->high_at;
+}
+
+/* Reads a scoring profile of `key = value[, value...]` lines; # starts a
+   comment and keys left out keep their default values. */
+int load_scoring_profile(const char *path, ScoringProfile *out) {
+  *out = k_default_profile;
+  snprintf(out->name, sizeof(out->name), "%s", path);
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    perror("Failed to open scoring profile");
+    return 0;
+  }
+  const struct {
+    const char *key;
+    int count;
+    int is_double;
+    void *dest;
+  } keys[] = {
+    {"recency_days", 3, 0, out->recency_days},
+    {"recency_points", 3, 0, out->recency_points},
+    {"touchpoints_at_most", 2, 0, out->touchpoints_at_most},
+    {"touchpoints_points", 2, 0, out->touchpoints_points},
+    {"attendance_below", 2, 1, out->attendance_below},
+    {"attendance_points", 2, 0, out->attendance_points},
+    {"satisfaction_below", 2, 1, out->satisfaction_below},
+    {"satisfaction_points", 2, 0, out->satisfaction_points},
+    {"medium_at", 1, 0, &out->medium_at},
+    {"high_at", 1, 0, &out->high_at},
+  };
+  char line[512];
+  int line_no = 0;
+  int ok = 1;
+  while (ok && fgets(line, sizeof(line), fp)) {
+    line_no++;
+    char *hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+    trim(line);
+    if (*line == '\0') continue;
+    char *eq = strchr(line, '=');
+    ok = eq != NULL;
+    if (ok) {
+      *eq = '\0';
+      char *key = line;
+      char *value = eq + 1;
+      trim(key);
+      trim(value);
+      if (strcmp(key, "name") == 0) {
+        ok = *value != '\0' && strlen(value) < sizeof(out->name);
+        if (ok) snprintf(out->name, sizeof(out->name), "%s", value);
+      } else {
+        ok = 0;
+        for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) {
+          if (strcmp(key, keys[k].key) == 0) {
+            ok = parse_profile_values(value, keys[k].count, keys[k].is_double, keys[k].dest);
+            break;
+          }
+        }
+      }
+    }
+    if (!ok) fprintf(stderr, "Invalid scoring profile line %d.\n", line_no);
+  }
+  fclose(fp);
+  if (ok && !profile_is_valid(out)) {
+    fprintf(stderr, "Invalid scoring profile: bounds must run mild to severe and points must be 0-1000.\n");
+    ok = 0;
+  }
+  return ok;
+}
+
+/* Reads a --scenarios file: each `[name]` line starts a scenario and the
+   `key = value` lines under it override the command-line settings given in
+   `base` (scoring_profile, alert_threshold, min_cohort_size, limit). */
+static int load_scenarios(const char *path, const Scenario *base, Scenario **out, int *count) {
+  *out = NULL;
+  *count = 0;
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    perror("Failed to open scenarios file");
+    return 0;
+  }
+  Scenario *list = NULL;
+  int slots = 0;
+  char line[512];
+  int line_no = 0;
+  int ok = 1;
+  while (ok && fgets(line, sizeof(line), fp)) {
+    line_no++;
+    char *hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+    trim(line);
+    if (*line == '\0') continue;
+    size_t len = strlen(line);
+    if (line[0] == '[') {
+      ok = len > 2 && len - 2 < MAX_NAME && line[len - 1] == ']';
+      if (ok && *count >= slots) {
+        slots = slots ? slots * 2 : 8;
+        Scenario *resized = (Scenario *)realloc(list, sizeof(Scenario) * (size_t)slots);
+        if (!resized) {
+          fprintf(stderr, "Failed to allocate scenarios.\n");
+          free(list);
+          fclose(fp);
+          return 0;
+        }
+        list = resized;
+      }
+      if (ok) {
+        Scenario *sc = &list[(*count)++];
+        *sc = *base;
+        snprintf(sc->name, sizeof(sc->name), "%.*s", (int)(len - 2), line + 1);
+      }
+    } else {
+      char *eq = strchr(line, '=');
+      ok = eq != NULL && *count > 0;
+      if (ok) {
+        Scenario *sc = &list[*count - 1];
+        *eq = '\0';
+        char *key = line;
+        char *value = eq + 1;
+        trim(key);
+        trim(value);
+        if (strcmp(key, "scoring_profile") == 0) {
+          if (!load_scoring_profile(value, &sc->profile)) {
+            free(list);
+            fclose(fp);
+            return 0;
+          }
+        } else if (strcmp(key, "alert_threshold") == 0) {
+          ok = parse_double(value, &sc->alert_threshold) && sc->alert_threshold >= 0 && sc->alert_threshold <= 1.0;
+        } else if (strcmp(key, "min_cohort_size") == 0) {
+          ok = parse_int(value, &sc->min_cohort_size) && sc->min_cohort_size >= 1;
+        } else if (strcmp(key, "limit") == 0) {
+          ok = parse_int(value, &sc->limit) && sc->limit >= 0;
+        } else {
+          ok = 0;
+        }
+      }
+    }
+    if (!ok) fprintf(stderr, "Invalid scenarios line %d.\n", line_no);
+  }
+  fclose(fp);
+  if (ok && *count == 0) {
+    fprintf(stderr, "Scenarios file defines no [scenario] sections.\n");
+    ok = 0;
+  }
+  if (!ok) {
+    free(list);
+    *count = 0;
+    return 0;
+  }
+  *out = list;
+  return 1;
+}
+
+static uint32_t hash_name(const char *name, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (unsigned char)name[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+#define ARENA_BLOCK (64 * 1024)
+
+static char *arena_alloc(Arena *a, size_t n) {
+  ArenaBlock *b = a->head;
+  if (!b || b->cap - b->used < n) {
+    size_t cap = n > ARENA_BLOCK ? n : ARENA_BLOCK;
+    b = (ArenaBlock *)malloc(sizeof(ArenaBlock) + cap);
+    if (!b) return NULL;
+    b->next = a->head;
+    b->used = 0;
+    b->cap = cap;
+    a->head = b;
+  }
+  char *p = b->data + b->used;
+  b->used += n;
+  a->used += n;
+  return p;
+}
+
+static char *arena_strndup(Arena *a, const char *p, size_t n) {
+  char *copy = arena_alloc(a, n + 1);
+  if (!copy) return NULL;
+  memcpy(copy, p, n);
+  copy[n] = '\0';
+  return copy;
+}
+
+static void arena_free(Arena *a) {
+  ArenaBlock *b = a->head;
+  while (b) {
+    ArenaBlock *next = b->next;
+    free(b);
+    b = next;
+  }
+  memset(a, 0, sizeof(Arena));
+}
+
+int cohort_table_init(CohortTable *table) {
+  memset(table, 0, sizeof(CohortTable));
+  table->capacity = 64;
+  table->slot_count = 128;
+  table->entries = (CohortStats *)malloc(sizeof(CohortStats) * table->capacity);
+  table->slots = (int *)calloc(table->slot_count, sizeof(int));
+  table->slot_hashes = (uint32_t *)calloc(table->slot_count, sizeof(uint32_t));
+  return table->entries && table->slots && table->slot_hashes;
+}
+
+void cohort_table_free(CohortTable *table) {
+  for (int i = 0; i < table->count; i++) free(table->entries[i].sketch);
+  arena_free(&table->names);
+  free(table->entries);
+  free(table->slots);
+  free(table->slot_hashes);
+  memset(table, 0, sizeof(CohortTable));
+}
+
+static void cohort_table_place(int *slots, uint32_t *slot_hashes, int slot_count, uint32_t hash, int index) {
+  int mask = slot_count - 1;
+  int slot = (int)(hash & (uint32_t)mask);
+  while (slots[slot] != 0) slot = (slot + 1) & mask;
+  slots[slot] = index + 1;
+  slot_hashes[slot] = hash;
+}
+
+static int cohort_table_grow_slots(CohortTable *table) {
+  int slot_count = table->slot_count * 2;
+  int *slots = (int *)calloc(slot_count, sizeof(int));
+  uint32_t *slot_hashes = (uint32_t *)calloc(slot_count, sizeof(uint32_t));
+  if (!slots || !slot_hashes) {
+    free(slots);
+    free(slot_hashes);
+    return 0;
+  }
+  for (int i = 0; i < table->slot_count; i++) {
+    if (table->slots[i] == 0) continue;
+    cohort_table_place(slots, slot_hashes, slot_count, table->slot_hashes[i], table->slots[i] - 1);
+  }
+  free(table->slots);
+  free(table->slot_hashes);
+  table->slots = slots;
+  table->slot_hashes = slot_hashes;
+  table->slot_count = slot_count;
+  table->rehashes++;
+  return 1;
+}
+
+/* Returns the index of the cohort's stats, interning the name on first use,
+   or -1 if the table could not grow. */
+int find_or_add_cohort(CohortTable *table, StrView name) {
+  size_t len = name.len;
+  uint32_t hash = hash_name(name.ptr, len);
+  int mask = table->slot_count - 1;
+  int slot = (int)(hash & (uint32_t)mask);
+  while (table->slots[slot] != 0) {
+    int index = table->slots[slot] - 1;
+    const CohortStats *c = &table->entries[index];
+    if (table->slot_hashes[slot] == hash && c->name_len == len && memcmp(c->name, name.ptr, len) == 0) {
+      return index;
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  int parent = -1;
+  int level = 0;
+  if (table->rollup) {
+    const char *sep = NULL;
+    level = 1;
+    for (size_t i = 0; i < len; i++) {
+      if (name.ptr[i] != table->rollup->separator) continue;
+      sep = name.ptr + i;
+      level++;
+    }
+    StrView prefix = {name.ptr, sep ? (size_t)(sep - name.ptr) : 0};
+    if (prefix.len > 0 && rollup_matches(table->rollup, prefix) && (parent = find_or_add_cohort(table, prefix)) < 0) {
+      return -1;
+    }
+  }
+
+  if ((table->count + 1) * 2 > table->slot_count && !cohort_table_grow_slots(table)) return -1;
+  if (table->count >= table->capacity) {
+    int capacity = table->capacity * 2;
+    CohortStats *resized = (CohortStats *)realloc(table->entries, sizeof(CohortStats) * capacity);
+    if (!resized) return -1;
+    table->entries = resized;
+    table->capacity = capacity;
+  }
+  uint32_t *sketch = NULL;
+  if (table->sketched && !(sketch = (uint32_t *)calloc(SKETCH_BUCKETS, sizeof(uint32_t)))) return -1;
+  char *interned = arena_strndup(&table->names, name.ptr, len);
+  if (!interned) {
+    free(sketch);
+    return -1;
+  }
+
+  int index = table->count++;
+  CohortStats *c = &table->entries[index];
+  memset(c, 0, sizeof(CohortStats));
+  c->name = interned;
+  c->name_len = len;
+  c->sketch = sketch;
+  c->parent = parent;
+  c->level = level;
+  cohort_table_place(table->slots, table->slot_hashes, table->slot_count, hash, index);
+  return index;
+}
+
+/* Ties on score, recency and id (duplicate ids) fall back to input order so
+   the kept set never depends on scan or thread scheduling order. */
+static int compare_risk_key(int score, int days_since, StrView id, size_t offset, const RiskEntry *rb) {
+  if (rb->risk_score != score) return rb->risk_score - score;
+  if (rb->days_since != days_since) return rb->days_since - days_since;
+  int r = view_cmp_cstr(id, rb->id);
+  if (r != 0) return r;
+  return (offset > rb->offset) - (offset < rb->offset);
+}
+
+int compare_risk(const void *a, const void *b) {
+  const RiskEntry *ra = (const RiskEntry *)a;
+  const RiskEntry *rb = (const RiskEntry *)b;
+  if (rb->risk_score != ra->risk_score) return rb->risk_score - ra->risk_score;
+  if (rb->days_since != ra->days_since) return rb->days_since - ra->days_since;
+  int r = strcmp(ra->id, rb->id);
+  if (r != 0) return r;
+  return (ra->offset > rb->offset) - (ra->offset < rb->offset);
+}
+
+int top_risks_init(TopRisks *top, int capacity) {
+  memset(top, 0, sizeof(TopRisks));
+  top->capacity = capacity;
+  top->allocated = capacity < 64 ? (capacity > 0 ? capacity : 1) : 64;
+  top->entries = (RiskEntry *)malloc(sizeof(RiskEntry) * (size_t)top->allocated);
+  return top->entries != NULL;
+}
+
+void top_risks_free(TopRisks *top) {
+  free(top->entries);
+  arena_free(&top->ids);
+  memset(top, 0, sizeof(TopRisks));
+}
+
+/* Re-copies the kept ids once evicted ones dominate the arena, so a list fed
+   rows in rising score order stays bounded. Keeps the old arena on failure. */
+static void top_risks_compact(TopRisks *top) {
+  Arena fresh;
+  memset(&fresh, 0, sizeof(Arena));
+  char **ids = (char **)malloc(sizeof(char *) * (size_t)(top->count > 0 ? top->count : 1));
+  int ok = ids != NULL;
+  for (int i = 0; ok && i < top->count; i++) {
+    ids[i] = arena_strndup(&fresh, top->entries[i].id, top->entries[i].id_len);
+    ok = ids[i] != NULL;
+  }
+  if (ok) {
+    for (int i = 0; i < top->count; i++) top->entries[i].id = ids[i];
+    arena_free(&top->ids);
+    top->ids = fresh;
+  } else {
+    arena_free(&fresh);
+  }
+  free(ids);
+}
+
+/* True when an entry with this key would be kept, checked before the caller
+   spends time copying id/cohort strings into a RiskEntry. */
+int top_risks_admits(const TopRisks *top, int score, int days_since, StrView id, size_t offset) {
+  if (top->count < top->capacity) return 1;
+  if (top->capacity == 0) return 0;
+  return compare_risk_key(score, days_since, id, offset, &top->entries[0]) < 0;
+}
+
+static void top_risks_sift_down(TopRisks *top, int i) {
+  RiskEntry *e = top->entries;
+  for (;;) {
+    int left = 2 * i + 1;
+    int right = left + 1;
+    int worst = i;
+    if (left < top->count && compare_risk(&e[left], &e[worst]) > 0) worst = left;
+    if (right < top->count && compare_risk(&e[right], &e[worst]) > 0) worst = right;
+    if (worst == i) return;
+    RiskEntry tmp = e[i];
+    e[i] = e[worst];
+    e[worst] = tmp;
+    i = worst;
+  }
+}
+
+/* Keeps *entry, with id copied into the list, when it ranks among the best
+   `capacity`; entry->id is ignored. Returns 0, and sets `failed`, when a
+   ranking entry could not be stored. */
+int top_risks_push(TopRisks *top, const RiskEntry *entry, StrView id) {
+  if (!top_risks_admits(top, entry->risk_score, entry->days_since, id, entry->offset)) return 1;
+  if (top->count == top->allocated && top->count < top->capacity) {
+    int grown = top->allocated > top->capacity / 2 ? top->capacity : top->allocated * 2;
+    RiskEntry *entries = (RiskEntry *)realloc(top->entries, sizeof(RiskEntry) * (size_t)grown);
+    if (!entries) {
+      top->failed = 1;
+      return 0;
+    }
+    top->entries = entries;
+    top->allocated = grown;
+  }
+  RiskEntry kept = *entry;
+  char *copy = arena_strndup(&top->ids, id.ptr, id.len);
+  if (!copy) {
+    top->failed = 1;
+    return 0;
+  }
+  kept.id = copy;
+  kept.id_len = id.len;
+  top->live_ids += id.len + 1;
+
+  RiskEntry *e = top->entries;
+  if (top->count < top->capacity) {
+    int i = top->count++;
+    e[i] = kept;
+    while (i > 0) {
+      int parent = (i - 1) / 2;
+      if (compare_risk(&e[i], &e[parent]) <= 0) break;
+      RiskEntry tmp = e[i];
+      e[i] = e[parent];
+      e[parent] = tmp;
+      i = parent;
+    }
+    return 1;
+  }
+  top->live_ids -= e[0].id_len + 1;
+  e[0] = kept;
+  top_risks_sift_down(top, 0);
+  if (top->ids.used > 4 * top->live_ids + ARENA_BLOCK) top_risks_compact(top);
+  return 1;
+}
+
+/* Folds the entries of a per-thread or per-file list into `into`, pointing
+   their cohorts at the names in `cohorts` (already merged from the same
+   source). */
+static void top_risks_merge(TopRisks *into, const TopRisks *from, CohortTable *cohorts) {
+  if (from->failed) into->failed = 1;
+  for (int i = 0; i < from->count; i++) {
+    RiskEntry entry = from->entries[i];
+    StrView name = {entry.cohort, strlen(entry.cohort)};
+    int idx = find_or_add_cohort(cohorts, name);
+    if (idx < 0) {
+      into->failed = 1;
+      continue;
+    }
+    entry.cohort = cohorts->entries[idx].name;
+    StrView id = {entry.id, entry.id_len};
+    top_risks_push(into, &entry, id);
+  }
+}
+
+/* Parallel merge sort for the big output arrays (a --limit or
+   --cohort-limit export of every row or cohort). The array is cut into a
+   power-of-two number of runs that are qsorted side by side, then merged
+   pairwise; every merge round is split into output slices found by binary
+   search, so all workers stay busy through the last merge. Ties keep the
+   left run first. Small arrays, one worker or a failed allocation fall
+   back to qsort() with the same comparator. */
+#define SORT_PARALLEL_MIN 65536
+#define SORT_MAX_RUNS 64
+
+typedef struct {
+  char *src;
+  char *dst;
+  size_t size;
+  int (*cmp)(const void *, const void *);
+  size_t bounds[SORT_MAX_RUNS + 1];
+  int runs;
+  int width;
+  int tasks;
+  atomic_int next;
+} SortPool;
+
+/* How many of the first k merged elements come from a (stable merge of a
+   and b, a first on ties). */
+static size_t merge_corank(const SortPool *p, const char *a, size_t na, const char *b, size_t nb, size_t k) {
+  size_t lo = k > nb ? k - nb : 0;
+  size_t hi = k < na ? k : na;
+  while (lo < hi) {
+    size_t i = lo + (hi - lo) / 2;
+    if (p->cmp(a + i * p->size, b + (k - i - 1) * p->size) > 0) {
+      hi = i;
+    } else {
+      lo = i + 1;
+    }
+  }
+  return lo;
+}
+
+static void sort_pool_task(SortPool *p, int t) {
+  size_t size = p->size;
+  if (p->width == 0) {
+    qsort(p->src + p->bounds[t] * size, p->bounds[t + 1] - p->bounds[t], size, p->cmp);
+    return;
+  }
+  int slices = p->tasks / (p->runs / (2 * p->width));
+  int pair = t / slices;
+  int slice = t % slices;
+  size_t start = p->bounds[pair * 2 * p->width];
+  size_t mid = p->bounds[pair * 2 * p->width + p->width];
+  size_t end = p->bounds[(pair + 1) * 2 * p->width];
+  const char *a = p->src + start * size;
+  const char *b = p->src + mid * size;
+  size_t na = mid - start;
+  size_t nb = end - mid;
+  size_t out_lo = (na + nb) * (size_t)slice / (size_t)slices;
+  size_t out_hi = (na + nb) * (size_t)(slice + 1) / (size_t)slices;
+  size_t i = merge_corank(p, a, na, b, nb, out_lo);
+  size_t j = out_lo - i;
+  size_t i_end = merge_corank(p, a, na, b, nb, out_hi);
+  size_t j_end = out_hi - i_end;
+  char *out = p->dst + (start + out_lo) * size;
+  while (i < i_end && j < j_end) {
+    if (p->cmp(a + i * size, b + j * size) <= 0) {
+      memcpy(out, a + i++ * size, size);
+    } else {
+      memcpy(out, b + j++ * size, size);
+    }
+    out += size;
+  }
+  memcpy(out, a + i * size, (i_end - i) * size);
+  out += (i_end - i) * size;
+  memcpy(out, b + j * size, (j_end - j) * size);
+}
+
+static void *sort_pool_worker(void *arg) {
+  SortPool *p = (SortPool *)arg;
+  for (;;) {
+    int t = atomic_fetch_add(&p->next, 1);
+    if (t >= p->tasks) break;
+    sort_pool_task(p, t);
+  }
+  return NULL;
+}
+
+static void sort_pool_run(SortPool *p, int workers) {
+  pthread_t tids[SORT_MAX_RUNS];
+  int started[SORT_MAX_RUNS] = {0};
+  if (workers > p->tasks) workers = p->tasks;
+  atomic_store(&p->next, 0);
+  /* The calling thread is the last worker. */
+  for (int i = 0; i < workers - 1; i++) started[i] = pthread_create(&tids[i], NULL, sort_pool_worker, p) == 0;
+  sort_pool_worker(p);
+  for (int i = 0; i < workers - 1; i++) {
+    if (started[i]) pthread_join(tids[i], NULL);
+  }
+}
+
+static void parallel_sort(void *base, size_t count, size_t size, int (*cmp)(const void *, const void *),
+                          int workers) {
+  int runs = 1;
+  while (runs * 2 <= workers && runs * 2 <= SORT_MAX_RUNS && count / (size_t)(runs * 2) >= SORT_PARALLEL_MIN / 4) {
+    runs *= 2;
+  }
+  char *tmp = runs > 1 && count >= SORT_PARALLEL_MIN ? (char *)malloc(count * size) : NULL;
+  if (!tmp) {
+    if (count > 1) qsort(base, count, size, cmp);
+    return;
+  }
+  SortPool pool;
+  memset(&pool, 0, sizeof(SortPool));
+  pool.src = (char *)base;
+  pool.dst = tmp;
+  pool.size = size;
+  pool.cmp = cmp;
+  pool.runs = runs;
+  for (int k = 0; k <= runs; k++) pool.bounds[k] = count * (size_t)k / (size_t)runs;
+  pool.tasks = runs;
+  sort_pool_run(&pool, runs);
+  for (pool.width = 1; pool.width < runs; pool.width *= 2) {
+    sort_pool_run(&pool, runs);
+    char *swap = pool.src;
+    pool.src = pool.dst;
+    pool.dst = swap;
+  }
+  if (pool.src != (char *)base) memcpy(base, pool.src, count * size);
+  free(tmp);
+}
+
+/* Orders the kept entries best-first; the heap is unusable afterwards. */
+void top_risks_finish(TopRisks *top, int workers) {
+  if (top->count > 1) {
+    parallel_sort(top->entries, (size_t)top->count, sizeof(RiskEntry), compare_risk, workers);
+  }
+}
+
+/* One summary comparator per CohortSort mode, indexed by k_summary_order;
+   rollup levels come first in every mode. */
+static int compare_summary_name(const void *a, const void *b) {
+  const CohortSummary *ca = (const CohortSummary *)a;
+  const CohortSummary *cb = (const CohortSummary *)b;
+  if (ca->level != cb->level) return ca->level - cb->level;
+  return strcmp(ca->cohort, cb->cohort);
+}
+
+static int compare_summary_high(const void *a, const void *b) {
+  const CohortSummary *ca = (const CohortSummary *)a;
+  const CohortSummary *cb = (const CohortSummary *)b;
+  if (ca->level != cb->level) return ca->level - cb->level;
+  if (cb->high_share > ca->high_share) return 1;
+  if (cb->high_share < ca->high_share) return -1;
+  if (cb->risk_index > ca->risk_index) return 1;
+  if (cb->risk_index < ca->risk_index) return -1;
+  return strcmp(ca->cohort, cb->cohort);
+}
+
+static int compare_summary_risk(const void *a, const void *b) {
+  const CohortSummary *ca = (const CohortSummary *)a;
+  const CohortSummary *cb = (const CohortSummary *)b;
+  if (ca->level != cb->level) return ca->level - cb->level;
+  if (cb->risk_index > ca->risk_index) return 1;
+  if (cb->risk_index < ca->risk_index) return -1;
+  if (cb->high_share > ca->high_share) return 1;
+  if (cb->high_share < ca->high_share) return -1;
+  return strcmp(ca->cohort, cb->cohort);
+}
+
+static int (*const k_summary_order[])(const void *, const void *) = {
+  compare_summary_risk, compare_summary_high, compare_summary_name
+};
+
+static int compare_alerts(const void *a, const void *b) {
+  const CohortAlert *ca = (const CohortAlert *)a;
+  const CohortAlert *cb = (const CohortAlert *)b;
+  if (ca->level != cb->level) return ca->level - cb->level;
+  if (cb->high_ratio > ca->high_ratio) return 1;
+  if (cb->high_ratio < ca->high_ratio) return -1;
+  if (cb->risk_index > ca->risk_index) return 1;
+  if (cb->risk_index < ca->risk_index) return -1;
+  return strcmp(ca->cohort, cb->cohort);
+}
+
+/* Row scanners: find the next newline and split the line on commas with
+   strtok() semantics (empty fields collapse, at most six are kept), so rows
+   like "S-1,,2026-01-02,..." count as short rather than missing a column.
+   Carriage returns stay in the last field and are removed by trim_view(),
+   which keeps a bare "\r" field counting as a column exactly as before.
+   The SIMD variants build comma/newline bitmasks per block and walk the set
+   bits; all variants must produce identical fields. */
+static inline void emit_field(const char *p, size_t start, size_t end, StrView fields[6], int *count) {
+  if (end > start && *count < 6) {
+    fields[*count].ptr = p + start;
+    fields[*count].len = end - start;
+    (*count)++;
+  }
+}
+
+static inline void emit_commas(const char *p, size_t base, uint64_t mask, size_t *start,
+                               StrView fields[6], int *count) {
+  while (mask) {
+    size_t at = base + (size_t)__builtin_ctzll(mask);
+    emit_field(p, *start, at, fields, count);
+    *start = at + 1;
+    mask &= mask - 1;
+  }
+}
+
+/* Finishes a line from offset i byte by byte; shared tail of every scanner. */
+static inline int scan_finish(const char *data, size_t len, size_t *pos, StrView *line,
+                              StrView fields[6], int *field_count, size_t i, size_t start, int count) {
+  const char *p = data + *pos;
+  size_t n = len - *pos;
+  for (; i < n; i++) {
+    char c = p[i];
+    if (c == '\n') break;
+    if (c == ',') {
+      emit_field(p, start, i, fields, &count);
+      start = i + 1;
+    }
+  }
+  /* strtok() saw the newline as part of the last token, so "a,b,c,d,e,\n"
+     still has six fields (the sixth is blank once trimmed). */
+  emit_field(p, start, i + (i < n), fields, &count);
+  line->ptr = p;
+  line->len = i;
+  *pos += i + (i < n);
+  *field_count = count;
+  return 1;
+}
+
+static int scan_line_scalar(const char *data, size_t len, size_t *pos, StrView *line,
+                            StrView fields[6], int *field_count) {
+  if (*pos >= len) return 0;
+  return scan_finish(data, len, pos, line, fields, field_count, 0, 0, 0);
+}
+
+#if defined(__x86_64__)
+static int scan_line_sse2(const char *data, size_t len, size_t *pos, StrView *line,
+                          StrView fields[6], int *field_count) {
+  if (*pos >= len) return 0;
+  const char *p = data + *pos;
+  size_t n = len - *pos;
+  const __m128i comma = _mm_set1_epi8(',');
+  const __m128i newline = _mm_set1_epi8('\n');
+  size_t i = 0, start = 0;
+  int count = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+    uint64_t cm = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, comma));
+    uint64_t nm = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+    if (nm) {
+      size_t stop = (size_t)__builtin_ctzll(nm);
+      emit_commas(p, i, cm & ((1ull << stop) - 1), &start, fields, &count);
+      return scan_finish(data, len, pos, line, fields, field_count, i + stop, start, count);
+    }
+    emit_commas(p, i, cm, &start, fields, &count);
+  }
+  return scan_finish(data, len, pos, line, fields, field_count, i, start, count);
+}
+
+__attribute__((target("avx2")))
+static int scan_line_avx2(const char *data, size_t len, size_t *pos, StrView *line,
+                          StrView fields[6], int *field_count) {
+  if (*pos >= len) return 0;
+  const char *p = data + *pos;
+  size_t n = len - *pos;
+  const __m256i comma = _mm256_set1_epi8(',');
+  const __m256i newline = _mm256_set1_epi8('\n');
+  size_t i = 0, start = 0;
+  int count = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+    uint64_t cm = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, comma));
+    uint64_t nm = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+    if (nm) {
+      size_t stop = (size_t)__builtin_ctzll(nm);
+      emit_commas(p, i, cm & ((1ull << stop) - 1), &start, fields, &count);
+      return scan_finish(data, len, pos, line, fields, field_count, i + stop, start, count);
+    }
+    emit_commas(p, i, cm, &start, fields, &count);
+  }
+  return scan_finish(data, len, pos, line, fields, field_count, i, start, count);
+}
+#endif
+
+#if defined(__aarch64__)
+/* NEON has no movemask; narrowing shifts pack each byte's compare result
+   into a nibble, so bit positions are scaled by 4. */
+static inline uint64_t neon_nibble_mask(uint8x16_t eq) {
+  return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+}
+
+static int scan_line_neon(const char *data, size_t len, size_t *pos, StrView *line,
+                          StrView fields[6], int *field_count) {
+  if (*pos >= len) return 0;
+  const char *p = data + *pos;
+  size_t n = len - *pos;
+  const uint8x16_t comma = vdupq_n_u8(',');
+  const uint8x16_t newline = vdupq_n_u8('\n');
+  size_t i = 0, start = 0;
+  int count = 0;
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t *)(p + i));
+    uint64_t cm = neon_nibble_mask(vceqq_u8(v, comma)) & 0x1111111111111111ull;
+    uint64_t nm = neon_nibble_mask(vceqq_u8(v, newline)) & 0x1111111111111111ull;
+    if (nm) {
+      size_t stop = (size_t)__builtin_ctzll(nm) / 4;
+      cm &= stop ? (~0ull >> (64 - 4 * stop)) : 0;
+      while (cm) {
+        size_t at = i + (size_t)__builtin_ctzll(cm) / 4;
+        emit_field(p, start, at, fields, &count);
+        start = at + 1;
+        cm &= cm - 1;
+      }
+      return scan_finish(data, len, pos, line, fields, field_count, i + stop, start, count);
+    }
+    while (cm) {
+      size_t at = i + (size_t)__builtin_ctzll(cm) / 4;
+      emit_field(p, start, at, fields, &count);
+      start = at + 1;
+      cm &= cm - 1;
+    }
+  }
+  return scan_finish(data, len, pos, line, fields, field_count, i, start, count);
+}
+#endif
+
+static ScanLineFn scan_line_named(const char *name) {
+  if (strcmp(name, "scalar") == 0) return scan_line_scalar;
+#if defined(__x86_64__)
+  if (strcmp(name, "sse2") == 0) return scan_line_sse2;
+  __builtin_cpu_init();
+  if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) return scan_line_avx2;
+#elif defined(__aarch64__)
+  if (strcmp(name, "neon") == 0) return scan_line_neon;
+#endif
+  return NULL;
+}
+
+/* Picks the widest scanner the CPU supports; SENTINEL_SCANNER=scalar|sse2|
+   avx2|neon pins one for benchmarking or to rule the SIMD path out. */
+ScanLineFn select_scan_line(void) {
+  const char *forced = getenv("SENTINEL_SCANNER");
+  if (forced && scan_line_named(forced)) return scan_line_named(forced);
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return scan_line_avx2;
+  return scan_line_sse2;
+#elif defined(__aarch64__)
+  return scan_line_neon;
+#else
+  return scan_line_scalar;
+#endif
+}
+
+/* Compressed input. gzip (1f 8b) and zstd (28 b5 2f fd) are recognized by
+   their magic bytes and inflated on a thread of their own into a ring of
+   buffers that input_fill() drains, so decompression overlaps parsing and
+   nothing is staged on disk. Mapped files are inflated from the mapping.
+   Each codec is a build option: -DSENTINEL_ZLIB -lz, -DSENTINEL_ZSTD -lzstd. */
+#define RING_SLOTS 4
+#define RING_SLOT_SIZE (1 << 20)
+#define PACKED_CHUNK (1 << 18)
+#define PACKED_MAP_STEP ((size_t)1 << 30)
+
+
+struct Decompressor {
+  int format;
+  int fd;
+  const unsigned char *src;
+  size_t src_len;
+  unsigned char lead[4];
+  size_t lead_len;
+  char *slots[RING_SLOTS];
+  size_t slot_len[RING_SLOTS];
+  int head;
+  int tail;
+  int filled;
+  size_t tail_pos;
+  int done;
+  int stop;
+  const char *error;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  pthread_t thread;
+};
+
+int packed_format(const unsigned char *lead, size_t len) {
+  if (len >= 2 && lead[0] == 0x1f && lead[1] == 0x8b) return PACK_GZIP;
+  if (len >= 4 && lead[0] == 0x28 && lead[1] == 0xb5 && lead[2] == 0x2f && lead[3] == 0xfd) return PACK_ZSTD;
+  return PACK_NONE;
+}
+
+#if defined(SENTINEL_ZLIB) || defined(SENTINEL_ZSTD)
+/* Returns the next empty slot for the producer, or NULL once the reader
+   has stopped. */
+static char *ring_acquire(Decompressor *d) {
+  pthread_mutex_lock(&d->lock);
+  while (d->filled == RING_SLOTS && !d->stop) pthread_cond_wait(&d->cond, &d->lock);
+  char *slot = d->stop ? NULL : d->slots[d->head];
+  pthread_mutex_unlock(&d->lock);
+  return slot;
+}
+
+static void ring_publish(Decompressor *d, size_t len) {
+  pthread_mutex_lock(&d->lock);
+  d->slot_len[d->head] = len;
+  d->head = (d->head + 1) % RING_SLOTS;
+  d->filled++;
+  pthread_cond_broadcast(&d->cond);
+  pthread_mutex_unlock(&d->lock);
+}
+
+/* Next compressed bytes: the whole mapping in <= 1 GB steps (zlib counts in
+   32 bits), or the sniffed lead bytes followed by read()s. Returns 0 at the
+   end of input and -1 on a read error. */
+static int packed_next(Decompressor *d, unsigned char *buf, const unsigned char **ptr, size_t *len) {
+  if (d->src) {
+    if (d->src_len == 0) return 0;
+    *ptr = d->src;
+    *len = d->src_len < PACKED_MAP_STEP ? d->src_len : PACKED_MAP_STEP;
+    d->src += *len;
+    d->src_len -= *len;
+    return 1;
+  }
+  if (d->lead_len) {
+    memcpy(buf, d->lead, d->lead_len);
+    *ptr = buf;
+    *len = d->lead_len;
+    d->lead_len = 0;
+    return 1;
+  }
+  ssize_t n;
+  do {
+    n = read(d->fd, buf, PACKED_CHUNK);
+  } while (n < 0 && errno == EINTR);
+  if (n <= 0) return n < 0 ? -1 : 0;
+  *ptr = buf;
+  *len = (size_t)n;
+  return 1;
+}
+#endif
+
+#ifdef SENTINEL_ZLIB
+/* Inflates concatenated gzip members until the input runs out. New input is
+   fetched only once inflate() stopped short of filling its output, so
+   pending output is never mistaken for a truncated stream. */
+static const char *inflate_gzip(Decompressor *d, unsigned char *buf) {
+  z_stream z;
+  memset(&z, 0, sizeof(z_stream));
+  if (inflateInit2(&z, 15 + 16) != Z_OK) return "out of memory";
+  const char *error = NULL;
+  int rc = Z_OK;
+  int drained = 1;
+  size_t fill = 0;
+  char *slot = ring_acquire(d);
+  while (slot) {
+    if (z.avail_in == 0 && drained) {
+      const unsigned char *ptr = NULL;
+      size_t len = 0;
+      int got = packed_next(d, buf, &ptr, &len);
+      if (got <= 0) {
+        if (got < 0) error = "read error";
+        else if (rc != Z_STREAM_END) error = "truncated gzip stream";
+        break;
+      }
+      z.next_in = (Bytef *)ptr;
+      z.avail_in = (uInt)len;
+    }
+    if (rc == Z_STREAM_END && z.avail_in > 0) inflateReset(&z);
+    z.next_out = (Bytef *)slot + fill;
+    z.avail_out = (uInt)(RING_SLOT_SIZE - fill);
+    rc = inflate(&z, Z_NO_FLUSH);
+    if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+      error = z.msg ? z.msg : "corrupt gzip stream";
+      break;
+    }
+    drained = z.avail_out > 0;
+    fill = RING_SLOT_SIZE - z.avail_out;
+    if (fill == RING_SLOT_SIZE) {
+      ring_publish(d, fill);
+      fill = 0;
+      slot = ring_acquire(d);
+    }
+  }
+  if (slot && fill > 0 && !error) ring_publish(d, fill);
+  inflateEnd(&z);
+  return error;
+}
+#endif
+
+#ifdef SENTINEL_ZSTD
+/* Decodes concatenated zstd frames; the same fetch rule as inflate_gzip(). A
+   zero hint from ZSTD_decompressStream() marks a finished frame. */
+static const char *inflate_zstd(Decompressor *d, unsigned char *buf) {
+  ZSTD_DStream *ds = ZSTD_createDStream();
+  if (!ds) return "out of memory";
+  ZSTD_initDStream(ds);
+  ZSTD_inBuffer in = {NULL, 0, 0};
+  const char *error = NULL;
+  size_t hint = 1;
+  int drained = 1;
+  size_t fill = 0;
+  char *slot = ring_acquire(d);
+  while (slot) {
+    if (in.pos == in.size && drained) {
+      const unsigned char *ptr = NULL;
+      size_t len = 0;
+      int got = packed_next(d, buf, &ptr, &len);
+      if (got <= 0) {
+        if (got < 0) error = "read error";
+        else if (hint != 0) error = "truncated zstd stream";
+        break;
+      }
+      in.src = ptr;
+      in.size = len;
+      in.pos = 0;
+    }
+    ZSTD_outBuffer out = {slot, RING_SLOT_SIZE, fill};
+    hint = ZSTD_decompressStream(ds, &out, &in);
+    if (ZSTD_isError(hint)) {
+      error = ZSTD_getErrorName(hint);
+      break;
+    }
+    drained = out.pos < out.size;
+    fill = out.pos;
+    if (fill == RING_SLOT_SIZE) {
+      ring_publish(d, fill);
+      fill = 0;
+      slot = ring_acquire(d);
+    }
+  }
+  if (slot && fill > 0 && !error) ring_publish(d, fill);
+  ZSTD_freeDStream(ds);
+  return error;
+}
+#endif
+
+static void *decompress_worker(void *arg) {
+  Decompressor *d = (Decompressor *)arg;
+  unsigned char *buf = d->src ? NULL : (unsigned char *)malloc(PACKED_CHUNK);
+  const char *error = d->src || buf ? NULL : "out of memory";
+#ifdef SENTINEL_ZLIB
+  if (!error && d->format == PACK_GZIP) error = inflate_gzip(d, buf);
+#endif
+#ifdef SENTINEL_ZSTD
+  if (!error && d->format == PACK_ZSTD) error = inflate_zstd(d, buf);
+#endif
+  free(buf);
+  pthread_mutex_lock(&d->lock);
+  d->done = 1;
+  d->error = error;
+  pthread_cond_broadcast(&d->cond);
+  pthread_mutex_unlock(&d->lock);
+  return NULL;
+}
+
+static int packed_supported(int format) {
+#ifdef SENTINEL_ZLIB
+  if (format == PACK_GZIP) return 1;
+#endif
+#ifdef SENTINEL_ZSTD
+  if (format == PACK_ZSTD) return 1;
+#endif
+  (void)format;
+  return 0;
+}
+
+static void decompressor_free(Decompressor *d) {
+  for (int i = 0; i < RING_SLOTS; i++) free(d->slots[i]);
+  pthread_cond_destroy(&d->cond);
+  pthread_mutex_destroy(&d->lock);
+  free(d);
+}
+
+/* Starts inflating src (a mapping) or, when src is NULL, the lead bytes and
+   then the rest of fd. Returns NULL on allocation or thread failure. */
+static Decompressor *decompressor_start(int format, int fd, const char *src, size_t src_len,
+                                        const unsigned char *lead, size_t lead_len) {
+  Decompressor *d = (Decompressor *)calloc(1, sizeof(Decompressor));
+  if (!d) return NULL;
+  d->format = format;
+  d->fd = fd;
+  d->src = (const unsigned char *)src;
+  d->src_len = src_len;
+  memcpy(d->lead, lead, lead_len);
+  d->lead_len = lead_len;
+  pthread_mutex_init(&d->lock, NULL);
+  pthread_cond_init(&d->cond, NULL);
+  int ok = 1;
+  for (int i = 0; i < RING_SLOTS; i++) ok = ok && (d->slots[i] = (char *)malloc(RING_SLOT_SIZE)) != NULL;
+  if (!ok || pthread_create(&d->thread, NULL, decompress_worker, d) != 0) {
+    decompressor_free(d);
+    return NULL;
+  }
+  return d;
+}
+
+static void decompressor_stop(Decompressor *d) {
+  pthread_mutex_lock(&d->lock);
+  d->stop = 1;
+  pthread_cond_broadcast(&d->cond);
+  pthread_mutex_unlock(&d->lock);
+  pthread_join(d->thread, NULL);
+  decompressor_free(d);
+}
+
+/* Copies up to cap decompressed bytes into dst. Returns the count, 0 at the
+   end of the stream and -1 when decompression failed. The tail slot belongs
+   to the reader until it is released, so the copy runs unlocked. */
+static ssize_t decompressor_read(Decompressor *d, char *dst, size_t cap) {
+  pthread_mutex_lock(&d->lock);
+  while (d->filled == 0 && !d->done) pthread_cond_wait(&d->cond, &d->lock);
+  int empty = d->filled == 0;
+  const char *error = d->error;
+  pthread_mutex_unlock(&d->lock);
+  if (empty) return error ? -1 : 0;
+
+  size_t avail = d->slot_len[d->tail] - d->tail_pos;
+  size_t n = avail < cap ? avail : cap;
+  memcpy(dst, d->slots[d->tail] + d->tail_pos, n);
+  d->tail_pos += n;
+  if (d->tail_pos == d->slot_len[d->tail]) {
+    pthread_mutex_lock(&d->lock);
+    d->tail = (d->tail + 1) % RING_SLOTS;
+    d->tail_pos = 0;
+    d->filled--;
+    pthread_cond_broadcast(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+  }
+  return (ssize_t)n;
+}
+
+void input_close(InputReader *in) {
+  if (in->dec) decompressor_stop(in->dec);
+  if (in->map) munmap((void *)in->map, in->map_len);
+  if (in->packed_map) munmap((void *)in->packed_map, in->packed_len);
+  if (in->fd > STDIN_FILENO) close(in->fd);
+  free(in->buf);
+  memset(in, 0, sizeof(InputReader));
+}
+
+int input_open(InputReader *in, const char *path) {
+  memset(in, 0, sizeof(InputReader));
+  in->scan_line = select_scan_line();
+  if (strcmp(path, "-") == 0) {
+    in->fd = STDIN_FILENO;
+  } else {
+    in->fd = open(path, O_RDONLY);
+    if (in->fd < 0) return 0;
+  }
+  struct stat st;
+  if (fstat(in->fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, in->fd, 0);
+    if (map != MAP_FAILED) {
+      posix_madvise(map, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+      in->map = (const char *)map;
+      in->map_len = (size_t)st.st_size;
+      in->bytes_read = in->map_len;
+    }
+  }
+
+  /* Sniff the format. Unmapped inputs cannot be rewound, so the lead bytes
+     seed the read buffer (or the decompressor). */
+  unsigned char lead[4];
+  size_t lead_len = 0;
+  if (in->map) {
+    lead_len = in->map_len < sizeof(lead) ? in->map_len : sizeof(lead);
+    memcpy(lead, in->map, lead_len);
+  } else {
+    while (lead_len < sizeof(lead)) {
+      ssize_t n = read(in->fd, lead + lead_len, sizeof(lead) - lead_len);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) break;
+      lead_len += (size_t)n;
+    }
+  }
+  int format = packed_format(lead, lead_len);
+  if (format == PACK_NONE) {
+    if (!in->map && lead_len > 0) {
+      in->buf = (char *)malloc(READ_CHUNK * 4);
+      if (!in->buf) {
+        input_close(in);
+        errno = ENOMEM;
+        return 0;
+      }
+      in->buf_cap = READ_CHUNK * 4;
+      memcpy(in->buf, lead, lead_len);
+      in->buf_len = lead_len;
+      in->bytes_read = lead_len;
+    }
+    return 1;
+  }
+  if (!packed_supported(format)) {
+    fprintf(stderr, "%s is %s-compressed; that needs a build with %s.\n", path, format == PACK_GZIP ? "gzip" : "zstd",
+            format == PACK_GZIP ? "-DSENTINEL_ZLIB and -lz" : "-DSENTINEL_ZSTD and -lzstd");
+    input_close(in);
+    errno = ENOTSUP;
+    return 0;
+  }
+  in->packed_map = in->map;
+  in->packed_len = in->map_len;
+  in->map = NULL;
+  in->map_len = 0;
+  in->bytes_read = 0;
+  in->dec = decompressor_start(format, in->fd, in->packed_map, in->packed_len, lead, in->packed_map ? 0 : lead_len);
+  if (!in->dec) {
+    input_close(in);
+    errno = ENOMEM;
+    return 0;
+  }
+  return 1;
+}
+
+/* Refills the fallback buffer, keeping the unconsumed tail. Returns 0 at EOF
+   or on a read error. */
+static int input_fill(InputReader *in) {
+  if (in->eof) return 0;
+  if (in->pos > 0) {
+    memmove(in->buf, in->buf + in->pos, in->buf_len - in->pos);
+    in->buf_len -= in->pos;
+    in->pos = 0;
+  }
+  if (in->buf_cap - in->buf_len < READ_CHUNK) {
+    size_t cap = in->buf_cap ? in->buf_cap * 2 : READ_CHUNK * 4;
+    char *resized = (char *)realloc(in->buf, cap);
+    if (!resized) return 0;
+    in->buf = resized;
+    in->buf_cap = cap;
+  }
+  ssize_t n;
+  if (in->dec) {
+    n = decompressor_read(in->dec, in->buf + in->buf_len, in->buf_cap - in->buf_len);
+  } else {
+    do {
+      n = read(in->fd, in->buf + in->buf_len, in->buf_cap - in->buf_len);
+    } while (n < 0 && errno == EINTR);
+  }
+  if (n <= 0) {
+    in->eof = 1;
+    if (n < 0) in->error = in->dec ? in->dec->error : "read error";
+    return 0;
+  }
+  in->buf_len += (size_t)n;
+  in->bytes_read += (size_t)n;
+  return 1;
+}
+
+/* Yields the next line without its trailing newline, split into fields;
+   line_offset records where it started in the input. */
+int input_next_row(InputReader *in, StrView *line, StrView fields[6], int *field_count) {
+  if (in->map) {
+    in->line_offset = in->pos;
+    return in->scan_line(in->map, in->map_len, &in->pos, line, fields, field_count);
+  }
+  size_t scanned = in->pos;
+  for (;;) {
+    const char *nl = (const char *)memchr(in->buf + scanned, '\n', in->buf_len - scanned);
+    if (nl) {
+      line->ptr = in->buf + in->pos;
+      line->len = (size_t)(nl - line->ptr);
+      in->line_offset = in->bytes_read - (in->buf_len - in->pos);
+      in->pos += line->len + 1;
+      break;
+    }
+    scanned = in->buf_len - in->pos;
+    if (!input_fill(in)) {
+      if (in->pos >= in->buf_len) return 0;
+      line->ptr = in->buf + in->pos;
+      line->len = in->buf_len - in->pos;
+      in->line_offset = in->bytes_read - line->len;
+      in->pos = in->buf_len;
+      break;
+    }
+  }
+  /* Rescan the line with its newline (when it has one) for strtok() field
+     semantics; the buffer already holds it. */
+  size_t line_pos = 0;
+  size_t scan_len = line->len + (in->line_offset + line->len < in->bytes_read);
+  StrView whole;
+  *field_count = 0;
+  if (scan_len > 0) in->scan_line(line->ptr, scan_len, &line_pos, &whole, fields, field_count);
+  return 1;
+}
+
+static StrView clip_view(StrView v, size_t max_len) {
+  if (v.len > max_len) v.len = max_len;
+  return v;
+}
+
+/* Validates one split CSV data line into *row. Returns 0 when the line does
+   not have enough columns (already counted as invalid), 1 otherwise. Text
+   fields are clipped to the widths the report has always carried. */
+int parse_scholar_fields(const StrView fields[6], int field_count, ScholarRow *row,
+                         RunTotals *t, int clamp_ranges) {
+  if (field_count < 6) {
+    t->invalid_rows++;
+    t->invalid_columns++;
+    return 0;
+  }
+
+  memset(row, 0, sizeof(ScholarRow));
+  row->valid = 1;
+
+  row->id = trim_view(fields[0]);
+  row->cohort = trim_view(fields[1]);
+  row->last_touchpoint = clip_view(trim_view(fields[2]), MAX_DATE - 1);
+
+  if (row->id.len == 0) {
+    t->missing_ids++;
+    row->valid = 0;
+  }
+
+  if (row->last_touchpoint.len == 0) {
+    t->missing_dates++;
+    row->valid = 0;
+  }
+
+  int numeric_invalid = 0;
+  if (!parse_int_view(trim_view(fields[3]), &row->touchpoints_30d)) {
+    row->valid = 0;
+    numeric_invalid = 1;
+  } else if (row->touchpoints_30d < 0) {
+    if (clamp_ranges) {
+      row->touchpoints_30d = 0;
+      t->clamped_values++;
+    } else {
+      row->valid = 0;
+      t->invalid_range++;
+    }
+  }
+  if (!parse_double_view(trim_view(fields[4]), &row->attendance_rate)) {
+    row->valid = 0;
+    numeric_invalid = 1;
+  } else if (row->attendance_rate < 0 || row->attendance_rate > 1.0) {
+    if (clamp_ranges) {
+      if (row->attendance_rate < 0) row->attendance_rate = 0;
+      if (row->attendance_rate > 1.0) row->attendance_rate = 1.0;
+      t->clamped_values++;
+    } else {
+      row->valid = 0;
+      t->invalid_range++;
+    }
+  }
+  if (!parse_double_view(trim_view(fields[5]), &row->satisfaction_score)) {
+    row->valid = 0;
+    numeric_invalid = 1;
+  } else if (row->satisfaction_score < 1.0 || row->satisfaction_score > 5.0) {
+    if (clamp_ranges) {
+      if (row->satisfaction_score < 1.0) row->satisfaction_score = 1.0;
+      if (row->satisfaction_score > 5.0) row->satisfaction_score = 5.0;
+      t->clamped_values++;
+    } else {
+      row->valid = 0;
+      t->invalid_range++;
+    }
+  }
+  if (numeric_invalid) t->invalid_numeric++;
+  return 1;
+}
+
+static inline uint64_t mix64(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return x;
+}
+
+/* 64-bit id fingerprint, one multiply per eight bytes; the last word
+   overlaps the previous one rather than loading a tail byte by byte. Never
+   0, which marks an empty slot. Fingerprints stay in memory, so byte order
+   does not matter. */
+static uint64_t id_fingerprint(StrView id) {
+  const char *p = id.ptr;
+  size_t n = id.len;
+  uint64_t h = 0x9e3779b97f4a7c15ull ^ (uint64_t)n;
+  uint64_t w = 0;
+  if (n >= 8) {
+    for (; n > 8; p += 8, n -= 8) {
+      memcpy(&w, p, 8);
+      h = (h ^ w) * 0xff51afd7ed558ccdull;
+      h ^= h >> 29;
+    }
+    memcpy(&w, p + n - 8, 8);
+  } else if (n >= 4) {
+    uint32_t lo;
+    uint32_t hi;
+    memcpy(&lo, p, 4);
+    memcpy(&hi, p + n - 4, 4);
+    w = (uint64_t)lo | (uint64_t)hi << 32;
+  } else if (n > 0) {
+    w = (uint64_t)(unsigned char)p[0] | (uint64_t)(unsigned char)p[n / 2] << 8 | (uint64_t)(unsigned char)p[n - 1] << 16;
+  }
+  h = mix64(h ^ w);
+  return h ? h : 1;
+}
+
+int dedupe_mode(const char *value) {
+  if (strcmp(value, "first") == 0) return DEDUPE_FIRST;
+  if (strcmp(value, "last") == 0) return DEDUPE_LAST;
+  if (strcmp(value, "latest-touchpoint") == 0) return DEDUPE_LATEST;
+  return DEDUPE_OFF;
+}
+
+static const char *dedupe_mode_name(int mode) {
+  return mode == DEDUPE_FIRST ? "first" : mode == DEDUPE_LAST ? "last" : "latest-touchpoint";
+}
+
+static void dedupe_free(Dedupe *d) {
+  for (int p = 0; p < DEDUPE_PARTS; p++) free(d->parts[p].slots);
+  free(d->keep);
+  int mode = d->mode;
+  memset(d, 0, sizeof(Dedupe));
+  d->mode = mode;
+}
+
+/* Sizes a partition for `ids` distinct ids at a load of at most 3/4. */
+static int dedupe_part_reserve(DedupePart *part, uint64_t ids) {
+  uint64_t cap = part->slots ? (uint64_t)part->mask + 1 : 1024;
+  while (ids * 4 > cap * 3) cap *= 2;
+  if (part->slots && cap == (uint64_t)part->mask + 1) return 1;
+  if (cap > ((uint64_t)1 << 31)) return 0;
+  DedupeSlot *slots = (DedupeSlot *)calloc((size_t)cap, sizeof(DedupeSlot));
+  if (!slots) return 0;
+  uint32_t mask = (uint32_t)(cap - 1);
+  for (uint64_t i = 0; part->slots && i <= part->mask; i++) {
+    const DedupeSlot *s = &part->slots[i];
+    if (!s->fp) continue;
+    uint32_t j = (uint32_t)s->fp & mask;
+    while (slots[j].fp) j = (j + 1) & mask;
+    slots[j] = *s;
+  }
+  free(part->slots);
+  part->slots = slots;
+  part->mask = mask;
+  return 1;
+}
+
+/* Records `row` for fingerprint fp. A repeated id keeps its earlier row
+   (first), takes the new one (last), or takes it when its touchpoint is at
+   least as recent (latest-touchpoint; ties go to the later row). Returns 1
+   for a new id, 0 for a repeat and -1 when the table cannot grow. */
+static int dedupe_part_put(DedupePart *part, int mode, uint64_t fp, uint32_t row, int day) {
+  if (((uint64_t)part->count + 1) * 4 > ((uint64_t)part->mask + 1) * 3 &&
+      !dedupe_part_reserve(part, (uint64_t)part->count + 1)) {
+    return -1;
+  }
+  uint32_t i = (uint32_t)fp & part->mask;
+  for (;;) {
+    DedupeSlot *s = &part->slots[i];
+    if (s->fp == 0) {
+      s->fp = fp;
+      s->row = row;
+      s->day = day;
+      part->count++;
+      return 1;
+    }
+    if (s->fp == fp) {
+      if (mode == DEDUPE_LAST || (mode == DEDUPE_LATEST && day >= s->day)) {
+        s->row = row;
+        s->day = day;
+      }
+      return 0;
+    }
+    i = (i + 1) & part->mask;
+  }
+}
+
+/* Numbers the next considered row and records it under its id. */
+static int dedupe_add(Dedupe *d, StrView id, int day) {
+  uint64_t fp = id_fingerprint(id);
+  int r = dedupe_part_put(&d->parts[fp >> (64 - DEDUPE_PART_BITS)], d->mode, fp, d->rows++, day);
+  if (r < 0) d->failed = 1;
+  return r;
+}
+
+/* dedupe_add for a run of rows whose answers are not needed yet: every
+   probe start is prefetched before the first insert, so the cache misses
+   of a large table overlap instead of queueing. */
+#define DEDUPE_BATCH 32
+
+static void dedupe_add_batch(Dedupe *d, const uint64_t *fps, const int *days, int n) {
+  for (int i = 0; i < n; i++) {
+    const DedupePart *part = &d->parts[fps[i] >> (64 - DEDUPE_PART_BITS)];
+    if (part->slots) __builtin_prefetch(&part->slots[(uint32_t)fps[i] & part->mask], 1);
+  }
+  for (int i = 0; i < n; i++) {
+    if (dedupe_part_put(&d->parts[fps[i] >> (64 - DEDUPE_PART_BITS)], d->mode, fps[i], d->rows++, days[i]) < 0) {
+      d->failed = 1;
+    }
+  }
+}
+
+static uint32_t dedupe_ids(const Dedupe *d, uint64_t *slots) {
+  uint32_t ids = 0;
+  *slots = 0;
+  for (int p = 0; p < DEDUPE_PARTS; p++) {
+    ids += d->parts[p].count;
+    if (d->parts[p].slots) *slots += (uint64_t)d->parts[p].mask + 1;
+  }
+  return ids;
+}
+
+/* Flags every id's winning row in `keep`. Returns 0 after an allocation
+   failure here or while the table was built. */
+static int dedupe_finish(Dedupe *d) {
+  free(d->keep);
+  d->keep = (unsigned char *)calloc(d->rows ? d->rows : 1, 1);
+  if (!d->keep) return 0;
+  for (int p = 0; p < DEDUPE_PARTS; p++) {
+    const DedupePart *part = &d->parts[p];
+    for (uint64_t i = 0; part->slots && i <= part->mask; i++) {
+      if (part->slots[i].fp) d->keep[part->slots[i].row] = 1;
+    }
+  }
+  return !d->failed;
+}
+
+/* Whether the next considered row survives --dedupe: looked up in `keep`
+   after a pre-pass, or resolved now for a one-pass DEDUPE_FIRST run. */
+static int dedupe_keeps(ScoreContext *ctx, StrView id, int day) {
+  Dedupe *d = ctx->dedupe;
+  if (d->keep) return ctx->dedupe_row >= d->rows || d->keep[ctx->dedupe_row++];
+  return dedupe_add(d, id, day) != 0;
+}
+
+/* Buffered runs number rows straight from the columns, file after file. */
+static void dedupe_scan_columns(Dedupe *d, const ScholarColumns *cols) {
+  uint64_t fps[DEDUPE_BATCH];
+  int days[DEDUPE_BATCH];
+  int n = 0;
+  for (int i = 0; i < cols->count; i++) {
+    if (cols->state[i] != ROW_VALID) continue;
+    StrView id = {cols->arena + cols->id_offsets[i], cols->id_lens[i]};
+    fps[n] = id_fingerprint(id);
+    days[n] = cols->days[i];
+    if (++n == DEDUPE_BATCH) {
+      dedupe_add_batch(d, fps, days, n);
+      n = 0;
+    }
+  }
+  dedupe_add_batch(d, fps, days, n);
+}
+
+/* A --dedupe pre-pass over one segment: a chunk of a mapped file, or a whole
+   file read again through input_open when data is NULL. Each segment numbers
+   its rows from 0 into its own table. */
+typedef struct {
+  const char *path;
+  const char *data;
+  size_t len;
+  int skip_header;
+  int clamp_ranges;
+  ScanLineFn scan_line;
+  Dedupe dedupe;
+  DateCache dates;
+  RunTotals scratch;
+  uint64_t fps[DEDUPE_BATCH];
+  int days[DEDUPE_BATCH];
+  int pending;
+  int open_errno;
+  const char *read_error;
+} DedupeScan;
+
+static void dedupe_scan_row(DedupeScan *scan, const StrView fields[6], int field_count) {
+  ScholarRow row;
+  int day = 0;
+  if (parse_scholar_fields(fields, field_count, &row, &scan->scratch, scan->clamp_ranges) && row.valid &&
+      date_cache_parse(&scan->dates, row.last_touchpoint, &day)) {
+    scan->fps[scan->pending] = id_fingerprint(row.id);
+    scan->days[scan->pending] = day;
+    if (++scan->pending == DEDUPE_BATCH) {
+      dedupe_add_batch(&scan->dedupe, scan->fps, scan->days, scan->pending);
+      scan->pending = 0;
+    }
+  }
+}
+
+static void dedupe_scan_run(DedupeScan *scan) {
+  StrView line;
+  StrView fields[6];
+  int field_count = 0;
+  if (scan->data) {
+    size_t pos = 0;
+    if (scan->skip_header) scan->scan_line(scan->data, scan->len, &pos, &line, fields, &field_count);
+    while (scan->scan_line(scan->data, scan->len, &pos, &line, fields, &field_count)) {
+      dedupe_scan_row(scan, fields, field_count);
+    }
+    dedupe_add_batch(&scan->dedupe, scan->fps, scan->days, scan->pending);
+    return;
+  }
+  InputReader in;
+  if (!input_open(&in, scan->path)) {
+    scan->open_errno = errno;
+    return;
+  }
+  int line_num = 0;
+  while (input_next_row(&in, &line, fields, &field_count)) {
+    if (++line_num > 1) dedupe_scan_row(scan, fields, field_count);
+  }
+  dedupe_add_batch(&scan->dedupe, scan->fps, scan->days, scan->pending);
+  scan->read_error = in.error;
+  input_close(&in);
+}
+
+/* Shared by both pre-pass stages: workers take the next segment to scan,
+   then the next partition to merge. */
+typedef struct {
+  Dedupe *into;
+  DedupeScan *scans;
+  int count;
+  const uint32_t *bases;
+  atomic_int next;
+  int merging;
+  int failed[DEDUPE_PARTS];
+} DedupePool;
+
+/* Folds partition p of every segment into `into`, in segment order, which
+   resolves repeats exactly as one ordered pass would. */
+static void dedupe_merge_part(DedupePool *pool, int p) {
+  DedupePart *dst = &pool->into->parts[p];
+  uint64_t ids = 0;
+  for (int k = 0; k < pool->count; k++) ids += pool->scans[k].dedupe.parts[p].count;
+  if (!dedupe_part_reserve(dst, ids)) {
+    pool->failed[p] = 1;
+    return;
+  }
+  for (int k = 0; k < pool->count; k++) {
+    const DedupePart *src = &pool->scans[k].dedupe.parts[p];
+    for (uint64_t i = 0; src->slots && i <= src->mask; i++) {
+      const DedupeSlot *s = &src->slots[i];
+      if (s->fp && dedupe_part_put(dst, pool->into->mode, s->fp, pool->bases[k] + s->row, s->day) < 0) {
+        pool->failed[p] = 1;
+        return;
+      }
+    }
+  }
+}
+
+static void *dedupe_pool_worker(void *arg) {
+  DedupePool *pool = (DedupePool *)arg;
+  int limit = pool->merging ? DEDUPE_PARTS : pool->count;
+  for (;;) {
+    int i = atomic_fetch_add(&pool->next, 1);
+    if (i >= limit) break;
+    if (pool->merging) {
+      dedupe_merge_part(pool, i);
+    } else {
+      dedupe_scan_run(&pool->scans[i]);
+    }
+  }
+  return NULL;
+}
+
+static void dedupe_pool_run(DedupePool *pool, int threads) {
+  pthread_t tids[DEDUPE_PARTS];
+  int started[DEDUPE_PARTS] = {0};
+  if (threads > DEDUPE_PARTS) threads = DEDUPE_PARTS;
+  atomic_store(&pool->next, 0);
+  /* The calling thread is the last worker. */
+  for (int i = 0; i < threads - 1; i++) started[i] = pthread_create(&tids[i], NULL, dedupe_pool_worker, pool) == 0;
+  dedupe_pool_worker(pool);
+  for (int i = 0; i < threads - 1; i++) {
+    if (started[i]) pthread_join(tids[i], NULL);
+  }
+}
+
+/* The --dedupe pre-pass for runs that score while reading: scans the
+   segments on up to `threads` threads, merges them into d and finishes it.
+   bases[k] gets the first row ordinal of segment k, where its scoring pass
+   starts counting. Returns 0 after reporting the failure. */
+static int dedupe_prepass(Dedupe *d, DedupeScan *scans, int count, int threads, uint32_t *bases) {
+  for (int k = 0; k < count; k++) scans[k].dedupe.mode = d->mode;
+  DedupePool pool = {d, scans, count, bases, 0, 0, {0}};
+  dedupe_pool_run(&pool, threads < count ? threads : count);
+  int ok = 1;
+  uint32_t rows = 0;
+  for (int k = 0; ok && k < count; k++) {
+    if (scans[k].open_errno) {
+      fprintf(stderr, "Failed to open input file %s: %s\n", scans[k].path, strerror(scans[k].open_errno));
+      ok = 0;
+    } else if (scans[k].read_error) {
+      fprintf(stderr, "Failed to read input file %s: %s.\n", scans[k].path, scans[k].read_error);
+      ok = 0;
+    } else if (scans[k].dedupe.failed || rows + scans[k].dedupe.rows < rows) {
+      fprintf(stderr, "Failed to allocate dedupe table.\n");
+      ok = 0;
+    }
+    bases[k] = rows;
+    rows += scans[k].dedupe.rows;
+  }
+  if (ok) {
+    pool.merging = 1;
+    dedupe_pool_run(&pool, threads);
+    d->rows = rows;
+    for (int p = 0; p < DEDUPE_PARTS; p++) d->failed |= pool.failed[p];
+    if (!dedupe_finish(d)) {
+      fprintf(stderr, "Failed to allocate dedupe table.\n");
+      ok = 0;
+    }
+  }
+  for (int k = 0; k < count; k++) dedupe_free(&scans[k].dedupe);
+  return ok;
+}
+
+/* A pre-pass reads its files a second time, so stdin and pipes cannot take
+   one. Missing files are left for input_open to report. */
+static int dedupe_rereadable(const char *path) {
+  struct stat st;
+  return strcmp(path, "-") != 0 && (stat(path, &st) != 0 || S_ISREG(st.st_mode));
+}
+
+/* The pre-pass over whole files. Returns each file's first row ordinal, or
+   NULL after reporting the failure. */
+static uint32_t *dedupe_prepass_files(Dedupe *d, char **paths, int count, int threads, int clamp_ranges) {
+  DedupeScan *scans = (DedupeScan *)calloc((size_t)count, sizeof(DedupeScan));
+  uint32_t *bases = (uint32_t *)calloc((size_t)count, sizeof(uint32_t));
+  if (!scans || !bases) {
+    fprintf(stderr, "Failed to allocate dedupe table.\n");
+    free(scans);
+    free(bases);
+    return NULL;
+  }
+  for (int k = 0; k < count; k++) {
+    scans[k].path = paths[k];
+    scans[k].clamp_ranges = clamp_ranges;
+  }
+  int ok = dedupe_prepass(d, scans, count, threads, bases);
+  free(scans);
+  if (!ok) {
+    free(bases);
+    return NULL;
+  }
+  return bases;
+}
+
+void run_totals_add_counts(RunTotals *t, const int counts[KC_COUNT]) {
+  t->future_dates += counts[KC_FUTURE];
+  t->recency_over_30 += counts[KC_RECENCY_OVER_30];
+  t->recency_15_30 += counts[KC_RECENCY_15_30];
+  t->recency_8_14 += counts[KC_RECENCY_8_14];
+  t->touchpoints_zero += counts[KC_TOUCHPOINTS_ZERO];
+  t->touchpoints_one += counts[KC_TOUCHPOINTS_ONE];
+  t->attendance_low += counts[KC_ATTENDANCE_LOW];
+  t->attendance_mid += counts[KC_ATTENDANCE_MID];
+  t->satisfaction_low += counts[KC_SATISFACTION_LOW];
+  t->satisfaction_mid += counts[KC_SATISFACTION_MID];
+  t->high_count += counts[KC_HIGH];
+  t->medium_count += counts[KC_MEDIUM];
+  t->low_count += counts[KC_LOW];
+  t->valid_count += counts[KC_HIGH] + counts[KC_MEDIUM] + counts[KC_LOW];
+}
+
+static void scored_out_add(ScoredOut *s, StrView id, StrView cohort, int score, int tier, int days_since,
+                           int touchpoints, double attendance, double satisfaction);
+
+static void cohort_stats_add(CohortStats *c, int tier, int days_since, int touchpoints, double attendance,
+                             double satisfaction) {
+  c->count++;
+  c->high += tier == TIER_HIGH;
+  c->medium += tier == TIER_MEDIUM;
+  c->low += tier == TIER_LOW;
+  fixed_sum_add(&c->attendance_sum, attendance);
+  fixed_sum_add(&c->satisfaction_sum, satisfaction);
+  c->touchpoints_sum += touchpoints;
+  c->days_since_sum += days_since;
+  if (c->sketch) sketch_add(c->sketch, attendance, satisfaction, touchpoints, days_since);
+}
+
+/* Folds one scored row into its cohort (when c is not NULL), the risk list
+   and the --scored-out stream; the run totals come from the kernel
+   counters. A kept risk entry refers to the cohort's name in ctx->cohorts.
+   With --rollup-separator, c's ancestors get the row too. */
+void account_row(ScoreContext *ctx, CohortStats *c, int score, int tier, int days_since, int touchpoints,
+                 double attendance, double satisfaction, StrView id, StrView cohort, size_t offset) {
+  if (c) {
+    cohort_stats_add(c, tier, days_since, touchpoints, attendance, satisfaction);
+    for (int p = c->parent; p >= 0; p = ctx->cohorts->entries[p].parent) {
+      cohort_stats_add(&ctx->cohorts->entries[p], tier, days_since, touchpoints, attendance, satisfaction);
+    }
+  }
+  if (ctx->scored) {
+    scored_out_add(ctx->scored, id, cohort, score, tier, days_since, touchpoints, attendance, satisfaction);
+  }
+
+  if (!top_risks_admits(ctx->risks, score, days_since, id, offset)) return;
+  RiskEntry entry;
+  memset(&entry, 0, sizeof(RiskEntry));
+  if (!c) {
+    int idx = find_or_add_cohort(ctx->cohorts, cohort);
+    c = idx >= 0 ? &ctx->cohorts->entries[idx] : NULL;
+  }
+  entry.cohort = c ? c->name : "";
+  entry.risk_score = score;
+  entry.days_since = days_since;
+  entry.touchpoints_30d = touchpoints;
+  entry.attendance_rate = attendance;
+  entry.satisfaction_score = satisfaction;
+  entry.offset = offset;
+  top_risks_push(ctx->risks, &entry, id);
+}
+
+/* Scores one parsed row and folds it into the run totals, cohort stats and
+   risk list. Used by the --stream and --threads ingest paths; it runs the
+   reference kernel on a one-row block so both paths share one definition
+   of the scoring rules. */
+void score_row(const ScholarRow *s, ScoreContext *ctx) {
+  RunTotals *t = ctx->totals;
+  if (!s->valid) {
+    t->invalid_rows++;
+    return;
+  }
+
+  /* --dedupe numbers every dated row, inside the cohort filter or not. */
+  int wanted = context_wants(ctx, s->cohort);
+  int touch_day = 0;
+  int dated = (wanted || ctx->dedupe) && date_cache_parse(ctx->dates, s->last_touchpoint, &touch_day);
+  if (dated && ctx->dedupe && !dedupe_keeps(ctx, s->id, touch_day)) {
+    t->duplicate_rows += wanted;
+    return;
+  }
+  if (!wanted) return;
+  if (!dated) {
+    t->invalid_rows++;
+    t->invalid_date_format++;
+    return;
+  }
+
+  const unsigned char eligible = 1;
+  int days_since = 0;
+  int score = 0;
+  int tier = 0;
+  int counts[KC_COUNT] = {0};
+  ScoreBlock block = {ctx->as_of_day, &touch_day, &s->touchpoints_30d, &s->attendance_rate,
+                      &s->satisfaction_score, &eligible, &days_since, &score, &tier, ctx->profile};
+  if (ctx->generic_profile) {
+    score_kernel_scalar_profile(&block, 0, 1, counts);
+  } else {
+    score_kernel_scalar(&block, 0, 1, counts);
+  }
+  run_totals_add_counts(t, counts);
+
+  int cidx = find_or_add_cohort(ctx->cohorts, s->cohort);
+  CohortStats *c = cidx >= 0 ? &ctx->cohorts->entries[cidx] : NULL;
+  account_row(ctx, c, score, tier, days_since, s->touchpoints_30d, s->attendance_rate, s->satisfaction_score,
+              s->id, s->cohort, s->offset);
+}
+
+/* Scores the lines in data[0, len), which start at input byte `base`;
+   *lines counts every line seen so far, so line 1 is skipped as the
+   header. Used where input arrives in pieces (--watch, the engine API). */
+void score_csv_lines(const char *data, size_t len, uint64_t base, int *lines, ScanLineFn scan_line,
+                     ScoreContext *ctx, int clamp_ranges) {
+  size_t pos = 0;
+  while (pos < len) {
+    size_t start = pos;
+    StrView line;
+    StrView fields[6];
+    int field_count = 0;
+    scan_line(data, len, &pos, &line, fields, &field_count);
+    if (++*lines == 1) continue;
+    ctx->totals->data_rows++;
+    ScholarRow row;
+    if (!parse_scholar_fields(fields, field_count, &row, ctx->totals, clamp_ranges)) continue;
+    row.offset = base + start;
+    score_row(&row, ctx);
+  }
+}
+
+int columns_init(ScholarColumns *cols) {
+  memset(cols, 0, sizeof(ScholarColumns));
+  return cohort_table_init(&cols->names);
+}
+
+void columns_free(ScholarColumns *cols) {
+  if (cols->mapped) {
+    munmap(cols->mapped, cols->mapped_len);
+    cohort_table_free(&cols->names);
+    memset(cols, 0, sizeof(ScholarColumns));
+    return;
+  }
+  free(cols->touchpoints);
+  free(cols->attendance);
+  free(cols->satisfaction);
+  free(cols->days);
+  free(cols->cohort_ids);
+  free(cols->state);
+  free(cols->id_offsets);
+  free(cols->id_lens);
+  free(cols->offsets);
+  free(cols->arena);
+  cohort_table_free(&cols->names);
+  memset(cols, 0, sizeof(ScholarColumns));
+}
+
+static int grow_column(void **column, size_t elem, int capacity) {
+  void *resized = realloc(*column, elem * (size_t)capacity);
+  if (!resized) return 0;
+  *column = resized;
+  return 1;
+}
+
+/* Makes room for at least `rows` rows. */
+static int columns_reserve_rows(ScholarColumns *cols, int rows) {
+  if (rows <= cols->capacity) return 1;
+  int capacity = rows;
+  if (!grow_column((void **)&cols->touchpoints, sizeof(int), capacity) ||
+      !grow_column((void **)&cols->attendance, sizeof(double), capacity) ||
+      !grow_column((void **)&cols->satisfaction, sizeof(double), capacity) ||
+      !grow_column((void **)&cols->days, sizeof(int), capacity) ||
+      !grow_column((void **)&cols->cohort_ids, sizeof(int), capacity) ||
+      !grow_column((void **)&cols->state, sizeof(unsigned char), capacity) ||
+      !grow_column((void **)&cols->id_offsets, sizeof(size_t), capacity) ||
+      !grow_column((void **)&cols->id_lens, sizeof(uint32_t), capacity) ||
+      !grow_column((void **)&cols->offsets, sizeof(size_t), capacity)) {
+    return 0;
+  }
+  if (cols->capacity) cols->grows++;
+  cols->capacity = capacity;
+  return 1;
+}
+
+static int columns_reserve(ScholarColumns *cols) {
+  if (cols->count < cols->capacity) return 1;
+  return columns_reserve_rows(cols, cols->capacity ? cols->capacity * 2 : 128);
+}
+
+/* Sizes the columns for a mapped input from the line length of its first
+   64 KB plus 1/8 headroom, so a typical export fills them without a grow. */
+static int columns_presize(ScholarColumns *cols, const InputReader *in) {
+  if (!in->map) return 1;
+  size_t sample = in->map_len < 65536 ? in->map_len : 65536;
+  size_t lines = 0;
+  for (const char *p = in->map; (p = (const char *)memchr(p, '\n', sample - (size_t)(p - in->map))) != NULL; p++) {
+    lines++;
+    if ((size_t)(p - in->map) + 1 >= sample) break;
+  }
+  if (lines == 0) return 1;
+  size_t rows = in->map_len / (sample / lines) + 1;
+  rows += rows / 8;
+  return rows >= INT32_MAX || columns_reserve_rows(cols, (int)rows);
+}
+
+static int columns_intern_id(ScholarColumns *cols, StrView id, size_t *offset_out) {
+  if (cols->arena_cap - cols->arena_len < id.len + 1) {
+    size_t cap = cols->arena_cap ? cols->arena_cap : 4096;
+    while (cap - cols->arena_len < id.len + 1) cap *= 2;
+    char *resized = (char *)realloc(cols->arena, cap);
+    if (!resized) return 0;
+    cols->arena = resized;
+    cols->arena_cap = cap;
+  }
+  memcpy(cols->arena + cols->arena_len, id.ptr, id.len);
+  cols->arena[cols->arena_len + id.len] = '\0';
+  *offset_out = cols->arena_len;
+  cols->arena_len += id.len + 1;
+  return 1;
+}
+
+/* Appends a validated row, resolving its date and interning its cohort and
+   id. Returns 0 on allocation failure. */
+static int columns_append(ScholarColumns *cols, const ScholarRow *row, DateCache *dates) {
+  if (!columns_reserve(cols)) return 0;
+  int i = cols->count;
+  cols->state[i] = ROW_INVALID;
+  cols->offsets[i] = row->offset;
+  cols->touchpoints[i] = 0;
+  cols->attendance[i] = 0;
+  cols->satisfaction[i] = 0;
+  cols->days[i] = 0;
+  cols->cohort_ids[i] = 0;
+  if (row->valid) {
+    int cid = find_or_add_cohort(&cols->names, row->cohort);
+    if (cid < 0 || !columns_intern_id(cols, row->id, &cols->id_offsets[i])) return 0;
+    cols->id_lens[i] = (uint32_t)row->id.len;
+    int day = 0;
+    cols->state[i] = date_cache_parse(dates, row->last_touchpoint, &day) ? ROW_VALID : ROW_BAD_DATE;
+    cols->touchpoints[i] = row->touchpoints_30d;
+    cols->attendance[i] = row->attendance_rate;
+    cols->satisfaction[i] = row->satisfaction_score;
+    cols->days[i] = day;
+    cols->cohort_ids[i] = cid;
+  }
+  cols->count++;
+  return 1;
+}
+
+/* Scores buffered columns in input order. Cohort filter matches and stats
+   slots are resolved once per interned name; stats slots are created on the
+   first scored row, so cohort order matches the row-at-a-time path. */
+int score_columns(const ScholarColumns *cols, ScoreContext *ctx) {
+  int name_count = cols->names.count;
+  int *stats_index = (int *)malloc(sizeof(int) * (size_t)(name_count > 0 ? name_count : 1));
+  signed char *match = (signed char *)malloc((size_t)(name_count > 0 ? name_count : 1));
+  if (!stats_index || !match) {
+    free(stats_index);
+    free(match);
+    return 0;
+  }
+  for (int i = 0; i < name_count; i++) {
+    const CohortStats *n = &cols->names.entries[i];
+    StrView name = {n->name, n->name_len};
+    match[i] = (signed char)context_wants(ctx, name);
+    stats_index[i] = -2;
+  }
+
+  RunTotals *t = ctx->totals;
+  ScoreKernelFn kernel = select_score_kernel(ctx->profile);
+  unsigned char eligible[SCORE_BLOCK];
+  int days_since[SCORE_BLOCK];
+  int scores[SCORE_BLOCK];
+  int tiers[SCORE_BLOCK];
+  int counts[KC_COUNT] = {0};
+  for (int base = 0; base < cols->count; base += SCORE_BLOCK) {
+    int n = cols->count - base < SCORE_BLOCK ? cols->count - base : SCORE_BLOCK;
+    for (int j = 0; j < n; j++) {
+      int i = base + j;
+      eligible[j] = 0;
+      int dropped = 0;
+      if (cols->state[i] == ROW_VALID && ctx->dedupe) {
+        StrView id = {cols->arena + cols->id_offsets[i], cols->id_lens[i]};
+        dropped = !dedupe_keeps(ctx, id, cols->days[i]);
+      }
+      if (cols->state[i] == ROW_INVALID) {
+        t->invalid_rows++;
+      } else if (dropped) {
+        t->duplicate_rows += match[cols->cohort_ids[i]];
+      } else if (!match[cols->cohort_ids[i]]) {
+        continue;
+      } else if (cols->state[i] == ROW_BAD_DATE) {
+        t->invalid_rows++;
+        t->invalid_date_format++;
+      } else {
+        eligible[j] = 1;
+      }
+    }
+
+    ScoreBlock block = {ctx->as_of_day, cols->days + base, cols->touchpoints + base, cols->attendance + base,
+                        cols->satisfaction + base, eligible, days_since, scores, tiers, ctx->profile};
+    kernel(&block, 0, n, counts);
+
+    for (int j = 0; j < n; j++) {
+      if (!eligible[j]) continue;
+      int i = base + j;
+      int cid = cols->cohort_ids[i];
+      const CohortStats *name = &cols->names.entries[cid];
+      StrView cohort = {name->name, name->name_len};
+      if (stats_index[cid] == -2) stats_index[cid] = find_or_add_cohort(ctx->cohorts, cohort);
+      CohortStats *c = stats_index[cid] >= 0 ? &ctx->cohorts->entries[stats_index[cid]] : NULL;
+      StrView id = {cols->arena + cols->id_offsets[i], cols->id_lens[i]};
+      account_row(ctx, c, scores[j], tiers[j], days_since[j], cols->touchpoints[i], cols->attendance[i],
+                  cols->satisfaction[i], id, cohort, cols->offsets[i]);
+    }
+  }
+  run_totals_add_counts(t, counts);
+
+  free(stats_index);
+  free(match);
+  return 1;
+}
+
+/* The buffered ingest: validates every data row of `in` into cols. Returns 0
+   on allocation failure. */
+static int parse_columns(InputReader *in, ScholarColumns *cols, RunTotals *t, DateCache *dates, int clamp_ranges) {
+  StrView line;
+  StrView fields[6];
+  int field_count = 0;
+  int line_num = 0;
+  if (!columns_presize(cols, in)) return 0;
+  while (input_next_row(in, &line, fields, &field_count)) {
+    if (++line_num == 1) continue;
+    t->data_rows++;
+    ScholarRow row;
+    if (!parse_scholar_fields(fields, field_count, &row, t, clamp_ranges)) continue;
+    row.offset = in->line_offset;
+    if (!columns_append(cols, &row, dates)) return 0;
+  }
+  return 1;
+}
+
+typedef struct {
+  const char *data;
+  size_t len;
+  size_t base;
+  int skip_header;
+  int clamp_ranges;
+  ScanLineFn scan_line;
+  ScoreContext ctx;
+  RunTotals totals;
+  CohortTable cohorts;
+  TopRisks risks;
+  DateCache dates;
+} ChunkJob;
+
+static void *chunk_worker(void *arg) {
+  ChunkJob *job = (ChunkJob *)arg;
+  size_t pos = 0;
+  StrView line;
+  StrView fields[6];
+  int field_count = 0;
+  if (job->skip_header) job->scan_line(job->data, job->len, &pos, &line, fields, &field_count);
+  for (;;) {
+    size_t start = pos;
+    if (!job->scan_line(job->data, job->len, &pos, &line, fields, &field_count)) break;
+    job->totals.data_rows++;
+    ScholarRow row;
+    if (!parse_scholar_fields(fields, field_count, &row, &job->totals, job->clamp_ranges)) continue;
+    row.offset = job->base + start;
+    score_row(&row, &job->ctx);
+  }
+  return NULL;
+}
+
+/* RunTotals is a flat block of int counters. */
+void run_totals_merge(RunTotals *into, const RunTotals *from) {
+  int *dst = (int *)into;
+  const int *src = (const int *)from;
+  for (size_t i = 0; i < sizeof(RunTotals) / sizeof(int); i++) dst[i] += src[i];
+}
+
+static int cohort_table_merge(CohortTable *into, const CohortTable *from) {
+  for (int i = 0; i < from->count; i++) {
+    const CohortStats *src = &from->entries[i];
+    StrView name = {src->name, src->name_len};
+    int idx = find_or_add_cohort(into, name);
+    if (idx < 0) return 0;
+    CohortStats *dst = &into->entries[idx];
+    dst->count += src->count;
+    dst->high += src->high;
+    dst->medium += src->medium;
+    dst->low += src->low;
+    fixed_sum_merge(&dst->attendance_sum, &src->attendance_sum);
+    fixed_sum_merge(&dst->satisfaction_sum, &src->satisfaction_sum);
+    dst->touchpoints_sum += src->touchpoints_sum;
+    dst->days_since_sum += src->days_since_sum;
+    if (dst->sketch && src->sketch) {
+      for (int b = 0; b < SKETCH_BUCKETS; b++) dst->sketch[b] += src->sketch[b];
+    }
+  }
+  return 1;
+}
+
+/* Splits a mapped input into newline-aligned chunks, scores each on its own
+   thread with private accumulators, then folds them into ctx. Every merged
+   quantity is order-independent (integer counts, FixedSum sums, and a top-K
+   with a total order), so the result matches a single-threaded run. */
+static int score_mapped_parallel(const InputReader *in, int threads, ScoreContext *ctx, int clamp_ranges) {
+  ChunkJob *jobs = (ChunkJob *)calloc((size_t)threads, sizeof(ChunkJob));
+  pthread_t *tids = (pthread_t *)calloc((size_t)threads, sizeof(pthread_t));
+  int *started = (int *)calloc((size_t)threads, sizeof(int));
+  int ok = jobs && tids && started;
+
+  size_t start = 0;
+  for (int i = 0; ok && i < threads; i++) {
+    size_t end = in->map_len;
+    if (i < threads - 1) {
+      end = in->map_len / (size_t)threads * (size_t)(i + 1);
+      if (end < start) end = start;
+      if (end > 0 && end < in->map_len) {
+        const char *nl = (const char *)memchr(in->map + end - 1, '\n', in->map_len - end + 1);
+        end = nl ? (size_t)(nl - in->map) + 1 : in->map_len;
+      }
+    }
+    ChunkJob *job = &jobs[i];
+    job->data = in->map + start;
+    job->len = end - start;
+    job->base = start;
+    job->skip_header = i == 0;
+    job->clamp_ranges = clamp_ranges;
+    job->scan_line = in->scan_line;
+    /* The chunk heap shares the run's limit but only grows with the rows it
+       keeps, so threads multiply the rows kept, not the limit. */
+    if (!cohort_table_init(&job->cohorts) || !top_risks_init(&job->risks, ctx->risks->capacity)) {
+      ok = 0;
+      break;
+    }
+    job->cohorts.sketched = ctx->cohorts->sketched;
+    job->cohorts.rollup = ctx->cohorts->rollup;
+    job->ctx = *ctx;
+    job->ctx.totals = &job->totals;
+    job->ctx.cohorts = &job->cohorts;
+    job->ctx.risks = &job->risks;
+    job->ctx.dates = &job->dates;
+    start = end;
+  }
+
+  /* --dedupe numbers the rows of the same chunks in a parallel pre-pass,
+     so each chunk knows where its row ordinals start. */
+  if (ok && ctx->dedupe) {
+    DedupeScan *scans = (DedupeScan *)calloc((size_t)threads, sizeof(DedupeScan));
+    uint32_t *bases = (uint32_t *)calloc((size_t)threads, sizeof(uint32_t));
+    if (!scans || !bases) {
+      fprintf(stderr, "Failed to allocate dedupe table.\n");
+      ok = 0;
+    }
+    for (int i = 0; ok && i < threads; i++) {
+      scans[i].data = jobs[i].data;
+      scans[i].len = jobs[i].len;
+      scans[i].skip_header = jobs[i].skip_header;
+      scans[i].clamp_ranges = clamp_ranges;
+      scans[i].scan_line = in->scan_line;
+    }
+    if (ok && !dedupe_prepass(ctx->dedupe, scans, threads, threads, bases)) ok = 0;
+    for (int i = 0; ok && i < threads; i++) jobs[i].ctx.dedupe_row = bases[i];
+    free(scans);
+    free(bases);
+  }
+
+  for (int i = 0; ok && i < threads; i++) {
+    started[i] = pthread_create(&tids[i], NULL, chunk_worker, &jobs[i]) == 0;
+    if (!started[i]) chunk_worker(&jobs[i]);
+  }
+  for (int i = 0; ok && i < threads; i++) {
+    if (started[i]) pthread_join(tids[i], NULL);
+  }
+
+  for (int i = 0; ok && i < threads; i++) {
+    ChunkJob *job = &jobs[i];
+    run_totals_merge(ctx->totals, &job->totals);
+    if (!cohort_table_merge(ctx->cohorts, &job->cohorts)) ok = 0;
+    top_risks_merge(ctx->risks, &job->risks, ctx->cohorts);
+  }
+
+  for (int i = 0; jobs && i < threads; i++) {
+    cohort_table_free(&jobs[i].cohorts);
+    top_risks_free(&jobs[i].risks);
+  }
+  free(jobs);
+  free(tids);
+  free(started);
+  return ok;
+}
+
+/* Multi-file runs: each --input file gets its own reader, date cache and
+   either buffered columns or (with --stream) private accumulators, so files
+   ingest concurrently. Offsets carry the file index in their top bits, which
+   keeps top-risk ties ordered as if the files had been concatenated. */
+#define FILE_OFFSET_SHIFT 40
+
+
+typedef struct {
+  FileJob *jobs;
+  int count;
+  atomic_int next;
+} FilePool;
+
+static void file_job_run(FileJob *job) {
+  InputReader in;
+  if (!input_open(&in, job->path)) {
+    job->open_errno = errno;
+    return;
+  }
+  if (job->stream) {
+    StrView line;
+    StrView fields[6];
+    int field_count = 0;
+    int line_num = 0;
+    while (input_next_row(&in, &line, fields, &field_count)) {
+      if (++line_num == 1) continue;
+      job->totals.data_rows++;
+      ScholarRow row;
+      if (!parse_scholar_fields(fields, field_count, &row, &job->totals, job->clamp_ranges)) continue;
+      row.offset = job->base + in.line_offset;
+      score_row(&row, &job->ctx);
+    }
+  } else if (!parse_columns(&in, &job->cols, &job->totals, &job->dates, job->clamp_ranges)) {
+    job->failed = 1;
+  } else {
+    for (int i = 0; i < job->cols.count; i++) job->cols.offsets[i] += job->base;
+  }
+  job->bytes_read = in.bytes_read;
+  job->read_error = in.error;
+  input_close(&in);
+}
+
+/* Workers take the next unread file until the list runs out. */
+static void *file_worker(void *arg) {
+  FilePool *pool = (FilePool *)arg;
+  for (;;) {
+    int i = atomic_fetch_add(&pool->next, 1);
+    if (i >= pool->count) break;
+    file_job_run(&pool->jobs[i]);
+  }
+  return NULL;
+}
+
+void file_jobs_free(FileJob *jobs, int count) {
+  for (int i = 0; jobs && i < count; i++) {
+    columns_free(&jobs[i].cols);
+    cohort_table_free(&jobs[i].cohorts);
+    top_risks_free(&jobs[i].risks);
+  }
+  free(jobs);
+}
+
+/* Reads every file in paths on up to `workers` threads and folds the parse
+   counters (plus, with --stream, the scored accumulators) into ctx in list
+   order. counts gets each file's row counts; buffered runs fill in valid and
+   invalid while scoring (score_file_columns). With --stream, dedupe_bases
+   holds each file's first --dedupe row ordinal. Returns the jobs, or NULL
+   after reporting the failure. */
+FileJob *ingest_files(char **paths, int count, int workers, int stream, ScoreContext *ctx, int clamp_ranges,
+                      const uint32_t *dedupe_bases, InputCount *counts) {
+  FileJob *jobs = (FileJob *)calloc((size_t)count, sizeof(FileJob));
+  pthread_t *tids = (pthread_t *)calloc((size_t)workers, sizeof(pthread_t));
+  int *started = (int *)calloc((size_t)workers, sizeof(int));
+  int ok = jobs && tids && started;
+  for (int i = 0; ok && i < count; i++) {
+    FileJob *job = &jobs[i];
+    job->path = paths[i];
+    job->base = (size_t)i << FILE_OFFSET_SHIFT;
+    job->stream = stream;
+    job->clamp_ranges = clamp_ranges;
+    if (stream) {
+      if (!cohort_table_init(&job->cohorts) || !top_risks_init(&job->risks, ctx->risks->capacity)) ok = 0;
+      job->cohorts.sketched = ctx->cohorts->sketched;
+      job->cohorts.rollup = ctx->cohorts->rollup;
+      job->ctx = *ctx;
+      job->ctx.totals = &job->totals;
+      job->ctx.cohorts = &job->cohorts;
+      job->ctx.risks = &job->risks;
+      job->ctx.dates = &job->dates;
+      if (dedupe_bases) job->ctx.dedupe_row = dedupe_bases[i];
+    } else if (!columns_init(&job->cols)) {
+      ok = 0;
+    }
+  }
+  if (!ok) fprintf(stderr, "Failed to allocate per-file buffers.\n");
+
+  /* The calling thread is the last worker. */
+  FilePool pool = {jobs, count, 0};
+  for (int i = 0; ok && i < workers - 1; i++) {
+    started[i] = pthread_create(&tids[i], NULL, file_worker, &pool) == 0;
+  }
+  if (ok) file_worker(&pool);
+  for (int i = 0; ok && i < workers - 1; i++) {
+    if (started[i]) pthread_join(tids[i], NULL);
+  }
+
+  for (int i = 0; ok && i < count; i++) {
+    FileJob *job = &jobs[i];
+    if (job->open_errno) {
+      fprintf(stderr, "Failed to open input file %s: %s\n", job->path, strerror(job->open_errno));
+      ok = 0;
+      break;
+    }
+    if (job->read_error) {
+      fprintf(stderr, "Failed to read input file %s: %s.\n", job->path, job->read_error);
+      ok = 0;
+      break;
+    }
+    if (job->failed) {
+      fprintf(stderr, "Failed to allocate scholar buffer.\n");
+      ok = 0;
+      break;
+    }
+    run_totals_merge(ctx->totals, &job->totals);
+    counts[i].path = job->path;
+    counts[i].rows = job->totals.data_rows;
+    counts[i].valid = job->totals.valid_count;
+    counts[i].invalid = job->totals.invalid_rows;
+    if (!stream) continue;
+    if (!cohort_table_merge(ctx->cohorts, &job->cohorts)) {
+      fprintf(stderr, "Failed to allocate cohort table.\n");
+      ok = 0;
+      break;
+    }
+    top_risks_merge(ctx->risks, &job->risks, ctx->cohorts);
+  }
+
+  free(tids);
+  free(started);
+  if (!ok) {
+    file_jobs_free(jobs, count);
+    return NULL;
+  }
+  return jobs;
+}
+
+/* Scores each file's buffered columns in list order, which matches scoring
+   their concatenation, and completes the per-file valid/invalid counts. */
+static int score_file_columns(const FileJob *jobs, int count, ScoreContext *ctx, InputCount *counts) {
+  for (int i = 0; i < count; i++) {
+    int valid = ctx->totals->valid_count;
+    int invalid = ctx->totals->invalid_rows;
+    if (jobs[i].cols.count > 0 && !score_columns(&jobs[i].cols, ctx)) return 0;
+    counts[i].valid = ctx->totals->valid_count - valid;
+    counts[i].invalid = jobs[i].totals.invalid_rows + ctx->totals->invalid_rows - invalid;
+  }
+  return 1;
+}
+
+/* --state: scholar rows remembered between runs, so a rerun only folds in
+   the rows that changed. A record is keyed by scholar id plus occurrence
+   (the n-th row for an id in a file maps to that id's n-th record), so
+   duplicate ids count exactly as they do in a fresh run. The cohort
+   accumulators and valid-row counters are saved too and patched in place:
+   a changed row subtracts what its old values contributed, then adds the
+   new ones. Contributions are recomputed from the stored values, never
+   stored, so subtracting one is exact. */
+#define STATE_MAGIC "GSSTATE1"
+#define STATE_VERSION 2
+
+typedef struct {
+  uint64_t hash;
+  uint64_t offset;
+  uint64_t id_offset;
+  uint32_t id_len;
+  int32_t occurrence;
+  int32_t cohort;
+  int32_t day;
+  int32_t touchpoints;
+  int32_t reserved;
+  double attendance;
+  double satisfaction;
+} StateRecord;
+
+/* On-disk cohort accumulator; the name bytes follow it. */
+typedef struct {
+  int32_t count;
+  int32_t high;
+  int32_t medium;
+  int32_t low;
+  FixedSum attendance_sum;
+  FixedSum satisfaction_sum;
+  int64_t touchpoints_sum;
+  int64_t days_since_sum;
+  int32_t saturated;
+  uint32_t name_len;
+} StateCohort;
+
+typedef struct {
+  int as_of_day;
+  uint64_t config_hash;
+  RunTotals totals;
+  CohortTable cohorts;
+  int *saturated;
+  int saturated_cap;
+  StateRecord *records;
+  unsigned char *seen;
+  int count;
+  int capacity;
+  char *arena;
+  size_t arena_len;
+  size_t arena_cap;
+  int *slots;
+  int slot_count;
+  int cursor;
+  int applied;
+  int unchanged;
+  int retired;
+  int rescored;
+} ScholarState;
+
+static uint64_t fnv1a64(uint64_t h, const void *data, size_t len) {
+  const unsigned char *p = (const unsigned char *)data;
+  for (size_t i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+/* Everything that changes what a row contributes, apart from --as-of. */
+static uint64_t state_config_hash(const ScoringProfile *p, int clamp_ranges, char **filters, int filter_count) {
+  uint64_t h = 14695981039346656037ull;
+  h = fnv1a64(h, p->recency_days, sizeof(p->recency_days));
+  h = fnv1a64(h, p->recency_points, sizeof(p->recency_points));
+  h = fnv1a64(h, p->touchpoints_at_most, sizeof(p->touchpoints_at_most));
+  h = fnv1a64(h, p->touchpoints_points, sizeof(p->touchpoints_points));
+  h = fnv1a64(h, p->attendance_below, sizeof(p->attendance_below));
+  h = fnv1a64(h, p->attendance_points, sizeof(p->attendance_points));
+  h = fnv1a64(h, p->satisfaction_below, sizeof(p->satisfaction_below));
+  h = fnv1a64(h, p->satisfaction_points, sizeof(p->satisfaction_points));
+  h = fnv1a64(h, &p->medium_at, sizeof(p->medium_at));
+  h = fnv1a64(h, &p->high_at, sizeof(p->high_at));
+  h = fnv1a64(h, &clamp_ranges, sizeof(clamp_ranges));
+  for (int i = 0; i < filter_count; i++) h = fnv1a64(h, filters[i], strlen(filters[i]) + 1);
+  /* Older builds keyed records by ids clipped to 63 bytes. */
+  h = fnv1a64(h, "full-ids", 8);
+  return h;
+}
+
+
+static void state_free(ScholarState *st) {
+  cohort_table_free(&st->cohorts);
+  free(st->saturated);
+  free(st->records);
+  free(st->seen);
+  free(st->arena);
+  free(st->slots);
+  memset(st, 0, sizeof(ScholarState));
+}
+
+static StrView state_record_id(const ScholarState *st, const StateRecord *r) {
+  StrView v = {st->arena + r->id_offset, r->id_len};
+  return v;
+}
+
+static uint32_t state_slot_hash(StrView id, int occurrence) {
+  return hash_name(id.ptr, id.len) ^ ((uint32_t)occurrence * 2654435761u);
+}
+
+/* The index stays at most half full; rebuilding leaves it a quarter full.
+   It is saved with the records, so loading a state never rehashes ids. */
+static int state_rebuild_index(ScholarState *st) {
+  int slot_count = 64;
+  while (slot_count < (st->count + 1) * 4) slot_count *= 2;
+  int *slots = (int *)calloc((size_t)slot_count, sizeof(int));
+  if (!slots) return 0;
+  free(st->slots);
+  st->slots = slots;
+  st->slot_count = slot_count;
+  for (int i = 0; i < st->count; i++) {
+    const StateRecord *r = &st->records[i];
+    int slot = (int)(state_slot_hash(state_record_id(st, r), r->occurrence) & (uint32_t)(slot_count - 1));
+    while (slots[slot] != 0) slot = (slot + 1) & (slot_count - 1);
+    slots[slot] = i + 1;
+  }
+  return 1;
+}
+
+static int state_init(ScholarState *st) {
+  memset(st, 0, sizeof(ScholarState));
+  return cohort_table_init(&st->cohorts) && state_rebuild_index(st);
+}
+
+static int state_find(const ScholarState *st, StrView id, int occurrence) {
+  if (st->slot_count == 0) return -1;
+  int mask = st->slot_count - 1;
+  int slot = (int)(state_slot_hash(id, occurrence) & (uint32_t)mask);
+  while (st->slots[slot] != 0) {
+    const StateRecord *r = &st->records[st->slots[slot] - 1];
+    if (r->occurrence == occurrence && r->id_len == id.len && memcmp(st->arena + r->id_offset, id.ptr, id.len) == 0) {
+      return st->slots[slot] - 1;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return -1;
+}
+
+/* Keeps the per-cohort saturated counters sized to the cohort table. */
+static int state_reserve_saturated(ScholarState *st) {
+  if (st->cohorts.capacity <= st->saturated_cap) return 1;
+  int *saturated = (int *)realloc(st->saturated, sizeof(int) * (size_t)st->cohorts.capacity);
+  if (!saturated) return 0;
+  memset(saturated + st->saturated_cap, 0, sizeof(int) * (size_t)(st->cohorts.capacity - st->saturated_cap));
+  st->saturated = saturated;
+  st->saturated_cap = st->cohorts.capacity;
+  return 1;
+}
+
+/* Makes room for one more record and id_len more id bytes. */
+static int state_reserve(ScholarState *st, size_t id_len) {
+  if (st->count >= st->capacity) {
+    int capacity = st->capacity ? st->capacity * 2 : 1024;
+    StateRecord *records = (StateRecord *)realloc(st->records, sizeof(StateRecord) * (size_t)capacity);
+    if (!records) return 0;
+    st->records = records;
+    unsigned char *seen = (unsigned char *)realloc(st->seen, (size_t)capacity);
+    if (!seen) return 0;
+    st->seen = seen;
+    st->capacity = capacity;
+  }
+  if ((st->count + 1) * 2 > st->slot_count && !state_rebuild_index(st)) return 0;
+  if (st->arena_len + id_len > st->arena_cap) {
+    size_t cap = st->arena_cap ? st->arena_cap * 2 : 65536;
+    while (cap < st->arena_len + id_len) cap *= 2;
+    char *arena = (char *)realloc(st->arena, cap);
+    if (!arena) return 0;
+    st->arena = arena;
+    st->arena_cap = cap;
+  }
+  return state_reserve_saturated(st);
+}
+
+static void fixed_sum_sub(FixedSum *sum, double value) {
+  uint64_t whole = (uint64_t)value;
+  uint64_t frac = (uint64_t)((value - (double)whole) * 18446744073709551616.0);
+  sum->whole -= whole + (sum->frac < frac);
+  sum->frac -= frac;
+}
+
+static void state_score(const StateRecord *r, int as_of_day, const ScoreContext *ctx, int *days_since, int *score,
+                        int *tier, int counts[KC_COUNT]) {
+  const unsigned char eligible = 1;
+  ScoreBlock block = {as_of_day, &r->day, &r->touchpoints, &r->attendance, &r->satisfaction,
+                      &eligible, days_since, score, tier, ctx->profile};
+  if (ctx->generic_profile) {
+    score_kernel_scalar_profile(&block, 0, 1, counts);
+  } else {
+    score_kernel_scalar(&block, 0, 1, counts);
+  }
+}
+
+/* Adds (sign 1) or removes (sign -1) what a record contributes at
+   as_of_day. A record past the last recency bound is "saturated": moving
+   --as-of forward only grows its days_since, which state_shift_as_of()
+   applies per cohort without rescoring it. */
+static void state_contribute(ScholarState *st, const StateRecord *r, int as_of_day, const ScoreContext *ctx, int sign) {
+  int days_since = 0;
+  int score = 0;
+  int tier = 0;
+  int counts[KC_COUNT] = {0};
+  state_score(r, as_of_day, ctx, &days_since, &score, &tier, counts);
+  for (int k = 0; k < KC_COUNT; k++) counts[k] *= sign;
+  run_totals_add_counts(&st->totals, counts);
+
+  CohortStats *c = &st->cohorts.entries[r->cohort];
+  c->count += sign;
+  c->high += sign * (tier == TIER_HIGH);
+  c->medium += sign * (tier == TIER_MEDIUM);
+  c->low += sign * (tier == TIER_LOW);
+  if (sign > 0) {
+    fixed_sum_add(&c->attendance_sum, r->attendance);
+    fixed_sum_add(&c->satisfaction_sum, r->satisfaction);
+  } else {
+    fixed_sum_sub(&c->attendance_sum, r->attendance);
+    fixed_sum_sub(&c->satisfaction_sum, r->satisfaction);
+  }
+  c->touchpoints_sum += sign * r->touchpoints;
+  c->days_since_sum += sign * days_since;
+  if (as_of_day - r->day > ctx->profile->recency_days[2]) st->saturated[r->cohort] += sign;
+}
+
+/* Re-bases the accumulators from st->as_of_day to ctx->as_of_day. Moving
+   forward rescores only records that were not yet saturated; moving back
+   rescores everything. */
+static void state_shift_as_of(ScholarState *st, const ScoreContext *ctx) {
+  int from = st->as_of_day;
+  int to = ctx->as_of_day;
+  if (to == from) return;
+  if (to < from) {
+    for (int i = 0; i < st->cohorts.count; i++) {
+      CohortStats *c = &st->cohorts.entries[i];
+      char *name = c->name;
+      size_t name_len = c->name_len;
+      memset(c, 0, sizeof(CohortStats));
+      c->name = name;
+      c->name_len = name_len;
+      st->saturated[i] = 0;
+    }
+    memset(&st->totals, 0, sizeof(RunTotals));
+    for (int i = 0; i < st->count; i++) state_contribute(st, &st->records[i], to, ctx, 1);
+    st->rescored = st->count;
+  } else {
+    for (int i = 0; i < st->cohorts.count; i++) {
+      st->cohorts.entries[i].days_since_sum += (long long)(to - from) * st->saturated[i];
+    }
+    int last_bound = ctx->profile->recency_days[2];
+    for (int i = 0; i < st->count; i++) {
+      const StateRecord *r = &st->records[i];
+      if (from - r->day > last_bound) continue;
+      state_contribute(st, r, from, ctx, -1);
+      state_contribute(st, r, to, ctx, 1);
+      st->rescored++;
+    }
+  }
+  st->as_of_day = to;
+}
+
+static uint64_t state_row_hash(const ScholarRow *s, int day) {
+  uint64_t h = 14695981039346656037ull;
+  h = fnv1a64(h, s->id.ptr, s->id.len);
+  h = fnv1a64(h, "", 1);
+  h = fnv1a64(h, s->cohort.ptr, s->cohort.len);
+  h = fnv1a64(h, &day, sizeof(day));
+  h = fnv1a64(h, &s->touchpoints_30d, sizeof(s->touchpoints_30d));
+  h = fnv1a64(h, &s->attendance_rate, sizeof(s->attendance_rate));
+  return fnv1a64(h, &s->satisfaction_score, sizeof(s->satisfaction_score));
+}
+
+/* Folds one valid, cohort-matched row into the state at ctx->as_of_day. */
+static int state_apply_row(ScholarState *st, const ScholarRow *s, int day, const ScoreContext *ctx) {
+  /* Records stay in input order, so when an export keeps its row order the
+     record after the last match is the one; the index is the fallback. */
+  int occurrence = 0;
+  int idx = -1;
+  if (st->cursor < st->count) {
+    const StateRecord *next = &st->records[st->cursor];
+    if (next->occurrence == 0 && !st->seen[st->cursor] && next->id_len == s->id.len &&
+        memcmp(st->arena + next->id_offset, s->id.ptr, s->id.len) == 0) {
+      idx = st->cursor;
+    }
+  }
+  if (idx < 0) {
+    idx = state_find(st, s->id, occurrence);
+    while (idx >= 0 && st->seen[idx]) idx = state_find(st, s->id, ++occurrence);
+  }
+  uint64_t hash = state_row_hash(s, day);
+  if (idx >= 0) {
+    StateRecord *r = &st->records[idx];
+    st->seen[idx] = 1;
+    st->cursor = idx + 1;
+    r->offset = s->offset;
+    if (r->hash == hash) {
+      st->unchanged++;
+      return 1;
+    }
+    state_contribute(st, r, ctx->as_of_day, ctx, -1);
+  } else {
+    if (!state_reserve(st, s->id.len)) return 0;
+    idx = st->count++;
+    StateRecord *r = &st->records[idx];
+    memset(r, 0, sizeof(StateRecord));
+    memcpy(st->arena + st->arena_len, s->id.ptr, s->id.len);
+    r->id_offset = st->arena_len;
+    r->id_len = (uint32_t)s->id.len;
+    r->occurrence = occurrence;
+    st->arena_len += s->id.len;
+    st->seen[idx] = 1;
+    st->cursor = idx + 1;
+    int slot = (int)(state_slot_hash(s->id, occurrence) & (uint32_t)(st->slot_count - 1));
+    while (st->slots[slot] != 0) slot = (slot + 1) & (st->slot_count - 1);
+    st->slots[slot] = idx + 1;
+  }
+
+  int cohort = find_or_add_cohort(&st->cohorts, s->cohort);
+  if (cohort < 0 || !state_reserve_saturated(st)) return 0;
+  StateRecord *r = &st->records[idx];
+  r->hash = hash;
+  r->offset = s->offset;
+  r->cohort = cohort;
+  r->day = day;
+  r->touchpoints = s->touchpoints_30d;
+  r->attendance = s->attendance_rate;
+  r->satisfaction = s->satisfaction_score;
+  state_contribute(st, r, ctx->as_of_day, ctx, 1);
+  st->applied++;
+  return 1;
+}
+
+/* Drops records a full input no longer contains, then rebuilds the cohort
+   table without emptied cohorts (a fresh run never lists them). The id
+   arena keeps retired ids until the state is rewritten. */
+static int state_retire_unseen(ScholarState *st, const ScoreContext *ctx) {
+  int kept = 0;
+  for (int i = 0; i < st->count; i++) {
+    if (!st->seen[i]) {
+      state_contribute(st, &st->records[i], ctx->as_of_day, ctx, -1);
+      st->retired++;
+      continue;
+    }
+    st->records[kept] = st->records[i];
+    st->seen[kept] = 1;
+    kept++;
+  }
+  st->count = kept;
+  return st->retired == 0 || state_rebuild_index(st);
+}
+
+static int state_compact_cohorts(ScholarState *st) {
+  CohortTable compact;
+  if (!cohort_table_init(&compact)) return 0;
+  int *remap = (int *)malloc(sizeof(int) * (size_t)(st->cohorts.count > 0 ? st->cohorts.count : 1));
+  int *saturated = (int *)calloc((size_t)(st->cohorts.count > 0 ? st->cohorts.count : 1), sizeof(int));
+  int ok = remap && saturated;
+  for (int i = 0; ok && i < st->cohorts.count; i++) {
+    const CohortStats *c = &st->cohorts.entries[i];
+    remap[i] = -1;
+    if (c->count == 0) continue;
+    StrView name = {c->name, c->name_len};
+    int idx = find_or_add_cohort(&compact, name);
+    if (idx < 0) {
+      ok = 0;
+      break;
+    }
+    char *interned = compact.entries[idx].name;
+    compact.entries[idx] = *c;
+    compact.entries[idx].name = interned;
+    saturated[idx] = st->saturated[i];
+    remap[i] = idx;
+  }
+  if (!ok) {
+    free(remap);
+    free(saturated);
+    cohort_table_free(&compact);
+    return 0;
+  }
+  for (int i = 0; i < st->count; i++) st->records[i].cohort = remap[st->records[i].cohort];
+  cohort_table_free(&st->cohorts);
+  free(st->saturated);
+  st->cohorts = compact;
+  st->saturated = saturated;
+  st->saturated_cap = st->cohorts.count > 0 ? st->cohorts.count : 1;
+  free(remap);
+  return state_reserve_saturated(st);
+}
+
+/* Reads a state file. Returns 1 when loaded, 0 when there is none yet and
+   -1 when it is unreadable or from another format version. */
+static int state_load(const char *path, ScholarState *st) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp) return errno == ENOENT ? 0 : -1;
+  char magic[8];
+  uint32_t version = 0;
+  int32_t cohort_count = 0;
+  int32_t record_count = 0;
+  uint64_t arena_len = 0;
+  int ok = fread(magic, 1, 8, fp) == 8 && memcmp(magic, STATE_MAGIC, 8) == 0 &&
+           fread(&version, sizeof(version), 1, fp) == 1 && version == STATE_VERSION &&
+           fread(&st->as_of_day, sizeof(int), 1, fp) == 1 && fread(&st->config_hash, sizeof(uint64_t), 1, fp) == 1 &&
+           fread(&st->totals, sizeof(RunTotals), 1, fp) == 1 && fread(&cohort_count, sizeof(int32_t), 1, fp) == 1 &&
+           fread(&record_count, sizeof(int32_t), 1, fp) == 1 && fread(&arena_len, sizeof(uint64_t), 1, fp) == 1 &&
+           cohort_count >= 0 && record_count >= 0;
+  char *name = NULL;
+  size_t name_cap = 0;
+  for (int i = 0; ok && i < cohort_count; i++) {
+    StateCohort sc;
+    ok = fread(&sc, sizeof(StateCohort), 1, fp) == 1;
+    if (ok && sc.name_len > name_cap) {
+      char *grown = (char *)realloc(name, sc.name_len);
+      ok = grown != NULL;
+      if (ok) {
+        name = grown;
+        name_cap = sc.name_len;
+      }
+    }
+    ok = ok && fread(name, 1, sc.name_len, fp) == sc.name_len;
+    StrView view = {name, sc.name_len};
+    int idx = ok ? find_or_add_cohort(&st->cohorts, view) : -1;
+    ok = idx == i && state_reserve_saturated(st);
+    if (ok) {
+      CohortStats *c = &st->cohorts.entries[idx];
+      c->count = sc.count;
+      c->high = sc.high;
+      c->medium = sc.medium;
+      c->low = sc.low;
+      c->attendance_sum = sc.attendance_sum;
+      c->satisfaction_sum = sc.satisfaction_sum;
+      c->touchpoints_sum = sc.touchpoints_sum;
+      c->days_since_sum = sc.days_since_sum;
+      st->saturated[idx] = sc.saturated;
+    }
+  }
+  free(name);
+  if (ok && record_count > 0) {
+    st->capacity = record_count;
+    st->records = (StateRecord *)malloc(sizeof(StateRecord) * (size_t)record_count);
+    st->seen = (unsigned char *)malloc((size_t)record_count);
+    st->arena_cap = arena_len > 0 ? (size_t)arena_len : 1;
+    st->arena = (char *)malloc(st->arena_cap);
+    ok = st->records && st->seen && st->arena &&
+         fread(st->records, sizeof(StateRecord), (size_t)record_count, fp) == (size_t)record_count &&
+         fread(st->arena, 1, (size_t)arena_len, fp) == (size_t)arena_len;
+    st->count = ok ? record_count : 0;
+    st->arena_len = ok ? (size_t)arena_len : 0;
+  }
+  for (int i = 0; ok && i < st->count; i++) {
+    const StateRecord *r = &st->records[i];
+    ok = r->cohort >= 0 && r->cohort < st->cohorts.count && r->id_offset + r->id_len <= st->arena_len;
+  }
+  int32_t slot_count = 0;
+  ok = ok && fread(&slot_count, sizeof(int32_t), 1, fp) == 1 && slot_count >= 64 &&
+       (slot_count & (slot_count - 1)) == 0 && (int64_t)st->count * 2 <= slot_count;
+  if (ok) {
+    free(st->slots);
+    st->slots = (int *)malloc(sizeof(int) * (size_t)slot_count);
+    st->slot_count = slot_count;
+    ok = st->slots && fread(st->slots, sizeof(int), (size_t)slot_count, fp) == (size_t)slot_count;
+  }
+  for (int i = 0; ok && i < st->slot_count; i++) ok = st->slots[i] >= 0 && st->slots[i] <= st->count;
+  ok = ok && fgetc(fp) == EOF;
+  fclose(fp);
+  return ok ? 1 : -1;
+}
+
+/* Writes the state next to its final path and renames it into place, so a
+   failed run never leaves a truncated state behind. */
+static int state_save(const char *path, const ScholarState *st) {
+  size_t path_len = strlen(path);
+  char *tmp = (char *)malloc(path_len + 5);
+  if (!tmp) return 0;
+  memcpy(tmp, path, path_len);
+  memcpy(tmp + path_len, ".tmp", 5);
+  FILE *fp = fopen(tmp, "wb");
+  if (!fp) {
+    free(tmp);
+    return 0;
+  }
+  uint64_t arena_len = 0;
+  for (int i = 0; i < st->count; i++) arena_len += st->records[i].id_len;
+  uint32_t version = STATE_VERSION;
+  int32_t cohort_count = st->cohorts.count;
+  int32_t record_count = st->count;
+  int ok = fwrite(STATE_MAGIC, 1, 8, fp) == 8 && fwrite(&version, sizeof(version), 1, fp) == 1 &&
+           fwrite(&st->as_of_day, sizeof(int), 1, fp) == 1 && fwrite(&st->config_hash, sizeof(uint64_t), 1, fp) == 1 &&
+           fwrite(&st->totals, sizeof(RunTotals), 1, fp) == 1 && fwrite(&cohort_count, sizeof(int32_t), 1, fp) == 1 &&
+           fwrite(&record_count, sizeof(int32_t), 1, fp) == 1 && fwrite(&arena_len, sizeof(uint64_t), 1, fp) == 1;
+  for (int i = 0; ok && i < st->cohorts.count; i++) {
+    const CohortStats *c = &st->cohorts.entries[i];
+    StateCohort sc;
+    memset(&sc, 0, sizeof(StateCohort));
+    sc.count = c->count;
+    sc.high = c->high;
+    sc.medium = c->medium;
+    sc.low = c->low;
+    sc.attendance_sum = c->attendance_sum;
+    sc.satisfaction_sum = c->satisfaction_sum;
+    sc.touchpoints_sum = c->touchpoints_sum;
+    sc.days_since_sum = c->days_since_sum;
+    sc.saturated = st->saturated[i];
+    sc.name_len = (uint32_t)c->name_len;
+    ok = fwrite(&sc, sizeof(StateCohort), 1, fp) == 1 && fwrite(c->name, 1, sc.name_len, fp) == sc.name_len;
+  }
+  /* Records and ids go out in chunks; ids are re-packed so retired ones
+     do not accumulate. */
+  enum { CHUNK = 1024 };
+  StateRecord *chunk = (StateRecord *)malloc(sizeof(StateRecord) * CHUNK);
+  size_t ids_cap = 65536;
+  char *ids = (char *)malloc(ids_cap);
+  ok = ok && chunk && ids;
+  uint64_t id_offset = 0;
+  for (int base = 0; ok && base < st->count; base += CHUNK) {
+    int n = st->count - base < CHUNK ? st->count - base : CHUNK;
+    for (int j = 0; j < n; j++) {
+      chunk[j] = st->records[base + j];
+      chunk[j].id_offset = id_offset;
+      id_offset += chunk[j].id_len;
+    }
+    ok = fwrite(chunk, sizeof(StateRecord), (size_t)n, fp) == (size_t)n;
+  }
+  for (int base = 0; ok && base < st->count; base += CHUNK) {
+    int n = st->count - base < CHUNK ? st->count - base : CHUNK;
+    size_t len = 0;
+    for (int j = 0; j < n; j++) len += st->records[base + j].id_len;
+    if (len > ids_cap) {
+      char *grown = (char *)realloc(ids, len);
+      if (!grown) {
+        ok = 0;
+        break;
+      }
+      ids = grown;
+      ids_cap = len;
+    }
+    len = 0;
+    for (int j = 0; j < n; j++) {
+      const StateRecord *r = &st->records[base + j];
+      memcpy(ids + len, st->arena + r->id_offset, r->id_len);
+      len += r->id_len;
+    }
+    ok = fwrite(ids, 1, len, fp) == len;
+  }
+  free(chunk);
+  free(ids);
+  int32_t slot_count = st->slot_count;
+  ok = ok && fwrite(&slot_count, sizeof(int32_t), 1, fp) == 1 &&
+       fwrite(st->slots, sizeof(int), (size_t)slot_count, fp) == (size_t)slot_count;
+  ok = fclose(fp) == 0 && ok;
+  ok = ok && rename(tmp, path) == 0;
+  if (!ok) remove(tmp);
+  free(tmp);
+  return ok;
+}
+
+/* Loads the state at path (starting empty when there is none, or when a full
+   input can rebuild one made with other settings) and re-bases it to
+   ctx->as_of_day. */
+static int state_open(const char *path, ScholarState *st, const ScoreContext *ctx, uint64_t config_hash, int delta) {
+  if (!state_init(st)) {
+    fprintf(stderr, "Failed to allocate state.\n");
+    return 0;
+  }
+  int loaded = state_load(path, st);
+  if (loaded < 0) {
+    fprintf(stderr, "Failed to read state file %s (remove it to start over).\n", path);
+    return 0;
+  }
+  if (loaded && st->config_hash != config_hash) {
+    if (delta) {
+      fprintf(stderr, "State file %s was built with other scoring settings; rerun once without --state-delta.\n", path);
+      return 0;
+    }
+    fprintf(stderr, "State file %s was built with other scoring settings; rebuilding it from this input.\n", path);
+    state_free(st);
+    if (!state_init(st)) {
+      fprintf(stderr, "Failed to allocate state.\n");
+      return 0;
+    }
+    loaded = 0;
+  }
+  if (!loaded) {
+    st->as_of_day = ctx->as_of_day;
+    st->config_hash = config_hash;
+  }
+  state_shift_as_of(st, ctx);
+  return 1;
+}
+
+/* The --state ingest: folds each valid row into the state, retires rows a
+   full input dropped, then hands the cohort accumulators, valid-row
+   counters and a top-K rebuilt from the records to ctx. Parse-time
+   counters (invalid rows and their breakdown) describe this input only. */
+static int score_incremental(InputReader *in, ScholarState *st, ScoreContext *ctx, int clamp_ranges, int delta) {
+  RunTotals *t = ctx->totals;
+  if (st->count > 0) memset(st->seen, 0, (size_t)st->count);
+  st->cursor = 0;
+  StrView line;
+  StrView fields[6];
+  int field_count = 0;
+  int line_num = 0;
+  while (input_next_row(in, &line, fields, &field_count)) {
+    if (++line_num == 1) continue;
+    t->data_rows++;
+    ScholarRow row;
+    if (!parse_scholar_fields(fields, field_count, &row, t, clamp_ranges)) continue;
+    row.offset = in->line_offset;
+    if (!row.valid) {
+      t->invalid_rows++;
+      continue;
+    }
+    if (!context_wants(ctx, row.cohort)) continue;
+    int day = 0;
+    if (!date_cache_parse(ctx->dates, row.last_touchpoint, &day)) {
+      t->invalid_rows++;
+      t->invalid_date_format++;
+      continue;
+    }
+    if (!state_apply_row(st, &row, day, ctx)) return 0;
+  }
+
+  if (!delta && !state_retire_unseen(st, ctx)) return 0;
+  if (!state_compact_cohorts(st)) return 0;
+  if (!cohort_table_merge(ctx->cohorts, &st->cohorts)) return 0;
+  run_totals_merge(t, &st->totals);
+  for (int i = 0; i < st->count; i++) {
+    const StateRecord *r = &st->records[i];
+    int days_since = 0;
+    int score = 0;
+    int tier = 0;
+    int counts[KC_COUNT] = {0};
+    state_score(r, ctx->as_of_day, ctx, &days_since, &score, &tier, counts);
+    const CohortStats *c = &st->cohorts.entries[r->cohort];
+    StrView cohort = {c->name, c->name_len};
+    /* Sketches are not saved; they are rebuilt from the records. */
+    if (ctx->cohorts->sketched) {
+      int idx = find_or_add_cohort(ctx->cohorts, cohort);
+      if (idx < 0) return 0;
+      sketch_add(ctx->cohorts->entries[idx].sketch, r->attendance, r->satisfaction, r->touchpoints, days_since);
+    }
+    account_row(ctx, NULL, score, tier, days_since, r->touchpoints, r->attendance, r->satisfaction,
+                state_record_id(st, r), cohort, (size_t)r->offset);
+  }
+  return 1;
+}
+
+/* --cache: the validated columns of one input file, written after a parse
+   and memory-mapped by later runs so they skip the CSV entirely. A cache
+   matches its source by size and mtime; when only the mtime moved, the
+   content hash decides. Parse-time counters are stored with the columns;
+   date-format and future-date counts come from scoring and are recomputed,
+   so one cache serves any --as-of, --cohort or scoring profile. Sections
+   start on 64-byte boundaries. */
+#define CACHE_MAGIC "GSCACHE1"
+#define CACHE_VERSION 3
+#define CACHE_ALIGN 64
+#define CACHE_BYTE_ORDER 0x01020304u
+
+enum {
+  CACHE_TOUCHPOINTS,
+  CACHE_ATTENDANCE,
+  CACHE_SATISFACTION,
+  CACHE_DAYS,
+  CACHE_COHORT_IDS,
+  CACHE_STATE,
+  CACHE_ID_OFFSETS,
+  CACHE_ID_LENS,
+  CACHE_OFFSETS,
+  CACHE_ARENA,
+  CACHE_NAMES,
+  CACHE_SECTIONS
+};
+
+
+/* The names section holds name_count (uint32 length, bytes) pairs in
+   interning order. */
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t source_size;
+  int64_t source_mtime_sec;
+  int64_t source_mtime_nsec;
+  uint64_t source_hash;
+  int32_t clamp_ranges;
+  int32_t row_count;
+  int32_t name_count;
+  int32_t reserved;
+  uint64_t file_len;
+  RunTotals totals;
+  uint64_t section_offset[CACHE_SECTIONS];
+  uint64_t section_len[CACHE_SECTIONS];
+} CacheHeader;
+
+/* Word-at-a-time content hash; it guards against a reused mtime, not
+   against tampering. */
+static uint64_t cache_content_hash(const char *data, size_t len) {
+  uint64_t h = 0x9E3779B97F4A7C15ull ^ (uint64_t)len;
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t w;
+    memcpy(&w, data + i, 8);
+    h = (h ^ w) * 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 31;
+  }
+  uint64_t tail = 0;
+  if (i < len) memcpy(&tail, data + i, len - i);
+  h = (h ^ tail) * 0x94D049BB133111EBull;
+  return h ^ (h >> 29);
+}
+
+int cache_source_key(const InputReader *in, CacheKey *key) {
+  struct stat st;
+  if (fstat(in->fd, &st) != 0 || !S_ISREG(st.st_mode)) return 0;
+  memset(key, 0, sizeof(CacheKey));
+  key->size = (uint64_t)st.st_size;
+  key->mtime_sec = (int64_t)st.st_mtim.tv_sec;
+  key->mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+  return 1;
+}
+
+static uint64_t cache_key_hash(CacheKey *key, const InputReader *in) {
+  if (!key->hashed) {
+    const char *data = in->map ? in->map : in->packed_map;
+    size_t len = in->map ? in->map_len : in->packed_len;
+    key->hash = cache_content_hash(data ? data : "", len);
+    key->hashed = 1;
+  }
+  return key->hash;
+}
+
+/* Element size of each column section; the arena and names are bytes. */
+static size_t cache_section_elem(int section) {
+  switch (section) {
+    case CACHE_ATTENDANCE:
+    case CACHE_SATISFACTION:
+      return sizeof(double);
+    case CACHE_TOUCHPOINTS:
+    case CACHE_DAYS:
+    case CACHE_COHORT_IDS:
+      return sizeof(int);
+    case CACHE_ID_LENS:
+      return sizeof(uint32_t);
+    case CACHE_ID_OFFSETS:
+    case CACHE_OFFSETS:
+      return sizeof(size_t);
+    default:
+      return 1;
+  }
+}
+
+/* Maps the cache at path into the empty *cols and *totals when it was built
+   from the file behind `in` with the same --clamp-ranges. Returns 1 on a
+   hit, 0 when the cache is missing or describes another input, -1 when it
+   is damaged (cols is left empty again) and -2 when that reset failed. */
+static int cache_load(const char *path, CacheKey *key, const InputReader *in, int clamp_ranges,
+                      ScholarColumns *cols, RunTotals *totals) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return errno == ENOENT ? 0 : -1;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CacheHeader)) {
+    close(fd);
+    return -1;
+  }
+  size_t len = (size_t)st.st_size;
+  void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return -1;
+
+  CacheHeader h;
+  memcpy(&h, map, sizeof(CacheHeader));
+  if (memcmp(h.magic, CACHE_MAGIC, 8) != 0 || h.version != CACHE_VERSION || h.byte_order != CACHE_BYTE_ORDER ||
+      h.file_len != len || h.row_count < 0 || h.name_count < 0) {
+    munmap(map, len);
+    return -1;
+  }
+  if (h.clamp_ranges != clamp_ranges || h.source_size != key->size ||
+      ((h.source_mtime_sec != key->mtime_sec || h.source_mtime_nsec != key->mtime_nsec) &&
+       h.source_hash != cache_key_hash(key, in))) {
+    munmap(map, len);
+    return 0;
+  }
+
+  const char *base = (const char *)map;
+  int ok = 1;
+  for (int i = 0; ok && i < CACHE_SECTIONS; i++) {
+    uint64_t off = h.section_offset[i];
+    uint64_t n = h.section_len[i];
+    ok = off % CACHE_ALIGN == 0 && off <= len && n <= len - off;
+    if (ok && i < CACHE_ARENA) ok = n == (uint64_t)h.row_count * cache_section_elem(i);
+  }
+  const char *names = base + (ok ? h.section_offset[CACHE_NAMES] : 0);
+  uint64_t names_left = ok ? h.section_len[CACHE_NAMES] : 0;
+  for (int i = 0; ok && i < h.name_count; i++) {
+    uint32_t name_len = 0;
+    ok = names_left >= sizeof(uint32_t);
+    if (ok) memcpy(&name_len, names, sizeof(uint32_t));
+    ok = ok && names_left - sizeof(uint32_t) >= name_len;
+    StrView name = {names + sizeof(uint32_t), name_len};
+    ok = ok && find_or_add_cohort(&cols->names, name) == i;
+    names += sizeof(uint32_t) + name_len;
+    names_left -= ok ? sizeof(uint32_t) + name_len : 0;
+  }
+  cols->mapped = map;
+  cols->mapped_len = len;
+  if (!ok) {
+    columns_free(cols);
+    return columns_init(cols) ? -1 : -2;
+  }
+
+  cols->touchpoints = (int *)(base + h.section_offset[CACHE_TOUCHPOINTS]);
+  cols->attendance = (double *)(base + h.section_offset[CACHE_ATTENDANCE]);
+  cols->satisfaction = (double *)(base + h.section_offset[CACHE_SATISFACTION]);
+  cols->days = (int *)(base + h.section_offset[CACHE_DAYS]);
+  cols->cohort_ids = (int *)(base + h.section_offset[CACHE_COHORT_IDS]);
+  cols->state = (unsigned char *)(base + h.section_offset[CACHE_STATE]);
+  cols->id_offsets = (size_t *)(base + h.section_offset[CACHE_ID_OFFSETS]);
+  cols->id_lens = (uint32_t *)(base + h.section_offset[CACHE_ID_LENS]);
+  cols->offsets = (size_t *)(base + h.section_offset[CACHE_OFFSETS]);
+  cols->arena = (char *)(base + h.section_offset[CACHE_ARENA]);
+  cols->arena_len = (size_t)h.section_len[CACHE_ARENA];
+  cols->count = h.row_count;
+  cols->capacity = h.row_count;
+  for (int i = 0; ok && i < cols->count; i++) {
+    if (cols->state[i] == ROW_INVALID) continue;
+    ok = cols->state[i] <= ROW_BAD_DATE && cols->cohort_ids[i] >= 0 && cols->cohort_ids[i] < h.name_count &&
+         cols->id_offsets[i] <= cols->arena_len && cols->id_lens[i] < cols->arena_len - cols->id_offsets[i];
+  }
+  if (!ok) {
+    columns_free(cols);
+    return columns_init(cols) ? -1 : -2;
+  }
+  *totals = h.totals;
+  return 1;
+}
+
+static int cache_write_section(FILE *fp, const void *data, uint64_t len, uint64_t *pos) {
+  static const char zeros[CACHE_ALIGN];
+  size_t pad = (size_t)((CACHE_ALIGN - *pos % CACHE_ALIGN) % CACHE_ALIGN);
+  if (fwrite(zeros, 1, pad, fp) != pad || fwrite(data, 1, (size_t)len, fp) != (size_t)len) return 0;
+  *pos += pad + len;
+  return 1;
+}
+
+static uint64_t cache_align(uint64_t pos) {
+  return (pos + CACHE_ALIGN - 1) / CACHE_ALIGN * CACHE_ALIGN;
+}
+
+/* Writes the parsed columns and parse-time counters next to path and
+   renames them into place. */
+static int cache_save(const char *path, CacheKey *key, const InputReader *in, int clamp_ranges,
+                      const ScholarColumns *cols, const RunTotals *totals) {
+  uint64_t names_len = 0;
+  for (int i = 0; i < cols->names.count; i++) names_len += sizeof(uint32_t) + cols->names.entries[i].name_len;
+  char *names = (char *)malloc(names_len > 0 ? (size_t)names_len : 1);
+  if (!names) return 0;
+  char *w = names;
+  for (int i = 0; i < cols->names.count; i++) {
+    uint32_t name_len = (uint32_t)cols->names.entries[i].name_len;
+    memcpy(w, &name_len, sizeof(uint32_t));
+    memcpy(w + sizeof(uint32_t), cols->names.entries[i].name, name_len);
+    w += sizeof(uint32_t) + name_len;
+  }
+
+  const void *data[CACHE_SECTIONS] = {cols->touchpoints, cols->attendance, cols->satisfaction, cols->days,
+                                      cols->cohort_ids, cols->state, cols->id_offsets, cols->id_lens,
+                                      cols->offsets, cols->arena, names};
+  CacheHeader h;
+  memset(&h, 0, sizeof(CacheHeader));
+  memcpy(h.magic, CACHE_MAGIC, 8);
+  h.version = CACHE_VERSION;
+  h.byte_order = CACHE_BYTE_ORDER;
+  h.source_size = key->size;
+  h.source_mtime_sec = key->mtime_sec;
+  h.source_mtime_nsec = key->mtime_nsec;
+  h.source_hash = cache_key_hash(key, in);
+  h.clamp_ranges = clamp_ranges;
+  h.row_count = cols->count;
+  h.name_count = cols->names.count;
+  h.totals = *totals;
+  uint64_t pos = sizeof(CacheHeader);
+  for (int i = 0; i < CACHE_SECTIONS; i++) {
+    h.section_len[i] = i == CACHE_ARENA ? cols->arena_len
+                       : i == CACHE_NAMES ? names_len
+                                          : (uint64_t)cols->count * cache_section_elem(i);
+    h.section_offset[i] = cache_align(pos);
+    pos = h.section_offset[i] + h.section_len[i];
+  }
+  h.file_len = pos;
+
+  size_t path_len = strlen(path);
+  char *tmp = (char *)malloc(path_len + 5);
+  FILE *fp = NULL;
+  if (tmp) {
+    memcpy(tmp, path, path_len);
+    memcpy(tmp + path_len, ".tmp", 5);
+    fp = fopen(tmp, "wb");
+  }
+  int ok = fp && fwrite(&h, sizeof(CacheHeader), 1, fp) == 1;
+  pos = sizeof(CacheHeader);
+  for (int i = 0; ok && i < CACHE_SECTIONS; i++) {
+    ok = cache_write_section(fp, data[i] ? data[i] : "", h.section_len[i], &pos);
+  }
+  if (fp) ok = fclose(fp) == 0 && ok;
+  ok = ok && rename(tmp, path) == 0;
+  if (!ok && fp) remove(tmp);
+  free(tmp);
+  free(names);
+  return ok;
+}
+
+/* Fills the empty cols and the parse-time counters from `in`, through the
+   --cache file when cache_path is set. Returns 1 on a cache hit, 0 after a
+   parse, -1 on failure (already reported). */
+int load_columns(InputReader *in, const char *cache_path, int clamp_ranges, ScholarColumns *cols,
+                 RunTotals *t, DateCache *dates) {
+  CacheKey key;
+  if (cache_path) {
+    if (!cache_source_key(in, &key)) {
+      fprintf(stderr, "--cache needs a regular --input file.\n");
+      return -1;
+    }
+    int hit = cache_load(cache_path, &key, in, clamp_ranges, cols, t);
+    if (hit == 1) return 1;
+    if (hit == -1) fprintf(stderr, "Cache file %s is unreadable; rebuilding it from this input.\n", cache_path);
+    if (hit == -2) {
+      fprintf(stderr, "Failed to allocate scholar buffer.\n");
+      return -1;
+    }
+  }
+  if (!parse_columns(in, cols, t, dates, clamp_ranges)) {
+    fprintf(stderr, "Failed to expand scholar buffer.\n");
+    return -1;
+  }
+  if (in->error) {
+    fprintf(stderr, "Failed to read input file: %s.\n", in->error);
+    return -1;
+  }
+  if (cache_path && !cache_save(cache_path, &key, in, clamp_ranges, cols, t)) perror("Failed to write cache file");
+  return 0;
+}
+
+/* Report output. Writers append into one reusable buffer that goes to the
+   descriptor in a single write() each time it fills, and once at the end.
+   Numbers are formatted here rather than by printf; out_fixed() produces
+   exactly what "%.Nf" would. */
+#define OUT_BUFFER (1 << 18)
+
+
+int out_init(OutBuf *o, int fd) {
+  memset(o, 0, sizeof(OutBuf));
+  o->fd = fd;
+  o->buf = (char *)malloc(OUT_BUFFER);
+  o->cap = o->buf ? OUT_BUFFER : 0;
+  return o->buf != NULL;
+}
+
+static int out_write_all(OutBuf *o, const char *p, size_t n) {
+  if (o->sink) {
+    if (n > 0 && !o->failed && !o->sink(o->sink_ctx, p, n)) o->failed = 1;
+    return !o->failed;
+  }
+  while (n > 0 && !o->failed) {
+    ssize_t w = write(o->fd, p, n);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) {
+      o->failed = 1;
+      break;
+    }
+    p += w;
+    n -= (size_t)w;
+  }
+  return !o->failed;
+}
+
+int out_flush(OutBuf *o) {
+  int ok = out_write_all(o, o->buf, o->len);
+  o->len = 0;
+  return ok;
+}
+
+/* Flushes, then closes the descriptor unless it is stdout or stderr.
+   Returns 0 when any write failed. */
+int out_close(OutBuf *o) {
+  int ok = out_flush(o);
+  if (o->fd > STDERR_FILENO && close(o->fd) != 0) ok = 0;
+  free(o->buf);
+  memset(o, 0, sizeof(OutBuf));
+  return ok;
+}
+
+/* Opens path for writing the way fopen(path, "w") would. */
+int out_open(OutBuf *o, const char *path) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) return 0;
+  if (!out_init(o, fd)) {
+    close(fd);
+    errno = ENOMEM;
+    return 0;
+  }
+  return 1;
+}
+
+static inline char *out_reserve(OutBuf *o, size_t n) {
+  if (o->cap - o->len < n) out_flush(o);
+  return o->buf + o->len;
+}
+
+void out_bytes(OutBuf *o, const char *p, size_t n) {
+  if (n > o->cap / 2) {
+    out_flush(o);
+    out_write_all(o, p, n);
+    return;
+  }
+  memcpy(out_reserve(o, n), p, n);
+  o->len += n;
+}
+
+void out_str(OutBuf *o, const char *s) {
+  out_bytes(o, s, strlen(s));
+}
+
+void out_char(OutBuf *o, char c) {
+  *out_reserve(o, 1) = c;
+  o->len++;
+}
+
+void out_int(OutBuf *o, long long v) {
+  char digits[24];
+  int n = 0;
+  unsigned long long u = v < 0 ? 0ull - (unsigned long long)v : (unsigned long long)v;
+  do {
+    digits[n++] = (char)('0' + u % 10);
+    u /= 10;
+  } while (u);
+  char *w = out_reserve(o, (size_t)n + 1);
+  if (v < 0) *w++ = '-';
+  while (n > 0) *w++ = digits[--n];
+  o->len = (size_t)(w - o->buf);
+}
+
+void out_printf(OutBuf *o, const char *fmt, ...) {
+  char line[512];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(line, sizeof(line), fmt, args);
+  va_end(args);
+  if (n < 0) return;
+  if ((size_t)n < sizeof(line)) {
+    out_bytes(o, line, (size_t)n);
+    return;
+  }
+  char *big = (char *)malloc((size_t)n + 1);
+  if (!big) {
+    o->failed = 1;
+    return;
+  }
+  va_start(args, fmt);
+  vsnprintf(big, (size_t)n + 1, fmt, args);
+  va_end(args);
+  out_bytes(o, big, (size_t)n);
+  free(big);
+}
+
+/* Error term of a * b: a * b == p + the result exactly (Dekker's product,
+   valid while nothing overflows). */
+static double two_product_err(double a, double b, double p) {
+  const double split = 134217729.0;
+  double t = split * a;
+  double ah = t - (t - a);
+  double al = a - ah;
+  t = split * b;
+  double bh = t - (t - b);
+  double bl = b - bh;
+  return ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+}
+
+/* Appends v with `decimals` (0-9) digits after the point, matching
+   printf("%.*f"): the exact binary value rounds half to even. |v| * 10^N is
+   kept as an exact sum prod + err, so the rounding decision needs no long
+   arithmetic. Huge or non-finite values fall back to snprintf. */
+void out_fixed(OutBuf *o, double v, int decimals) {
+  static const double k_pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+  static const uint64_t k_upow10[] = {1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+                                      10000000ull, 100000000ull, 1000000000ull};
+  uint64_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  int negative = (int)(bits >> 63);
+  double a = negative ? -v : v;
+  double scale = k_pow10[decimals];
+#if FLT_EVAL_METHOD == 0
+  int fast = a < 4503599627370496.0 / scale;
+#else
+  int fast = 0;
+#endif
+  if (!fast) {
+    out_printf(o, "%.*f", decimals, v);
+    return;
+  }
+  double prod = a * scale;
+  double err = two_product_err(a, scale, prod);
+  uint64_t n = (uint64_t)prod;
+  double half = (prod - (double)n) - 0.5;
+  n += half > 0 || (half == 0 && (err > 0 || (err == 0 && (n & 1))));
+  uint64_t whole = n / k_upow10[decimals];
+  uint64_t frac = n % k_upow10[decimals];
+
+  char digits[40];
+  int len = 0;
+  for (int i = 0; i < decimals; i++) {
+    digits[len++] = (char)('0' + frac % 10);
+    frac /= 10;
+  }
+  if (decimals > 0) digits[len++] = '.';
+  do {
+    digits[len++] = (char)('0' + whole % 10);
+    whole /= 10;
+  } while (whole);
+  char *w = out_reserve(o, (size_t)len + 1);
+  if (negative) *w++ = '-';
+  while (len > 0) *w++ = digits[--len];
+  o->len = (size_t)(w - o->buf);
+}
+
+/* Appends s as a quoted JSON string. */
+void out_json_str(OutBuf *o, const char *s) {
+  static const char hex[] = "0123456789abcdef";
+  out_char(o, '"');
+  const char *run = s;
+  for (const char *p = s; *p; p++) {
+    unsigned char c = (unsigned char)*p;
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    out_bytes(o, run, (size_t)(p - run));
+    run = p + 1;
+    char esc[6] = {'\\', 0, 0, 0, 0, 0};
+    size_t n = 2;
+    switch (c) {
+      case '"': esc[1] = '"'; break;
+      case '\\': esc[1] = '\\'; break;
+      case '\n': esc[1] = 'n'; break;
+      case '\r': esc[1] = 'r'; break;
+      case '\t': esc[1] = 't'; break;
+      case '\b': esc[1] = 'b'; break;
+      case '\f': esc[1] = 'f'; break;
+      default:
+        esc[1] = 'u';
+        esc[2] = '0';
+        esc[3] = '0';
+        esc[4] = hex[c >> 4];
+        esc[5] = hex[c & 15];
+        n = 6;
+        break;
+    }
+    out_bytes(o, esc, n);
+  }
+  out_bytes(o, run, strlen(run));
+  out_char(o, '"');
+}
+
+/* Appends s as a CSV field, quoted only when it holds a quote, comma or
+   line break. */
+void out_csv_str(OutBuf *o, const char *s) {
+  if (!strpbrk(s, "\",\r\n")) {
+    out_str(o, s);
+    return;
+  }
+  out_char(o, '"');
+  for (const char *p = s; *p; p++) {
+    if (*p == '"') out_char(o, '"');
+    out_char(o, *p);
+  }
+  out_char(o, '"');
+}
+
+/* --scored-out: every scored row as an Arrow IPC stream, the format
+   pyarrow.ipc.open_stream() and other Arrow readers load column by column.
+   The file is a schema message, one record batch per SCORED_BATCH rows
+   written as soon as it fills, and the end-of-stream marker, so memory
+   stays at one batch however large the input. Message metadata is a
+   flatbuffer, built back to front like the flatbuffers library does; it
+   is little-endian on every host, while column buffers use host order and
+   the schema records which. */
+#define SCORED_BATCH 65536
+#define SCORED_COLUMNS 8
+#define SCORED_BUFFERS 19
+#define FB_MAX_FIELDS 8
+
+typedef struct {
+  unsigned char *buf;
+  size_t cap;
+  size_t size;
+  size_t minalign;
+  size_t table_start;
+  size_t fields[FB_MAX_FIELDS];
+  int failed;
+} FbBuilder;
+
+static void fb_reset(FbBuilder *b) {
+  b->size = 0;
+  b->minalign = 1;
+  b->failed = 0;
+}
+
+/* Bytes are written at buf + cap - size, so growing moves the used tail. */
+static unsigned char *fb_push(FbBuilder *b, size_t n) {
+  if (b->cap - b->size < n) {
+    size_t cap = b->cap ? b->cap : 1024;
+    while (cap - b->size < n) cap *= 2;
+    unsigned char *grown = (unsigned char *)malloc(cap);
+    if (!grown) {
+      b->failed = 1;
+      return NULL;
+    }
+    if (b->size) memcpy(grown + cap - b->size, b->buf + b->cap - b->size, b->size);
+    free(b->buf);
+    b->buf = grown;
+    b->cap = cap;
+  }
+  b->size += n;
+  return b->buf + b->cap - b->size;
+}
+
+static void fb_push_le(FbBuilder *b, uint64_t v, size_t n) {
+  unsigned char *p = fb_push(b, n);
+  for (size_t i = 0; p && i < n; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+/* Pads so that `len` more bytes end on an `align` boundary. */
+static void fb_align(FbBuilder *b, size_t len, size_t align) {
+  if (align > b->minalign) b->minalign = align;
+  size_t pad = (align - (b->size + len) % align) % align;
+  unsigned char *p = pad ? fb_push(b, pad) : NULL;
+  if (p) memset(p, 0, pad);
+}
+
+static void fb_table_start(FbBuilder *b) {
+  b->table_start = b->size;
+  memset(b->fields, 0, sizeof(b->fields));
+}
+
+static void fb_add_scalar(FbBuilder *b, int field, uint64_t v, size_t n) {
+  fb_align(b, n, n);
+  fb_push_le(b, v, n);
+  b->fields[field] = b->size;
+}
+
+/* uoffsets count from their own position to a later object. */
+static void fb_push_offset(FbBuilder *b, size_t target) {
+  fb_align(b, 4, 4);
+  fb_push_le(b, (uint64_t)(b->size + 4 - target), 4);
+}
+
+static void fb_add_offset(FbBuilder *b, int field, size_t target) {
+  fb_push_offset(b, target);
+  b->fields[field] = b->size;
+}
+
+/* Writes the table's vtable in front of it. Absent fields have offset 0. */
+static size_t fb_table_end(FbBuilder *b) {
+  fb_align(b, 4, 4);
+  fb_push_le(b, 0, 4);
+  size_t table = b->size;
+  int used = 0;
+  for (int i = 0; i < FB_MAX_FIELDS; i++) {
+    if (b->fields[i]) used = i + 1;
+  }
+  for (int i = used - 1; i >= 0; i--) fb_push_le(b, b->fields[i] ? table - b->fields[i] : 0, 2);
+  fb_push_le(b, table - b->table_start, 2);
+  fb_push_le(b, 4 + 2 * (uint64_t)used, 2);
+  if (!b->failed) {
+    unsigned char *soffset = b->buf + b->cap - table;
+    uint32_t distance = (uint32_t)(b->size - table);
+    for (int i = 0; i < 4; i++) soffset[i] = (unsigned char)(distance >> (8 * i));
+  }
+  return table;
+}
+
+static size_t fb_string(FbBuilder *b, const char *s) {
+  size_t len = strlen(s);
+  fb_align(b, len + 1, 4);
+  unsigned char *p = fb_push(b, len + 1);
+  if (p) {
+    memcpy(p, s, len);
+    p[len] = 0;
+  }
+  fb_push_le(b, len, 4);
+  return b->size;
+}
+
+/* Vector of structs made of int64 pairs (FieldNode, Buffer). */
+static size_t fb_pair_vector(FbBuilder *b, const int64_t (*pairs)[2], int count) {
+  fb_align(b, (size_t)count * 16, 8);
+  for (int i = count - 1; i >= 0; i--) {
+    fb_push_le(b, (uint64_t)pairs[i][1], 8);
+    fb_push_le(b, (uint64_t)pairs[i][0], 8);
+  }
+  fb_push_le(b, (uint64_t)count, 4);
+  return b->size;
+}
+
+static size_t fb_offset_vector(FbBuilder *b, const size_t *targets, int count) {
+  fb_align(b, (size_t)count * 4 + 4, 4);
+  for (int i = count - 1; i >= 0; i--) fb_push_offset(b, targets[i]);
+  fb_push_le(b, (uint64_t)count, 4);
+  return b->size;
+}
+
+/* Adds the root offset; the finished buffer is the last b->size bytes. */
+static const unsigned char *fb_finish(FbBuilder *b, size_t root) {
+  fb_align(b, 4, b->minalign);
+  fb_push_offset(b, root);
+  return b->failed ? NULL : b->buf + b->cap - b->size;
+}
+
+enum {
+  ARROW_TYPE_INT = 2,
+  ARROW_TYPE_FLOAT = 3,
+  ARROW_TYPE_UTF8 = 5,
+  ARROW_HEADER_SCHEMA = 1,
+  ARROW_HEADER_RECORD_BATCH = 3,
+  ARROW_METADATA_V5 = 4
+};
+
+static const char *const k_scored_names[SCORED_COLUMNS] = {
+  "scholar_id", "cohort", "risk_score", "tier", "days_since", "touchpoints_30d", "attendance_rate",
+  "satisfaction_score"
+};
+static const unsigned char k_scored_types[SCORED_COLUMNS] = {
+  ARROW_TYPE_UTF8, ARROW_TYPE_UTF8, ARROW_TYPE_INT, ARROW_TYPE_UTF8, ARROW_TYPE_INT, ARROW_TYPE_INT,
+  ARROW_TYPE_FLOAT, ARROW_TYPE_FLOAT
+};
+static const char *const k_tier_names[3] = {"low", "medium", "high"};
+
+/* Text column of the current batch: Arrow offsets plus the bytes. */
+typedef struct {
+  int32_t *offsets;
+  char *data;
+  size_t len;
+  size_t cap;
+} ScoredText;
+
+struct ScoredOut {
+  OutBuf out;
+  FbBuilder fb;
+  int count;
+  long long rows;
+  int batches;
+  int failed;
+  ScoredText text[3];
+  int32_t *ints[3];
+  double *doubles[2];
+  unsigned char *tiers;
+};
+
+enum { SCORED_ID, SCORED_COHORT, SCORED_TIER };
+enum { SCORED_SCORE, SCORED_DAYS, SCORED_TOUCHPOINTS };
+
+/* Frames one message: continuation marker, padded metadata length, the
+   flatbuffer, then the body written by the caller. */
+static void scored_write_metadata(ScoredOut *s, const unsigned char *meta, size_t len) {
+  static const char zeros[8] = {0};
+  size_t padded = (len + 7) / 8 * 8;
+  unsigned char prefix[8] = {0xff, 0xff, 0xff, 0xff};
+  for (int i = 0; i < 4; i++) prefix[4 + i] = (unsigned char)((uint32_t)padded >> (8 * i));
+  out_bytes(&s->out, (const char *)prefix, 8);
+  out_bytes(&s->out, (const char *)meta, len);
+  out_bytes(&s->out, zeros, padded - len);
+}
+
+static size_t scored_message(FbBuilder *b, int header_type, size_t header, int64_t body_len) {
+  fb_table_start(b);
+  fb_add_scalar(b, 3, (uint64_t)body_len, 8);
+  fb_add_offset(b, 2, header);
+  fb_add_scalar(b, 0, ARROW_METADATA_V5, 2);
+  fb_add_scalar(b, 1, (uint64_t)header_type, 1);
+  return fb_table_end(b);
+}
+
+static int scored_write_schema(ScoredOut *s) {
+  FbBuilder *b = &s->fb;
+  fb_reset(b);
+  size_t fields[SCORED_COLUMNS];
+  for (int i = SCORED_COLUMNS - 1; i >= 0; i--) {
+    fb_table_start(b);
+    if (k_scored_types[i] == ARROW_TYPE_INT) {
+      fb_add_scalar(b, 0, 32, 4);
+      fb_add_scalar(b, 1, 1, 1);
+    } else if (k_scored_types[i] == ARROW_TYPE_FLOAT) {
+      fb_add_scalar(b, 0, 2, 2);
+    }
+    size_t type = fb_table_end(b);
+    size_t name = fb_string(b, k_scored_names[i]);
+    size_t children = fb_offset_vector(b, NULL, 0);
+    fb_table_start(b);
+    fb_add_offset(b, 0, name);
+    fb_add_offset(b, 3, type);
+    fb_add_offset(b, 5, children);
+    fb_add_scalar(b, 1, 0, 1);
+    fb_add_scalar(b, 2, k_scored_types[i], 1);
+    fields[i] = fb_table_end(b);
+  }
+  size_t field_vector = fb_offset_vector(b, fields, SCORED_COLUMNS);
+  fb_table_start(b);
+  fb_add_offset(b, 1, field_vector);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  fb_add_scalar(b, 0, 1, 2);
+#else
+  fb_add_scalar(b, 0, 0, 2);
+#endif
+  size_t schema = fb_table_end(b);
+  const unsigned char *meta = fb_finish(b, scored_message(b, ARROW_HEADER_SCHEMA, schema, 0));
+  if (!meta) return 0;
+  scored_write_metadata(s, meta, b->size);
+  return 1;
+}
+
+/* Writes the pending rows as one record batch. Every buffer starts on an
+   8-byte boundary of the body; validity bitmaps are empty (no nulls). */
+static int scored_flush_batch(ScoredOut *s) {
+  static const char zeros[8] = {0};
+  if (s->count == 0 || s->failed) return !s->failed;
+  int n = s->count;
+  ScoredText *tier = &s->text[SCORED_TIER];
+  tier->len = 0;
+  for (int i = 0; i < n; i++) {
+    const char *name = k_tier_names[s->tiers[i]];
+    size_t len = strlen(name);
+    memcpy(tier->data + tier->len, name, len);
+    tier->len += len;
+    tier->offsets[i + 1] = (int32_t)tier->len;
+  }
+
+  const void *data[SCORED_BUFFERS];
+  int64_t buffers[SCORED_BUFFERS][2];
+  int64_t nodes[SCORED_COLUMNS][2];
+  int nb = 0;
+  int64_t body = 0;
+  for (int c = 0; c < SCORED_COLUMNS; c++) {
+    nodes[c][0] = n;
+    nodes[c][1] = 0;
+    const void *parts[2];
+    size_t sizes[2];
+    int count = 1;
+    if (k_scored_types[c] == ARROW_TYPE_UTF8) {
+      const ScoredText *t = &s->text[c == 0 ? SCORED_ID : c == 1 ? SCORED_COHORT : SCORED_TIER];
+      parts[0] = t->offsets;
+      sizes[0] = sizeof(int32_t) * (size_t)(n + 1);
+      parts[1] = t->data;
+      sizes[1] = t->len;
+      count = 2;
+    } else if (k_scored_types[c] == ARROW_TYPE_INT) {
+      parts[0] = s->ints[c == 2 ? SCORED_SCORE : c == 4 ? SCORED_DAYS : SCORED_TOUCHPOINTS];
+      sizes[0] = sizeof(int32_t) * (size_t)n;
+    } else {
+      parts[0] = s->doubles[c - 6];
+      sizes[0] = sizeof(double) * (size_t)n;
+    }
+    data[nb] = NULL;
+    buffers[nb][0] = body;
+    buffers[nb++][1] = 0;
+    for (int p = 0; p < count; p++) {
+      data[nb] = parts[p];
+      buffers[nb][0] = body;
+      buffers[nb++][1] = (int64_t)sizes[p];
+      body += (int64_t)((sizes[p] + 7) / 8 * 8);
+    }
+  }
+
+  FbBuilder *b = &s->fb;
+  fb_reset(b);
+  size_t buffer_vector = fb_pair_vector(b, (const int64_t (*)[2])buffers, nb);
+  size_t node_vector = fb_pair_vector(b, (const int64_t (*)[2])nodes, SCORED_COLUMNS);
+  fb_table_start(b);
+  fb_add_scalar(b, 0, (uint64_t)n, 8);
+  fb_add_offset(b, 1, node_vector);
+  fb_add_offset(b, 2, buffer_vector);
+  size_t batch = fb_table_end(b);
+  const unsigned char *meta = fb_finish(b, scored_message(b, ARROW_HEADER_RECORD_BATCH, batch, body));
+  if (!meta) return 0;
+  scored_write_metadata(s, meta, b->size);
+  for (int i = 0; i < nb; i++) {
+    size_t len = (size_t)buffers[i][1];
+    if (!data[i]) continue;
+    out_bytes(&s->out, (const char *)data[i], len);
+    out_bytes(&s->out, zeros, (8 - len % 8) % 8);
+  }
+
+  s->batches++;
+  s->count = 0;
+  for (int t = 0; t < 3; t++) s->text[t].len = 0;
+  return !s->out.failed;
+}
+
+static void scored_out_free(ScoredOut *s) {
+  for (int t = 0; t < 3; t++) {
+    free(s->text[t].offsets);
+    free(s->text[t].data);
+  }
+  for (int i = 0; i < 3; i++) free(s->ints[i]);
+  for (int i = 0; i < 2; i++) free(s->doubles[i]);
+  free(s->tiers);
+  free(s->fb.buf);
+}
+
+/* Creates path and writes the schema. Returns NULL with errno set. */
+static ScoredOut *scored_out_open(const char *path) {
+  ScoredOut *s = (ScoredOut *)calloc(1, sizeof(ScoredOut));
+  if (!s) return NULL;
+  int ok = 1;
+  for (int t = 0; t < 3; t++) {
+    s->text[t].offsets = (int32_t *)calloc(SCORED_BATCH + 1, sizeof(int32_t));
+    ok = ok && s->text[t].offsets;
+  }
+  for (int i = 0; i < 3; i++) ok = ok && (s->ints[i] = (int32_t *)malloc(sizeof(int32_t) * SCORED_BATCH));
+  for (int i = 0; i < 2; i++) ok = ok && (s->doubles[i] = (double *)malloc(sizeof(double) * SCORED_BATCH));
+  ok = ok && (s->tiers = (unsigned char *)malloc(SCORED_BATCH));
+  ScoredText *tier = &s->text[SCORED_TIER];
+  ok = ok && (tier->data = (char *)malloc(SCORED_BATCH * 6));
+  if (!ok) {
+    scored_out_free(s);
+    free(s);
+    errno = ENOMEM;
+    return NULL;
+  }
+  tier->cap = SCORED_BATCH * 6;
+  if (!out_open(&s->out, path)) {
+    int saved = errno;
+    scored_out_free(s);
+    free(s);
+    errno = saved;
+    return NULL;
+  }
+  if (!scored_write_schema(s)) s->failed = 1;
+  return s;
+}
+
+static int scored_text_add(ScoredText *t, int row, StrView v) {
+  if (t->cap - t->len < v.len) {
+    size_t cap = t->cap ? t->cap : 1 << 16;
+    while (cap - t->len < v.len) cap *= 2;
+    char *grown = (char *)realloc(t->data, cap);
+    if (!grown) return 0;
+    t->data = grown;
+    t->cap = cap;
+  }
+  memcpy(t->data + t->len, v.ptr, v.len);
+  t->len += v.len;
+  t->offsets[row + 1] = (int32_t)t->len;
+  return 1;
+}
+
+static void scored_out_add(ScoredOut *s, StrView id, StrView cohort, int score, int tier, int days_since,
+                           int touchpoints, double attendance, double satisfaction) {
+  if (s->failed) return;
+  /* Offsets are int32, so a batch also ends before its text reaches 1 GB. */
+  if (s->text[SCORED_ID].len + id.len > (1u << 30) || s->text[SCORED_COHORT].len + cohort.len > (1u << 30)) {
+    if (!scored_flush_batch(s)) s->failed = 1;
+  }
+  int i = s->count;
+  if (!scored_text_add(&s->text[SCORED_ID], i, id) || !scored_text_add(&s->text[SCORED_COHORT], i, cohort)) {
+    s->failed = 1;
+    return;
+  }
+  s->ints[SCORED_SCORE][i] = score;
+  s->ints[SCORED_DAYS][i] = days_since;
+  s->ints[SCORED_TOUCHPOINTS][i] = touchpoints;
+  s->doubles[0][i] = attendance;
+  s->doubles[1][i] = satisfaction;
+  s->tiers[i] = (unsigned char)tier;
+  s->rows++;
+  if (++s->count == SCORED_BATCH && !scored_flush_batch(s)) s->failed = 1;
+}
+
+/* Writes the last batch and the end-of-stream marker, then frees s.
+   Returns 0 when anything failed to allocate or write. */
+static int scored_out_close(ScoredOut *s) {
+  static const unsigned char eos[8] = {0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0};
+  int ok = !s->failed && scored_flush_batch(s);
+  out_bytes(&s->out, (const char *)eos, sizeof(eos));
+  if (!out_close(&s->out)) ok = 0;
+  scored_out_free(s);
+  free(s);
+  return ok;
+}
+
+
+/* Returns the cohort summaries sorted by `sort` on up to `workers`
+   threads, or NULL when the allocation fails. */
+CohortSummary *build_cohort_summaries(const CohortTable *cohorts, CohortSort sort, int workers) {
+  int cohort_count = cohorts->count;
+  CohortSummary *summaries = (CohortSummary *)malloc(sizeof(CohortSummary) * (cohort_count > 0 ? cohort_count : 1));
+  if (!summaries) return NULL;
+  for (int i = 0; i < cohort_count; i++) {
+    const CohortStats *c = &cohorts->entries[i];
+    CohortSummary summary;
+    memset(&summary, 0, sizeof(CohortSummary));
+    summary.cohort = c->name;
+    summary.count = c->count;
+    summary.high = c->high;
+    summary.medium = c->medium;
+    summary.low = c->low;
+    summary.high_share = c->count ? (double)c->high / c->count : 0;
+    summary.risk_index = cohort_risk_index(c->high, c->medium, c->low);
+    summary.avg_touchpoints = c->count ? (double)c->touchpoints_sum / c->count : 0;
+    summary.avg_attendance = c->count ? fixed_sum_value(&c->attendance_sum) / c->count : 0;
+    summary.avg_satisfaction = c->count ? fixed_sum_value(&c->satisfaction_sum) / c->count : 0;
+    summary.avg_days = c->count ? (double)c->days_since_sum / c->count : 0;
+    summary.level = c->level;
+    for (int m = 0; c->sketch && m < SKETCH_METRICS; m++) {
+      for (int q = 0; q < SKETCH_QUANTILES; q++) {
+        summary.percentiles[m][q] = sketch_quantile(c->sketch, &k_sketch_metrics[m], k_sketch_percents[q]);
+      }
+    }
+    summaries[i] = summary;
+  }
+
+  if (cohort_count > 1) {
+    parallel_sort(summaries, (size_t)cohort_count, sizeof(CohortSummary), k_summary_order[sort], workers);
+  }
+  return summaries;
+}
+
+/* Collects cohorts at or above the alert threshold into a sorted array in
+   *out. Returns the alert count, or -1 when the allocation fails. */
+int build_alerts(const CohortSummary *summaries, int cohort_count, double alert_threshold,
+                 int min_cohort_size, CohortAlert **out) {
+  CohortAlert *alerts = (CohortAlert *)malloc(sizeof(CohortAlert) * (cohort_count > 0 ? cohort_count : 1));
+  if (!alerts) return -1;
+  int alert_count = 0;
+  for (int i = 0; i < cohort_count; i++) {
+    const CohortSummary *c = &summaries[i];
+    if (c->count < min_cohort_size) continue;
+    if (c->high_share < alert_threshold) continue;
+    CohortAlert alert;
+    memset(&alert, 0, sizeof(CohortAlert));
+    alert.cohort = c->cohort;
+    alert.count = c->count;
+    alert.high = c->high;
+    alert.medium = c->medium;
+    alert.low = c->low;
+    alert.high_ratio = c->high_share;
+    alert.risk_index = c->risk_index;
+    alert.avg_days = c->avg_days;
+    alert.avg_attendance = c->avg_attendance;
+    alert.avg_satisfaction = c->avg_satisfaction;
+    alert.level = c->level;
+    alerts[alert_count++] = alert;
+  }
+  if (alert_count > 1) {
+    qsort(alerts, alert_count, sizeof(CohortAlert), compare_alerts);
+  }
+  *out = alerts;
+  return alert_count;
+}
+
+/* Keeps the first `limit` summaries of each level (all of them when limit
+   is -1) at the front of the sorted array and returns how many that is.
+   Without rollups every summary is level 0, so this is min(limit, count). */
+int cohort_display_count(CohortSummary *summaries, int count, int limit) {
+  if (limit < 0) return count;
+  int kept = 0;
+  int run = 0;
+  for (int i = 0; i < count; i++) {
+    if (i > 0 && summaries[i].level != summaries[i - 1].level) run = 0;
+    if (run++ < limit) summaries[kept++] = summaries[i];
+  }
+  return kept;
+}
+
+/* Row tables of big reports are formatted in chunks of at least
+   OUT_PARALLEL_ROWS rows on up to r->workers threads, each into its own
+   memory buffer, and appended in order, so the bytes match a sequential
+   pass. A chunk that runs out of memory is rewritten directly. */
+#define OUT_PARALLEL_ROWS 16384
+#define OUT_MAX_CHUNKS 64
+
+typedef void (*RowWriter)(OutBuf *out, const Report *r, int from, int to);
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t cap;
+} OutMem;
+
+static int out_mem_put(void *ctx, const char *p, size_t n) {
+  OutMem *m = (OutMem *)ctx;
+  if (m->cap - m->len < n) {
+    size_t cap = m->cap ? m->cap : OUT_BUFFER;
+    while (cap - m->len < n) cap *= 2;
+    char *grown = (char *)realloc(m->data, cap);
+    if (!grown) return 0;
+    m->data = grown;
+    m->cap = cap;
+  }
+  memcpy(m->data + m->len, p, n);
+  m->len += n;
+  return 1;
+}
+
+typedef struct {
+  const Report *report;
+  RowWriter write;
+  int count;
+  int chunks;
+  OutBuf bufs[OUT_MAX_CHUNKS];
+  OutMem mems[OUT_MAX_CHUNKS];
+  atomic_int next;
+} OutPool;
+
+static void *out_pool_worker(void *arg) {
+  OutPool *pool = (OutPool *)arg;
+  for (;;) {
+    int c = atomic_fetch_add(&pool->next, 1);
+    if (c >= pool->chunks) break;
+    OutBuf *o = &pool->bufs[c];
+    if (!out_init(o, -1)) continue;
+    o->sink = out_mem_put;
+    o->sink_ctx = &pool->mems[c];
+    pool->write(o, pool->report, (int)((int64_t)pool->count * c / pool->chunks),
+                (int)((int64_t)pool->count * (c + 1) / pool->chunks));
+  }
+  return NULL;
+}
+
+static void out_rows(OutBuf *out, const Report *r, int count, RowWriter write) {
+  int chunks = r->workers < OUT_MAX_CHUNKS ? r->workers : OUT_MAX_CHUNKS;
+  if (chunks > count / OUT_PARALLEL_ROWS) chunks = count / OUT_PARALLEL_ROWS;
+  if (chunks < 2) {
+    write(out, r, 0, count);
+    return;
+  }
+  OutPool *pool = (OutPool *)calloc(1, sizeof(OutPool));
+  if (!pool) {
+    write(out, r, 0, count);
+    return;
+  }
+  pool->report = r;
+  pool->write = write;
+  pool->count = count;
+  pool->chunks = chunks;
+  pthread_t tids[OUT_MAX_CHUNKS];
+  int started[OUT_MAX_CHUNKS] = {0};
+  /* The calling thread is the last worker. */
+  for (int i = 0; i < chunks - 1; i++) started[i] = pthread_create(&tids[i], NULL, out_pool_worker, pool) == 0;
+  out_pool_worker(pool);
+  for (int i = 0; i < chunks - 1; i++) {
+    if (started[i]) pthread_join(tids[i], NULL);
+  }
+  for (int c = 0; c < chunks; c++) {
+    OutBuf *o = &pool->bufs[c];
+    if (!o->buf || o->failed) {
+      write(out, r, (int)((int64_t)count * c / chunks), (int)((int64_t)count * (c + 1) / chunks));
+    } else {
+      out_bytes(out, pool->mems[c].data, pool->mems[c].len);
+      out_bytes(out, o->buf, o->len);
+    }
+    free(o->buf);
+    free(pool->mems[c].data);
+  }
+  free(pool);
+}
+
+static void write_text_risk_rows(OutBuf *out, const Report *r, int from, int to) {
+  for (int i = from; i < to; i++) {
+    const RiskEntry *e = &r->risks[i];
+    out_str(out, e->id);
+    out_char(out, '\t');
+    out_str(out, e->cohort);
+    out_char(out, '\t');
+    out_int(out, e->risk_score);
+    out_char(out, '\t');
+    out_int(out, e->days_since);
+    out_char(out, '\t');
+    out_int(out, e->touchpoints_30d);
+    out_char(out, '\t');
+    out_fixed(out, e->attendance_rate, 2);
+    out_char(out, '\t');
+    out_fixed(out, e->satisfaction_score, 2);
+    out_char(out, '\n');
+  }
+}
+
+static void write_text_cohort_rows(OutBuf *out, const Report *r, int from, int to) {
+  for (int i = from; i < to; i++) {
+    const CohortSummary *c = &r->summaries[i];
+    if (r->rollup_separator) {
+      out_int(out, c->level);
+      out_char(out, '\t');
+    }
+    out_str(out, c->cohort);
+    out_char(out, '\t');
+    out_int(out, c->count);
+    out_char(out, '\t');
+    out_int(out, c->high);
+    out_char(out, '\t');
+    out_int(out, c->medium);
+    out_char(out, '\t');
+    out_int(out, c->low);
+    out_char(out, '\t');
+    out_fixed(out, c->high_share, 2);
+    out_char(out, '\t');
+    out_fixed(out, c->risk_index, 2);
+    out_char(out, '\t');
+    out_fixed(out, c->avg_touchpoints, 2);
+    out_char(out, '\t');
+    out_fixed(out, c->avg_attendance, 2);
+    out_char(out, '\t');
+    out_fixed(out, c->avg_satisfaction, 2);
+    out_char(out, '\t');
+    out_fixed(out, c->avg_days, 1);
+    out_char(out, '\n');
+  }
+}
+
+void write_text_report(OutBuf *out, const Report *r) {
+  const RunTotals *t = r->totals;
+  out_str(out, "Group Scholar Cohort Health Sentinel\n");
+  if (r->scenario) out_printf(out, "Scenario: %s\n", r->scenario);
+  out_printf(out, "Reference date: %s\n", r->reference_date);
+  if (!profile_is_default(r->profile)) out_printf(out, "Scoring profile: %s\n", r->profile->name);
+  out_printf(out, "Records: %d valid, %d invalid\n", t->valid_count, t->invalid_rows);
+  for (int i = 0; i < r->input_count; i++) {
+    const InputCount *c = &r->inputs[i];
+    out_printf(out, "  %s: %d rows | %d valid | %d invalid\n", c->path, c->rows, c->valid, c->invalid);
+  }
+  if (r->dedupe) out_printf(out, "Duplicates collapsed: %d (--dedupe %s)\n", t->duplicate_rows, r->dedupe);
+  out_printf(out, "Missing IDs: %d | Missing dates: %d | Future dates: %d\n", t->missing_ids, t->missing_dates, t->future_dates);
+  out_printf(out, "Invalid breakdown: columns %d | numeric %d | date format %d | range %d\n",
+             t->invalid_columns, t->invalid_numeric, t->invalid_date_format, t->invalid_range);
+  out_printf(out, "Clamped values: %d\n", t->clamped_values);
+  out_printf(out, "Risk mix: %d high | %d medium | %d low\n", t->high_count, t->medium_count, t->low_count);
+  out_printf(out, "Risk drivers: recency>30 %d | recency15-30 %d | recency8-14 %d\n",
+             t->recency_over_30, t->recency_15_30, t->recency_8_14);
+  out_printf(out, "              touchpoints0 %d | touchpoints1 %d | attendance<0.6 %d | attendance<0.8 %d | satisfaction<3 %d | satisfaction<4 %d\n\n",
+             t->touchpoints_zero, t->touchpoints_one, t->attendance_low, t->attendance_mid, t->satisfaction_low, t->satisfaction_mid);
+
+  if (r->risk_count > 0) {
+    out_printf(out, "Top %d risk entries\n", r->risk_count);
+    out_str(out, "ID\tCohort\tScore\tDays\tTouch30\tAttend\tSatisfaction\n");
+    out_rows(out, r, r->risk_count, write_text_risk_rows);
+  }
+
+  out_printf(out, "\nCohort summary (sorted by %s%s)\n", r->cohort_sort, r->rollup_separator ? " within each level" : "");
+  if (r->cohort_display == 0) {
+    out_str(out, "None\n");
+  } else {
+    if (r->rollup_separator) out_str(out, "Level\t");
+    out_str(out, "Cohort\tCount\tHigh\tMedium\tLow\tHighShare\tRiskIndex\tAvgTouch30\tAvgAttend\tAvgSatisfaction\tAvgDaysSince\n");
+    out_rows(out, r, r->cohort_display, write_text_cohort_rows);
+  }
+
+  out_str(out, "\nCohort alerts (high-risk share >= ");
+  out_fixed(out, r->alert_threshold, 2);
+  out_printf(out, ", min size %d)\n", r->min_cohort_size);
+  if (r->alert_count == 0) {
+    out_str(out, "None\n");
+  } else {
+    if (r->rollup_separator) out_str(out, "Level\t");
+    out_str(out, "Cohort\tHighShare\tRiskIndex\tCount\tHigh\tMedium\tLow\tAvgDays\tAvgAttend\tAvgSatisfaction\n");
+    for (int i = 0; i < r->alert_count; i++) {
+      const CohortAlert *a = &r->alerts[i];
+      if (r->rollup_separator) {
+        out_int(out, a->level);
+        out_char(out, '\t');
+      }
+      out_str(out, a->cohort);
+      out_char(out, '\t');
+      out_fixed(out, a->high_ratio, 2);
+      out_char(out, '\t');
+      out_fixed(out, a->risk_index, 2);
+      out_char(out, '\t');
+      out_int(out, a->count);
+      out_char(out, '\t');
+      out_int(out, a->high);
+      out_char(out, '\t');
+      out_int(out, a->medium);
+      out_char(out, '\t');
+      out_int(out, a->low);
+      out_char(out, '\t');
+      out_fixed(out, a->avg_days, 1);
+      out_char(out, '\t');
+      out_fixed(out, a->avg_attendance, 2);
+      out_char(out, '\t');
+      out_fixed(out, a->avg_satisfaction, 2);
+      out_char(out, '\n');
+    }
+  }
+}
+
+/* Scenario runs share one CSV: a leading scenario column, header once. */
+static int write_csv_prefix(OutBuf *out, const Report *r) {
+  if (r->scenario && r->scenario_index == 0) out_str(out, "scenario,");
+  return !r->scenario || r->scenario_index == 0;
+}
+
+static const char *const k_quantile_names[SKETCH_QUANTILES] = {"p10", "p50", "p90"};
+
+/* The --percentiles fields of one cohort: CSV values, or `"name": value`
+   pairs when json is set. A NULL c writes the CSV header names. */
+static void write_percentiles(OutBuf *out, const CohortSummary *c, int json) {
+  for (int m = 0; m < SKETCH_METRICS; m++) {
+    const SketchMetric *metric = &k_sketch_metrics[m];
+    for (int q = 0; q < SKETCH_QUANTILES; q++) {
+      out_str(out, json ? ", \"" : ",");
+      if (json || !c) {
+        out_str(out, metric->name);
+        out_char(out, '_');
+        out_str(out, k_quantile_names[q]);
+      }
+      if (json) out_str(out, "\": ");
+      if (c) out_fixed(out, c->percentiles[m][q], metric->integral ? 0 : 2);
+    }
+  }
+}
+
+static void write_cohort_csv_rows(OutBuf *out, const Report *r, int from, int to) {
+  for (int i = from; i < to; i++) {
+    const CohortSummary *c = &r->summaries[i];
+    if (r->scenario) {
+      out_csv_str(out, r->scenario);
+      out_char(out, ',');
+    }
+    out_csv_str(out, c->cohort);
+    out_char(out, ',');
+    out_int(out, c->count);
+    out_char(out, ',');
+    out_int(out, c->high);
+    out_char(out, ',');
+    out_int(out, c->medium);
+    out_char(out, ',');
+    out_int(out, c->low);
+    out_char(out, ',');
+    out_fixed(out, c->high_share, 2);
+    out_char(out, ',');
+    out_fixed(out, c->risk_index, 2);
+    out_char(out, ',');
+    out_fixed(out, c->avg_touchpoints, 2);
+    out_char(out, ',');
+    out_fixed(out, c->avg_attendance, 2);
+    out_char(out, ',');
+    out_fixed(out, c->avg_satisfaction, 2);
+    out_char(out, ',');
+    out_fixed(out, c->avg_days, 1);
+    if (r->percentiles) write_percentiles(out, c, 0);
+    out_char(out, '\n');
+  }
+}
+
+void write_cohort_csv(OutBuf *out, const Report *r) {
+  if (write_csv_prefix(out, r)) {
+    out_str(out, "cohort,count,high,medium,low,high_share,risk_index,avg_touchpoints_30d,avg_attendance,avg_satisfaction,avg_days_since");
+    if (r->percentiles) write_percentiles(out, NULL, 0);
+    out_char(out, '\n');
+  }
+  out_rows(out, r, r->cohort_display, write_cohort_csv_rows);
+}
+
+void write_alert_csv(OutBuf *out, const Report *r) {
+  if (write_csv_prefix(out, r)) out_str(out, "cohort,high_share,risk_index,count,high,medium,low,avg_days_since,avg_attendance,avg_satisfaction\n");
+  for (int i = 0; i < r->alert_count; i++) {
+    const CohortAlert *a = &r->alerts[i];
+    if (r->scenario) {
+      out_csv_str(out, r->scenario);
+      out_char(out, ',');
+    }
+    out_csv_str(out, a->cohort);
+    out_char(out, ',');
+    out_fixed(out, a->high_ratio, 2);
+    out_char(out, ',');
+    out_fixed(out, a->risk_index, 2);
+    out_char(out, ',');
+    out_int(out, a->count);
+    out_char(out, ',');
+    out_int(out, a->high);
+    out_char(out, ',');
+    out_int(out, a->medium);
+    out_char(out, ',');
+    out_int(out, a->low);
+    out_char(out, ',');
+    out_fixed(out, a->avg_days, 1);
+    out_char(out, ',');
+    out_fixed(out, a->avg_attendance, 2);
+    out_char(out, ',');
+    out_fixed(out, a->avg_satisfaction, 2);
+    out_char(out, '\n');
+  }
+}
+
+/* Records the profile a report was scored with. */
+static void write_profile_json(OutBuf *out, const ScoringProfile *p) {
+  out_str(out, "  \"scoring_profile\": {\"name\": ");
+  out_json_str(out, p->name);
+  out_printf(out, ", \"specialized\": %s, ", profile_is_default(p) ? "true" : "false");
+  out_printf(out, "\"recency_days\": [%d, %d, %d], \"recency_points\": [%d, %d, %d], ",
+             p->recency_days[0], p->recency_days[1], p->recency_days[2],
+             p->recency_points[0], p->recency_points[1], p->recency_points[2]);
+  out_printf(out, "\"touchpoints_at_most\": [%d, %d], \"touchpoints_points\": [%d, %d], ",
+             p->touchpoints_at_most[0], p->touchpoints_at_most[1], p->touchpoints_points[0], p->touchpoints_points[1]);
+  out_printf(out, "\"attendance_below\": [%.15g, %.15g], \"attendance_points\": [%d, %d], ",
+             p->attendance_below[0], p->attendance_below[1], p->attendance_points[0], p->attendance_points[1]);
+  out_printf(out, "\"satisfaction_below\": [%.15g, %.15g], \"satisfaction_points\": [%d, %d], ",
+             p->satisfaction_below[0], p->satisfaction_below[1], p->satisfaction_points[0], p->satisfaction_points[1]);
+  out_printf(out, "\"medium_at\": %d, \"high_at\": %d},\n", p->medium_at, p->high_at);
+}
+
+/* Writes the report object without a trailing newline so scenario runs
+   can list several in one document. */
+static void write_json_risk_rows(OutBuf *out, const Report *r, int from, int to) {
+  for (int i = from; i < to; i++) {
+    const RiskEntry *e = &r->risks[i];
+    out_str(out, "    {\"id\": ");
+    out_json_str(out, e->id);
+    out_str(out, ", \"cohort\": ");
+    out_json_str(out, e->cohort);
+    out_str(out, ", \"score\": ");
+    out_int(out, e->risk_score);
+    out_str(out, ", \"days_since\": ");
+    out_int(out, e->days_since);
+    out_str(out, ", \"touchpoints_30d\": ");
+    out_int(out, e->touchpoints_30d);
+    out_str(out, ", \"attendance_rate\": ");
+    out_fixed(out, e->attendance_rate, 2);
+    out_str(out, ", \"satisfaction_score\": ");
+    out_fixed(out, e->satisfaction_score, 2);
+    out_str(out, i == r->risk_count - 1 ? "}\n" : "},\n");
+  }
+}
+
+static void write_json_cohort_rows(OutBuf *out, const Report *r, int from, int to) {
+  for (int i = from; i < to; i++) {
+    const CohortSummary *c = &r->summaries[i];
+    out_str(out, "    {\"cohort\": ");
+    out_json_str(out, c->cohort);
+    if (r->rollup_separator) {
+      out_str(out, ", \"level\": ");
+      out_int(out, c->level);
+    }
+    out_str(out, ", \"count\": ");
+    out_int(out, c->count);
+    out_str(out, ", \"high\": ");
+    out_int(out, c->high);
+    out_str(out, ", \"medium\": ");
+    out_int(out, c->medium);
+    out_str(out, ", \"low\": ");
+    out_int(out, c->low);
+    out_str(out, ", \"high_share\": ");
+    out_fixed(out, c->high_share, 2);
+    out_str(out, ", \"risk_index\": ");
+    out_fixed(out, c->risk_index, 2);
+    out_str(out, ", \"avg_touchpoints_30d\": ");
+    out_fixed(out, c->avg_touchpoints, 2);
+    out_str(out, ", \"avg_attendance\": ");
+    out_fixed(out, c->avg_attendance, 2);
+    out_str(out, ", \"avg_satisfaction\": ");
+    out_fixed(out, c->avg_satisfaction, 2);
+    out_str(out, ", \"avg_days_since\": ");
+    out_fixed(out, c->avg_days, 1);
+    if (r->percentiles) write_percentiles(out, c, 1);
+    out_str(out, i == r->cohort_display - 1 ? "}\n" : "},\n");
+  }
+}
+
+static void write_json_object(OutBuf *out, const Report *r) {
+  const RunTotals *t = r->totals;
+  out_str(out, "{\n");
+  if (r->scenario) {
+    out_str(out, "  \"scenario\": ");
+    out_json_str(out, r->scenario);
+    out_str(out, ",\n");
+  }
+  out_str(out, "  \"reference_date\": ");
+  out_json_str(out, r->reference_date);
+  out_printf(out, ",\n  \"records\": {\"valid\": %d, \"invalid\": %d},\n", t->valid_count, t->invalid_rows);
+  if (r->input_count > 0) {
+    out_str(out, "  \"inputs\": [\n");
+    for (int i = 0; i < r->input_count; i++) {
+      const InputCount *c = &r->inputs[i];
+      out_str(out, "    {\"path\": ");
+      out_json_str(out, c->path);
+      out_printf(out, ", \"rows\": %d, \"valid\": %d, \"invalid\": %d}%s\n", c->rows, c->valid, c->invalid,
+                 i == r->input_count - 1 ? "" : ",");
+    }
+    out_str(out, "  ],\n");
+  }
+  if (r->dedupe) {
+    out_str(out, "  \"dedupe\": {\"mode\": ");
+    out_json_str(out, r->dedupe);
+    out_printf(out, ", \"duplicates\": %d},\n", t->duplicate_rows);
+  }
+  out_str(out, "  \"cohort_sort\": ");
+  out_json_str(out, r->cohort_sort);
+  if (r->rollup_separator) {
+    char separator[2] = {r->rollup_separator, '\0'};
+    out_str(out, ",\n  \"rollup_separator\": ");
+    out_json_str(out, separator);
+  }
+  out_printf(out, ",\n  \"cohort_total\": %d,\n", r->cohort_count);
+  out_printf(out, "  \"cohort_limit\": %d,\n", r->cohort_display);
+  if (r->cohort_filter_count > 0) {
+    out_str(out, "  \"cohort_filter\": [");
+    for (int i = 0; i < r->cohort_filter_count; i++) {
+      out_json_str(out, r->cohort_filters[i]);
+      if (i < r->cohort_filter_count - 1) out_str(out, ", ");
+    }
+    out_str(out, "],\n");
+  }
+  out_printf(out, "  \"missing\": {\"ids\": %d, \"dates\": %d},\n", t->missing_ids, t->missing_dates);
+  out_printf(out, "  \"invalid_breakdown\": {\"columns\": %d, \"numeric\": %d, \"date_format\": %d, \"range\": %d},\n",
+             t->invalid_columns, t->invalid_numeric, t->invalid_date_format, t->invalid_range);
+  out_printf(out, "  \"clamped_values\": %d,\n", t->clamped_values);
+  out_printf(out, "  \"date_anomalies\": {\"future_dates\": %d},\n", t->future_dates);
+  out_printf(out, "  \"risk_mix\": {\"high\": %d, \"medium\": %d, \"low\": %d},\n",
+             t->high_count, t->medium_count, t->low_count);
+  out_printf(out, "  \"risk_drivers\": {\"recency_over_30\": %d, \"recency_15_30\": %d, \"recency_8_14\": %d, \"touchpoints_zero\": %d, \"touchpoints_one\": %d, \"attendance_low\": %d, \"attendance_mid\": %d, \"satisfaction_low\": %d, \"satisfaction_mid\": %d},\n",
+             t->recency_over_30, t->recency_15_30, t->recency_8_14, t->touchpoints_zero, t->touchpoints_one,
+             t->attendance_low, t->attendance_mid, t->satisfaction_low, t->satisfaction_mid);
+  out_str(out, "  \"alert_threshold\": ");
+  out_fixed(out, r->alert_threshold, 2);
+  out_printf(out, ",\n  \"min_cohort_size\": %d,\n", r->min_cohort_size);
+  write_profile_json(out, r->profile);
+  out_str(out, "  \"top_risks\": [\n");
+  out_rows(out, r, r->risk_count, write_json_risk_rows);
+  out_str(out, "  ],\n");
+  out_str(out, "  \"cohorts\": [\n");
+  out_rows(out, r, r->cohort_display, write_json_cohort_rows);
+  out_str(out, "  ],\n");
+  out_str(out, "  \"alerts\": [\n");
+  for (int i = 0; i < r->alert_count; i++) {
+    const CohortAlert *a = &r->alerts[i];
+    out_str(out, "    {\"cohort\": ");
+    out_json_str(out, a->cohort);
+    if (r->rollup_separator) {
+      out_str(out, ", \"level\": ");
+      out_int(out, a->level);
+    }
+    out_str(out, ", \"high_share\": ");
+    out_fixed(out, a->high_ratio, 2);
+    out_str(out, ", \"risk_index\": ");
+    out_fixed(out, a->risk_index, 2);
+    out_str(out, ", \"count\": ");
+    out_int(out, a->count);
+    out_str(out, ", \"high\": ");
+    out_int(out, a->high);
+    out_str(out, ", \"medium\": ");
+    out_int(out, a->medium);
+    out_str(out, ", \"low\": ");
+    out_int(out, a->low);
+    out_str(out, ", \"avg_days_since\": ");
+    out_fixed(out, a->avg_days, 1);
+    out_str(out, ", \"avg_attendance\": ");
+    out_fixed(out, a->avg_attendance, 2);
+    out_str(out, ", \"avg_satisfaction\": ");
+    out_fixed(out, a->avg_satisfaction, 2);
+    out_str(out, i == r->alert_count - 1 ? "}\n" : "},\n");
+  }
+  out_str(out, "  ]\n");
+  out_str(out, "}");
+}
+
+void write_json_report(OutBuf *out, const Report *r) {
+  write_json_object(out, r);
+  out_char(out, '\n');
+}
+
+static double clock_seconds(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void stats_start(RunStats *stats) {
+  if (!stats->enabled) return;
+  stats->mark_wall = clock_seconds(CLOCK_MONOTONIC);
+  stats->mark_cpu = clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+/* Charges the time since the previous lap to phase. */
+static void stats_lap(RunStats *stats, StatsPhase phase) {
+  if (!stats->enabled) return;
+  double wall = clock_seconds(CLOCK_MONOTONIC);
+  double cpu = clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+  stats->wall[phase] += wall - stats->mark_wall;
+  stats->cpu[phase] += cpu - stats->mark_cpu;
+  stats->mark_wall = wall;
+  stats->mark_cpu = cpu;
+}
+
+static long peak_rss_kb(void) {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  return usage.ru_maxrss;
+}
+
+static void stats_totals(const RunStats *stats, double *wall, double *cpu) {
+  *wall = 0;
+  *cpu = 0;
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    *wall += stats->wall[i];
+    *cpu += stats->cpu[i];
+  }
+}
+
+static void write_stats_text(OutBuf *out, const RunStats *stats, const char *mode, int threads,
+                             const RunTotals *totals, size_t bytes_read, const CohortTable *cohorts) {
+  double wall = 0;
+  double cpu = 0;
+  stats_totals(stats, &wall, &cpu);
+  out_printf(out, "Run stats (%s, %d thread%s%s, %d scenario%s)\n", mode, threads, threads == 1 ? "" : "s",
+             stats->fused_scoring ? ", scoring inside parse" : "", stats->scenarios, stats->scenarios == 1 ? "" : "s");
+  out_printf(out, "Phase\tWallMs\tCpuMs\n");
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    out_printf(out, "%s\t%.3f\t%.3f\n", k_phase_names[i], stats->wall[i] * 1e3, stats->cpu[i] * 1e3);
+  }
+  out_printf(out, "total\t%.3f\t%.3f\n", wall * 1e3, cpu * 1e3);
+  out_printf(out, "Rows: %d (%.0f rows/sec) | Bytes read: %zu | Peak RSS: %ld KB\n",
+             totals->data_rows, wall > 0 ? totals->data_rows / wall : 0.0, bytes_read, peak_rss_kb());
+  out_printf(out, "Cohort table: %d entries / %d slots (load %.2f, rehashes %d) | Scholar buffer grows: %d\n",
+             cohorts->count, cohorts->slot_count, cohorts->slot_count ? (double)cohorts->count / cohorts->slot_count : 0.0,
+             cohorts->rehashes, stats->scholar_grows);
+  if (stats->state_used) {
+    out_printf(out, "State: %d rows applied | %d unchanged | %d retired | %d rescored for --as-of\n",
+               stats->state_applied, stats->state_unchanged, stats->state_retired, stats->state_rescored);
+  }
+  if (stats->cache_used) {
+    out_printf(out, "Cache: %s\n", stats->cache_hit ? "hit, columns mapped without parsing" : "miss, columns written");
+  }
+  if (stats->input_files > 1) out_printf(out, "Inputs: %d files, one reader each\n", stats->input_files);
+  if (stats->dedupe_mode) {
+    out_printf(out, "Dedupe (%s): %u rows | %u distinct ids | %llu slots (%llu KB)\n", dedupe_mode_name(stats->dedupe_mode),
+               stats->dedupe_rows, stats->dedupe_ids, (unsigned long long)stats->dedupe_slots,
+               (unsigned long long)(stats->dedupe_slots * sizeof(DedupeSlot) / 1024));
+  }
+}
+
+static void write_stats_json(OutBuf *out, const RunStats *stats, const char *mode, int threads,
+                             const RunTotals *totals, size_t bytes_read, const CohortTable *cohorts) {
+  double wall = 0;
+  double cpu = 0;
+  stats_totals(stats, &wall, &cpu);
+  out_printf(out, "{\n");
+  out_printf(out, "  \"mode\": \"%s\",\n", mode);
+  out_printf(out, "  \"threads\": %d,\n", threads);
+  out_printf(out, "  \"parse_includes_scoring\": %s,\n", stats->fused_scoring ? "true" : "false");
+  out_printf(out, "  \"scenarios\": %d,\n", stats->scenarios);
+  out_printf(out, "  \"rows\": %d,\n", totals->data_rows);
+  out_printf(out, "  \"bytes_read\": %zu,\n", bytes_read);
+  out_printf(out, "  \"wall_seconds\": %.6f,\n", wall);
+  out_printf(out, "  \"cpu_seconds\": %.6f,\n", cpu);
+  out_printf(out, "  \"rows_per_second\": %.0f,\n", wall > 0 ? totals->data_rows / wall : 0.0);
+  out_printf(out, "  \"peak_rss_kb\": %ld,\n", peak_rss_kb());
+  out_printf(out, "  \"cohort_table\": {\"entries\": %d, \"slots\": %d, \"load\": %.4f, \"rehashes\": %d},\n",
+             cohorts->count, cohorts->slot_count, cohorts->slot_count ? (double)cohorts->count / cohorts->slot_count : 0.0,
+             cohorts->rehashes);
+  out_printf(out, "  \"scholar_buffer_grows\": %d,\n", stats->scholar_grows);
+  if (stats->state_used) {
+    out_printf(out, "  \"state\": {\"applied\": %d, \"unchanged\": %d, \"retired\": %d, \"rescored\": %d},\n",
+               stats->state_applied, stats->state_unchanged, stats->state_retired, stats->state_rescored);
+  }
+  if (stats->cache_used) out_printf(out, "  \"cache\": {\"hit\": %s},\n", stats->cache_hit ? "true" : "false");
+  if (stats->input_files > 1) out_printf(out, "  \"input_files\": %d,\n", stats->input_files);
+  if (stats->dedupe_mode) {
+    out_printf(out, "  \"dedupe\": {\"mode\": \"%s\", \"rows\": %u, \"ids\": %u, \"slots\": %llu},\n",
+               dedupe_mode_name(stats->dedupe_mode), stats->dedupe_rows, stats->dedupe_ids,
+               (unsigned long long)stats->dedupe_slots);
+  }
+  out_printf(out, "  \"phases\": [\n");
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    out_printf(out, "    {\"name\": \"%s\", \"wall_seconds\": %.6f, \"cpu_seconds\": %.6f}%s\n",
+               k_phase_names[i], stats->wall[i], stats->cpu[i], i == PHASE_COUNT - 1 ? "" : ",");
+  }
+  out_printf(out, "  ]\n");
+  out_printf(out, "}\n");
+}
+
+/* Worker count for phases that split by default: --threads when given,
+   otherwise one per online CPU. */
+int default_workers(int threads) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return threads > 1 ? threads : (cpus > 0 && cpus < MAX_THREADS ? (int)cpus : MAX_THREADS);
+}
+
+/* Embedding API (src/sentinel.h). Each handle carries its own options and
+   accumulators. The command-line tool runs every report through one:
+   sentinel_feed_files() is its ingest and each scenario is finalized and
+   written in turn. sentinel_feed_buffer() and sentinel_feed_rows() score
+   through score_row(), the path --stream and --watch use, so they report
+   what a plain run over the same rows does. */
+enum { ENGINE_FED_NONE, ENGINE_FED_CSV, ENGINE_FED_ROWS, ENGINE_FED_FILES };
+
+struct SentinelEngine {
+  ScoringProfile profile;
+  char *filter_buffer;
+  char **filters;
+  int filter_count;
+  Rollup rollup;
+  CohortSort sort;
+  int cohort_limit;
+  int clamp_ranges;
+  int percentiles;
+  int threads;
+  int stream;
+  int state_delta;
+  char *cache_path;
+  char *state_path;
+  char *scored_path;
+  char as_of[MAX_DATE];
+  char reference_date[MAX_DATE];
+  ScanLineFn scan_line;
+  int fed;
+  int finalized;
+  int failed;
+  char *buf;
+  size_t len;
+  size_t cap;
+  uint64_t offset;
+  int lines;
+  /* sentinel_feed_files(): the inputs, and the buffered columns or per-file
+     jobs each scenario scores. */
+  char **paths;
+  int path_count;
+  ScholarColumns columns;
+  FileJob *file_jobs;
+  InputCount *input_counts;
+  int file_workers;
+  int parallel;
+  size_t bytes_read;
+  ScholarState state;
+  Dedupe dedupe;
+  Scenario base;
+  Scenario *scenarios;
+  int scenario_count;
+  int scenario;
+  int output_workers;
+  RunStats stats;
+  RunTotals parsed_totals;
+  RunTotals totals;
+  CohortTable cohorts;
+  TopRisks risks;
+  DateCache dates;
+  ScoreContext ctx;
+  CohortSummary *summaries;
+  int cohort_display;
+  CohortAlert *alerts;
+  int alert_count;
+  Report report;
+};
+
+void sentinel_options_init(SentinelOptions *options) {
+  memset(options, 0, sizeof(SentinelOptions));
+  options->cohort_sort = "risk";
+  options->limit = 10;
+  options->cohort_limit = -1;
+  options->alert_threshold = 0.30;
+  options->min_cohort_size = 5;
+  options->threads = 1;
+}
+
+static void engine_error(char *error, size_t error_len, const char *message, const char *detail) {
+  if (error && error_len > 0) snprintf(error, error_len, "%s%s", message, detail ? detail : "");
+}
+
+/* The option combinations the ingest cannot run; the command-line tool
+   rejects the same ones under its flag names first. */
+static const char *engine_conflict(const SentinelOptions *o) {
+  int threaded = o->stream || o->threads > 1;
+  if (o->scenarios && threaded) return "scenarios score buffered columns; drop stream and threads.";
+  if (o->state && (threaded || o->scenarios)) return "state cannot be combined with stream, threads or scenarios.";
+  if (o->state_delta && !o->state) return "state_delta needs state.";
+  if (o->cache && (threaded || o->state)) return "cache stores buffered columns; drop stream, threads and state.";
+  if (o->scored_out && (o->threads > 1 || o->state || o->scenarios)) {
+    return "scored_out writes rows in input order from one scoring pass; drop threads, state and scenarios.";
+  }
+  if (o->state && (o->dedupe || o->rollup_separator)) return "dedupe and rollup_separator cannot be combined with state.";
+  return NULL;
+}
+
+static int engine_copy(char **out, const char *text) {
+  *out = text ? strdup(text) : NULL;
+  return !text || *out;
+}
+
+SentinelEngine *sentinel_engine_create(const SentinelOptions *options, char *error, size_t error_len) {
+  SentinelEngine *e = (SentinelEngine *)calloc(1, sizeof(SentinelEngine));
+  if (!e) {
+    engine_error(error, error_len, "Failed to allocate engine.", NULL);
+    return NULL;
+  }
+  const char *sort_name = options->cohort_sort ? options->cohort_sort : "risk";
+  int sort_ok = 0;
+  e->sort = cohort_sort_mode(sort_name, &sort_ok);
+  int as_of_day = local_today();
+  int dedupe = options->dedupe ? dedupe_mode(options->dedupe) : DEDUPE_OFF;
+  const char *failure = NULL;
+  const char *detail = NULL;
+  e->profile = k_default_profile;
+  e->scenarios = &e->base;
+  e->scenario_count = 1;
+  if (!sort_ok) {
+    failure = "Invalid cohort_sort value. Use risk, high, or name.";
+  } else if (options->as_of && (strlen(options->as_of) >= MAX_DATE || !parse_date(options->as_of, &as_of_day))) {
+    failure = "Invalid as_of date: ";
+    detail = options->as_of;
+  } else if (options->rollup_separator == ',') {
+    failure = "rollup_separator cannot be a comma.";
+  } else if (options->dedupe && !dedupe) {
+    failure = "Invalid dedupe value. Use first, last, or latest-touchpoint.";
+  } else if (options->threads < 0 || options->threads > MAX_THREADS) {
+    failure = "Invalid threads value.";
+  } else {
+    failure = engine_conflict(options);
+  }
+  if (!failure && options->scoring_profile && !load_scoring_profile(options->scoring_profile, &e->profile)) {
+    failure = "Failed to load scoring profile ";
+    detail = options->scoring_profile;
+  }
+  if (!failure) {
+    snprintf(e->base.name, sizeof(e->base.name), "default");
+    e->base.profile = e->profile;
+    e->base.alert_threshold = options->alert_threshold < 0 ? 0 : options->alert_threshold > 1.0
+                                                                   ? 1.0 : options->alert_threshold;
+    e->base.min_cohort_size = options->min_cohort_size < 1 ? 1 : options->min_cohort_size;
+    e->base.limit = options->limit > 0 ? options->limit : 0;
+    if (options->scenarios && !load_scenarios(options->scenarios, &e->base, &e->scenarios, &e->scenario_count)) {
+      e->scenarios = &e->base;
+      failure = "Failed to load scenarios ";
+      detail = options->scenarios;
+    }
+  }
+  if (failure) {
+    engine_error(error, error_len, failure, detail);
+    sentinel_engine_free(e);
+    return NULL;
+  }
+
+  int ok = engine_copy(&e->cache_path, options->cache) && engine_copy(&e->state_path, options->state) &&
+           engine_copy(&e->scored_path, options->scored_out);
+  if (ok && options->cohort_filter) {
+    ok = split_cohort_filters(options->cohort_filter, &e->filter_buffer, &e->filters, &e->filter_count);
+  }
+  if (ok && options->rollup_separator) {
+    e->rollup.separator = options->rollup_separator;
+    e->rollup.filter_count = e->filter_count;
+    if (e->filter_count > 0) {
+      e->rollup.filters = (char **)malloc(sizeof(char *) * (size_t)e->filter_count);
+      ok = e->rollup.filters != NULL;
+      if (ok) {
+        memcpy(e->rollup.filters, e->filters, sizeof(char *) * (size_t)e->filter_count);
+        qsort(e->rollup.filters, e->filter_count, sizeof(char *), compare_name_ptr);
+      }
+    }
+  }
+  ok = ok && cohort_table_init(&e->cohorts) && top_risks_init(&e->risks, e->base.limit);
+  if (!ok) {
+    engine_error(error, error_len, "Failed to allocate engine.", NULL);
+    sentinel_engine_free(e);
+    return NULL;
+  }
+
+  int y, m, d;
+  civil_from_days(as_of_day, &y, &m, &d);
+  snprintf(e->reference_date, sizeof(e->reference_date), "%04u-%02u-%02u", (unsigned)y % 10000u, (unsigned)m,
+           (unsigned)d);
+  if (options->as_of) snprintf(e->as_of, sizeof(e->as_of), "%s", options->as_of);
+  e->cohort_limit = options->cohort_limit < -1 ? -1 : options->cohort_limit;
+  e->clamp_ranges = options->clamp_ranges;
+  e->percentiles = options->percentiles;
+  e->threads = options->threads > 1 ? options->threads : 1;
+  e->stream = options->stream || e->threads > 1;
+  e->state_delta = options->state_delta;
+  e->scan_line = select_scan_line();
+  e->file_workers = 1;
+  e->output_workers = default_workers(e->threads);
+  e->dedupe.mode = dedupe;
+  e->stats.enabled = options->stats;
+  e->stats.scenarios = e->scenario_count;
+  e->cohorts.sketched = options->percentiles;
+  if (options->rollup_separator) e->cohorts.rollup = &e->rollup;
+
+  ScoreContext *ctx = &e->ctx;
+  ctx->as_of_day = as_of_day;
+  ctx->dates = &e->dates;
+  ctx->cohort_filters = e->filters;
+  ctx->cohort_filter_count = e->filter_count;
+  ctx->totals = &e->totals;
+  ctx->cohorts = &e->cohorts;
+  ctx->risks = &e->risks;
+  ctx->profile = &e->base.profile;
+  ctx->generic_profile = !profile_is_default(&e->base.profile);
+  ctx->rollup = e->cohorts.rollup;
+  if (dedupe) ctx->dedupe = &e->dedupe;
+  return e;
+}
+
+/* Feeds other than whole files score as rows arrive, so they cannot take
+   scenarios or a --dedupe mode that needs every row first. */
+static int engine_accepts(SentinelEngine *e, int fed) {
+  if (e->finalized || e->failed || (e->fed != ENGINE_FED_NONE && e->fed != fed)) return 0;
+  if (fed != ENGINE_FED_FILES && (e->scenarios != &e->base || e->dedupe.mode > DEDUPE_FIRST)) return 0;
+  e->fed = fed;
+  return 1;
+}
+
+/* Appends to the partial-line buffer. */
+static int engine_buffer(SentinelEngine *e, const char *data, size_t len) {
+  if (e->cap - e->len < len) {
+    size_t cap = e->cap ? e->cap : READ_CHUNK;
+    while (cap - e->len < len) cap *= 2;
+    char *grown = (char *)realloc(e->buf, cap);
+    if (!grown) return 0;
+    e->buf = grown;
+    e->cap = cap;
+  }
+  memcpy(e->buf + e->len, data, len);
+  e->len += len;
+  return 1;
+}
+
+int sentinel_feed_buffer(SentinelEngine *e, const char *data, size_t len) {
+  if (!engine_accepts(e, ENGINE_FED_CSV)) return 0;
+  size_t end = len;
+  while (end > 0 && data[end - 1] != '\n') end--;
+  /* Complete the buffered line first; the rest is scored in place. */
+  size_t head = 0;
+  if (e->len > 0 && end > 0) {
+    head = (size_t)((const char *)memchr(data, '\n', end) - data) + 1;
+    if (!engine_buffer(e, data, head)) return 0;
+    score_csv_lines(e->buf, e->len, e->offset, &e->lines, e->scan_line, &e->ctx, e->clamp_ranges);
+    e->offset += e->len;
+    e->len = 0;
+  }
+  score_csv_lines(data + head, end - head, e->offset, &e->lines, e->scan_line, &e->ctx, e->clamp_ranges);
+  e->offset += end - head;
+  return engine_buffer(e, data + end, len - end);
+}
+
+int sentinel_feed_rows(SentinelEngine *e, const SentinelRow *rows, size_t count) {
+  if (!engine_accepts(e, ENGINE_FED_ROWS)) return 0;
+  for (size_t i = 0; i < count; i++) {
+    const char *values[6] = {rows[i].scholar_id, rows[i].cohort, rows[i].last_touchpoint_date,
+                             rows[i].touchpoints_30d, rows[i].attendance_rate, rows[i].satisfaction_score};
+    StrView fields[6];
+    int field_count = 0;
+    for (int f = 0; f < 6; f++) {
+      if (values[f] && *values[f]) fields[field_count++] = (StrView){values[f], strlen(values[f])};
+    }
+    e->totals.data_rows++;
+    ScholarRow row;
+    if (!parse_scholar_fields(fields, field_count, &row, &e->totals, e->clamp_ranges)) continue;
+    row.offset = e->offset++;
+    score_row(&row, &e->ctx);
+  }
+  return 1;
+}
+
+/* Reads the inputs the way the options say: through --state, in parallel
+   over a mapped file (--threads), scoring while reading (--stream), into
+   buffered columns (optionally through --cache), or one reader per file
+   when there are several. Failures are reported here. */
+static int engine_ingest(SentinelEngine *e) {
+  RunStats *stats = &e->stats;
+  ScoreContext *ctx = &e->ctx;
+  int count = e->path_count;
+  stats->input_files = count;
+  stats_start(stats);
+  InputReader reader;
+  memset(&reader, 0, sizeof(InputReader));
+  if (count == 1 && !input_open(&reader, e->paths[0])) {
+    perror("Failed to open input file");
+    return 0;
+  }
+  stats->fused_scoring = e->stream;
+  stats_lap(stats, PHASE_OPEN);
+  if (e->scored_path && !(ctx->scored = scored_out_open(e->scored_path))) {
+    perror("Failed to write scored rows");
+    input_close(&reader);
+    return 0;
+  }
+
+  int ok = 1;
+  int cache_hit = 0;
+  e->parallel = e->threads > 1 && reader.map != NULL;
+  if (e->state_path) {
+    uint64_t config_hash = state_config_hash(&e->profile, e->clamp_ranges, e->filters, e->filter_count);
+    ok = state_open(e->state_path, &e->state, ctx, config_hash, e->state_delta);
+    if (ok && !score_incremental(&reader, &e->state, ctx, e->clamp_ranges, e->state_delta)) {
+      fprintf(stderr, "Failed to expand state.\n");
+      ok = 0;
+    }
+    stats->state_used = 1;
+    stats->state_applied = e->state.applied;
+    stats->state_unchanged = e->state.unchanged;
+    stats->state_retired = e->state.retired;
+    stats->state_rescored = e->state.rescored;
+  } else if (count > 1) {
+    e->file_workers = default_workers(e->threads);
+    if (e->file_workers > count) e->file_workers = count;
+    e->input_counts = (InputCount *)calloc((size_t)count, sizeof(InputCount));
+    uint32_t *dedupe_bases = NULL;
+    if (!e->input_counts) {
+      fprintf(stderr, "Failed to allocate per-file counts.\n");
+    } else if (!(e->dedupe.mode && e->stream) ||
+               (dedupe_bases = dedupe_prepass_files(&e->dedupe, e->paths, count, e->file_workers, e->clamp_ranges))) {
+      e->file_jobs = ingest_files(e->paths, count, e->file_workers, e->stream, ctx, e->clamp_ranges, dedupe_bases,
+                                  e->input_counts);
+    }
+    free(dedupe_bases);
+    ok = e->file_jobs != NULL;
+  } else if (e->parallel) {
+    if (!score_mapped_parallel(&reader, e->threads, ctx, e->clamp_ranges)) {
+      fprintf(stderr, "Failed to allocate per-thread accumulators.\n");
+      ok = 0;
+    }
+  } else if (e->stream) {
+    uint32_t *dedupe_bases = NULL;
+    if (e->dedupe.mode && e->dedupe.mode != DEDUPE_FIRST &&
+        !(dedupe_bases = dedupe_prepass_files(&e->dedupe, e->paths, 1, 1, e->clamp_ranges))) {
+      ok = 0;
+    }
+    free(dedupe_bases);
+    StrView line;
+    StrView fields[6];
+    int field_count = 0;
+    int line_num = 0;
+    while (ok && input_next_row(&reader, &line, fields, &field_count)) {
+      line_num++;
+      if (line_num == 1) continue;
+      e->totals.data_rows++;
+
+      ScholarRow row;
+      if (!parse_scholar_fields(fields, field_count, &row, &e->totals, e->clamp_ranges)) continue;
+      row.offset = reader.line_offset;
+      score_row(&row, ctx);
+    }
+  } else if (!columns_init(&e->columns)) {
+    fprintf(stderr, "Failed to allocate scholar buffer.\n");
+    ok = 0;
+  } else {
+    cache_hit = load_columns(&reader, e->cache_path, e->clamp_ranges, &e->columns, &e->totals, &e->dates);
+    ok = cache_hit >= 0;
+    stats->cache_used = e->cache_path != NULL;
+    stats->cache_hit = cache_hit;
+  }
+  if (ok && reader.error) {
+    fprintf(stderr, "Failed to read input file: %s.\n", reader.error);
+    ok = 0;
+  }
+  e->bytes_read = cache_hit > 0 ? 0 : reader.bytes_read;
+  input_close(&reader);
+  if (!ok) return 0;
+
+  /* Buffered runs number their rows from the columns, in list order. */
+  if (e->dedupe.mode && !e->stream) {
+    if (e->file_jobs) {
+      for (int i = 0; i < count; i++) dedupe_scan_columns(&e->dedupe, &e->file_jobs[i].cols);
+    } else {
+      dedupe_scan_columns(&e->dedupe, &e->columns);
+    }
+    if (!dedupe_finish(&e->dedupe)) e->dedupe.failed = 1;
+  }
+  if (e->dedupe.failed) {
+    fprintf(stderr, "Failed to allocate dedupe table.\n");
+    return 0;
+  }
+  stats->dedupe_mode = e->dedupe.mode;
+  stats->dedupe_rows = e->dedupe.rows;
+  stats->dedupe_ids = dedupe_ids(&e->dedupe, &stats->dedupe_slots);
+  stats_lap(stats, PHASE_PARSE);
+
+  stats->scholar_grows = e->columns.grows;
+  for (int i = 0; e->file_jobs && i < count; i++) {
+    e->bytes_read += e->file_jobs[i].bytes_read;
+    stats->scholar_grows += e->file_jobs[i].cols.grows;
+  }
+  e->parsed_totals = e->totals;
+  return 1;
+}
+
+int sentinel_feed_files(SentinelEngine *e, char *const *paths, int count) {
+  if (count < 1 || !engine_accepts(e, ENGINE_FED_FILES)) return 0;
+  e->failed = 1;
+  if (count > 1 && (e->state_path || e->cache_path)) {
+    fprintf(stderr, "--state and --cache read a single --input file.\n");
+    return 0;
+  }
+  if (count > 1 && e->scored_path && e->stream) {
+    fprintf(stderr, "--scored-out over several inputs scores buffered columns; drop --stream.\n");
+    return 0;
+  }
+  /* Scoring while reading needs a pre-pass, except for first over one input. */
+  if (e->dedupe.mode && e->stream && (count > 1 || e->dedupe.mode != DEDUPE_FIRST)) {
+    for (int i = 0; i < count; i++) {
+      if (dedupe_rereadable(paths[i])) continue;
+      fprintf(stderr, "--dedupe %s with --stream reads %s twice; use a regular file or --dedupe first.\n",
+              dedupe_mode_name(e->dedupe.mode), paths[i]);
+      return 0;
+    }
+  }
+  e->paths = (char **)calloc((size_t)count, sizeof(char *));
+  if (!e->paths) {
+    fprintf(stderr, "Failed to allocate per-file counts.\n");
+    return 0;
+  }
+  for (int i = 0; i < count; i++) {
+    if (!(e->paths[i] = strdup(paths[i]))) {
+      fprintf(stderr, "Failed to allocate per-file counts.\n");
+      return 0;
+    }
+    e->path_count++;
+  }
+  if (!engine_ingest(e)) return 0;
+  e->failed = 0;
+  return 1;
+}
+
+int sentinel_scenario_count(const SentinelEngine *e) {
+  return e->scenario_count;
+}
+
+const char *sentinel_scenario_name(const SentinelEngine *e, int index) {
+  return index >= 0 && index < e->scenario_count ? e->scenarios[index].name : NULL;
+}
+
+/* Scores the buffered rows under the scenario (scenarios start from the
+   parse-time counters with fresh accumulators) and builds its report. */
+static int engine_finalize(SentinelEngine *e, int index) {
+  const Scenario *sc = &e->scenarios[index];
+  free(e->summaries);
+  free(e->alerts);
+  e->summaries = NULL;
+  e->alerts = NULL;
+  e->alert_count = 0;
+  if (e->len > 0) {
+    score_csv_lines(e->buf, e->len, e->offset, &e->lines, e->scan_line, &e->ctx, e->clamp_ranges);
+    e->offset += e->len;
+    e->len = 0;
+  }
+  if (e->scenarios != &e->base) {
+    e->totals = e->parsed_totals;
+    cohort_table_free(&e->cohorts);
+    top_risks_free(&e->risks);
+    if (!cohort_table_init(&e->cohorts) || !top_risks_init(&e->risks, sc->limit)) {
+      fprintf(stderr, "Failed to allocate scenario accumulators.\n");
+      return 0;
+    }
+    e->cohorts.sketched = e->percentiles;
+    if (e->rollup.separator) e->cohorts.rollup = &e->rollup;
+    e->ctx.profile = &sc->profile;
+    e->ctx.generic_profile = !profile_is_default(&sc->profile);
+  }
+  e->ctx.dedupe_row = 0;
+
+  int score_ok = 1;
+  if (e->file_jobs && !e->stream) {
+    score_ok = score_file_columns(e->file_jobs, e->path_count, &e->ctx, e->input_counts);
+  } else if (e->columns.count > 0) {
+    score_ok = score_columns(&e->columns, &e->ctx);
+  }
+  if (!score_ok) {
+    fprintf(stderr, "Failed to allocate cohort lookup.\n");
+    return 0;
+  }
+  if (e->risks.failed) {
+    fprintf(stderr, "Failed to allocate top risk list.\n");
+    return 0;
+  }
+  stats_lap(&e->stats, PHASE_SCORE);
+  top_risks_finish(&e->risks, e->output_workers);
+  stats_lap(&e->stats, PHASE_SORT_RISKS);
+
+  e->summaries = build_cohort_summaries(&e->cohorts, e->sort, e->output_workers);
+  stats_lap(&e->stats, PHASE_SUMMARIES);
+  e->alert_count = e->summaries ? build_alerts(e->summaries, e->cohorts.count, sc->alert_threshold,
+                                               sc->min_cohort_size, &e->alerts) : -1;
+  stats_lap(&e->stats, PHASE_ALERTS);
+  if (e->alert_count < 0) {
+    fprintf(stderr, "Failed to allocate cohort summaries.\n");
+    free(e->summaries);
+    e->summaries = NULL;
+    e->alert_count = 0;
+    return 0;
+  }
+  e->cohort_display = cohort_display_count(e->summaries, e->cohorts.count, e->cohort_limit);
+
+  Report *r = &e->report;
+  memset(r, 0, sizeof(Report));
+  r->reference_date = e->as_of[0] ? e->as_of : "today";
+  r->cohort_sort = k_sort_names[e->sort];
+  r->cohort_filters = e->filters;
+  r->cohort_filter_count = e->filter_count;
+  r->totals = &e->totals;
+  r->risks = e->risks.entries;
+  r->risk_count = sc->limit < e->risks.count ? sc->limit : e->risks.count;
+  r->summaries = e->summaries;
+  r->cohort_count = e->cohorts.count;
+  r->cohort_display = e->cohort_display;
+  r->alerts = e->alerts;
+  r->alert_count = e->alert_count;
+  r->alert_threshold = sc->alert_threshold;
+  r->min_cohort_size = sc->min_cohort_size;
+  r->profile = &sc->profile;
+  r->scenario = e->scenarios != &e->base ? sc->name : NULL;
+  r->scenario_index = index;
+  r->inputs = e->input_counts;
+  r->input_count = e->file_jobs ? e->path_count : 0;
+  r->dedupe = e->dedupe.mode ? dedupe_mode_name(e->dedupe.mode) : NULL;
+  r->percentiles = e->percentiles;
+  r->rollup_separator = e->rollup.separator;
+  r->workers = e->output_workers;
+  return 1;
+}
+
+/* A failure is final: the heap may already be sorted, so the handle keeps
+   `failed` and only sentinel_engine_free() is left to call. */
+int sentinel_finalize_scenario(SentinelEngine *e, int index) {
+  if (e->finalized && e->scenario == index) return 1;
+  if (e->failed || index < 0 || index >= e->scenario_count) return 0;
+  e->failed = 1;
+  e->finalized = 0;
+  if (!engine_finalize(e, index)) return 0;
+  e->failed = 0;
+  e->finalized = 1;
+  e->scenario = index;
+  return 1;
+}
+
+int sentinel_finalize(SentinelEngine *e) {
+  return sentinel_finalize_scenario(e, 0);
+}
+
+int sentinel_write(SentinelEngine *e, SentinelOutput output, int fd) {
+  int stats = output == SENTINEL_OUTPUT_STATS_TEXT || output == SENTINEL_OUTPUT_STATS_JSON;
+  if (!stats && !e->finalized) return 0;
+  OutBuf out;
+  if (!out_init(&out, fd)) {
+    fprintf(stderr, "Failed to allocate output buffer.\n");
+    return 0;
+  }
+  const Report *r = &e->report;
+  const char *mode = e->state_path ? "state" : e->parallel ? "threads" : (e->stream ? "stream" : "buffered");
+  int threads = e->parallel ? e->threads : e->file_workers;
+  StatsPhase phase = PHASE_COUNT;
+  switch (output) {
+    case SENTINEL_OUTPUT_TEXT:
+      if (r->scenario_index > 0) out_char(&out, '\n');
+      write_text_report(&out, r);
+      phase = PHASE_WRITE_TEXT;
+      break;
+    case SENTINEL_OUTPUT_COHORT_CSV:
+      write_cohort_csv(&out, r);
+      phase = PHASE_WRITE_COHORT_CSV;
+      break;
+    case SENTINEL_OUTPUT_ALERT_CSV:
+      write_alert_csv(&out, r);
+      phase = PHASE_WRITE_ALERT_CSV;
+      break;
+    case SENTINEL_OUTPUT_JSON:
+      /* Scenario reports are the items of one "scenarios" array. */
+      if (r->scenario && r->scenario_index == 0) out_str(&out, "{\n\"scenarios\": [\n");
+      if (r->scenario) {
+        write_json_object(&out, r);
+        out_str(&out, r->scenario_index == e->scenario_count - 1 ? "\n]\n}\n" : ",\n");
+      } else {
+        write_json_report(&out, r);
+      }
+      phase = PHASE_WRITE_JSON;
+      break;
+    case SENTINEL_OUTPUT_STATS_TEXT:
+      write_stats_text(&out, &e->stats, mode, threads, &e->totals, e->bytes_read, &e->cohorts);
+      break;
+    case SENTINEL_OUTPUT_STATS_JSON:
+      write_stats_json(&out, &e->stats, mode, threads, &e->totals, e->bytes_read, &e->cohorts);
+      break;
+    default:
+      free(out.buf);
+      return 0;
+  }
+  int ok = out_flush(&out);
+  free(out.buf);
+  if (phase != PHASE_COUNT) stats_lap(&e->stats, phase);
+  return ok;
+}
+
+int sentinel_save(SentinelEngine *e) {
+  if (!e->finalized) return 0;
+  int ok = 1;
+  if (e->ctx.scored) {
+    ok = scored_out_close(e->ctx.scored);
+    e->ctx.scored = NULL;
+    if (!ok) perror("Failed to write scored rows");
+  }
+  if (ok && e->state_path && !state_save(e->state_path, &e->state)) {
+    perror("Failed to write state file");
+    ok = 0;
+  }
+  return ok;
+}
+
+const Report *engine_report(const SentinelEngine *e) {
+  return e->finalized ? &e->report : NULL;
+}
+
+void engine_lap(SentinelEngine *e, StatsPhase phase) {
+  stats_lap(&e->stats, phase);
+}
+
+const char *sentinel_reference_date(const SentinelEngine *e) {
+  return e->reference_date;
+}
+
+void sentinel_totals(const SentinelEngine *e, SentinelTotals *out) {
+  const RunTotals *t = &e->totals;
+  out->data_rows = t->data_rows;
+  out->valid = t->valid_count;
+  out->invalid = t->invalid_rows;
+  out->missing_ids = t->missing_ids;
+  out->missing_dates = t->missing_dates;
+  out->invalid_columns = t->invalid_columns;
+  out->invalid_numeric = t->invalid_numeric;
+  out->invalid_date_format = t->invalid_date_format;
+  out->invalid_range = t->invalid_range;
+  out->future_dates = t->future_dates;
+  out->clamped_values = t->clamped_values;
+  out->high = t->high_count;
+  out->medium = t->medium_count;
+  out->low = t->low_count;
+}
+
+int sentinel_cohort_total(const SentinelEngine *e) {
+  return e->cohorts.count;
+}
+
+int sentinel_cohort_count(const SentinelEngine *e) {
+  return e->finalized ? e->cohort_display : 0;
+}
+
+int sentinel_cohort_at(const SentinelEngine *e, int index, SentinelCohort *out) {
+  if (index < 0 || index >= sentinel_cohort_count(e)) return 0;
+  const CohortSummary *c = &e->summaries[index];
+  out->cohort = c->cohort;
+  out->level = c->level;
+  out->count = c->count;
+  out->high = c->high;
+  out->medium = c->medium;
+  out->low = c->low;
+  out->high_share = c->high_share;
+  out->risk_index = c->risk_index;
+  out->avg_touchpoints_30d = c->avg_touchpoints;
+  out->avg_attendance = c->avg_attendance;
+  out->avg_satisfaction = c->avg_satisfaction;
+  out->avg_days_since = c->avg_days;
+  memcpy(out->percentiles, c->percentiles, sizeof(out->percentiles));
+  return 1;
+}
+
+int sentinel_alert_count(const SentinelEngine *e) {
+  return e->finalized ? e->alert_count : 0;
+}
+
+int sentinel_alert_at(const SentinelEngine *e, int index, SentinelAlert *out) {
+  if (index < 0 || index >= sentinel_alert_count(e)) return 0;
+  const CohortAlert *a = &e->alerts[index];
+  out->cohort = a->cohort;
+  out->level = a->level;
+  out->count = a->count;
+  out->high = a->high;
+  out->medium = a->medium;
+  out->low = a->low;
+  out->high_share = a->high_ratio;
+  out->risk_index = a->risk_index;
+  out->avg_days_since = a->avg_days;
+  out->avg_attendance = a->avg_attendance;
+  out->avg_satisfaction = a->avg_satisfaction;
+  return 1;
+}
+
+int sentinel_risk_count(const SentinelEngine *e) {
+  return e->finalized ? e->report.risk_count : 0;
+}
+
+int sentinel_risk_at(const SentinelEngine *e, int index, SentinelRisk *out) {
+  if (index < 0 || index >= sentinel_risk_count(e)) return 0;
+  const RiskEntry *r = &e->risks.entries[index];
+  out->scholar_id = r->id;
+  out->cohort = r->cohort;
+  out->score = r->risk_score;
+  out->days_since = r->days_since;
+  out->touchpoints_30d = r->touchpoints_30d;
+  out->attendance_rate = r->attendance_rate;
+  out->satisfaction_score = r->satisfaction_score;
+  return 1;
+}
+
+void sentinel_engine_free(SentinelEngine *e) {
+  if (!e) return;
+  if (e->ctx.scored) scored_out_close(e->ctx.scored);
+  free(e->summaries);
+  free(e->alerts);
+  free(e->buf);
+  cohort_table_free(&e->cohorts);
+  top_risks_free(&e->risks);
+  columns_free(&e->columns);
+  file_jobs_free(e->file_jobs, e->path_count);
+  free(e->input_counts);
+  state_free(&e->state);
+  dedupe_free(&e->dedupe);
+  if (e->scenarios != &e->base) free(e->scenarios);
+  for (int i = 0; i < e->path_count; i++) free(e->paths[i]);
+  free(e->paths);
+  free(e->cache_path);
+  free(e->state_path);
+  free(e->scored_path);
+  free(e->rollup.filters);
+  free(e->filters);
+  free(e->filter_buffer);
+  free(e);
+}
+
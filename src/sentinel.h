@@ -0,0 +1,200 @@
+/* Embedding API for the Cohort Health Sentinel scoring engine.
+
+   An engine handle owns everything one report needs (options, cohort table,
+   top-risk heap, date cache); there is no global state, so separate handles
+   may run on separate threads. One handle must not be used by two threads
+   at once. Rows go through the same validation and scoring as the
+   command-line tool, so a handle fed an export reports what a plain run over
+   that export with the same options reports.
+
+   Build the shared library with
+     cc -std=c11 -O2 -pthread -fPIC -shared -o libsentinel.so src/sentinel.c
+
+   Typical use: sentinel_options_init(), set fields, sentinel_engine_create(),
+   feed with sentinel_feed_buffer(), sentinel_feed_rows() or
+   sentinel_feed_files(), then sentinel_finalize() and read the results
+   through the accessors or sentinel_write() until sentinel_engine_free().
+   Result strings stay valid until the handle is freed. */
+#ifndef SENTINEL_H
+#define SENTINEL_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SENTINEL_API_VERSION 2
+
+typedef struct SentinelEngine SentinelEngine;
+
+/* Mirrors the command-line options of the same names. Strings are copied by
+   sentinel_engine_create(). */
+typedef struct {
+  const char *as_of;           /* --as-of YYYY-MM-DD; NULL scores as of today */
+  const char *cohort_filter;   /* --cohort list, comma separated; NULL for all */
+  const char *cohort_sort;     /* "risk" (default), "high" or "name" */
+  const char *scoring_profile; /* --scoring-profile file; NULL for the default */
+  int limit;                   /* top risks kept (10) */
+  int cohort_limit;            /* cohorts kept per level; -1 keeps all (default) */
+  double alert_threshold;      /* 0.30 */
+  int min_cohort_size;         /* 5 */
+  int clamp_ranges;            /* --clamp-ranges */
+  int percentiles;             /* --percentiles */
+  char rollup_separator;       /* --rollup-separator; 0 keeps cohorts flat */
+  const char *scenarios;       /* --scenarios file; NULL scores one report */
+  const char *dedupe;          /* --dedupe first|last|latest; NULL keeps every row */
+  int threads;                 /* --threads; above 1 also streams (1) */
+  int stream;                  /* --stream */
+  const char *cache;           /* --cache file */
+  const char *state;           /* --state file, written by sentinel_save() */
+  int state_delta;             /* --state-delta */
+  const char *scored_out;      /* --scored-out file, closed by sentinel_save() */
+  int stats;                   /* collect --stats phase timings */
+} SentinelOptions;
+
+/* What sentinel_write() produces: the text report, --cohort-csv,
+   --alert-csv, --json, or the --stats summary as text or JSON. */
+typedef enum {
+  SENTINEL_OUTPUT_TEXT,
+  SENTINEL_OUTPUT_COHORT_CSV,
+  SENTINEL_OUTPUT_ALERT_CSV,
+  SENTINEL_OUTPUT_JSON,
+  SENTINEL_OUTPUT_STATS_TEXT,
+  SENTINEL_OUTPUT_STATS_JSON
+} SentinelOutput;
+
+/* One export row, each field as its CSV text. NULL or empty fields drop
+   out the way empty CSV fields do, so the row then counts as short. */
+typedef struct {
+  const char *scholar_id;
+  const char *cohort;
+  const char *last_touchpoint_date;
+  const char *touchpoints_30d;
+  const char *attendance_rate;
+  const char *satisfaction_score;
+} SentinelRow;
+
+typedef struct {
+  int data_rows;
+  int valid;
+  int invalid;
+  int missing_ids;
+  int missing_dates;
+  int invalid_columns;
+  int invalid_numeric;
+  int invalid_date_format;
+  int invalid_range;
+  int future_dates;
+  int clamped_values;
+  int high;
+  int medium;
+  int low;
+} SentinelTotals;
+
+typedef struct {
+  const char *scholar_id;
+  const char *cohort;
+  int score;
+  int days_since;
+  int touchpoints_30d;
+  double attendance_rate;
+  double satisfaction_score;
+} SentinelRisk;
+
+/* percentiles[metric][q]: metrics attendance, satisfaction, touchpoints_30d,
+   days_since; q = p10, p50, p90. Zero unless options.percentiles is set. */
+typedef struct {
+  const char *cohort;
+  int level;
+  int count;
+  int high;
+  int medium;
+  int low;
+  double high_share;
+  double risk_index;
+  double avg_touchpoints_30d;
+  double avg_attendance;
+  double avg_satisfaction;
+  double avg_days_since;
+  double percentiles[4][3];
+} SentinelCohort;
+
+typedef struct {
+  const char *cohort;
+  int level;
+  int count;
+  int high;
+  int medium;
+  int low;
+  double high_share;
+  double risk_index;
+  double avg_days_since;
+  double avg_attendance;
+  double avg_satisfaction;
+} SentinelAlert;
+
+void sentinel_options_init(SentinelOptions *options);
+
+/* Returns NULL and writes a message to error (when given) on bad options or
+   allocation failure. */
+SentinelEngine *sentinel_engine_create(const SentinelOptions *options, char *error, size_t error_len);
+
+/* Feeds CSV bytes split anywhere, header line first. A handle takes either
+   CSV bytes or rows, not both. These return 1, or 0 on allocation failure,
+   once sentinel_finalize() has run (whether or not it succeeded), or when
+   the handle was fed the other way. */
+int sentinel_feed_buffer(SentinelEngine *engine, const char *data, size_t len);
+int sentinel_feed_rows(SentinelEngine *engine, const SentinelRow *rows, size_t count);
+
+/* Reads and parses export files ("-" is stdin; .gz and .zst when built in)
+   the way --input does, honouring cache, state, dedupe, stream and threads.
+   Feeds a fresh handle once; it then takes no CSV bytes or rows. Returns 1,
+   or 0 after printing the reason to stderr, which is final. It is the only
+   feed that works with scenarios or dedupe last/latest. */
+int sentinel_feed_files(SentinelEngine *engine, char *const *paths, int count);
+
+/* Scenarios loaded from options.scenarios, or 1 for the plain options.
+   Names are NULL without scenarios or when index is out of range. */
+int sentinel_scenario_count(const SentinelEngine *engine);
+const char *sentinel_scenario_name(const SentinelEngine *engine, int index);
+
+/* Scores any final line without a newline and builds the results. Returns
+   1, also on repeated calls once it has succeeded, or 0 on allocation
+   failure. A failure is not retryable: the handle then rejects feeds, this
+   keeps returning 0, and it only remains to free it. */
+int sentinel_finalize(SentinelEngine *engine);
+
+/* Like sentinel_finalize() for one scenario of a handle fed files; the
+   accessors and sentinel_write() then show that scenario until the next
+   call. */
+int sentinel_finalize_scenario(SentinelEngine *engine, int index);
+
+/* Writes one output of the finalized report (stats at any point) to fd,
+   which is left open. JSON scenario reports written in order form one
+   document. Returns 0 on a write error, with errno set. */
+int sentinel_write(SentinelEngine *engine, SentinelOutput output, int fd);
+
+/* Closes options.scored_out and writes options.state after the last
+   finalize. Returns 1, or 0 after printing the reason to stderr. */
+int sentinel_save(SentinelEngine *engine);
+
+/* Result accessors, valid after sentinel_finalize(). The *_at functions
+   return 0 when index is out of range. */
+const char *sentinel_reference_date(const SentinelEngine *engine);
+void sentinel_totals(const SentinelEngine *engine, SentinelTotals *out);
+int sentinel_cohort_total(const SentinelEngine *engine);
+int sentinel_cohort_count(const SentinelEngine *engine);
+int sentinel_cohort_at(const SentinelEngine *engine, int index, SentinelCohort *out);
+int sentinel_alert_count(const SentinelEngine *engine);
+int sentinel_alert_at(const SentinelEngine *engine, int index, SentinelAlert *out);
+int sentinel_risk_count(const SentinelEngine *engine);
+int sentinel_risk_at(const SentinelEngine *engine, int index, SentinelRisk *out);
+
+void sentinel_engine_free(SentinelEngine *engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
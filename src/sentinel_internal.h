@@ -0,0 +1,635 @@
+/* Internals shared by the library (sentinel.c) and the command-line tool
+   (main.c), whose --serve, --trend, --watch and --pg-sink modes drive the
+   core directly. Everything here has hidden visibility, so libsentinel.so
+   exports only the sentinel.h API. */
+#ifndef SENTINEL_INTERNAL_H
+#define SENTINEL_INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "sentinel.h"
+
+#pragma GCC visibility push(hidden)
+
+#define READ_CHUNK 65536
+#define MAX_THREADS 256
+#define MAX_NAME 64
+#define MAX_DATE 16
+#define DATE_CACHE_SLOTS 256
+#define SCORE_BLOCK 256
+
+typedef struct {
+  const char *ptr;
+  size_t len;
+} StrView;
+
+/* Scans one line starting at data[*pos] into up to six fields and advances
+   *pos past its newline. See scan_line_scalar(). */
+typedef int (*ScanLineFn)(const char *data, size_t len, size_t *pos, StrView *line,
+                          StrView fields[6], int *field_count);
+
+/* One parsed CSV row whose text fields point into the reader's buffer. Only
+   valid until the next input_next_row() call. */
+typedef struct {
+  StrView id;
+  StrView cohort;
+  StrView last_touchpoint;
+  int touchpoints_30d;
+  double attendance_rate;
+  double satisfaction_score;
+  int valid;
+  size_t offset;
+} ScholarRow;
+
+typedef struct Decompressor Decompressor;
+
+/* Line source over the input file. Regular files are memory-mapped and lines
+   are handed out as views into the mapping; pipes and stdin fall back to a
+   growable read() buffer, and so do compressed inputs, which dec fills.
+   bytes_read and line offsets count decompressed bytes; error is set when
+   the input ended early because a read or decompression failed. */
+typedef struct {
+  int fd;
+  const char *map;
+  size_t map_len;
+  const char *packed_map;
+  size_t packed_len;
+  Decompressor *dec;
+  char *buf;
+  size_t buf_len;
+  size_t buf_cap;
+  size_t pos;
+  int eof;
+  const char *error;
+  size_t bytes_read;
+  size_t line_offset;
+  ScanLineFn scan_line;
+} InputReader;
+
+/* Bump allocator for strings that live as long as their owner: a chain of
+   blocks that never move, so handed-out pointers stay valid until
+   arena_free() releases every block at once. */
+typedef struct ArenaBlock {
+  struct ArenaBlock *next;
+  size_t used;
+  size_t cap;
+  char data[];
+} ArenaBlock;
+
+typedef struct {
+  ArenaBlock *head;
+  size_t used;
+} Arena;
+
+/* Order-independent sum of non-negative doubles: an integer part plus a
+   2^-64 fixed-point fraction. Each value is rounded the same way no matter
+   where it lands, so per-thread partial sums merge to identical bits. */
+typedef struct {
+  uint64_t whole;
+  uint64_t frac;
+} FixedSum;
+
+/* --percentiles keeps a log-bucket histogram per cohort and metric, with 64
+   buckets per power of two: a bucket is a double's exponent and top six
+   mantissa bits, so it spans at most 1/64 of its values and a reported
+   quantile lies within 0.78% of a value of that rank. Counts only add,
+   so sketches merge in any order to the same counts. */
+enum { SKETCH_ATTENDANCE, SKETCH_SATISFACTION, SKETCH_TOUCHPOINTS, SKETCH_DAYS_SINCE, SKETCH_METRICS };
+enum { SKETCH_P10, SKETCH_P50, SKETCH_P90, SKETCH_QUANTILES };
+#define SKETCH_SUB_BITS 6
+#define SKETCH_BUCKETS 2948
+
+/* Values under 2^min_exp count in the zero bucket (reported as 0); values
+   from 2^(min_exp + octaves) share the top bucket. `first` places the zero
+   bucket in the cohort's SKETCH_BUCKETS counts. */
+typedef struct {
+  const char *name;
+  int min_exp;
+  int octaves;
+  int integral;
+  int first;
+} SketchMetric;
+
+extern const SketchMetric k_sketch_metrics[SKETCH_METRICS];
+
+typedef struct {
+  char *name;
+  size_t name_len;
+  uint32_t *sketch;
+  int count;
+  int high;
+  int medium;
+  int low;
+  FixedSum attendance_sum;
+  FixedSum satisfaction_sum;
+  long long touchpoints_sum;
+  long long days_since_sum;
+  int parent;
+  int level;
+} CohortStats;
+
+/* --rollup-separator: cohort names are paths ("Region/Campus/Section") and
+   every row also counts toward each ancestor. `filters` is the --cohort
+   list sorted, so a name passes when it or any ancestor is named. */
+typedef struct {
+  char separator;
+  char **filters;
+  int filter_count;
+} Rollup;
+
+/* Open-addressing index over interned cohort names. Entries stay dense in
+   insertion order; slots hold entry index + 1 (0 marks an empty slot).
+   A `sketched` table gives each new entry its SKETCH_BUCKETS counts. In a
+   `rollup` table each entry has a level (its path depth) and links to its
+   parent prefix when that passes the filter; -1 otherwise. */
+typedef struct {
+  CohortStats *entries;
+  int count;
+  int capacity;
+  int *slots;
+  uint32_t *slot_hashes;
+  int slot_count;
+  int rehashes;
+  int sketched;
+  const Rollup *rollup;
+  Arena names;
+} CohortTable;
+
+/* A kept top-risk row. id is the list's own NUL-terminated copy; cohort is
+   a handle to the interned name in the run's CohortTable. */
+typedef struct {
+  const char *id;
+  size_t id_len;
+  const char *cohort;
+  int risk_score;
+  int days_since;
+  int touchpoints_30d;
+  double attendance_rate;
+  double satisfaction_score;
+  size_t offset;
+} RiskEntry;
+
+typedef struct {
+  const char *cohort;
+  int count;
+  int high;
+  int medium;
+  int low;
+  double high_ratio;
+  double risk_index;
+  double avg_days;
+  double avg_attendance;
+  double avg_satisfaction;
+  int level;
+} CohortAlert;
+
+typedef struct {
+  const char *cohort;
+  int count;
+  int high;
+  int medium;
+  int low;
+  double high_share;
+  double risk_index;
+  double avg_touchpoints;
+  double avg_attendance;
+  double avg_satisfaction;
+  double avg_days;
+  double percentiles[SKETCH_METRICS][SKETCH_QUANTILES];
+  int level;
+} CohortSummary;
+
+typedef enum {
+  SORT_RISK,
+  SORT_HIGH,
+  SORT_NAME
+} CohortSort;
+
+typedef struct {
+  int data_rows;
+  int valid_count;
+  int invalid_rows;
+  int missing_dates;
+  int missing_ids;
+  int invalid_columns;
+  int invalid_numeric;
+  int invalid_date_format;
+  int invalid_range;
+  int future_dates;
+  int clamped_values;
+  int recency_over_30;
+  int recency_15_30;
+  int recency_8_14;
+  int touchpoints_zero;
+  int touchpoints_one;
+  int attendance_low;
+  int attendance_mid;
+  int satisfaction_low;
+  int satisfaction_mid;
+  int high_count;
+  int medium_count;
+  int low_count;
+  int duplicate_rows;
+} RunTotals;
+
+/* Row counts for one file of a multi-file run, reported so a bad source
+   stands out. */
+typedef struct {
+  const char *path;
+  int rows;
+  int valid;
+  int invalid;
+} InputCount;
+
+/* Bounded heap holding the best `capacity` risk entries. The root is the
+   entry that sorts last under compare_risk, so a candidate only needs one
+   comparison to be rejected. `entries` grows with `count` up to `capacity`,
+   so a huge --limit costs only the rows actually kept. Kept ids are copied
+   into `ids`; evicted ones stay behind until the arena is compacted.
+   `failed` sticks once a row that ranks was dropped for lack of memory, so
+   the run fails instead of printing a short list. */
+typedef struct {
+  RiskEntry *entries;
+  int count;
+  int allocated;
+  int capacity;
+  Arena ids;
+  size_t live_ids;
+  int failed;
+} TopRisks;
+
+/* Direct-mapped cache of recently parsed date strings. Exports carry only a
+   few hundred distinct dates, so most rows resolve with two word compares. */
+typedef struct {
+  uint64_t key[2];
+  int day;
+  unsigned char used;
+  unsigned char ok;
+} DateCacheSlot;
+
+typedef struct {
+  DateCacheSlot slots[DATE_CACHE_SLOTS];
+} DateCache;
+
+/* Risk scoring policy. Each signal lists its bounds from mild to severe with
+   the points a row scores in that bucket; a row also in a more severe bucket
+   scores only that bucket's points. Tiers: medium_at / high_at points. */
+typedef struct {
+  char name[MAX_NAME];
+  int recency_days[3];
+  int recency_points[3];
+  int touchpoints_at_most[2];
+  int touchpoints_points[2];
+  double attendance_below[2];
+  int attendance_points[2];
+  double satisfaction_below[2];
+  int satisfaction_points[2];
+  int medium_at;
+  int high_at;
+} ScoringProfile;
+
+extern const ScoringProfile k_default_profile;
+
+/* Writer for --scored-out, defined with the other output code. */
+typedef struct ScoredOut ScoredOut;
+
+/* --dedupe: which row of a repeated scholar id is scored. */
+enum {
+  DEDUPE_OFF = 0,
+  DEDUPE_FIRST,
+  DEDUPE_LAST,
+  DEDUPE_LATEST
+};
+
+#define DEDUPE_PART_BITS 4
+#define DEDUPE_PARTS (1 << DEDUPE_PART_BITS)
+
+/* One distinct id: its 64-bit fingerprint (0 marks an empty slot), the
+   ordinal of its winning row and that row's touchpoint day. */
+typedef struct {
+  uint64_t fp;
+  uint32_t row;
+  int32_t day;
+} DedupeSlot;
+
+typedef struct {
+  DedupeSlot *slots;
+  uint32_t mask;
+  uint32_t count;
+} DedupePart;
+
+/* Linear-probing fingerprint table, split by the fingerprint's top bits so
+   per-segment tables merge one partition per thread. Rows are numbered in
+   input order over the rows --dedupe considers (valid, with a parseable
+   date); once finished, `keep` flags each id's winning ordinal. Without
+   `keep`, rows are resolved as they arrive, which only DEDUPE_FIRST over a
+   single ordered pass allows. */
+typedef struct {
+  int mode;
+  DedupePart parts[DEDUPE_PARTS];
+  uint32_t rows;
+  unsigned char *keep;
+  int failed;
+} Dedupe;
+
+typedef struct {
+  int as_of_day;
+  DateCache *dates;
+  char **cohort_filters;
+  int cohort_filter_count;
+  RunTotals *totals;
+  CohortTable *cohorts;
+  TopRisks *risks;
+  const ScoringProfile *profile;
+  int generic_profile;
+  ScoredOut *scored;
+  Dedupe *dedupe;
+  uint32_t dedupe_row;
+  const Rollup *rollup;
+} ScoreContext;
+
+enum {
+  ROW_INVALID = 0,
+  ROW_VALID = 1,
+  ROW_BAD_DATE = 2
+};
+
+/* Buffered rows stored column by column, so the scoring pass reads only the
+   numeric columns. Cohort names are interned in `names` (cohort_ids index
+   it) and scholar ids are NUL-terminated in `arena`. Rows that failed
+   validation keep state ROW_INVALID and nothing else. Ids are only read
+   when a row makes the top-risk list. Columns loaded from --cache point
+   into the `mapped` file instead of the heap. */
+typedef struct {
+  int count;
+  int capacity;
+  int grows;
+  int *touchpoints;
+  double *attendance;
+  double *satisfaction;
+  int *days;
+  int *cohort_ids;
+  unsigned char *state;
+  size_t *id_offsets;
+  uint32_t *id_lens;
+  size_t *offsets;
+  char *arena;
+  size_t arena_len;
+  size_t arena_cap;
+  CohortTable names;
+  void *mapped;
+  size_t mapped_len;
+} ScholarColumns;
+
+typedef enum {
+  PHASE_OPEN,
+  PHASE_PARSE,
+  PHASE_SCORE,
+  PHASE_SORT_RISKS,
+  PHASE_SUMMARIES,
+  PHASE_ALERTS,
+  PHASE_WRITE_TEXT,
+  PHASE_WRITE_COHORT_CSV,
+  PHASE_WRITE_ALERT_CSV,
+  PHASE_WRITE_JSON,
+  PHASE_WRITE_PG,
+  PHASE_COUNT
+} StatsPhase;
+
+/* Per-phase wall and CPU time for --stats. Laps are taken between phases,
+   never per row, and are skipped entirely when stats are off. Row
+   validation happens inside the parse loop and is charged to it; so is
+   scoring in --stream/--threads runs (fused_scoring). */
+typedef struct {
+  int enabled;
+  int fused_scoring;
+  double wall[PHASE_COUNT];
+  double cpu[PHASE_COUNT];
+  double mark_wall;
+  double mark_cpu;
+  int scholar_grows;
+  int scenarios;
+  int state_used;
+  int state_applied;
+  int state_unchanged;
+  int state_retired;
+  int state_rescored;
+  int cache_used;
+  int cache_hit;
+  int input_files;
+  int dedupe_mode;
+  uint32_t dedupe_rows;
+  uint32_t dedupe_ids;
+  uint64_t dedupe_slots;
+} RunStats;
+
+enum {
+  TIER_LOW = 0,
+  TIER_MEDIUM = 1,
+  TIER_HIGH = 2
+};
+
+/* Counters produced by the scoring kernels, in the order they are summed. */
+enum {
+  KC_FUTURE,
+  KC_RECENCY_OVER_30,
+  KC_RECENCY_15_30,
+  KC_RECENCY_8_14,
+  KC_TOUCHPOINTS_ZERO,
+  KC_TOUCHPOINTS_ONE,
+  KC_ATTENDANCE_LOW,
+  KC_ATTENDANCE_MID,
+  KC_SATISFACTION_LOW,
+  KC_SATISFACTION_MID,
+  KC_HIGH,
+  KC_MEDIUM,
+  KC_LOW,
+  KC_COUNT
+};
+
+/* One block of columnar rows for a scoring kernel. Rows with eligible[i] == 0
+   still get outputs written but are left out of every counter. */
+typedef struct {
+  int as_of_day;
+  const int *days;
+  const int *touchpoints;
+  const double *attendance;
+  const double *satisfaction;
+  const unsigned char *eligible;
+  int *days_since;
+  int *scores;
+  int *tiers;
+  const ScoringProfile *profile;
+} ScoreBlock;
+
+typedef void (*ScoreKernelFn)(const ScoreBlock *b, int start, int end, int counts[KC_COUNT]);
+
+/* One scoring/alert configuration evaluated against the parsed columns. */
+typedef struct {
+  char name[MAX_NAME];
+  ScoringProfile profile;
+  double alert_threshold;
+  int min_cohort_size;
+  int limit;
+} Scenario;
+
+enum { PACK_NONE, PACK_GZIP, PACK_ZSTD };
+
+typedef struct {
+  const char *path;
+  size_t base;
+  int stream;
+  int clamp_ranges;
+  ScholarColumns cols;
+  ScoreContext ctx;
+  RunTotals totals;
+  CohortTable cohorts;
+  TopRisks risks;
+  DateCache dates;
+  size_t bytes_read;
+  int open_errno;
+  const char *read_error;
+  int failed;
+} FileJob;
+
+typedef struct {
+  uint64_t size;
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+  uint64_t hash;
+  int hashed;
+} CacheKey;
+
+typedef struct {
+  int fd;
+  char *buf;
+  size_t len;
+  size_t cap;
+  int failed;
+  /* When set, flushed bytes go here instead of fd; returns 0 on failure. */
+  int (*sink)(void *ctx, const char *p, size_t n);
+  void *sink_ctx;
+} OutBuf;
+
+/* Everything the writers need once scoring is done. */
+typedef struct {
+  const char *reference_date;
+  const char *cohort_sort;
+  char **cohort_filters;
+  int cohort_filter_count;
+  const RunTotals *totals;
+  const RiskEntry *risks;
+  int risk_count;
+  const CohortSummary *summaries;
+  int cohort_count;
+  int cohort_display;
+  const CohortAlert *alerts;
+  int alert_count;
+  double alert_threshold;
+  int min_cohort_size;
+  const ScoringProfile *profile;
+  const char *scenario;
+  int scenario_index;
+  const InputCount *inputs;
+  int input_count;
+  const char *dedupe;
+  int percentiles;
+  char rollup_separator;
+  /* Threads for large row tables; 0 or 1 writes them sequentially. */
+  int workers;
+} Report;
+
+extern const char *const k_sort_names[3];
+
+/* Parsing and dates. */
+void trim(char *s);
+int parse_int(const char *s, int *out);
+int parse_double(const char *s, double *out);
+StrView trim_view(StrView v);
+void civil_from_days(int z, int *y, int *m, int *d);
+int parse_date_fixed(const char *s, int *y, int *m, int *d);
+int parse_date(const char *s, int *day_out);
+int local_today(void);
+int date_cache_parse(DateCache *cache, StrView s, int *day_out);
+
+/* Scoring profiles and cohorts. */
+int profile_is_default(const ScoringProfile *p);
+ScoreKernelFn select_score_kernel(const ScoringProfile *profile);
+double cohort_risk_index(int high, int medium, int low);
+CohortSort cohort_sort_mode(const char *value, int *ok);
+int matches_cohort(StrView cohort, char **filters, int filter_count);
+int split_cohort_filters(const char *text, char **buffer, char ***filters, int *count);
+int compare_name_ptr(const void *a, const void *b);
+int load_scoring_profile(const char *path, ScoringProfile *out);
+int cohort_table_init(CohortTable *table);
+void cohort_table_free(CohortTable *table);
+int find_or_add_cohort(CohortTable *table, StrView name);
+
+/* Top-risk selection. */
+int compare_risk(const void *a, const void *b);
+int top_risks_init(TopRisks *top, int capacity);
+void top_risks_free(TopRisks *top);
+int top_risks_admits(const TopRisks *top, int score, int days_since, StrView id, size_t offset);
+int top_risks_push(TopRisks *top, const RiskEntry *entry, StrView id);
+void top_risks_finish(TopRisks *top, int workers);
+
+/* Input readers. */
+ScanLineFn select_scan_line(void);
+int packed_format(const unsigned char *lead, size_t len);
+void input_close(InputReader *in);
+int input_open(InputReader *in, const char *path);
+int input_next_row(InputReader *in, StrView *line, StrView fields[6], int *field_count);
+int parse_scholar_fields(const StrView fields[6], int field_count, ScholarRow *row,
+                         RunTotals *t, int clamp_ranges);
+int dedupe_mode(const char *value);
+
+/* Scoring and ingest. */
+void run_totals_add_counts(RunTotals *t, const int counts[KC_COUNT]);
+void account_row(ScoreContext *ctx, CohortStats *c, int score, int tier, int days_since, int touchpoints,
+                 double attendance, double satisfaction, StrView id, StrView cohort, size_t offset);
+void score_row(const ScholarRow *s, ScoreContext *ctx);
+void score_csv_lines(const char *data, size_t len, uint64_t base, int *lines, ScanLineFn scan_line,
+                     ScoreContext *ctx, int clamp_ranges);
+int columns_init(ScholarColumns *cols);
+void columns_free(ScholarColumns *cols);
+int score_columns(const ScholarColumns *cols, ScoreContext *ctx);
+void run_totals_merge(RunTotals *into, const RunTotals *from);
+void file_jobs_free(FileJob *jobs, int count);
+FileJob *ingest_files(char **paths, int count, int workers, int stream, ScoreContext *ctx, int clamp_ranges,
+                      const uint32_t *dedupe_bases, InputCount *counts);
+int cache_source_key(const InputReader *in, CacheKey *key);
+int load_columns(InputReader *in, const char *cache_path, int clamp_ranges, ScholarColumns *cols,
+                 RunTotals *t, DateCache *dates);
+int default_workers(int threads);
+
+/* Buffered output and reports. */
+int out_init(OutBuf *o, int fd);
+int out_flush(OutBuf *o);
+int out_close(OutBuf *o);
+int out_open(OutBuf *o, const char *path);
+void out_bytes(OutBuf *o, const char *p, size_t n);
+void out_str(OutBuf *o, const char *s);
+void out_char(OutBuf *o, char c);
+void out_int(OutBuf *o, long long v);
+void out_printf(OutBuf *o, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void out_fixed(OutBuf *o, double v, int decimals);
+void out_json_str(OutBuf *o, const char *s);
+void out_csv_str(OutBuf *o, const char *s);
+CohortSummary *build_cohort_summaries(const CohortTable *cohorts, CohortSort sort, int workers);
+int build_alerts(const CohortSummary *summaries, int cohort_count, double alert_threshold,
+                 int min_cohort_size, CohortAlert **out);
+int cohort_display_count(CohortSummary *summaries, int count, int limit);
+void write_text_report(OutBuf *out, const Report *r);
+void write_cohort_csv(OutBuf *out, const Report *r);
+void write_alert_csv(OutBuf *out, const Report *r);
+void write_json_report(OutBuf *out, const Report *r);
+
+/* The report and stats of an engine, for the CLI's --pg-sink. */
+const Report *engine_report(const SentinelEngine *e);
+void engine_lap(SentinelEngine *e, StatsPhase phase);
+
+#pragma GCC visibility pop
+
+#endif
@@ -4,7 +4,7 @@ set -euo pipefail
 PROJECT_ROOT=$(CDPATH= cd -- "$(dirname -- "$0")/.." && pwd)
 cd "$PROJECT_ROOT"
 
-cc -std=c11 -O2 -o cohort-health-sentinel src/main.c
+cc -std=c11 -O2 -pthread -o cohort-health-sentinel src/main.c src/sentinel.c
 
 output=$(./cohort-health-sentinel --input data/sample.csv --limit 3 --cohort-limit 2)
 printf '%s\n' "$output" | grep -q "Cohort summary"
@@ -83,4 +83,1048 @@ head -n 1 "$cohort_csv" | grep -q "cohort,count,high,medium,low,high_share,risk_
 head -n 1 "$alert_csv" | grep -q "cohort,high_share,risk_index,count,high,medium,low,avg_days_since,avg_attendance,avg_satisfaction"
 rm -f "$cohort_csv" "$alert_csv"
 
+buffered_json=$(mktemp)
+stream_json=$(mktemp)
+./cohort-health-sentinel --input data/sample.csv --as-of 2026-02-01 --limit 4 --json "$buffered_json" > /dev/null
+./cohort-health-sentinel --input data/sample.csv --as-of 2026-02-01 --limit 4 --json "$stream_json" --stream > /dev/null
+cmp -s "$buffered_json" "$stream_json"
+./cohort-health-sentinel --input - --as-of 2026-02-01 --limit 4 --json "$stream_json" --stream < data/sample.csv > /dev/null
+cmp -s "$buffered_json" "$stream_json"
+python3 - "$stream_json" <<'PY'
+import json
+import sys
+
+with open(sys.argv[1], "r", encoding="utf-8") as fh:
+    payload = json.load(fh)
+
+ids = [entry["id"] for entry in payload["top_risks"]]
+assert ids == ["S-1008", "S-1002", "S-1005", "S-1007"], ids
+PY
+./cohort-health-sentinel --input data/sample.csv --as-of 2026-02-01 --limit 2147483647 --json "$buffered_json" > /dev/null
+./cohort-health-sentinel --input data/sample.csv --as-of 2026-02-01 --limit 2147483647 --json "$stream_json" --stream > /dev/null
+cmp -s "$buffered_json" "$stream_json"
+python3 - "$buffered_json" <<'PY'
+import json
+import sys
+
+with open(sys.argv[1], "r", encoding="utf-8") as fh:
+    payload = json.load(fh)
+
+assert len(payload["top_risks"]) == payload["records"]["valid"] == 10, payload["records"]
+PY
+rm -f "$buffered_json" "$stream_json"
+
+many_csv=$(mktemp)
+many_json=$(mktemp)
+python3 - "$many_csv" <<'PY'
+import sys
+
+with open(sys.argv[1], "w", encoding="utf-8") as fh:
+    fh.write("scholar_id,cohort,last_touchpoint_date,touchpoints_last_30d,attendance_rate,satisfaction_score\n")
+    for i in range(750):
+        fh.write(f"S-{i},Section-{i % 250},2026-01-20,2,0.85,4.2\n")
+PY
+./cohort-health-sentinel --input "$many_csv" --as-of 2026-02-01 --json "$many_json" --cohort-limit 0 > /dev/null
+threaded_json=$(mktemp)
+./cohort-health-sentinel --input "$many_csv" --as-of 2026-02-01 --json "$threaded_json" --cohort-limit 0 --threads 4 > /dev/null
+cmp -s "$many_json" "$threaded_json"
+./cohort-health-sentinel --input "$many_csv" --as-of 2026-02-01 --limit 2147483647 --json "$many_json" > /dev/null
+./cohort-health-sentinel --input "$many_csv" --as-of 2026-02-01 --limit 2147483647 --json "$threaded_json" --threads 4 > /dev/null
+cmp -s "$many_json" "$threaded_json"
+python3 - "$threaded_json" <<'PY'
+import json
+import sys
+
+with open(sys.argv[1], "r", encoding="utf-8") as fh:
+    payload = json.load(fh)
+
+assert len(payload["top_risks"]) == 750, len(payload["top_risks"])
+PY
+./cohort-health-sentinel --input "$many_csv" --input data/sample.csv --as-of 2026-02-01 --limit 2147483647 \
+  --stream --json "$many_json" > /dev/null
+./cohort-health-sentinel --input "$many_csv" --input data/sample.csv --as-of 2026-02-01 --limit 2147483647 \
+  --stream --threads 2 --json "$threaded_json" > /dev/null
+cmp -s "$many_json" "$threaded_json"
+./cohort-health-sentinel --input "$many_csv" --as-of 2026-02-01 --json "$many_json" --cohort-limit 0 > /dev/null
+rm -f "$threaded_json"
+python3 - "$many_json" <<'PY'
+import json
+import sys
+
+with open(sys.argv[1], "r", encoding="utf-8") as fh:
+    payload = json.load(fh)
+
+assert payload["cohort_total"] == 250, payload["cohort_total"]
+assert payload["records"]["valid"] == 750
+PY
+rm -f "$many_csv" "$many_json"
+
+scan_csv=$(mktemp)
+scan_json=$(mktemp)
+printf '%s\n' "scholar_id,cohort,last_touchpoint_date,touchpoints_last_30d,attendance_rate,satisfaction_score" \
+  "S-1,A,2026-01-10,1,0.50," "S-2,A,2026-01-10,1,0.50,3.0" ",,,,," "" > "$scan_csv"
+printf 'S-3,A,2026-01-10,1,0.50,4.0' >> "$scan_csv"
+for scanner in scalar sse2 avx2 neon; do
+  SENTINEL_SCANNER=$scanner ./cohort-health-sentinel --input "$scan_csv" --json "$scan_json" > /dev/null
+  python3 - "$scan_json" <<'PY'
+import json
+import sys
+
+with open(sys.argv[1], "r", encoding="utf-8") as fh:
+    payload = json.load(fh)
+
+assert payload["records"] == {"valid": 2, "invalid": 3}, payload["records"]
+assert payload["invalid_breakdown"]["columns"] == 2
+assert payload["invalid_breakdown"]["numeric"] == 1
+PY
+done
+cc -std=c11 -O2 -pthread -o scan-bench bench/scan_bench.c
+./scan-bench "$scan_csv" 1 > /dev/null
+./scan-bench data/sample.csv 1 > /dev/null
+rm -f "$scan_csv" "$scan_json" scan-bench
+
+cc -std=c11 -O2 -pthread -o kernel-bench bench/kernel_bench.c
+./kernel-bench 20011 1 > /dev/null
+rm -f kernel-bench
+
+cc -std=c11 -O2 -pthread -o format-bench bench/format_bench.c
+./format-bench 20000 1 > /dev/null
+rm -f format-bench
+
+stats_json=$(mktemp)
+./cohort-health-sentinel --input data/sample.csv --stats-json "$stats_json" > /dev/null
+./cohort-health-sentinel --input data/sample.csv --stats 2>&1 >/dev/null | grep "Rows: 10 " > /dev/null
+python3 - "$stats_json" <<'PY'
+import json
+import sys
+
+with open(sys.argv[1], "r", encoding="utf-8") as fh:
+    stats = json.load(fh)
+
+assert stats["mode"] == "buffered"
+assert stats["rows"] == 10
+assert stats["bytes_read"] > 0
+assert stats["peak_rss_kb"] > 0
+names = [phase["name"] for phase in stats["phases"]]
+assert names[:3] == ["open", "parse", "score"], names
+assert "write_json" in names
+assert 0 < stats["cohort_table"]["load"] <= 0.5
+PY
+rm -f "$stats_json"
+
+gen_a=$(mktemp)
+gen_b=$(mktemp)
+gen_json=$(mktemp)
+cc -std=c11 -O2 -o gen-cohort-csv bench/gen_cohort_csv.c
+./gen-cohort-csv --rows 5000 --cohorts 40 --invalid-ratio 0.1 --seed 9 --output "$gen_a"
+./gen-cohort-csv --rows 5000 --cohorts 40 --invalid-ratio 0.1 --seed 9 > "$gen_b"
+cmp -s "$gen_a" "$gen_b"
+./cohort-health-sentinel --input "$gen_a" --as-of 2026-03-01 --json "$gen_json" > /dev/null
+python3 - "$gen_json" <<'PY'
+import json
+import sys
+
+with open(sys.argv[1], "r", encoding="utf-8") as fh:
+    payload = json.load(fh)
+
+records = payload["records"]
+assert records["valid"] + records["invalid"] == 5000, records
+assert 300 < records["invalid"] < 700, records
+assert payload["cohort_total"] == 40
+PY
+cc -std=c11 -O2 -pthread -o sentinel-bench bench/sentinel_bench.c
+./sentinel-bench "$gen_a" --repeats 1 --as-of 2026-03-01 --threads 2 | grep "peak RSS" > /dev/null
+
+scored_dir=$(mktemp -d)
+./gen-cohort-csv --rows 70000 --cohorts 30 --seed 4 --output "$scored_dir/in.csv"
+./cohort-health-sentinel --input "$scored_dir/in.csv" --as-of 2026-03-01 --limit 70000 \
+  --json "$scored_dir/out.json" --scored-out "$scored_dir/rows.arrows" > /dev/null
+./cohort-health-sentinel --input "$scored_dir/in.csv" --as-of 2026-03-01 --stream \
+  --scored-out "$scored_dir/stream.arrows" > /dev/null
+cmp "$scored_dir/rows.arrows" "$scored_dir/stream.arrows"
+python3 - "$scored_dir" <<'PY'
+import json
+import sys
+
+sys.path.insert(0, "scripts")
+from read_scored import iter_batches
+
+base = sys.argv[1]
+with open(base + "/out.json", "r", encoding="utf-8") as fh:
+    payload = json.load(fh)
+rows = []
+batches = 0
+with open(base + "/rows.arrows", "rb") as fh:
+    for columns in iter_batches(fh):
+        batches += 1
+        rows.extend(zip(columns["scholar_id"], columns["cohort"], columns["risk_score"], columns["tier"],
+                        columns["days_since"], columns["attendance_rate"]))
+assert batches == 2, batches
+assert len(rows) == payload["records"]["valid"]
+scored = {(r[0], r[1], r[2], r[4]) for r in rows}
+for risk in payload["top_risks"]:
+    assert (risk["id"], risk["cohort"], risk["score"], risk["days_since"]) in scored, risk
+tiers = {"high": 0, "medium": 0, "low": 0}
+for r in rows:
+    tiers[r[3]] += 1
+assert tiers == payload["risk_mix"], tiers
+PY
+if ./cohort-health-sentinel --input "$scored_dir/in.csv" --threads 2 --scored-out "$scored_dir/x.arrows" > /dev/null 2>&1; then
+  echo "Expected --scored-out with --threads to fail." >&2
+  exit 1
+fi
+rm -rf "$scored_dir"
+rm -f "$gen_b" gen-cohort-csv sentinel-bench
+
+profile_dir=$(mktemp -d)
+./cohort-health-sentinel --input "$gen_a" --as-of 2026-03-01 --scoring-profile data/scoring-profile-strict.conf \
+  --json "$profile_dir/strict.json" > "$profile_dir/strict.txt"
+./cohort-health-sentinel --input "$gen_a" --as-of 2026-03-01 --scoring-profile data/scoring-profile-strict.conf \
+  --threads 2 --json "$profile_dir/strict-threads.json" > "$profile_dir/strict-threads.txt"
+SENTINEL_KERNEL=scalar ./cohort-health-sentinel --input "$gen_a" --as-of 2026-03-01 \
+  --scoring-profile data/scoring-profile-strict.conf --json "$profile_dir/strict-scalar.json" > /dev/null
+cmp -s "$profile_dir/strict.json" "$profile_dir/strict-threads.json"
+cmp -s "$profile_dir/strict.json" "$profile_dir/strict-scalar.json"
+grep -q "^Scoring profile: strict$" "$profile_dir/strict.txt"
+printf 'name = same\nrecency_days = 7, 14, 30\nhigh_at = 6\n' > "$profile_dir/same.conf"
+./cohort-health-sentinel --input "$gen_a" --as-of 2026-03-01 --scoring-profile "$profile_dir/same.conf" \
+  --json "$profile_dir/same.json" > /dev/null
+printf 'recency_days = 30, 14, 7\n' > "$profile_dir/bad.conf"
+if ./cohort-health-sentinel --input "$gen_a" --scoring-profile "$profile_dir/bad.conf" > /dev/null 2>&1; then
+  echo "Expected an out-of-order scoring profile to fail." >&2
+  exit 1
+fi
+python3 - "$gen_json" "$profile_dir/same.json" "$profile_dir/strict.json" <<'PY'
+import json
+import sys
+
+payloads = []
+for path in sys.argv[1:]:
+    with open(path, "r", encoding="utf-8") as fh:
+        payloads.append(json.load(fh))
+default, same, strict = payloads
+
+assert default["scoring_profile"]["name"] == "default"
+assert default["scoring_profile"]["specialized"] is True
+assert same["scoring_profile"]["name"] == "same"
+assert same["scoring_profile"]["specialized"] is True
+for key in ("risk_mix", "risk_drivers", "top_risks", "cohorts"):
+    assert default[key] == same[key], key
+profile = strict["scoring_profile"]
+assert profile["specialized"] is False
+assert profile["recency_days"] == [5, 10, 21]
+assert profile["attendance_below"] == [0.85, 0.7]
+assert strict["risk_mix"]["high"] > default["risk_mix"]["high"]
+assert sum(strict["risk_mix"].values()) == default["records"]["valid"]
+PY
+./cohort-health-sentinel --input "$gen_a" --as-of 2026-03-01 --limit 20 --scenarios data/scenarios-example.conf \
+  --json "$profile_dir/scenarios.json" --alert-csv "$profile_dir/scenarios.a.csv" > "$profile_dir/scenarios.txt"
+./cohort-health-sentinel --input "$gen_a" --as-of 2026-03-01 --limit 20 --alert-threshold 0.20 --min-cohort-size 3 \
+  --json "$profile_dir/tight.json" > /dev/null
+./cohort-health-sentinel --input "$gen_a" --as-of 2026-03-01 --limit 5 --alert-threshold 0.40 \
+  --scoring-profile data/scoring-profile-strict.conf --json "$profile_dir/strict-alerts.json" \
+  --alert-csv "$profile_dir/strict.a.csv" > /dev/null
+test "$(grep -c '^Scenario: ' "$profile_dir/scenarios.txt")" -eq 3
+grep '^strict-profile,' "$profile_dir/scenarios.a.csv" | cut -d, -f2- > "$profile_dir/strict-from-scenarios.a.csv"
+tail -n +2 "$profile_dir/strict.a.csv" | cmp -s - "$profile_dir/strict-from-scenarios.a.csv"
+if ./cohort-health-sentinel --input "$gen_a" --scenarios data/scenarios-example.conf --stream > /dev/null 2>&1; then
+  echo "Expected --scenarios with --stream to fail." >&2
+  exit 1
+fi
+python3 - "$profile_dir" <<'PY'
+import json
+import os
+import sys
+
+def load(name):
+    with open(os.path.join(sys.argv[1], name), "r", encoding="utf-8") as fh:
+        return json.load(fh)
+
+scenarios = load("scenarios.json")["scenarios"]
+assert [s["scenario"] for s in scenarios] == ["baseline", "tight-alerts", "strict-profile"]
+for scenario, single in zip(scenarios[1:], (load("tight.json"), load("strict-alerts.json"))):
+    del scenario["scenario"]
+    assert scenario == single, [key for key in single if scenario.get(key) != single[key]]
+PY
+state_dir="$profile_dir/state"
+mkdir -p "$state_dir"
+python3 - "$gen_a" "$state_dir" <<'PY'
+import os
+import random
+import sys
+
+random.seed(4)
+with open(sys.argv[1], "r", encoding="utf-8") as fh:
+    header, *rows = fh.read().splitlines()
+full, delta = [], []
+for row in rows:
+    fields = row.split(",")
+    roll = random.random()
+    if roll < 0.03:
+        continue
+    if roll < 0.10 and len(fields) == 6:
+        fields[2] = "2026-02-%02d" % random.randint(1, 28)
+        fields[3] = str(random.randint(0, 8))
+        row = ",".join(fields)
+        delta.append(row)
+    full.append(row)
+for name, body in (("full.csv", full), ("delta.csv", delta)):
+    with open(os.path.join(sys.argv[2], name), "w", encoding="utf-8") as fh:
+        fh.write("\n".join([header] + body) + "\n")
+PY
+./cohort-health-sentinel --input "$gen_a" --as-of 2026-03-01 --state "$state_dir/state.bin" > /dev/null
+cp "$state_dir/state.bin" "$state_dir/delta.bin"
+./cohort-health-sentinel --input "$state_dir/full.csv" --as-of 2026-03-09 --json "$state_dir/fresh.json" > "$state_dir/fresh.txt"
+./cohort-health-sentinel --input "$state_dir/full.csv" --as-of 2026-03-09 --state "$state_dir/state.bin" \
+  --json "$state_dir/incremental.json" --stats-json "$state_dir/stats.json" > "$state_dir/incremental.txt"
+cmp -s "$state_dir/fresh.json" "$state_dir/incremental.json"
+cmp -s "$state_dir/fresh.txt" "$state_dir/incremental.txt"
+./cohort-health-sentinel --input "$state_dir/full.csv" --as-of 2026-03-09 --state "$state_dir/state.bin" \
+  --json "$state_dir/rerun.json" --stats-json "$state_dir/rerun-stats.json" > /dev/null
+cmp -s "$state_dir/fresh.json" "$state_dir/rerun.json"
+./cohort-health-sentinel --input "$state_dir/delta.csv" --as-of 2026-03-01 --state "$state_dir/delta.bin" --state-delta \
+  --json "$state_dir/delta.json" > /dev/null
+python3 - "$state_dir" "$gen_a" <<'PY'
+import json
+import os
+import subprocess
+import sys
+
+def load(name):
+    with open(os.path.join(sys.argv[1], name), "r", encoding="utf-8") as fh:
+        return json.load(fh)
+
+stats = load("stats.json")["state"]
+assert stats["retired"] > 0 and stats["applied"] > 0 and stats["rescored"] > 0, stats
+rerun = load("rerun-stats.json")["state"]
+assert rerun == {"applied": 0, "unchanged": rerun["unchanged"], "retired": 0, "rescored": 0}, rerun
+
+# A delta never retires rows: it matches a full file that kept every row.
+with open(sys.argv[2], "r", encoding="utf-8") as fh:
+    header, *rows = fh.read().splitlines()
+with open(os.path.join(sys.argv[1], "delta.csv"), "r", encoding="utf-8") as fh:
+    changes = fh.read().splitlines()[1:]
+by_id = {row.split(",")[0]: row for row in changes}
+merged = os.path.join(sys.argv[1], "merged.csv")
+with open(merged, "w", encoding="utf-8") as fh:
+    fh.write("\n".join([header] + [by_id.get(row.split(",")[0], row) for row in rows]) + "\n")
+subprocess.run(["./cohort-health-sentinel", "--input", merged, "--as-of", "2026-03-01", "--json",
+                os.path.join(sys.argv[1], "merged.json")], check=True, stdout=subprocess.DEVNULL)
+delta, fresh = load("delta.json"), load("merged.json")
+for key in ("risk_mix", "risk_drivers", "top_risks", "cohorts", "alerts"):
+    assert delta[key] == fresh[key], key
+PY
+cache_file="$profile_dir/columns.cache"
+./cohort-health-sentinel --input "$gen_a" --as-of 2026-03-01 --cache "$cache_file" \
+  --json "$profile_dir/cache-miss.json" > "$profile_dir/cache-miss.txt"
+./cohort-health-sentinel --input "$gen_a" --as-of 2026-03-01 --cache "$cache_file" --stats-json "$profile_dir/cache-stats.json" \
+  --json "$profile_dir/cache-hit.json" > "$profile_dir/cache-hit.txt"
+cmp -s "$gen_json" "$profile_dir/cache-miss.json"
+cmp -s "$gen_json" "$profile_dir/cache-hit.json"
+cmp -s "$profile_dir/cache-miss.txt" "$profile_dir/cache-hit.txt"
+grep -q '"cache": {"hit": true}' "$profile_dir/cache-stats.json"
+./cohort-health-sentinel --input "$gen_a" --as-of 2026-03-01 --cache "$cache_file" \
+  --scoring-profile data/scoring-profile-strict.conf --json "$profile_dir/cache-strict.json" > /dev/null
+cmp -s "$profile_dir/strict.json" "$profile_dir/cache-strict.json"
+head -c 200 "$cache_file" > "$profile_dir/damaged.cache"
+./cohort-health-sentinel --input "$gen_a" --as-of 2026-03-01 --cache "$profile_dir/damaged.cache" \
+  --json "$profile_dir/cache-damaged.json" > /dev/null 2>&1
+cmp -s "$gen_json" "$profile_dir/cache-damaged.json"
+if cat "$gen_a" | ./cohort-health-sentinel --input - --cache "$cache_file" > /dev/null 2>&1; then
+  echo "Expected --cache to reject stdin input" >&2
+  exit 1
+fi
+serve_csv="$profile_dir/serve.csv"
+cp "$gen_a" "$serve_csv"
+./cohort-health-sentinel --input "$serve_csv" --as-of 2026-03-01 --serve "$profile_dir/sock" 2> "$profile_dir/serve.log" &
+serve_pid=$!
+trap 'kill "$serve_pid" 2> /dev/null || true' EXIT
+python3 - "$profile_dir" "$gen_json" "$serve_pid" <<'PY'
+import os
+import signal
+import socket
+import subprocess
+import sys
+import time
+
+root, fresh_json, pid = sys.argv[1], sys.argv[2], int(sys.argv[3])
+sock, csv = os.path.join(root, "sock"), os.path.join(root, "serve.csv")
+
+def ask(query):
+    client = socket.socket(socket.AF_UNIX)
+    client.connect(sock)
+    client.sendall((query + "\n").encode())
+    client.shutdown(socket.SHUT_WR)
+    chunks = []
+    while True:
+        chunk = client.recv(65536)
+        if not chunk:
+            break
+        chunks.append(chunk)
+    client.close()
+    return b"".join(chunks).decode()
+
+def cli(*args):
+    out = os.path.join(root, "serve-expected.json")
+    subprocess.run(["./cohort-health-sentinel", "--input", csv, "--as-of", "2026-03-01", "--json", out, *args],
+                   check=True, stdout=subprocess.DEVNULL)
+    with open(out, "r", encoding="utf-8") as fh:
+        return fh.read()
+
+deadline = time.time() + 10
+while not os.path.exists(sock) and time.time() < deadline:
+    time.sleep(0.05)
+with open(fresh_json, "r", encoding="utf-8") as fh:
+    assert ask("") == fh.read()
+query = "cohort=Cohort-00003, Cohort-00007&cohort_sort=name&limit=3&alert_threshold=0.1&min_cohort_size=2"
+assert ask(query) == cli("--cohort", "Cohort-00003, Cohort-00007", "--cohort-sort", "name", "--limit", "3",
+                         "--alert-threshold", "0.1", "--min-cohort-size", "2")
+assert ask("nope=1") == '{"error": "invalid query"}\n'
+
+# Replace the input atomically and ask for a reload.
+before = ask("")
+with open(csv, "r", encoding="utf-8") as fh:
+    lines = fh.read().splitlines()
+with open(csv + ".tmp", "w", encoding="utf-8") as fh:
+    fh.write("\n".join(lines[:3000]) + "\n")
+os.rename(csv + ".tmp", csv)
+os.kill(pid, signal.SIGHUP)
+deadline = time.time() + 10
+while ask("") == before and time.time() < deadline:
+    time.sleep(0.05)
+assert ask("") == cli()
+PY
+kill "$serve_pid"
+wait "$serve_pid"
+trap - EXIT
+test ! -e "$profile_dir/sock"
+rm -rf "$profile_dir" "$gen_a" "$gen_json"
+
+escape_dir=$(mktemp -d)
+printf '%s\n' 'scholar_id,cohort,last_touchpoint_date,touchpoints_last_30d,attendance_rate,satisfaction_score' \
+  'S-"1"\x,Quote "A"\B,2024-01-01,0,0.40,1.5' 'S-2,Plain,2024-01-01,0,0.40,1.5' > "$escape_dir/in.csv"
+./cohort-health-sentinel --input "$escape_dir/in.csv" --as-of 2024-03-01 --alert-threshold 0 \
+  --json "$escape_dir/out.json" --cohort-csv "$escape_dir/cohorts.csv" > /dev/null
+python3 - "$escape_dir" <<'PY'
+import csv
+import json
+import sys
+
+base = sys.argv[1]
+with open(base + "/out.json", "r", encoding="utf-8") as fh:
+    payload = json.load(fh)
+assert 'Quote "A"\\B' in [c["cohort"] for c in payload["cohorts"]]
+assert 'S-"1"\\x' in [r["id"] for r in payload["top_risks"]]
+with open(base + "/cohorts.csv", newline="", encoding="utf-8") as fh:
+    assert 'Quote "A"\\B' in [row["cohort"] for row in csv.DictReader(fh)]
+PY
+rm -rf "$escape_dir"
+
+multi_dir=$(mktemp -d)
+head -n 6 data/sample.csv > "$multi_dir/campus_a.csv"
+{ head -n 1 data/sample.csv; tail -n +7 data/sample.csv; echo 'S-9,North-2025,bad-date,1,0.50,3.0'; } > "$multi_dir/campus_b.csv"
+{ cat data/sample.csv; echo 'S-9,North-2025,bad-date,1,0.50,3.0'; } > "$multi_dir/all.csv"
+printf '%s\n' '# one export per campus' 'campus_a.csv' '' 'campus_b.csv' > "$multi_dir/list.txt"
+./cohort-health-sentinel --input "$multi_dir/all.csv" --as-of 2026-03-05 --json "$multi_dir/all.json" > /dev/null
+./cohort-health-sentinel --input "$multi_dir/campus_*.csv" --as-of 2026-03-05 --json "$multi_dir/glob.json" > /dev/null
+./cohort-health-sentinel --input-list "$multi_dir/list.txt" --as-of 2026-03-05 --threads 2 \
+  --json "$multi_dir/list.json" > /dev/null
+python3 - "$multi_dir" <<'PY'
+import json
+import sys
+
+base = sys.argv[1]
+with open(base + "/all.json", "r", encoding="utf-8") as fh:
+    whole = json.load(fh)
+for name in ("glob", "list"):
+    with open(f"{base}/{name}.json", "r", encoding="utf-8") as fh:
+        merged = json.load(fh)
+    inputs = merged.pop("inputs")
+    assert merged == whole, f"{name}: merged report differs from the concatenated input"
+    assert [i["path"].rsplit("/", 1)[-1] for i in inputs] == ["campus_a.csv", "campus_b.csv"]
+    assert [(i["rows"], i["valid"], i["invalid"]) for i in inputs] == [(5, 5, 0), (6, 5, 1)], inputs
+PY
+if ./cohort-health-sentinel --input "$multi_dir/none_*.csv" > /dev/null 2>&1; then
+  echo "Expected a glob without matches to fail." >&2
+  exit 1
+fi
+rm -rf "$multi_dir"
+
+gz_dir=$(mktemp -d)
+gzip -c data/sample.csv > "$gz_dir/sample.csv.gz"
+if ./cohort-health-sentinel --input "$gz_dir/sample.csv.gz" > /dev/null 2>&1; then
+  echo "Expected gzip input to fail in a build without -DSENTINEL_ZLIB." >&2
+  exit 1
+fi
+if printf '#include <zlib.h>\n' | cc -E - > /dev/null 2>&1; then
+  cc -std=c11 -O2 -pthread -DSENTINEL_ZLIB -o "$gz_dir/sentinel-z" src/main.c src/sentinel.c -lz
+  "$gz_dir/sentinel-z" --input data/sample.csv --as-of 2026-03-05 > "$gz_dir/plain.txt"
+  "$gz_dir/sentinel-z" --input "$gz_dir/sample.csv.gz" --as-of 2026-03-05 | cmp - "$gz_dir/plain.txt"
+  # Concatenated members, read from a pipe.
+  { head -n 4 data/sample.csv | gzip -c; tail -n +5 data/sample.csv | gzip -c; } > "$gz_dir/parts.gz"
+  "$gz_dir/sentinel-z" --input - --as-of 2026-03-05 --stream < "$gz_dir/parts.gz" | cmp - "$gz_dir/plain.txt"
+  head -c 40 "$gz_dir/sample.csv.gz" > "$gz_dir/short.gz"
+  if "$gz_dir/sentinel-z" --input "$gz_dir/short.gz" > /dev/null 2>&1; then
+    echo "Expected a truncated gzip input to fail." >&2
+    exit 1
+  fi
+fi
+rm -rf "$gz_dir"
+
+dedupe_dir=$(mktemp -d)
+printf '%s\n' 'scholar_id,cohort,last_touchpoint_date,touchpoints_last_30d,attendance_rate,satisfaction_score' \
+  'S-1,Alpha,2026-02-01,1,0.70,3.5' \
+  'S-2,Alpha,2026-01-15,0,0.50,2.5' \
+  'S-1,Beta,2026-02-20,2,0.90,4.5' \
+  'S-1,Gamma,2026-01-10,0,0.40,2.0' \
+  'S-2,Beta,2026-01-15,1,0.60,3.0' \
+  'S-3,Gamma,not-a-date,1,0.60,3.0' > "$dedupe_dir/dupes.csv"
+for mode in first last latest-touchpoint; do
+  for flags in "" "--stream" "--threads 2"; do
+    ./cohort-health-sentinel --input "$dedupe_dir/dupes.csv" --as-of 2026-03-05 --dedupe "$mode" $flags \
+      --json "$dedupe_dir/$mode.json" > /dev/null
+    python3 - "$dedupe_dir/$mode.json" "$mode" <<'PY'
+import json
+import sys
+report = json.load(open(sys.argv[1]))
+expected = {"first": {"Alpha": 2}, "last": {"Beta": 1, "Gamma": 1}, "latest-touchpoint": {"Beta": 2}}[sys.argv[2]]
+assert {c["cohort"]: c["count"] for c in report["cohorts"]} == expected, report["cohorts"]
+assert report["dedupe"] == {"mode": sys.argv[2], "duplicates": 3}, report["dedupe"]
+assert report["records"] == {"valid": 2, "invalid": 1}, report["records"]
+PY
+  done
+done
+./cohort-health-sentinel --input - --as-of 2026-03-05 --dedupe first --stream < "$dedupe_dir/dupes.csv" \
+  | grep "^Duplicates collapsed: 3 (--dedupe first)$" > /dev/null
+if ./cohort-health-sentinel --input - --dedupe last --stream < "$dedupe_dir/dupes.csv" > /dev/null 2>&1; then
+  echo "Expected --dedupe last over stdin with --stream to fail." >&2
+  exit 1
+fi
+rm -rf "$dedupe_dir"
+
+long_dir=$(mktemp -d)
+python3 - "$long_dir/long.csv" <<'PY'
+import sys
+header = "scholar_id,cohort,last_touchpoint_date,touchpoints_last_30d,attendance_rate,satisfaction_score\n"
+prefix = "C" * 63
+rows = [
+    ("S" * 100, prefix + "-north-region"),
+    ("T" * 100, prefix + "-south-region"),
+    ("U" * 80, prefix + "-north-region"),
+]
+with open(sys.argv[1], "w") as out:
+    out.write(header)
+    for scholar, cohort in rows:
+        out.write(f"{scholar},{cohort},2025-12-01,0,0.40,2.0\n")
+PY
+for mode in "" "--stream"; do
+  ./cohort-health-sentinel --input "$long_dir/long.csv" --as-of 2026-03-05 --json "$long_dir/out.json" $mode > /dev/null
+  python3 - "$long_dir/out.json" <<'PY'
+import json
+import sys
+report = json.load(open(sys.argv[1]))
+prefix = "C" * 63
+assert sorted(c["cohort"] for c in report["cohorts"]) == [prefix + "-north-region", prefix + "-south-region"], report["cohorts"]
+assert sorted(r["id"] for r in report["top_risks"]) == ["S" * 100, "T" * 100, "U" * 80], report["top_risks"]
+assert all(r["cohort"].startswith(prefix + "-") and len(r["cohort"]) == 76 for r in report["top_risks"])
+PY
+done
+rm -rf "$long_dir"
+
+pct_dir=$(mktemp -d)
+python3 - "$pct_dir/rows.csv" <<'PY'
+import random
+import sys
+rng = random.Random(25)
+with open(sys.argv[1], "w", encoding="utf-8") as fh:
+    fh.write("scholar_id,cohort,last_touchpoint_date,touchpoints_last_30d,attendance_rate,satisfaction_score\n")
+    for i in range(3000):
+        fh.write(f"S-{i},C-{i % 3},2025-{rng.randint(1, 12):02d}-{rng.randint(1, 28):02d},{rng.randint(0, 300)},"
+                 f"{rng.random():.3f},{rng.uniform(1, 5):.2f}\n")
+PY
+for flags in "" "--stream" "--threads 2"; do
+  ./cohort-health-sentinel --input "$pct_dir/rows.csv" --as-of 2026-03-05 --percentiles $flags \
+    --json "$pct_dir/out.json" --cohort-csv "$pct_dir/out$flags.csv" > /dev/null
+  cmp "$pct_dir/out.csv" "$pct_dir/out$flags.csv"
+done
+python3 - "$pct_dir" <<'PY'
+import csv
+import datetime
+import json
+import sys
+root = sys.argv[1]
+values = {}
+with open(root + "/rows.csv", encoding="utf-8") as fh:
+    for row in csv.DictReader(fh):
+        days = (datetime.date(2026, 3, 5) - datetime.date.fromisoformat(row["last_touchpoint_date"])).days
+        metrics = values.setdefault(row["cohort"], {"attendance": [], "satisfaction": [], "touchpoints_30d": [], "days_since": []})
+        metrics["attendance"].append(float(row["attendance_rate"]))
+        metrics["satisfaction"].append(float(row["satisfaction_score"]))
+        metrics["touchpoints_30d"].append(int(row["touchpoints_last_30d"]))
+        metrics["days_since"].append(days)
+report = json.load(open(root + "/out.json"))
+for cohort in report["cohorts"]:
+    for name, xs in values[cohort["cohort"]].items():
+        xs.sort()
+        for p in (10, 50, 90):
+            exact = xs[(len(xs) - 1) * p // 100]
+            slack = 0.5 if name in ("touchpoints_30d", "days_since") else 0.005
+            assert abs(cohort[f"{name}_p{p}"] - exact) <= exact / 129 + slack, (cohort, name, p, exact)
+    assert cohort["touchpoints_30d_p10"] == sorted(values[cohort["cohort"]]["touchpoints_30d"])[99]
+header = open(root + "/out.csv", encoding="utf-8").readline().strip().split(",")
+assert header[11:14] == ["attendance_p10", "attendance_p50", "attendance_p90"], header
+PY
+rm -rf "$pct_dir"
+
+trend_dir=$(mktemp -d)
+python3 - "$trend_dir" <<'PY'
+import datetime
+import sys
+root = sys.argv[1]
+header = "scholar_id,cohort,last_touchpoint_date,touchpoints_last_30d,attendance_rate,satisfaction_score"
+dated = open(root + "/dated.csv", "w", encoding="utf-8")
+dated.write(header + ",snapshot_date\n")
+for week, rising in enumerate((4, 8, 12)):
+    day = datetime.date(2026, 1, 5) + datetime.timedelta(weeks=week)
+    with open(f"{root}/export-{day}.csv", "w", encoding="utf-8") as fh:
+        fh.write(header + "\n")
+        for i in range(40):
+            cohort = "Rising" if i < 20 else "Steady"
+            high = i % 20 < (rising if cohort == "Rising" else 6)
+            last = day - datetime.timedelta(days=120 if high else 5)
+            row = f"S-{i},{cohort},{last},{0 if high else 10},{0.1 if high else 0.95},{1.0 if high else 5.0}"
+            fh.write(row + "\n")
+            dated.write(f"{row},{day}\n")
+dated.write("S-99,Steady,2026-01-01,3,0.5,3.0,not-a-date\n")
+dated.close()
+PY
+./cohort-health-sentinel --trend --input "$trend_dir/export-*.csv" --threads 2 --min-cohort-size 5 \
+  --json "$trend_dir/files.json" --cohort-csv "$trend_dir/files.csv" --alert-csv "$trend_dir/files.alerts.csv" > /dev/null
+./cohort-health-sentinel --trend --input "$trend_dir/dated.csv" --min-cohort-size 5 \
+  --json "$trend_dir/dated.json" --cohort-csv "$trend_dir/dated.csv.out" --alert-csv "$trend_dir/dated.alerts.csv" > /dev/null
+cmp "$trend_dir/files.csv" "$trend_dir/dated.csv.out"
+cmp "$trend_dir/files.alerts.csv" "$trend_dir/dated.alerts.csv"
+python3 - "$trend_dir" <<'PY'
+import csv
+import json
+import sys
+root = sys.argv[1]
+report = json.load(open(root + "/dated.json"))
+assert report["trend"]["snapshots"] == 3 and report["trend"]["undated_rows"] == 1, report["trend"]
+assert [s["date"] for s in report["snapshots"]] == ["2026-01-05", "2026-01-12", "2026-01-19"]
+rising = next(c for c in report["cohorts"] if c["cohort"] == "Rising")
+assert [p["high_share"] for p in rising["series"]] == [0.2, 0.4, 0.6], rising
+alerts = list(csv.DictReader(open(root + "/files.alerts.csv", encoding="utf-8")))
+assert [(a["cohort"], a["high_share_change"]) for a in alerts] == [("Rising", "0.20")], alerts
+PY
+cp "$trend_dir/export-2026-01-05.csv" "$trend_dir/undated.csv"
+if ./cohort-health-sentinel --trend --input "$trend_dir/undated.csv" --input "$trend_dir/export-2026-01-12.csv" > /dev/null 2>&1; then
+  echo "Expected --trend to reject file names without a snapshot date." >&2
+  exit 1
+fi
+if ./cohort-health-sentinel --trend --input "$trend_dir/dated.csv" --as-of 2026-03-05 > /dev/null 2>&1; then
+  echo "Expected --trend to reject --as-of." >&2
+  exit 1
+fi
+rm -rf "$trend_dir"
+
+watch_dir=$(mktemp -d)
+header="scholar_id,cohort,last_touchpoint_date,touchpoints_last_30d,attendance_rate,satisfaction_score"
+{
+  echo "$header"
+  for i in 1 2 3 4 5 6; do echo "S-$i,Steady,2026-03-01,10,0.95,5.0"; done
+} > "$watch_dir/rows.csv"
+./cohort-health-sentinel --watch --input "$watch_dir/rows.csv" --as-of 2026-03-05 --json "$watch_dir/watch.json" \
+  --alert-csv "$watch_dir/watch.alerts.csv" > "$watch_dir/watch.txt" 2> /dev/null &
+watch_pid=$!
+for _ in $(seq 1 50); do
+  [ -f "$watch_dir/watch.alerts.csv" ] && break
+  sleep 0.1
+done
+for i in 1 2 3 4 5; do echo "R-$i,Rising,2025-10-01,0,0.1,1.0"; done >> "$watch_dir/rows.csv"
+printf 'R-6,Rising,2025-10-' >> "$watch_dir/rows.csv"
+for _ in $(seq 1 50); do
+  grep -q '^Rising,' "$watch_dir/watch.alerts.csv" && break
+  sleep 0.1
+done
+printf '01,0,0.1,1.0\n' >> "$watch_dir/rows.csv"
+kill -TERM "$watch_pid"
+wait "$watch_pid"
+./cohort-health-sentinel --input "$watch_dir/rows.csv" --as-of 2026-03-05 --json "$watch_dir/run.json" \
+  --alert-csv "$watch_dir/run.alerts.csv" > /dev/null
+cmp "$watch_dir/watch.json" "$watch_dir/run.json"
+cmp "$watch_dir/watch.alerts.csv" "$watch_dir/run.alerts.csv"
+[ "$(grep -c '^Group Scholar Cohort Health Sentinel$' "$watch_dir/watch.txt")" = 3 ]
+if ./cohort-health-sentinel --watch --input data/sample.csv --threads 2 > /dev/null 2>&1; then
+  echo "Expected --watch to reject --threads." >&2
+  exit 1
+fi
+rm -rf "$watch_dir"
+
+rollup_dir=$(mktemp -d)
+python3 - "$rollup_dir/rows.csv" <<'PY'
+import random
+import sys
+rng = random.Random(28)
+with open(sys.argv[1], "w", encoding="utf-8") as fh:
+    fh.write("scholar_id,cohort,last_touchpoint_date,touchpoints_last_30d,attendance_rate,satisfaction_score\n")
+    for i in range(2000):
+        path = [rng.choice(["North", "South"]), rng.choice(["C1", "C2"]), rng.choice(["S1", "S2"])]
+        fh.write(f"S-{i},{'/'.join(path[:rng.choice([1, 2, 3, 3])])},2026-0{rng.randint(1, 2)}-{rng.randint(10, 28)},"
+                 f"{rng.randint(0, 5)},{rng.random():.2f},{rng.uniform(1, 5):.1f}\n")
+PY
+for flags in "" "--stream" "--threads 2"; do
+  ./cohort-health-sentinel --input "$rollup_dir/rows.csv" --as-of 2026-03-05 --rollup-separator / $flags \
+    --cohort-csv "$rollup_dir/cohorts$flags.csv" > /dev/null
+  cmp "$rollup_dir/cohorts.csv" "$rollup_dir/cohorts$flags.csv"
+done
+./cohort-health-sentinel --input "$rollup_dir/rows.csv" --as-of 2026-03-05 --rollup-separator / --cohort North/C1,South \
+  --cohort-limit 2 --json "$rollup_dir/filtered.json" > /dev/null
+python3 - "$rollup_dir" <<'PY'
+import collections
+import csv
+import json
+import sys
+root = sys.argv[1]
+counts = collections.Counter()
+for row in csv.DictReader(open(root + "/rows.csv", encoding="utf-8")):
+    parts = row["cohort"].split("/")
+    for depth in range(1, len(parts) + 1):
+        counts["/".join(parts[:depth])] += 1
+rows = list(csv.DictReader(open(root + "/cohorts.csv", encoding="utf-8")))
+assert {r["cohort"]: int(r["count"]) for r in rows} == dict(counts)
+levels = [r["cohort"].count("/") + 1 for r in rows]
+assert levels == sorted(levels), levels
+report = json.load(open(root + "/filtered.json"))
+kept = [(c["level"], c["cohort"]) for c in report["cohorts"]]
+assert [level for level, _ in kept] == [1, 2, 2, 3, 3], kept
+assert (1, "North") not in kept and (2, "North/C1") in kept, kept
+assert report["records"]["valid"] == counts["North/C1"] + counts["South"], report["records"]
+PY
+if ./cohort-health-sentinel --input data/sample.csv --rollup-separator ab > /dev/null 2>&1; then
+  echo "Expected --rollup-separator to take one character." >&2
+  exit 1
+fi
+rm -rf "$rollup_dir"
+
+engine_dir=$(mktemp -d)
+cc -std=c11 -O2 -pthread -Wall -Werror -fPIC -shared -o "$engine_dir/libsentinel.so" src/sentinel.c
+python3 - "$engine_dir/rows.csv" <<'PY'
+import random
+import sys
+rng = random.Random(29)
+lines = ["scholar_id,cohort,last_touchpoint_date,touchpoints_last_30d,attendance_rate,satisfaction_score"]
+for i in range(3000):
+    cohort = "/".join([rng.choice(["North", "South", "West"]), rng.choice(["C1", "C2"])][:rng.choice([1, 2])])
+    lines.append(f"S-{i % 2500},{cohort},2026-0{rng.randint(1, 4)}-{rng.randint(10, 28)},{rng.randint(0, 5)},"
+                 f"{rng.random():.2f},{rng.uniform(1, 5):.1f}")
+lines[7] = "S-7,North,2026/02/03,1,0.5,3.0"
+lines[8] = "S-8,North,2026-02-03,x,0.5,3.0"
+lines[9] = "S-9,North,2026-02-03,1,1.5,3.0"
+lines[10] = "S-10,North"
+with open(sys.argv[1], "w", encoding="utf-8") as fh:
+    fh.write("\n".join(lines))
+PY
+./cohort-health-sentinel --input "$engine_dir/rows.csv" --as-of 2026-03-05 --limit 5 --cohort-sort high --percentiles \
+  --min-cohort-size 50 --alert-threshold 0.2 --json "$engine_dir/flat.json" > /dev/null
+./cohort-health-sentinel --input "$engine_dir/rows.csv" --as-of 2026-03-05 --rollup-separator / --cohort North,West/C1 \
+  --cohort-limit 2 --clamp-ranges --json "$engine_dir/rollup.json" > /dev/null
+SENTINEL_LIB="$engine_dir/libsentinel.so" python3 -B - "$engine_dir" <<'PY'
+import argparse
+import contextlib
+import csv
+import io
+import json
+import os
+import sys
+import threading
+import types
+sys.path.insert(0, "scripts")
+from sentinel_engine import Engine
+
+root = sys.argv[1]
+
+def decimals(key):
+    if key == "avg_days_since":
+        return 1
+    return 0 if key.startswith(("touchpoints_30d_p", "days_since_p")) else 2
+
+def same(ours, json_value, key=""):
+    if isinstance(json_value, dict):
+        return all(same(ours[k], v, k) for k, v in json_value.items())
+    if isinstance(json_value, list):
+        return len(ours) == len(json_value) and all(same(a, b, key) for a, b in zip(ours, json_value))
+    if isinstance(ours, float):
+        return f"{ours:.{decimals(key)}f}" == f"{json_value:.{decimals(key)}f}"
+    return ours == json_value
+
+def check(engine, path):
+    report = engine.report()
+    expected = json.load(open(path, encoding="utf-8"))
+    for key, value in report.items():
+        assert same(value, expected[key], key), (path, key, value, expected[key])
+    return report
+
+flat = dict(as_of="2026-03-05", limit=5, cohort_sort="high", percentiles=True, min_cohort_size=50, alert_threshold=0.2)
+rollup = dict(as_of="2026-03-05", rollup_separator="/", cohort="North,West/C1", cohort_limit=2, clamp_ranges=True)
+data = open(root + "/rows.csv", "rb").read()
+for options, path in ((flat, "/flat.json"), (rollup, "/rollup.json")):
+    with Engine(**options) as whole, Engine(**options) as chunked, Engine(**options) as rows:
+        whole.feed(data)
+        for at in range(0, len(data), 997):
+            chunked.feed(data[at:at + 997])
+        rows.feed_rows(list(csv.reader(open(root + "/rows.csv", encoding="utf-8")))[1:])
+        reports = [check(engine, root + path) for engine in (whole, chunked, rows)]
+    assert reports[0] == reports[1] == reports[2]
+    clamped = int(options.get("clamp_ranges", False))
+    assert list(reports[0]["invalid_breakdown"].values()) == [1, 1, 1, 1 - clamped], reports[0]["invalid_breakdown"]
+    assert reports[0]["clamped_values"] == clamped, reports[0]["clamped_values"]
+
+# Handles are independent: two sort orders scored side by side on threads.
+engines = [Engine(as_of="2026-03-05", cohort_sort=mode) for mode in ("name", "risk")]
+threads = [threading.Thread(target=engine.feed, args=(data,)) for engine in engines]
+for thread in threads:
+    thread.start()
+for thread in threads:
+    thread.join()
+names, risks = ([c["cohort"] for c in engine.report()["cohorts"]] for engine in engines)
+assert names == sorted(names) and sorted(risks) == names and risks != names, (names, risks)
+for engine in engines:
+    engine.close()
+# db_sync.py --input builds its payload through the engine and COPYs it into
+# the migrated tables; the stub connection records what it would send.
+class Query(str):
+    def format(self, *args):
+        return Query(str.format(self, *args))
+
+    def join(self, items):
+        return Query(str.join(self, items))
+
+    def as_string(self, conn):
+        return str(self)
+
+class Cursor:
+    def __init__(self, log):
+        self.log = log
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        return False
+
+    def execute(self, query, params=None):
+        self.log.append(str(query).split(" (")[0].strip())
+
+    def fetchone(self):
+        return {"SELECT to": ("t",), "SELECT CO": (3,)}.get(self.log[-1][:9], ("report-1",))
+
+    def copy(self, statement):
+        self.log.append(str(statement).split(" (")[0])
+        return self
+
+    def write_row(self, row):
+        self.log.append(row)
+
+class Connection:
+    def __init__(self, **params):
+        self.log = sent
+
+    def transaction(self):
+        return Cursor(self.log)
+
+    def cursor(self):
+        return Cursor(self.log)
+
+    def close(self):
+        pass
+
+sent = []
+psycopg = types.ModuleType("psycopg")
+psycopg.sql = types.SimpleNamespace(SQL=Query, Identifier=lambda name: Query(f'"{name}"'))
+psycopg.connect = Connection
+sys.modules["psycopg"] = psycopg
+import db_sync
+args = argparse.Namespace(input=root + "/rows.csv", as_of="2026-03-05", cohort=None, scoring_profile=None, limit=5,
+                          alert_threshold=0.2, min_cohort_size=50, clamp_ranges=False)
+payload = db_sync.score_input(args)
+assert same(payload["top_risks"], json.load(open(root + "/flat.json", encoding="utf-8"))["top_risks"])
+os.environ.update(PGHOST="db", PGPORT="5432", PGUSER="u", PGPASSWORD="p", PGDATABASE="d")
+sys.argv = ["db_sync.py", "--json", root + "/flat.json"]
+with contextlib.redirect_stdout(io.StringIO()) as out:
+    db_sync.main()
+assert out.getvalue() == "Synced report report-1 into schema 'cohort_health_sentinel'.\n", out.getvalue()
+tables = [entry for entry in sent if isinstance(entry, str) and entry.startswith(("INSERT", "COPY"))]
+assert tables == ['INSERT INTO "cohort_health_sentinel".reports', 'COPY "cohort_health_sentinel"."top_risks"',
+                  'COPY "cohort_health_sentinel"."cohort_summaries"', 'COPY "cohort_health_sentinel"."alerts"'], tables
+rows = [entry for entry in sent if isinstance(entry, tuple)]
+flat_json = json.load(open(root + "/flat.json", encoding="utf-8"))
+assert len(rows) == sum(len(flat_json[key]) for key in ("top_risks", "cohorts", "alerts")), len(rows)
+assert all(row[0] == "report-1" for row in rows)
+try:
+    Engine(cohort_sort="size")
+except ValueError as exc:
+    assert "cohort_sort" in str(exc)
+else:
+    raise AssertionError("expected an invalid cohort_sort to be rejected")
+PY
+rm -rf "$engine_dir"
+
+big_dir=$(mktemp -d)
+python3 - "$big_dir/rows.csv" <<'PY'
+import random
+import sys
+rng = random.Random(30)
+with open(sys.argv[1], "w", encoding="utf-8") as fh:
+    fh.write("scholar_id,cohort,last_touchpoint_date,touchpoints_last_30d,attendance_rate,satisfaction_score\n")
+    for i in range(80000):
+        fh.write(f"S-{rng.randint(0, 60000)},C{i % 70000},2026-0{rng.randint(1, 2)}-{rng.randint(10, 28)},"
+                 f"{rng.randint(0, 5)},{rng.random():.2f},{rng.uniform(1, 5):.1f}\n")
+PY
+for mode in risk name; do
+  for threads in 3 4; do
+    ./cohort-health-sentinel --input "$big_dir/rows.csv" --as-of 2026-03-05 --limit 100000 --cohort-sort $mode \
+      --threads $threads --json "$big_dir/$mode$threads.json" --cohort-csv "$big_dir/$mode$threads.csv" \
+      > "$big_dir/$mode$threads.txt"
+  done
+  cmp "$big_dir/${mode}3.json" "$big_dir/${mode}4.json"
+  cmp "$big_dir/${mode}3.csv" "$big_dir/${mode}4.csv"
+  cmp "$big_dir/${mode}3.txt" "$big_dir/${mode}4.txt"
+done
+python3 - "$big_dir" <<'PY'
+import csv
+import json
+import sys
+root = sys.argv[1]
+for mode in ("risk", "name"):
+    report = json.load(open(f"{root}/{mode}4.json", encoding="utf-8"))
+    risks = report["top_risks"]
+    assert len(risks) == report["records"]["valid"] == 80000, len(risks)
+    keys = [(-r["score"], -r["days_since"], r["id"].encode()) for r in risks]
+    assert keys == sorted(keys), mode
+    cohorts = report["cohorts"]
+    assert len(cohorts) == report["cohort_total"] > 65536, len(cohorts)
+    if mode == "name":
+        order = [c["cohort"].encode() for c in cohorts]
+    else:
+        order = [(-c["risk_index"], -c["high_share"]) for c in cohorts]
+    assert order == sorted(order), mode
+    rows = list(csv.DictReader(open(f"{root}/{mode}4.csv", encoding="utf-8")))
+    assert [r["cohort"] for r in rows] == [c["cohort"] for c in cohorts], mode
+    text = open(f"{root}/{mode}4.txt", encoding="utf-8").read().split("\n")
+    start = text.index("ID\tCohort\tScore\tDays\tTouch30\tAttend\tSatisfaction") + 1
+    assert [line.split("\t")[0] for line in text[start:start + len(risks)]] == [r["id"] for r in risks], mode
+PY
+rm -rf "$big_dir"
+
+if ./cohort-health-sentinel --input data/sample.csv --pg-sink "" > /dev/null 2>&1; then
+  echo "Expected --pg-sink to fail in a build without -DSENTINEL_PG." >&2
+  exit 1
+fi
+if command -v pg_config > /dev/null 2>&1 && [ -f "$(pg_config --includedir)/libpq-fe.h" ]; then
+  pg_dir=$(mktemp -d)
+  cc -std=c11 -O2 -pthread -DSENTINEL_PG -I"$(pg_config --includedir)" -o "$pg_dir/sentinel-pg" src/main.c src/sentinel.c -lpq
+  # A stand-in server speaking just enough of the wire protocol: trust
+  # auth, the extended-query pipeline, COPY FROM STDIN and COMMIT.
+  python3 - "$pg_dir" <<'PY' &
+import socket
+import struct
+import sys
+
+base = sys.argv[1]
+server = socket.socket(socket.AF_UNIX)
+server.bind(base + "/.s.PGSQL.5432")
+server.listen(1)
+conn, _ = server.accept()
+log = open(base + "/log", "w")
+
+
+def recv(n):
+    data = b""
+    while len(data) < n:
+        chunk = conn.recv(n - len(data))
+        if not chunk:
+            raise SystemExit(0)
+        data += chunk
+    return data
+
+
+def message():
+    kind = recv(1)
+    return kind, recv(struct.unpack("!I", recv(4))[0] - 4)
+
+
+def send(kind, payload=b""):
+    conn.sendall(kind + struct.pack("!I", len(payload) + 4) + payload)
+
+
+def send_row(value):
+    send(b"D", struct.pack("!HI", 1, len(value)) + value)
+
+
+recv(struct.unpack("!I", recv(4))[0] - 4)
+send(b"R", struct.pack("!I", 0))
+send(b"S", b"client_encoding\0UTF8\0")
+send(b"S", b"server_version\0" + b"15.0\0")
+send(b"K", struct.pack("!II", 1, 2))
+send(b"Z", b"I")
+queries = []
+while True:
+    kind, body = message()
+    if kind == b"X":
+        break
+    if kind == b"P":
+        queries.append(body.split(b"\0")[1].decode())
+        send(b"1")
+    elif kind == b"B":
+        send(b"2")
+    elif kind == b"D":
+        if queries[0].startswith("SELECT") or "RETURNING" in queries[0]:
+            send(b"T", struct.pack("!H", 1) + b"x\0" + struct.pack("!IHIhih", 0, 0, 25, -1, -1, 0))
+        else:
+            send(b"n")
+    elif kind == b"E":
+        query = queries.pop(0)
+        log.write(query.split(" (")[0] + "\n")
+        if query.startswith("SELECT"):
+            send_row(b"3")
+        elif "RETURNING" in query:
+            send_row(b"00000000-0000-0000-0000-000000000001")
+        send(b"C", query.split()[0].encode() + b"\0")
+    elif kind == b"S":
+        send(b"Z", b"T")
+    elif kind == b"Q":
+        query = body[:-1].decode()
+        log.write(query.split(" (")[0] + "\n")
+        if query.startswith("COPY"):
+            send(b"G", struct.pack("!bH", 0, 0))
+            data = b""
+            kind, body = message()
+            while kind == b"d":
+                data += body
+                kind, body = message()
+            log.write(data.decode())
+        send(b"C", query.split()[0].encode() + b"\0")
+        send(b"Z", b"I" if query == "COMMIT" else b"T")
+log.close()
+PY
+  pg_pid=$!
+  for _ in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S "$pg_dir/.s.PGSQL.5432" ] && break
+    sleep 0.2
+  done
+  "$pg_dir/sentinel-pg" --input data/sample.csv --as-of 2026-03-05 --limit 2 --alert-threshold 0.5 --min-cohort-size 1 \
+    --pg-sink "host=$pg_dir dbname=test user=test" > /dev/null
+  wait "$pg_pid"
+  printf '%s\n' 'BEGIN' 'SELECT COALESCE(MAX(version), 0) FROM "cohort_health_sentinel".schema_migrations' \
+    'INSERT INTO "cohort_health_sentinel".reports' 'COPY "cohort_health_sentinel".top_risks' \
+    "$(printf '00000000-0000-0000-0000-000000000001\tS-1008\tWest-2024\t9\t145\t0\t0.58\t2.40')" \
+    "$(printf '00000000-0000-0000-0000-000000000001\tS-1002\tNorth-2025\t9\t85\t0\t0.52\t2.70')" \
+    'COPY "cohort_health_sentinel".cohort_summaries' > "$pg_dir/expected"
+  head -n 7 "$pg_dir/log" | cmp - "$pg_dir/expected"
+  grep -q "$(printf '^00000000-0000-0000-0000-000000000001\tSouth-2025\t0.67\t2.67\t3\t2\t1\t0\t69.0\t0.72\t3.50$')" "$pg_dir/log"
+  tail -n 1 "$pg_dir/log" | grep '^COMMIT$' > /dev/null
+  rm -rf "$pg_dir"
+fi
+
 echo "All tests passed."